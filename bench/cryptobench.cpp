@@ -0,0 +1,418 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of the crypto primitives that ZRTP and SRTP use.
+ *
+ * The program measures the crypto backend the library was built with
+ * (standalone or OpenSSL) and writes a JSON report to stdout or to the
+ * file given with '-o'. Build the library for each backend in its own build
+ * directory and compare the reports.
+ *
+ * Usage: cryptobench [-o file] [-t milliseconds]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER
+#endif
+
+#include <crypto/SrtpSymCrypto.h>
+#include <crypto/hmac.h>
+#include <crypto/sha1.h>
+#include <CryptoContext.h>
+
+#include <common/zrtpAlgorithms.h>
+#include <zrtp/crypto/aesCFB.h>
+#include <zrtp/crypto/sha256.h>
+#include <zrtp/crypto/sha384.h>
+#include <zrtp/crypto/hmac256.h>
+#include <zrtp/crypto/hmac384.h>
+#include <zrtp/crypto/zrtpDH.h>
+#if ZRTP_WITH_TWOFISH
+#include <zrtp/crypto/twoCFB.h>
+#endif
+#if ZRTP_WITH_SKEIN
+#include <zrtp/crypto/skein256.h>
+#include <zrtp/crypto/skein384.h>
+#include <cryptcommon/macSkein.h>
+#include <cryptcommon/skeinApi.h>
+#endif
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpTextData.h>
+
+#if defined(ZRTP_OPENSSL)
+static const char backendName[] = "openssl";
+#else
+static const char backendName[] = "standalone";
+#endif
+
+// Payload sizes typical for SRTP: small control packets, G.711 20ms, video MTU
+static const uint32_t packetSizes[] = {32, 172, 1280};
+
+static std::chrono::milliseconds minRunTime(200);
+
+static uint64_t readCycles() {
+#ifdef HAVE_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Result {
+    std::string name;
+    uint32_t size;
+    double nsPerByte;
+    double cyclesPerByte;
+    double mbPerSecond;
+};
+
+struct PubKeyResult {
+    std::string name;
+    double keygenPerSecond;
+    double agreePerSecond;
+};
+
+static std::vector<Result> results;
+static std::vector<PubKeyResult> pubKeyResults;
+
+/*
+ * Run the function until the minimum run time elapsed, doubling the number
+ * of calls per round to keep the clock overhead low. Returns the number of
+ * calls, the elapsed nanoseconds and cycles.
+ */
+template <typename F>
+static uint64_t runTimed(F func, double* nanos, double* cycles) {
+    uint64_t calls = 0;
+    uint64_t batch = 1;
+
+    func();                     // warm up caches and lazy initializations
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startCycles = readCycles();
+    std::chrono::steady_clock::duration elapsed;
+    do {
+        for (uint64_t i = 0; i < batch; i++)
+            func();
+        calls += batch;
+        batch *= 2;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < minRunTime);
+
+    *cycles = static_cast<double>(readCycles() - startCycles);
+    *nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return calls;
+}
+
+template <typename F>
+static void benchBytes(const char* name, uint32_t size, F func, uint32_t packets = 1) {
+    double nanos, cycles;
+    uint64_t calls = runTimed(func, &nanos, &cycles);
+    double bytes = static_cast<double>(calls) * size * packets;
+
+    Result r;
+    r.name = name;
+    r.size = size;
+    r.nsPerByte = nanos / bytes;
+    r.cyclesPerByte = cycles / bytes;
+    r.mbPerSecond = (bytes / (1024.0 * 1024.0)) / (nanos / 1e9);
+    results.push_back(r);
+    fprintf(stderr, "%-20s %5u bytes: %8.2f ns/byte\n", name, size, r.nsPerByte);
+}
+
+template <typename F>
+static double benchOps(F func) {
+    double nanos, cycles;
+    uint64_t calls = runTimed(func, &nanos, &cycles);
+    return static_cast<double>(calls) / (nanos / 1e9);
+}
+
+static void benchSrtpCipher(const char* ecbName, const char* ctrName, const char* f8Name, const char* f8BatchName,
+                            int cmAlgo, int f8Algo, int32_t keyLength) {
+    uint8_t key[32];
+    uint8_t salt[14];
+    uint8_t iv[16];
+    uint8_t data[1280];
+
+    memset(key, 0x11, sizeof(key));
+    memset(salt, 0x22, sizeof(salt));
+    memset(iv, 0x33, sizeof(iv));
+    memset(data, 0x44, sizeof(data));
+
+    SrtpSymCrypto cmCipher(key, keyLength, cmAlgo);
+    for (uint32_t size : packetSizes) {
+        benchBytes(ecbName, size, [&]() {
+            for (uint32_t i = 0; i + SRTP_BLOCK_SIZE <= size; i += SRTP_BLOCK_SIZE)
+                cmCipher.encrypt(data + i, data + i);
+        });
+        benchBytes(ctrName, size, [&]() { cmCipher.ctr_encrypt(data, size, iv); });
+    }
+
+    SrtpSymCrypto f8Cipher(key, keyLength, f8Algo);
+    SrtpSymCrypto f8IvCipher(f8Algo);
+    f8Cipher.f8_deriveForIV(&f8IvCipher, key, keyLength, salt, sizeof(salt));
+    for (uint32_t size : packetSizes) {
+        benchBytes(f8Name, size, [&]() { f8Cipher.f8_encrypt(data, size, iv, &f8IvCipher); });
+    }
+
+    // Independent packets of one key in lockstep, the same data buffer is fine for timing
+    F8_JOB jobs[SrtpSymCrypto::f8BatchLanes];
+    for (F8_JOB& job : jobs) {
+        job.in = data;
+        job.out = data;
+        memcpy(job.iv, iv, sizeof(iv));
+        job.cipher = &f8Cipher;
+        job.f8Cipher = &f8IvCipher;
+    }
+    for (uint32_t size : packetSizes) {
+        for (F8_JOB& job : jobs)
+            job.length = size;
+        benchBytes(f8BatchName, size, [&]() { SrtpSymCrypto::f8_encryptBatch(jobs, SrtpSymCrypto::f8BatchLanes); },
+                   SrtpSymCrypto::f8BatchLanes);
+    }
+}
+
+// CFB is used for Confirm and SASrelay packets only, thus measure with their sizes
+static void benchCfb() {
+    static const uint32_t cfbSizes[] = {40, 104};
+    uint8_t key[32];
+    uint8_t iv[16];
+    uint8_t data[128];
+
+    memset(key, 0x11, sizeof(key));
+    memset(iv, 0x33, sizeof(iv));
+    memset(data, 0x44, sizeof(data));
+
+    for (uint32_t size : cfbSizes) {
+        benchBytes("AES-128-CFB", size, [&]() { aesCfbEncrypt(key, 16, iv, data, size); });
+        benchBytes("AES-256-CFB", size, [&]() { aesCfbEncrypt(key, 32, iv, data, size); });
+#if ZRTP_WITH_TWOFISH
+        benchBytes("Twofish-128-CFB", size, [&]() { twoCfbEncrypt(key, 16, iv, data, size); });
+        benchBytes("Twofish-256-CFB", size, [&]() { twoCfbEncrypt(key, 32, iv, data, size); });
+#endif
+    }
+}
+
+static void benchHashes() {
+    uint8_t data[1280];
+    uint8_t digest[64];
+    memset(data, 0x55, sizeof(data));
+
+#if ZRTP_WITH_SKEIN
+    SkeinCtx_t skein512;
+    skeinCtxPrepare(&skein512, Skein512);
+#endif
+
+    for (uint32_t size : packetSizes) {
+        benchBytes("SHA-1", size, [&]() {
+            sha1_ctx ctx[1];
+            sha1_begin(ctx);
+            sha1_hash(data, size, ctx);
+            sha1_end(digest, ctx);
+        });
+        benchBytes("SHA-256", size, [&]() { sha256(data, size, digest); });
+        benchBytes("SHA-384", size, [&]() { sha384(data, size, digest); });
+#if ZRTP_WITH_SKEIN
+        benchBytes("Skein-256", size, [&]() { skein256(data, size, digest); });
+        benchBytes("Skein-384", size, [&]() { skein384(data, size, digest); });
+        benchBytes("Skein-512", size, [&]() {
+            skeinInit(&skein512, 512);
+            skeinUpdate(&skein512, data, size);
+            skeinFinal(&skein512, digest);
+        });
+#endif
+    }
+}
+
+static void benchMacs() {
+    uint8_t key[32];
+    uint8_t data[1280];
+    uint8_t mac[64];
+    uint32_t macLength;
+
+    memset(key, 0x66, sizeof(key));
+    memset(data, 0x77, sizeof(data));
+
+    // SRTP keeps the MAC contexts and computes the MAC per packet
+    void* sha1Ctx = createSha1HmacContext(key, 20);
+#if ZRTP_WITH_SKEIN
+    void* skeinCtx = createSkeinMacContext(key, 32, 32, Skein512);
+#endif
+
+    for (uint32_t size : packetSizes) {
+        // Same call as SRTP: packet and ROC as data chunks
+        uint8_t roc[4] = {0};
+        ZrtpVector<const uint8_t*> chunks = {data, roc};
+        ZrtpVector<uint64_t> chunkLength = {size - sizeof(roc), sizeof(roc)};
+
+        benchBytes("HMAC-SHA1-ctx", size, [&]() { hmacSha1Ctx(sha1Ctx, chunks, chunkLength, mac, &macLength); });
+        benchBytes("HMAC-SHA256", size, [&]() { hmac_sha256(key, 32, data, size, mac, &macLength); });
+        benchBytes("HMAC-SHA384", size, [&]() { hmac_sha384(key, 32, data, size, mac, &macLength); });
+#if ZRTP_WITH_SKEIN
+        benchBytes("Skein-MAC-512-ctx", size, [&]() { macSkeinCtx(skeinCtx, data, size, mac); });
+        benchBytes("Skein-MAC-256", size, [&]() { macSkein(key, 32, data, size, mac, 256, Skein256); });
+#endif
+    }
+    freeSha1HmacContext(sha1Ctx);
+#if ZRTP_WITH_SKEIN
+    freeSkeinMacContext(skeinCtx);
+#endif
+}
+
+static void benchPubKeys() {
+    static const char* pubKeyNames[] = {dh2k, dh3k, ec25, ec38, e255, e414};
+
+    for (const char* name : pubKeyNames) {
+        // The enumeration contains only the algorithms this build supports
+        if (!zrtpPubKeys.getByName(name).isValid())
+            continue;
+
+        PubKeyResult r;
+        r.name.assign(name, 4);
+
+        r.keygenPerSecond = benchOps([&]() {
+            ZrtpDH dh(name);
+            dh.generatePublicKey();
+        });
+
+        ZrtpDH own(name);
+        ZrtpDH peer(name);
+        own.generatePublicKey();
+        peer.generatePublicKey();
+
+        std::vector<uint8_t> peerPubKey(peer.getPubKeySize());
+        std::vector<uint8_t> secret(own.getDhSize());
+        peer.getPubKeyBytes(peerPubKey.data());
+
+        r.agreePerSecond = benchOps([&]() { own.computeSecretKey(peerPubKey.data(), secret.data()); });
+
+        pubKeyResults.push_back(r);
+        fprintf(stderr, "%-20s keygen: %8.1f ops/s, agreement: %8.1f ops/s\n", r.name.c_str(),
+                r.keygenPerSecond, r.agreePerSecond);
+    }
+}
+
+static std::string cpuName() {
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    std::string line;
+
+    while (std::getline(cpuInfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos)
+                return line.substr(line.find_first_not_of(' ', colon + 1));
+        }
+    }
+    return "unknown";
+}
+
+static std::string jsonString(const std::string& in) {
+    std::string out("\"");
+    for (char c : in) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20)
+            out += c;
+    }
+    out += '"';
+    return out;
+}
+
+static void writeReport(FILE* out) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"backend\": %s,\n", jsonString(backendName).c_str());
+    fprintf(out, "  \"cpu\": %s,\n", jsonString(cpuName()).c_str());
+#ifdef __VERSION__
+    fprintf(out, "  \"compiler\": %s,\n", jsonString(__VERSION__).c_str());
+#endif
+    fprintf(out, "  \"cycleCounter\": %s,\n", readCycles() != 0 ? "true" : "false");
+    fprintf(out, "  \"symmetric\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(out, "    {\"name\": %s, \"size\": %u, \"nsPerByte\": %.3f, \"cyclesPerByte\": ",
+                jsonString(r.name).c_str(), r.size, r.nsPerByte);
+        if (readCycles() != 0)
+            fprintf(out, "%.3f", r.cyclesPerByte);
+        else
+            fprintf(out, "null");
+        fprintf(out, ", \"MBPerSecond\": %.2f}%s\n", r.mbPerSecond, (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"publicKey\": [\n");
+    for (size_t i = 0; i < pubKeyResults.size(); i++) {
+        const PubKeyResult& r = pubKeyResults[i];
+        fprintf(out, "    {\"name\": %s, \"keygenPerSecond\": %.1f, \"agreementPerSecond\": %.1f}%s\n",
+                jsonString(r.name).c_str(), r.keygenPerSecond, r.agreePerSecond,
+                (i + 1 < pubKeyResults.size()) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char* outName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            minRunTime = std::chrono::milliseconds(atoi(argv[++i]));
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-o file] [-t milliseconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    benchSrtpCipher("AES-128-ECB", "AES-128-CM", "AES-128-F8", "AES-128-F8-batch",
+                    SrtpEncryptionAESCM, SrtpEncryptionAESF8, 16);
+    benchSrtpCipher("AES-256-ECB", "AES-256-CM", "AES-256-F8", "AES-256-F8-batch",
+                    SrtpEncryptionAESCM, SrtpEncryptionAESF8, 32);
+#if ZRTP_WITH_TWOFISH
+    benchSrtpCipher("Twofish-128-ECB", "Twofish-128-CM", "Twofish-128-F8", "Twofish-128-F8-batch",
+                    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8, 16);
+    benchSrtpCipher("Twofish-256-ECB", "Twofish-256-CM", "Twofish-256-F8", "Twofish-256-F8-batch",
+                    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8, 32);
+#endif
+    benchCfb();
+    benchHashes();
+    benchMacs();
+    benchPubKeys();
+
+    FILE* out = stdout;
+    if (outName != NULL) {
+        out = fopen(outName, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Cannot open report file %s\n", outName);
+            return 1;
+        }
+    }
+    writeReport(out);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,395 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Count the heap allocations of a ZRTP handshake.
+ *
+ * Two ZRtp engines negotiate over an in-memory loopback that uses fixed
+ * buffers, thus every allocation the program counts comes from the
+ * library. For each public key algorithm the program runs a few warm up
+ * handshakes, then counts the allocations of engine construction, of the
+ * handshake and of the engine destruction. The counts are per handshake
+ * and include both engines. The program also installs a counting library
+ * allocator and reports the share of the allocations that went through it,
+ * the others bypass the allocator hook of the library.
+ *
+ * The counters hook malloc and free on glibc. On other C libraries they
+ * hook the C++ operators new and delete only and do not see the bnlib big
+ * number allocations.
+ *
+ * Usage: zrtpalloc [-n handshakes] [-k pubkey] [-a allocs] [-z zidfile]
+ *
+ *   -n handshakes  handshakes per public key algorithm, default 100
+ *   -k pubkey      public key algorithm, for example EC25 or DH3k, default
+ *                  all DH algorithms of the library
+ *   -a allocs      budget of handshake allocations, default 0: any steady
+ *                  state allocation fails the run
+ *   -z zidfile     ZID cache file, default zrtpalloc.zid, removed at start
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <common/zrtpAllocator.h>
+
+// Constant initialized, the allocator hooks run before any dynamic
+// initialization.
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> allocs(0);
+static std::atomic<uint64_t> hookedAllocs(0);
+
+static inline void countAlloc() {
+    if (counting.load(std::memory_order_relaxed))
+        allocs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void* hookAlloc(void*, size_t size, uint32_t) {
+    if (counting.load(std::memory_order_relaxed))
+        hookedAllocs.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size);
+}
+
+static void hookRelease(void*, void* ptr, size_t, uint32_t) {
+    free(ptr);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    if (ptr != NULL)
+        countAlloc();
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    if (ptr != NULL)
+        countAlloc();
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+    void* newPtr = __libc_realloc(ptr, size);
+    if (newPtr != NULL)
+        countAlloc();
+    return newPtr;
+}
+}
+#else
+void* operator new(size_t size) {
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    countAlloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+#endif
+
+/*
+ * A queue of ZRTP messages in fixed buffers. A handshake has at most a
+ * few messages in flight per direction.
+ */
+class Loopback {
+public:
+    Loopback(): head(0), count(0) {}
+
+    void push(const uint8_t* data, int32_t length) {
+        if (count == maxMessages || length > maxLength)
+            return;
+        int32_t slot = (head + count) % maxMessages;
+        memcpy(messages[slot], data, length);
+        lengths[slot] = length;
+        count++;
+    }
+
+    bool empty() const { return count == 0; }
+
+    /* Copies the oldest message to data and removes it, returns its length */
+    int32_t pop(uint8_t* data) {
+        int32_t length = lengths[head];
+        memcpy(data, messages[head], length);
+        head = (head + 1) % maxMessages;
+        count--;
+        return length;
+    }
+
+    static const int32_t maxMessages = 16;
+    static const int32_t maxLength = 3072;
+
+private:
+    uint8_t messages[maxMessages][maxLength];
+    int32_t lengths[maxMessages];
+    int32_t head;
+    int32_t count;
+};
+
+static uint64_t virtualMs = 0;
+
+class AllocEndpoint : public ZrtpCallback {
+public:
+    explicit AllocEndpoint(Loopback* out): out(out), timerDeadline(0), secure(false), failed(false) {}
+
+    void reset() {
+        timerDeadline = 0;
+        secure = false;
+        failed = false;
+    }
+
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) {
+        out->push(data, length);
+        return 1;
+    }
+
+    int32_t activateTimer(int32_t time) {
+        timerDeadline = virtualMs + time;
+        return 1;
+    }
+
+    int32_t cancelTimer() {
+        timerDeadline = 0;
+        return 1;
+    }
+
+    void sendInfo(GnuZrtpCodes::MessageSeverity, int32_t) {}
+    bool srtpSecretsReady(SrtpSecret_t*, EnableSecurity) { return true; }
+    void srtpSecretsOff(EnableSecurity) {}
+    void srtpSecretsOn(const std::string&, const std::string&, bool) { secure = true; }
+    void handleGoClear() {}
+    void zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity, int32_t) { failed = true; }
+    void zrtpNotSuppOther() { failed = true; }
+    void synchEnter() {}
+    void synchLeave() {}
+    void zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment) {}
+    void zrtpInformEnrollment(GnuZrtpCodes::InfoEnrollment) {}
+    void signSAS(uint8_t*) {}
+    bool checkSASSignature(uint8_t*) { return true; }
+
+    Loopback* out;
+    uint64_t timerDeadline;
+    bool secure;
+    bool failed;
+};
+
+static Loopback toA, toB;
+static AllocEndpoint endpointA(&toB), endpointB(&toA);
+static uint8_t packet[Loopback::maxLength];
+
+/*
+ * Deliver the ZRTP messages until both endpoints are secure. If no message
+ * is in flight advance the virtual clock to the next timer and fire it.
+ */
+static bool runHandshake(ZRtp* engineA, ZRtp* engineB) {
+    for (int32_t steps = 0; steps < 1000; steps++) {
+        if (endpointA.failed || endpointB.failed)
+            return false;
+        if (endpointA.secure && endpointB.secure && toA.empty() && toB.empty())
+            return true;
+
+        if (!toB.empty()) {
+            // The engines expect the length including the RTP header and CRC
+            int32_t length = toB.pop(packet);
+            engineB->processZrtpMessage(packet, 0xa0a0a0a0, length + 12);
+        }
+        if (!toA.empty()) {
+            int32_t length = toA.pop(packet);
+            engineA->processZrtpMessage(packet, 0xb0b0b0b0, length + 12);
+        }
+        if (!toA.empty() || !toB.empty())
+            continue;
+
+        AllocEndpoint* next = NULL;
+        if (endpointA.timerDeadline != 0)
+            next = &endpointA;
+        if (endpointB.timerDeadline != 0 && (next == NULL || endpointB.timerDeadline < next->timerDeadline))
+            next = &endpointB;
+        if (next == NULL)
+            return endpointA.secure && endpointB.secure;
+        if (next->timerDeadline > virtualMs)
+            virtualMs = next->timerDeadline;
+        next->timerDeadline = 0;
+        if (next == &endpointA)
+            engineA->processTimeout();
+        else
+            engineB->processTimeout();
+    }
+    return false;
+}
+
+struct Counts {
+    uint64_t setup;
+    uint64_t handshake;
+    uint64_t teardown;
+    uint64_t hooked;
+    uint64_t failures;
+};
+
+static void runAlgorithm(ZrtpConfigure& config, uint32_t handshakes, uint32_t warmup, Counts* counts) {
+    uint8_t zidA[IDENTIFIER_LEN] = {'a', 'l', 'l', 'o', 'c', 'A'};
+    uint8_t zidB[IDENTIFIER_LEN] = {'a', 'l', 'l', 'o', 'c', 'B'};
+
+    memset(counts, 0, sizeof(Counts));
+    for (uint32_t i = 0; i < warmup + handshakes; i++) {
+        bool measure = i >= warmup;
+        endpointA.reset();
+        endpointB.reset();
+
+        counting.store(measure, std::memory_order_relaxed);
+        uint64_t start = allocs.load(std::memory_order_relaxed);
+        uint64_t hookedStart = hookedAllocs.load(std::memory_order_relaxed);
+        ZRtp* engineA = new ZRtp(zidA, &endpointA, "alloc A", &config);
+        ZRtp* engineB = new ZRtp(zidB, &endpointB, "alloc B", &config);
+        uint64_t setupDone = allocs.load(std::memory_order_relaxed);
+
+        engineA->startZrtpEngine();
+        engineB->startZrtpEngine();
+        bool ok = runHandshake(engineA, engineB);
+        uint64_t handshakeDone = allocs.load(std::memory_order_relaxed);
+
+        engineA->stopZrtp();
+        engineB->stopZrtp();
+        delete engineA;
+        delete engineB;
+        uint64_t teardownDone = allocs.load(std::memory_order_relaxed);
+        uint64_t hookedDone = hookedAllocs.load(std::memory_order_relaxed);
+        counting.store(false, std::memory_order_relaxed);
+
+        while (!toA.empty())
+            toA.pop(packet);
+        while (!toB.empty())
+            toB.pop(packet);
+
+        if (!measure)
+            continue;
+        counts->setup += setupDone - start;
+        counts->handshake += handshakeDone - setupDone;
+        counts->teardown += teardownDone - handshakeDone;
+        counts->hooked += hookedDone - hookedStart;
+        if (!ok)
+            counts->failures++;
+    }
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-n handshakes] [-k pubkey] [-a allocs] [-z zidfile]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t handshakes = 100;
+    double allocBudget = 0;
+    const char* pubKey = NULL;
+    std::string zidFile("zrtpalloc.zid");
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc || argv[i][0] != '-' || argv[i][2] != '\0')
+            usage(argv[0]);
+        const char* value = argv[++i];
+        switch (argv[i - 1][1]) {
+            case 'n': handshakes = atoi(value); break;
+            case 'k': pubKey = value; break;
+            case 'a': allocBudget = atof(value); break;
+            case 'z': zidFile = value; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (handshakes == 0)
+        usage(argv[0]);
+
+    zrtpAllocator_t allocator = { hookAlloc, hookRelease, NULL };
+    if (zrtpSetAllocator(&allocator) < 0) {
+        fprintf(stderr, "Cannot install the allocator\n");
+        return 1;
+    }
+
+    remove(zidFile.c_str());
+    ZIDCache* zidCache = getZidCacheInstance();
+    if (zidCache->open(const_cast<char*>(zidFile.c_str())) < 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", zidFile.c_str());
+        return 1;
+    }
+    if (pubKey != NULL && !zrtpPubKeys.getByName(pubKey).isValid()) {
+        fprintf(stderr, "Unknown public key algorithm %s\n", pubKey);
+        return 1;
+    }
+
+    printf("allocations per handshake of two engines, %u handshakes\n", handshakes);
+    printf("%-8s %10s %10s %10s %8s\n", "pubkey", "setup", "handshake", "teardown", "hooked");
+
+    bool failed = false;
+    int32_t numberOfPubKeys = static_cast<int32_t>(zrtpPubKeys.getSize());
+    for (int32_t ord = 0; ord < numberOfPubKeys; ord++) {
+        AlgorithmEnum& algo = zrtpPubKeys.getByOrdinal(ord);
+        if (!algo.isValid() || strcmp(algo.getName(), "Mult") == 0)
+            continue;
+        if (pubKey != NULL && strcmp(algo.getName(), zrtpPubKeys.getByName(pubKey).getName()) != 0)
+            continue;
+
+        ZrtpConfigure config;
+        config.setStandardConfig();
+        while (config.getNumConfiguredAlgos(PubKeyAlgorithm) > 0)
+            config.removeAlgo(PubKeyAlgorithm, config.getAlgoAt(PubKeyAlgorithm, 0));
+        config.addAlgo(PubKeyAlgorithm, algo);
+
+        // The first handshakes create the cache records and initialize statics
+        Counts counts;
+        runAlgorithm(config, handshakes, 3, &counts);
+
+        double handshakeAllocs = counts.handshake / static_cast<double>(handshakes);
+        uint64_t total = counts.setup + counts.handshake + counts.teardown;
+        printf("%-8s %10.1f %10.1f %10.1f %7.1f%%", algo.getName(), counts.setup / static_cast<double>(handshakes),
+               handshakeAllocs, counts.teardown / static_cast<double>(handshakes),
+               total != 0 ? counts.hooked * 100.0 / total : 100.0);
+        if (counts.failures != 0) {
+            printf("  %llu failed", (unsigned long long)counts.failures);
+            failed = true;
+        }
+        if (handshakeAllocs > allocBudget) {
+            printf("  over budget %.1f", allocBudget);
+            failed = true;
+        }
+        printf("\n");
+    }
+    zidCache->close();
+    remove(zidFile.c_str());
+    return failed ? 1 : 0;
+}
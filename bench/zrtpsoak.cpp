@@ -0,0 +1,560 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Soak benchmark for memory growth and allocator churn.
+ *
+ * Each cycle creates two ZRtp engines that negotiate over an in-memory
+ * loopback, builds the SRTP contexts from the negotiated secrets, sends
+ * media packets in both directions and destroys everything again. Timers
+ * and media run on a virtual clock, a cycle never sleeps, thus a soak of
+ * millions of cycles covers months of call time.
+ *
+ * The program counts the heap allocations of each phase of a cycle and
+ * reports the RSS, the allocator statistics and the number of live heap
+ * blocks at regular intervals. After the warm up cycles it records a
+ * baseline, at the end it fails if the RSS grew more than the budget, if
+ * live blocks leaked or if a cycle needed more allocations than allowed.
+ *
+ * The allocation counters hook malloc and free on glibc. On other C
+ * libraries they hook the C++ operators new and delete only and do not
+ * see the bnlib big number allocations.
+ *
+ * Usage: zrtpsoak [-n cycles] [-p packets] [-l loss] [-k pubkey] [-w warmup]
+ *                 [-r interval] [-g KiB] [-b blocks] [-a allocs] [-z zidfile]
+ *
+ *   -n cycles    number of handshake-and-media cycles, default 10000
+ *   -p packets   media packets per direction and cycle, default 50
+ *   -l loss      ZRTP packet loss in percent, exercises the retransmission
+ *                timers, default 0
+ *   -k pubkey    public key algorithm, for example EC25 or DH3k, default
+ *                the standard configuration
+ *   -w warmup    cycles before the baseline is taken, default 1/10 of cycles
+ *   -r interval  report every interval cycles, default 1/20 of cycles
+ *   -g KiB       RSS growth budget after the warm up, default 1024
+ *   -b blocks    budget of live heap blocks that may leak, default 0
+ *   -a allocs    budget of heap allocations per cycle, default 0 (no check)
+ *   -z zidfile   ZID cache file, default zrtpsoak.zid, removed at start
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <deque>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <CryptoContext.h>
+#include <SrtpHandler.h>
+
+enum Phase {
+    PhaseIdle,
+    PhaseSetup,                 // engine construction, Hello hash
+    PhaseHandshake,             // ZRTP messages, timers, ZID cache
+    PhaseSrtp,                  // SRTP contexts from the secrets
+    PhaseMedia,                 // protect and unprotect
+    PhaseTeardown,              // engine and context destruction
+    numberOfPhases
+};
+
+static const char* phaseNames[numberOfPhases] = {
+    "idle", "setup", "handshake", "srtp", "media", "teardown"
+};
+
+// Constant initialized, the allocator hooks run before any dynamic
+// initialization.
+static std::atomic<int> phase(PhaseIdle);
+static std::atomic<uint64_t> phaseAllocs[numberOfPhases];
+static std::atomic<int64_t> liveBlocks(0);
+
+static inline void countAlloc() {
+    phaseAllocs[phase.load(std::memory_order_relaxed)].fetch_add(1, std::memory_order_relaxed);
+    liveBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+static inline void countFree() {
+    liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    if (ptr != NULL)
+        countAlloc();
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    if (ptr != NULL)
+        countAlloc();
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+    void* newPtr = __libc_realloc(ptr, size);
+    if (ptr == NULL && newPtr != NULL)
+        countAlloc();
+    else if (ptr != NULL && size == 0)
+        countFree();
+    else if (newPtr != NULL)
+        phaseAllocs[phase.load(std::memory_order_relaxed)].fetch_add(1, std::memory_order_relaxed);
+    return newPtr;
+}
+
+void free(void* ptr) {
+    if (ptr != NULL)
+        countFree();
+    __libc_free(ptr);
+}
+}
+#else
+void* operator new(size_t size) {
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    countAlloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr != NULL) {
+        countFree();
+        free(ptr);
+    }
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+#endif
+
+static uint64_t virtualMs = 0;
+static uint32_t lossPercent = 0;
+static uint32_t lossState = 0x12345678;
+
+// Deterministic loss pattern, runs are comparable
+static bool dropPacket() {
+    if (lossPercent == 0)
+        return false;
+    lossState = lossState * 1103515245 + 12345;
+    return ((lossState >> 16) % 100) < lossPercent;
+}
+
+struct Message {
+    std::vector<uint8_t> data;
+};
+
+class SoakEndpoint : public ZrtpCallback {
+public:
+    SoakEndpoint(uint32_t ssrc, uint32_t peerSsrc, std::deque<Message>* out):
+        out(out), ssrc(ssrc), peerSsrc(peerSsrc), timerDeadline(0), secure(false), failed(false),
+        sender(NULL), receiver(NULL) {}
+
+    ~SoakEndpoint() {
+        delete sender;
+        delete receiver;
+    }
+
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) {
+        if (dropPacket())
+            return 1;
+        out->push_back(Message());
+        out->back().data.assign(data, data + length);
+        return 1;
+    }
+
+    int32_t activateTimer(int32_t time) {
+        timerDeadline = virtualMs + time;
+        return 1;
+    }
+
+    int32_t cancelTimer() {
+        timerDeadline = 0;
+        return 1;
+    }
+
+    void sendInfo(GnuZrtpCodes::MessageSeverity, int32_t) {}
+
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) {
+        int previous = phase.exchange(PhaseSrtp, std::memory_order_relaxed);
+
+        // To encrypt packets the initiator uses the initiator keys, to
+        // decrypt it uses the responder keys, the responder vice versa.
+        bool useInitiator = (secrets->role == Initiator) == (part == ForSender);
+        const uint8_t* key = useInitiator ? secrets->keyInitiator : secrets->keyResponder;
+        const uint8_t* salt = useInitiator ? secrets->saltInitiator : secrets->saltResponder;
+        int32_t keyLen = (useInitiator ? secrets->initKeyLen : secrets->respKeyLen) / 8;
+        int32_t saltLen = (useInitiator ? secrets->initSaltLen : secrets->respSaltLen) / 8;
+
+        int32_t cipher = (secrets->symEncAlgorithm == TwoFish) ? SrtpEncryptionTWOCM : SrtpEncryptionAESCM;
+        int32_t authn = (secrets->authAlgorithm == Skein) ? SrtpAuthenticationSkeinHmac : SrtpAuthenticationSha1Hmac;
+        int32_t authKeyLen = (secrets->authAlgorithm == Skein) ? 32 : 20;
+
+        CryptoContext* cc = new CryptoContext(part == ForSender ? ssrc : peerSsrc, 0, 0L, cipher, authn,
+                                              const_cast<uint8_t*>(key), keyLen, const_cast<uint8_t*>(salt),
+                                              saltLen, keyLen, authKeyLen, saltLen, secrets->srtpAuthTagLen / 8);
+        cc->deriveSrtpKeys(0);
+        if (part == ForSender) {
+            delete sender;
+            sender = cc;
+        }
+        else {
+            delete receiver;
+            receiver = cc;
+        }
+        phase.store(previous, std::memory_order_relaxed);
+        return true;
+    }
+
+    void srtpSecretsOff(EnableSecurity) {}
+    void srtpSecretsOn(const std::string&, const std::string&, bool) { secure = true; }
+    void handleGoClear() {}
+    void zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity, int32_t) { failed = true; }
+    void zrtpNotSuppOther() { failed = true; }
+    void synchEnter() {}
+    void synchLeave() {}
+    void zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment) {}
+    void zrtpInformEnrollment(GnuZrtpCodes::InfoEnrollment) {}
+    void signSAS(uint8_t*) {}
+    bool checkSASSignature(uint8_t*) { return true; }
+
+    std::deque<Message>* out;
+    uint32_t ssrc;
+    uint32_t peerSsrc;
+    uint64_t timerDeadline;
+    bool secure;
+    bool failed;
+    CryptoContext* sender;
+    CryptoContext* receiver;
+};
+
+/*
+ * Deliver the ZRTP messages until both endpoints are secure. If no message
+ * is in flight advance the virtual clock to the next timer and fire it.
+ */
+static bool runHandshake(ZRtp* engineA, SoakEndpoint& a, std::deque<Message>& toA,
+                         ZRtp* engineB, SoakEndpoint& b, std::deque<Message>& toB) {
+    for (int32_t steps = 0; steps < 1000; steps++) {
+        if (a.failed || b.failed)
+            return false;
+        if (a.secure && b.secure && toA.empty() && toB.empty())
+            return true;
+
+        if (!toB.empty()) {
+            Message msg;
+            msg.data.swap(toB.front().data);
+            toB.pop_front();
+            // The engines expect the length including the RTP header and CRC
+            engineB->processZrtpMessage(msg.data.data(), a.ssrc, msg.data.size() + 12);
+        }
+        if (!toA.empty()) {
+            Message msg;
+            msg.data.swap(toA.front().data);
+            toA.pop_front();
+            engineA->processZrtpMessage(msg.data.data(), b.ssrc, msg.data.size() + 12);
+        }
+        if (!toA.empty() || !toB.empty())
+            continue;
+
+        SoakEndpoint* next = NULL;
+        if (a.timerDeadline != 0)
+            next = &a;
+        if (b.timerDeadline != 0 && (next == NULL || b.timerDeadline < next->timerDeadline))
+            next = &b;
+        if (next == NULL)
+            return a.secure && b.secure;
+        if (next->timerDeadline > virtualMs)
+            virtualMs = next->timerDeadline;
+        next->timerDeadline = 0;
+        if (next == &a)
+            engineA->processTimeout();
+        else
+            engineB->processTimeout();
+    }
+    return false;
+}
+
+/*
+ * Send G.711 sized packets, 20ms apart, from the sender of one endpoint to
+ * the receiver of the other. Returns the number of packets that failed.
+ */
+static uint32_t runMedia(SoakEndpoint& from, SoakEndpoint& to, uint32_t packets) {
+    uint8_t packet[12 + 160 + 16];
+    uint32_t failures = 0;
+
+    if (from.sender == NULL || to.receiver == NULL)
+        return packets;
+
+    for (uint32_t i = 0; i < packets; i++) {
+        memset(packet, 0, sizeof(packet));
+        packet[0] = 0x80;
+        packet[2] = static_cast<uint8_t>(i >> 8);
+        packet[3] = static_cast<uint8_t>(i);
+        packet[8] = static_cast<uint8_t>(from.ssrc >> 24);
+        packet[9] = static_cast<uint8_t>(from.ssrc >> 16);
+        packet[10] = static_cast<uint8_t>(from.ssrc >> 8);
+        packet[11] = static_cast<uint8_t>(from.ssrc);
+        memset(packet + 12, static_cast<int>(i), 160);
+
+        size_t length;
+        size_t plainLength;
+        SrtpHandler::protect(from.sender, packet, 12 + 160, &length);
+        if (SrtpHandler::unprotect(to.receiver, packet, length, &plainLength) != 1 || plainLength != 12 + 160)
+            failures++;
+        virtualMs += 20;
+    }
+    return failures;
+}
+
+struct Snapshot {
+    uint64_t rssKiB;
+    uint64_t heapInUseKiB;
+    uint64_t heapFreeKiB;
+    int64_t liveBlocks;
+    uint64_t allocs[numberOfPhases];
+};
+
+static uint64_t readRssKiB() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    if (n != 2)
+        return 0;
+    return static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+static void takeSnapshot(Snapshot* snap) {
+    snap->rssKiB = readRssKiB();
+    snap->heapInUseKiB = 0;
+    snap->heapFreeKiB = 0;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    snap->heapInUseKiB = (mi.uordblks + mi.hblkhd) / 1024;
+    snap->heapFreeKiB = mi.fordblks / 1024;
+#endif
+    snap->liveBlocks = liveBlocks.load(std::memory_order_relaxed);
+    for (int32_t i = 0; i < numberOfPhases; i++)
+        snap->allocs[i] = phaseAllocs[i].load(std::memory_order_relaxed);
+}
+
+static uint64_t totalAllocs(const Snapshot& snap) {
+    uint64_t total = 0;
+    for (int32_t i = PhaseSetup; i < numberOfPhases; i++)
+        total += snap.allocs[i];
+    return total;
+}
+
+static void printReport(uint64_t cycle, const Snapshot& now, const Snapshot& last, uint64_t cycles) {
+    printf("cycle %10llu  call time %8.1f h  rss %8llu KiB  heap %8llu KiB  free %8llu KiB  live %8lld",
+           (unsigned long long)cycle, virtualMs / 3600000.0, (unsigned long long)now.rssKiB,
+           (unsigned long long)now.heapInUseKiB, (unsigned long long)now.heapFreeKiB, (long long)now.liveBlocks);
+    if (cycles != 0) {
+        printf("  allocs/cycle");
+        for (int32_t i = PhaseSetup; i < numberOfPhases; i++)
+            printf(" %s %.1f", phaseNames[i], (now.allocs[i] - last.allocs[i]) / static_cast<double>(cycles));
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-n cycles] [-p packets] [-l loss] [-k pubkey] [-w warmup]\n"
+                    "       [-r interval] [-g KiB] [-b blocks] [-a allocs] [-z zidfile]\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t cycles = 10000;
+    uint32_t packets = 50;
+    int64_t warmup = -1;
+    int64_t interval = -1;
+    uint64_t growthBudgetKiB = 1024;
+    int64_t leakBudget = 0;
+    double allocBudget = 0;
+    const char* pubKey = NULL;
+    std::string zidFile("zrtpsoak.zid");
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc || argv[i][0] != '-' || argv[i][2] != '\0')
+            usage(argv[0]);
+        const char* value = argv[++i];
+        switch (argv[i - 1][1]) {
+            case 'n': cycles = strtoull(value, NULL, 10); break;
+            case 'p': packets = atoi(value); break;
+            case 'l': lossPercent = atoi(value); break;
+            case 'k': pubKey = value; break;
+            case 'w': warmup = strtoll(value, NULL, 10); break;
+            case 'r': interval = strtoll(value, NULL, 10); break;
+            case 'g': growthBudgetKiB = strtoull(value, NULL, 10); break;
+            case 'b': leakBudget = strtoll(value, NULL, 10); break;
+            case 'a': allocBudget = atof(value); break;
+            case 'z': zidFile = value; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (cycles == 0 || lossPercent >= 100)
+        usage(argv[0]);
+    if (warmup < 0)
+        warmup = cycles / 10;
+    if (static_cast<uint64_t>(warmup) >= cycles)
+        warmup = cycles - 1;
+    if (interval <= 0)
+        interval = (cycles >= 20) ? cycles / 20 : 1;
+
+    remove(zidFile.c_str());
+    ZIDCache* zidCache = getZidCacheInstance();
+    if (zidCache->open(const_cast<char*>(zidFile.c_str())) < 0) {
+        fprintf(stderr, "Cannot open ZID cache file %s\n", zidFile.c_str());
+        return 1;
+    }
+
+    ZrtpConfigure config;
+    config.setStandardConfig();
+    if (pubKey != NULL) {
+        AlgorithmEnum& algo = zrtpPubKeys.getByName(pubKey);
+        if (!algo.isValid()) {
+            fprintf(stderr, "Unknown public key algorithm %s\n", pubKey);
+            return 1;
+        }
+        while (config.getNumConfiguredAlgos(PubKeyAlgorithm) > 0)
+            config.removeAlgo(PubKeyAlgorithm, config.getAlgoAt(PubKeyAlgorithm, 0));
+        config.addAlgo(PubKeyAlgorithm, algo);
+    }
+
+    uint8_t zidA[IDENTIFIER_LEN] = {'s', 'o', 'a', 'k', 'A'};
+    uint8_t zidB[IDENTIFIER_LEN] = {'s', 'o', 'a', 'k', 'B'};
+    uint64_t handshakeFailures = 0;
+    uint64_t mediaFailures = 0;
+    Snapshot baseline, last, now;
+    uint64_t lastCycle = 0;
+
+    takeSnapshot(&last);
+    baseline = last;
+    for (uint64_t cycle = 1; cycle <= cycles; cycle++) {
+        std::deque<Message> toA, toB;
+        SoakEndpoint a(0xa0a0a0a0, 0xb0b0b0b0, &toB);
+        SoakEndpoint b(0xb0b0b0b0, 0xa0a0a0a0, &toA);
+
+        phase.store(PhaseSetup, std::memory_order_relaxed);
+        ZRtp* engineA = new ZRtp(zidA, &a, "soak A", &config);
+        ZRtp* engineB = new ZRtp(zidB, &b, "soak B", &config);
+        std::string helloHash = engineA->getHelloHash(0);
+        helloHash = engineB->getHelloHash(0);
+
+        phase.store(PhaseHandshake, std::memory_order_relaxed);
+        engineA->startZrtpEngine();
+        engineB->startZrtpEngine();
+        if (!runHandshake(engineA, a, toA, engineB, b, toB))
+            handshakeFailures++;
+        std::string params = engineA->getMultiStrParams(NULL);
+
+        phase.store(PhaseMedia, std::memory_order_relaxed);
+        mediaFailures += runMedia(a, b, packets);
+        mediaFailures += runMedia(b, a, packets);
+
+        phase.store(PhaseTeardown, std::memory_order_relaxed);
+        engineA->stopZrtp();
+        engineB->stopZrtp();
+        delete engineA;
+        delete engineB;
+        delete a.sender; a.sender = NULL;
+        delete a.receiver; a.receiver = NULL;
+        delete b.sender; b.sender = NULL;
+        delete b.receiver; b.receiver = NULL;
+        toA.clear();
+        toB.clear();
+        std::deque<Message>().swap(toA);
+        std::deque<Message>().swap(toB);
+        helloHash.clear();
+        helloHash.shrink_to_fit();
+        params.clear();
+        params.shrink_to_fit();
+        phase.store(PhaseIdle, std::memory_order_relaxed);
+
+        if (cycle == static_cast<uint64_t>(warmup) || cycle % interval == 0 || cycle == cycles) {
+            takeSnapshot(&now);
+            printReport(cycle, now, last, cycle - lastCycle);
+            // After the report, the first report allocates the stdout buffer
+            if (cycle == static_cast<uint64_t>(warmup))
+                takeSnapshot(&baseline);
+            last = now;
+            lastCycle = cycle;
+        }
+    }
+    zidCache->close();
+    remove(zidFile.c_str());
+
+    uint64_t measured = cycles - warmup;
+    uint64_t rssGrowth = (now.rssKiB > baseline.rssKiB) ? now.rssKiB - baseline.rssKiB : 0;
+    int64_t leaked = now.liveBlocks - baseline.liveBlocks;
+    double allocsPerCycle = (totalAllocs(now) - totalAllocs(baseline)) / static_cast<double>(measured);
+
+    printf("\ncycles %llu, call time %.1f h, handshake failures %llu, media failures %llu\n",
+           (unsigned long long)cycles, virtualMs / 3600000.0, (unsigned long long)handshakeFailures,
+           (unsigned long long)mediaFailures);
+    printf("after warm up: rss growth %llu KiB (budget %llu), leaked blocks %lld (budget %lld), "
+           "allocs/cycle %.1f", (unsigned long long)rssGrowth, (unsigned long long)growthBudgetKiB,
+           (long long)leaked, (long long)leakBudget, allocsPerCycle);
+    if (allocBudget > 0)
+        printf(" (budget %.1f)", allocBudget);
+    printf("\n");
+
+    bool failed = false;
+    if (handshakeFailures != 0 || mediaFailures != 0) {
+        fprintf(stderr, "FAIL: handshake or media failures\n");
+        failed = true;
+    }
+    if (rssGrowth > growthBudgetKiB) {
+        fprintf(stderr, "FAIL: RSS grew by %llu KiB\n", (unsigned long long)rssGrowth);
+        failed = true;
+    }
+    if (leaked > leakBudget) {
+        fprintf(stderr, "FAIL: %lld heap blocks leaked\n", (long long)leaked);
+        failed = true;
+    }
+    if (allocBudget > 0 && allocsPerCycle > allocBudget) {
+        fprintf(stderr, "FAIL: %.1f allocations per cycle\n", allocsPerCycle);
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Offline analyser for ZRTP handshake traces.
+ *
+ * Reads a trace file written by ZrtpTrace, rebuilds the timeline of each
+ * ZRTP session and prints aggregate handshake statistics: latency from
+ * engine start to secure state, time spent in each state, retransmissions,
+ * failures and the negotiated algorithms.
+ *
+ * Usage: zrtptrace [-t] [-s session] [-j] tracefile
+ *
+ *   -t          print the timeline of each session
+ *   -s session  only look at this session
+ *   -j          print the summary as JSON
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libzrtpcpp/ZrtpTrace.h>
+#include <libzrtpcpp/ZrtpStateClass.h>
+
+struct SessionInfo {
+    SessionInfo(): start(0), secure(0), end(0), started(false), isSecure(false), failed(false),
+                   failCode(0), retransmits(0), sent(0), received(0), role(0), multiStream(false) {}
+
+    uint64_t start, secure, end;
+    bool started, isSecure, failed;
+    uint32_t failCode;
+    uint32_t retransmits, sent, received;
+    uint8_t role;
+    bool multiStream;
+    std::string algorithms[numberOfTraceAlgos];
+    uint64_t stateTime[numberOfStates];
+};
+
+static void usage() {
+    fprintf(stderr, "Usage: zrtptrace [-t] [-s session] [-j] tracefile\n");
+    exit(1);
+}
+
+static std::string algoString(uint32_t data) {
+    char name[5];
+    memcpy(name, &data, 4);
+    name[4] = '\0';
+    std::string str(name);
+    size_t last = str.find_last_not_of(' ');
+    return (last == std::string::npos) ? str : str.substr(0, last + 1);
+}
+
+static const char* roleName(uint8_t role) {
+    return (role == Initiator) ? "initiator" : (role == Responder) ? "responder" : "-";
+}
+
+static void printRecord(const ZrtpTraceRecord_t& rec, uint64_t base) {
+    printf("  %10.3f ms  %-10s %-12s", (rec.timeUs - base) / 1000.0, ZrtpTrace::eventName(rec.event),
+           ZrtpTrace::stateName(rec.state));
+
+    switch (rec.event) {
+        case TracePacketSent:
+        case TracePacketRecv:
+            printf(" %s (%u bytes)", ZrtpTrace::messageName(rec.message), rec.length);
+            break;
+        case TraceState:
+            printf(" from %s", ZrtpTrace::stateName(static_cast<uint8_t>(rec.data)));
+            break;
+        case TraceRetransmit:
+            printf(" retry %u, next timeout %u ms", rec.retries, rec.data);
+            break;
+        case TraceAlgorithm:
+            printf(" %s %s", ZrtpTrace::algoName(rec.message), algoString(rec.data).c_str());
+            break;
+        case TraceFailed:
+            printf(" severity %u, code %u", rec.data >> 16, rec.data & 0xffff);
+            break;
+        default:
+            break;
+    }
+    printf("\n");
+}
+
+static double percentile(std::vector<double>& values, double p) {
+    if (values.empty())
+        return 0.0;
+    size_t idx = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[idx];
+}
+
+int main(int argc, char *argv[]) {
+    bool timeline = false;
+    bool json = false;
+    bool oneSession = false;
+    uint32_t onlySession = 0;
+    const char* fileName = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0)
+            timeline = true;
+        else if (strcmp(argv[i], "-j") == 0)
+            json = true;
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            oneSession = true;
+            onlySession = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argv[i][0] != '-' && fileName == nullptr)
+            fileName = argv[i];
+        else
+            usage();
+    }
+    if (fileName == nullptr)
+        usage();
+
+    FILE* file = fopen(fileName, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot open trace file %s\n", fileName);
+        return 1;
+    }
+
+    ZrtpTraceHeader_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "ZTRC", 4) != 0) {
+        fprintf(stderr, "%s is not a ZRTP trace file\n", fileName);
+        fclose(file);
+        return 1;
+    }
+    if (header.endian != 0x01020304) {
+        fprintf(stderr, "Trace file was written on a host with different byte order\n");
+        fclose(file);
+        return 1;
+    }
+    if (header.version != ZrtpTrace::formatVersion || header.recordSize != sizeof(ZrtpTraceRecord_t)) {
+        fprintf(stderr, "Unsupported trace format version %u, record size %u\n", header.version, header.recordSize);
+        fclose(file);
+        return 1;
+    }
+
+    std::vector<ZrtpTraceRecord_t> records;
+    ZrtpTraceRecord_t rec;
+    uint64_t dropped = 0;
+    while (fread(&rec, sizeof(rec), 1, file) == 1) {
+        if (rec.event == TraceDropped) {
+            dropped += rec.data;
+            continue;
+        }
+        if (oneSession && rec.session != onlySession)
+            continue;
+        records.push_back(rec);
+    }
+    fclose(file);
+
+    // Each thread flushes its own ring, restore the time order per session
+    std::stable_sort(records.begin(), records.end(), [](const ZrtpTraceRecord_t& a, const ZrtpTraceRecord_t& b) {
+        return (a.session != b.session) ? a.session < b.session : a.timeUs < b.timeUs;
+    });
+
+    std::map<uint32_t, SessionInfo> sessions;
+    std::map<std::string, uint32_t> algoCount[numberOfTraceAlgos];
+    uint32_t lastSession = 0;
+    uint64_t lastTime = 0;
+    uint8_t lastState = Initial;
+
+    for (const ZrtpTraceRecord_t& r : records) {
+        bool newSession = sessions.find(r.session) == sessions.end();
+        SessionInfo& info = sessions[r.session];
+        if (newSession) {
+            memset(info.stateTime, 0, sizeof(info.stateTime));
+            info.start = info.end = r.timeUs;
+            if (timeline)
+                printf("%sSession %u\n", (r.session == records.front().session) ? "" : "\n", r.session);
+        }
+        else if (r.session == lastSession && lastState < numberOfStates) {
+            info.stateTime[lastState] += r.timeUs - lastTime;
+        }
+        if (timeline)
+            printRecord(r, info.start);
+
+        info.end = r.timeUs;
+        if (r.role != 0)
+            info.role = r.role;
+        if (r.flags & 1)
+            info.multiStream = true;
+
+        switch (r.event) {
+            case TraceStart:
+                info.started = true;
+                info.start = r.timeUs;
+                break;
+            case TracePacketSent:
+                info.sent++;
+                break;
+            case TracePacketRecv:
+                info.received++;
+                break;
+            case TraceRetransmit:
+                info.retransmits++;
+                break;
+            case TraceAlgorithm:
+                if (r.message < numberOfTraceAlgos)
+                    info.algorithms[r.message] = algoString(r.data);
+                break;
+            case TraceSecure:
+                if (!info.isSecure) {
+                    info.isSecure = true;
+                    info.secure = r.timeUs;
+                }
+                break;
+            case TraceFailed:
+                if (!info.failed) {
+                    info.failed = true;
+                    info.failCode = r.data;
+                }
+                break;
+            default:
+                break;
+        }
+        lastSession = r.session;
+        lastTime = r.timeUs;
+        lastState = r.state;
+    }
+
+    std::vector<double> latencies;
+    uint32_t secureCount = 0, failedCount = 0, incompleteCount = 0;
+    uint64_t retransmits = 0;
+    double stateTotal[numberOfStates] = {0.0};
+    uint32_t stateSessions[numberOfStates] = {0};
+
+    for (auto& entry : sessions) {
+        SessionInfo& info = entry.second;
+        retransmits += info.retransmits;
+        if (info.isSecure) {
+            secureCount++;
+            if (info.started)
+                latencies.push_back((info.secure - info.start) / 1000.0);
+        }
+        else if (info.failed)
+            failedCount++;
+        else
+            incompleteCount++;
+
+        for (int32_t i = 0; i < numberOfStates; i++) {
+            if (info.stateTime[i] > 0) {
+                stateTotal[i] += info.stateTime[i] / 1000.0;
+                stateSessions[i]++;
+            }
+        }
+        if (info.isSecure) {
+            for (int32_t i = 0; i < numberOfTraceAlgos; i++) {
+                if (!info.algorithms[i].empty())
+                    algoCount[i][info.algorithms[i]]++;
+            }
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double sum = 0.0;
+    for (double l : latencies)
+        sum += l;
+    double mean = latencies.empty() ? 0.0 : sum / latencies.size();
+    double minimum = latencies.empty() ? 0.0 : latencies.front();
+    double maximum = latencies.empty() ? 0.0 : latencies.back();
+
+    if (json) {
+        printf("{\n");
+        printf("  \"sessions\": %zu,\n  \"secure\": %u,\n  \"failed\": %u,\n  \"incomplete\": %u,\n",
+               sessions.size(), secureCount, failedCount, incompleteCount);
+        printf("  \"retransmits\": %llu,\n  \"droppedRecords\": %llu,\n",
+               static_cast<unsigned long long>(retransmits), static_cast<unsigned long long>(dropped));
+        printf("  \"latencyMs\": {\"min\": %.3f, \"mean\": %.3f, \"median\": %.3f, \"p95\": %.3f, \"max\": %.3f},\n",
+               minimum, mean, percentile(latencies, 0.5), percentile(latencies, 0.95), maximum);
+        printf("  \"stateMeanMs\": {");
+        bool first = true;
+        for (int32_t i = 0; i < numberOfStates; i++) {
+            if (stateSessions[i] == 0)
+                continue;
+            printf("%s\"%s\": %.3f", first ? "" : ", ", ZrtpTrace::stateName(static_cast<uint8_t>(i)), stateTotal[i] / stateSessions[i]);
+            first = false;
+        }
+        printf("},\n  \"algorithms\": {");
+        for (int32_t i = 0; i < numberOfTraceAlgos; i++) {
+            printf("%s\"%s\": {", (i == 0) ? "" : ", ", ZrtpTrace::algoName(static_cast<uint8_t>(i)));
+            first = true;
+            for (auto& a : algoCount[i]) {
+                printf("%s\"%s\": %u", first ? "" : ", ", a.first.c_str(), a.second);
+                first = false;
+            }
+            printf("}");
+        }
+        printf("},\n  \"perSession\": [\n");
+        first = true;
+        for (auto& entry : sessions) {
+            SessionInfo& info = entry.second;
+            printf("%s    {\"session\": %u, \"role\": \"%s\", \"multiStream\": %s, \"result\": \"%s\", \"latencyMs\": %.3f, \"retransmits\": %u, \"sent\": %u, \"received\": %u}",
+                   first ? "" : ",\n", entry.first, roleName(info.role), info.multiStream ? "true" : "false",
+                   info.isSecure ? "secure" : info.failed ? "failed" : "incomplete",
+                   (info.isSecure && info.started) ? (info.secure - info.start) / 1000.0 : 0.0,
+                   info.retransmits, info.sent, info.received);
+            first = false;
+        }
+        printf("\n  ]\n}\n");
+        return 0;
+    }
+
+    if (timeline)
+        printf("\n");
+    printf("Sessions: %zu, secure: %u, failed: %u, incomplete: %u\n", sessions.size(), secureCount, failedCount, incompleteCount);
+    printf("Retransmits: %llu, dropped trace records: %llu\n",
+           static_cast<unsigned long long>(retransmits), static_cast<unsigned long long>(dropped));
+    printf("Handshake latency (start to secure), ms: min %.3f, mean %.3f, median %.3f, p95 %.3f, max %.3f\n",
+           minimum, mean, percentile(latencies, 0.5), percentile(latencies, 0.95), maximum);
+
+    printf("Mean time per state, ms:\n");
+    for (int32_t i = 0; i < numberOfStates; i++) {
+        if (stateSessions[i] > 0)
+            printf("  %-12s %10.3f  (%u sessions)\n", ZrtpTrace::stateName(static_cast<uint8_t>(i)),
+                   stateTotal[i] / stateSessions[i], stateSessions[i]);
+    }
+
+    printf("Negotiated algorithms:\n");
+    for (int32_t i = 0; i < numberOfTraceAlgos; i++) {
+        printf("  %-10s", ZrtpTrace::algoName(static_cast<uint8_t>(i)));
+        for (auto& a : algoCount[i])
+            printf(" %s: %u", a.first.c_str(), a.second);
+        printf("\n");
+    }
+
+    for (auto& entry : sessions) {
+        SessionInfo& info = entry.second;
+        if (info.failed)
+            printf("Session %u (%s) failed: severity %u, code %u\n", entry.first, roleName(info.role),
+                   info.failCode >> 16, info.failCode & 0xffff);
+    }
+    return 0;
+}
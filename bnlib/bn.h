@@ -46,6 +46,17 @@ struct BigNum {
  */
 extern int (*bnYield)(void);
 
+/*
+ * Take the temporary limbs of the following computations from a
+ * caller-owned buffer instead of the heap, until bnScratchEnd().
+ * The scratch window belongs to the calling thread and does not nest.
+ * Numbers that grow inside the window still use the heap, thus they
+ * outlive the window.  Computations that keep precomputed tables
+ * (bnBasePrecompBegin) must not run inside a window.
+ */
+void bnScratchBegin(void *buf, unsigned bytes);
+void bnScratchEnd(void);
+
 /* Functions */
 
 /*
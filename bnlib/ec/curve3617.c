@@ -0,0 +1,434 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Fixed width arithmetic for Curve3617: x^2 + y^2 = 1 + 3617x^2y^2 over the
+ * prime field p = 2^414 - 17.
+ *
+ * A field element uses seven 64 bit limbs, little endian. The arithmetic
+ * keeps elements only partially reduced (any value < 2^448 that is congruent
+ * mod p) and reduces to the canonical value when converting to bytes.
+ * Reduction uses 2^448 = 17 * 2^34 mod p.
+ *
+ * Points use extended twisted Edwards coordinates (X:Y:Z:T) with x = X/Z,
+ * y = Y/Z and T = XY/Z, refer to Hisil, Wong, Carter, Dawson: "Twisted
+ * Edwards Curves Revisited", section 3. Curve3617 is a complete Edwards curve
+ * (d is not a square), thus the addition formula has no exceptions.
+ *
+ * The scalar multiplication uses a fixed 4 bit window. It runs the same
+ * sequence of field operations for every scalar and reads the window
+ * table in constant time.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <ec/ec.h>
+
+#ifdef HAVE_CURVE3617_64
+
+typedef unsigned __int128 uint128_t;
+
+#define LIMBS 7
+
+typedef uint64_t fe[LIMBS];
+
+typedef struct {
+    fe X, Y, Z, T;
+} ge;
+
+static const uint64_t fold448 = 17ULL << 34;      /* 2^448 mod p */
+static const uint64_t curveD = 3617;
+
+static void feCopy(fe r, const fe a)
+{
+    memcpy(r, a, sizeof(fe));
+}
+
+static void feSetSmall(fe r, uint64_t v)
+{
+    memset(r, 0, sizeof(fe));
+    r[0] = v;
+}
+
+/* Add c * 2^448 to r, that is add c * fold448. Called twice the final carry is always 0 */
+static void feFold(fe r, uint64_t c)
+{
+    int i;
+    uint128_t acc = (uint128_t)c * fold448;
+
+    for (i = 0; i < LIMBS; i++) {
+        acc += r[i];
+        r[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    /* a carry leaves r < fold448, the second fold cannot carry again */
+    c = (uint64_t)acc;
+    acc = (uint128_t)c * fold448;
+    for (i = 0; i < LIMBS; i++) {
+        acc += r[i];
+        r[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+}
+
+static void feAdd(fe r, const fe a, const fe b)
+{
+    int i;
+    uint128_t acc = 0;
+
+    for (i = 0; i < LIMBS; i++) {
+        acc += (uint128_t)a[i] + b[i];
+        r[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    feFold(r, (uint64_t)acc);
+}
+
+static void feSub(fe r, const fe a, const fe b)
+{
+    int i, k;
+    uint64_t borrow = 0;
+
+    for (i = 0; i < LIMBS; i++) {
+        uint128_t d = (uint128_t)a[i] - b[i] - borrow;
+        r[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    /* On borrow r holds a - b + 2^448, subtract 2^448 mod p. Two rounds cover a second wrap */
+    for (k = 0; k < 2; k++) {
+        uint64_t sub = fold448 & (0 - borrow);
+        uint128_t d = (uint128_t)r[0] - sub;
+        r[0] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+        for (i = 1; i < LIMBS; i++) {
+            d = (uint128_t)r[i] - borrow;
+            r[i] = (uint64_t)d;
+            borrow = (uint64_t)(d >> 64) & 1;
+        }
+    }
+}
+
+/* Reduce a 14 limb product */
+static void feReduce(fe r, const uint64_t t[2 * LIMBS])
+{
+    int i;
+    uint128_t acc = 0;
+
+    for (i = 0; i < LIMBS; i++) {
+        acc += (uint128_t)t[LIMBS + i] * fold448 + t[i];
+        r[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    feFold(r, (uint64_t)acc);
+}
+
+static void feMul(fe r, const fe a, const fe b)
+{
+    uint64_t t[2 * LIMBS] = {0};
+    int i, j;
+
+    for (i = 0; i < LIMBS; i++) {
+        uint128_t acc = 0;
+        for (j = 0; j < LIMBS; j++) {
+            acc += (uint128_t)a[i] * b[j] + t[i + j];
+            t[i + j] = (uint64_t)acc;
+            acc >>= 64;
+        }
+        t[i + LIMBS] = (uint64_t)acc;
+    }
+    feReduce(r, t);
+}
+
+static void feSquare(fe r, const fe a)
+{
+    uint64_t t[2 * LIMBS] = {0};
+    uint128_t acc;
+    uint64_t carry;
+    int i, j;
+
+    /* off-diagonal products once, then double and add the squares */
+    for (i = 0; i < LIMBS - 1; i++) {
+        acc = 0;
+        for (j = i + 1; j < LIMBS; j++) {
+            acc += (uint128_t)a[i] * a[j] + t[i + j];
+            t[i + j] = (uint64_t)acc;
+            acc >>= 64;
+        }
+        t[i + LIMBS] = (uint64_t)acc;
+    }
+    carry = 0;
+    for (i = 0; i < 2 * LIMBS; i++) {
+        uint64_t top = t[i] >> 63;
+        t[i] = (t[i] << 1) | carry;
+        carry = top;
+    }
+    acc = 0;
+    for (i = 0; i < LIMBS; i++) {
+        acc += (uint128_t)a[i] * a[i] + t[2 * i];
+        t[2 * i] = (uint64_t)acc;
+        acc >>= 64;
+        acc += t[2 * i + 1];
+        t[2 * i + 1] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    feReduce(r, t);
+}
+
+static void feMulSmall(fe r, const fe a, uint64_t b)
+{
+    int i;
+    uint128_t acc = 0;
+
+    for (i = 0; i < LIMBS; i++) {
+        acc += (uint128_t)a[i] * b;
+        r[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    feFold(r, (uint64_t)acc);
+}
+
+static void feSquareTimes(fe r, const fe a, int n)
+{
+    feSquare(r, a);
+    while (--n > 0)
+        feSquare(r, r);
+}
+
+/* r = a^(p-2) = a^(2^414 - 19) = (a^(2^409 - 1))^(2^5) * a^13 */
+static void feInvert(fe r, const fe a)
+{
+    fe a1, a2, a4, a8, a16, a32, a64, a128, t, a13;
+
+    feCopy(a1, a);
+    feSquare(t, a1);    feMul(a2, t, a1);
+    feSquareTimes(t, a2, 2);    feMul(a4, t, a2);
+    feSquareTimes(t, a4, 4);    feMul(a8, t, a4);
+    feSquareTimes(t, a8, 8);    feMul(a16, t, a8);
+    feSquareTimes(t, a16, 16);  feMul(a32, t, a16);
+    feSquareTimes(t, a32, 32);  feMul(a64, t, a32);
+    feSquareTimes(t, a64, 64);  feMul(a128, t, a64);
+    feSquareTimes(t, a128, 128); feMul(t, t, a128);     /* 2^256 - 1 */
+    feSquareTimes(t, t, 128);   feMul(t, t, a128);      /* 2^384 - 1 */
+    feSquareTimes(t, t, 16);    feMul(t, t, a16);       /* 2^400 - 1 */
+    feSquareTimes(t, t, 8);     feMul(t, t, a8);        /* 2^408 - 1 */
+    feSquare(t, t);             feMul(t, t, a1);        /* 2^409 - 1 */
+    feSquareTimes(t, t, 5);
+
+    feSquare(a13, a1);          feMul(a13, a13, a1);    /* a^3 */
+    feSquareTimes(a13, a13, 2); feMul(a13, a13, a1);    /* a^13 */
+    feMul(r, t, a13);
+}
+
+/* Reduce to the canonical value in [0, p) */
+static void feCanonical(fe r, const fe a)
+{
+    int i, k;
+    uint64_t mask = (1ULL << 30) - 1;     /* bits 384..413 in limb 6 */
+    uint128_t acc;
+    fe t;
+
+    feCopy(r, a);
+    /* fold bits 414 and above: 2^414 = 17 mod p, two rounds leave r < 2^414 */
+    for (k = 0; k < 2; k++) {
+        uint64_t high = r[6] >> 30;
+        r[6] &= mask;
+        acc = (uint128_t)high * 17;
+        for (i = 0; i < LIMBS; i++) {
+            acc += r[i];
+            r[i] = (uint64_t)acc;
+            acc >>= 64;
+        }
+    }
+    /* r < 2^414 now. r >= p if and only if r + 17 >= 2^414 */
+    acc = 17;
+    for (i = 0; i < LIMBS; i++) {
+        acc += r[i];
+        t[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    {
+        uint64_t sel = 0 - (t[6] >> 30);
+        t[6] &= mask;
+        for (i = 0; i < LIMBS; i++)
+            r[i] = (t[i] & sel) | (r[i] & ~sel);
+    }
+}
+
+static void feFromBytes(fe r, const unsigned char *in)
+{
+    int i, j;
+
+    memset(r, 0, sizeof(fe));
+    for (i = 0; i < 52; i++) {
+        j = i / 8;
+        r[j] |= (uint64_t)in[i] << (8 * (i % 8));
+    }
+}
+
+static void feToBytes(unsigned char *out, const fe a)
+{
+    fe t;
+    int i;
+
+    feCanonical(t, a);
+    for (i = 0; i < 52; i++)
+        out[i] = (unsigned char)(t[i / 8] >> (8 * (i % 8)));
+}
+
+static int feIsZero(const fe a)
+{
+    fe t;
+    uint64_t z = 0;
+    int i;
+
+    feCanonical(t, a);
+    for (i = 0; i < LIMBS; i++)
+        z |= t[i];
+    return z == 0;
+}
+
+static void feCondMove(fe r, const fe a, uint64_t sel)
+{
+    int i;
+    for (i = 0; i < LIMBS; i++)
+        r[i] = (a[i] & sel) | (r[i] & ~sel);
+}
+
+static void geIdentity(ge *r)
+{
+    feSetSmall(r->X, 0);
+    feSetSmall(r->Y, 1);
+    feSetSmall(r->Z, 1);
+    feSetSmall(r->T, 0);
+}
+
+/* add-2008-hwcd with a = 1 */
+static void geAdd(ge *r, const ge *p, const ge *q)
+{
+    fe A, B, C, D, E, F, G, H, t;
+
+    feMul(A, p->X, q->X);
+    feMul(B, p->Y, q->Y);
+    feMul(C, p->T, q->T);
+    feMulSmall(C, C, curveD);
+    feMul(D, p->Z, q->Z);
+
+    feAdd(E, p->X, p->Y);
+    feAdd(t, q->X, q->Y);
+    feMul(E, E, t);
+    feSub(E, E, A);
+    feSub(E, E, B);
+
+    feSub(F, D, C);
+    feAdd(G, D, C);
+    feSub(H, B, A);
+
+    feMul(r->X, E, F);
+    feMul(r->Y, G, H);
+    feMul(r->T, E, H);
+    feMul(r->Z, F, G);
+}
+
+/* dbl-2008-hwcd with a = 1, T is only needed if an addition follows */
+static void geDouble(ge *r, const ge *p, int withT)
+{
+    fe A, B, C, E, F, G, H;
+
+    feSquare(A, p->X);
+    feSquare(B, p->Y);
+    feSquare(C, p->Z);
+    feAdd(C, C, C);
+
+    feAdd(E, p->X, p->Y);
+    feSquare(E, E);
+    feSub(E, E, A);
+    feSub(E, E, B);
+
+    feAdd(G, A, B);
+    feSub(F, G, C);
+    feSub(H, A, B);
+
+    feMul(r->X, E, F);
+    feMul(r->Y, G, H);
+    if (withT)
+        feMul(r->T, E, H);
+    feMul(r->Z, F, G);
+}
+
+/* Constant time r = table[idx] */
+static void geSelect(ge *r, const ge table[16], uint32_t idx)
+{
+    uint32_t i;
+
+    geIdentity(r);
+    for (i = 0; i < 16; i++) {
+        uint64_t sel = 0 - (uint64_t)(((i ^ idx) - 1) >> 31);
+        feCondMove(r->X, table[i].X, sel);
+        feCondMove(r->Y, table[i].Y, sel);
+        feCondMove(r->Z, table[i].Z, sel);
+        feCondMove(r->T, table[i].T, sel);
+    }
+}
+
+int curve3617_mul(unsigned char *rx, unsigned char *ry,
+                  const unsigned char *px, const unsigned char *py, const unsigned char *scalar)
+{
+    ge table[16], r, s;
+    fe zInv;
+    int i, j;
+
+    /* table[i] = i * P */
+    geIdentity(&table[0]);
+    feFromBytes(table[1].X, px);
+    feFromBytes(table[1].Y, py);
+    feSetSmall(table[1].Z, 1);
+    feMul(table[1].T, table[1].X, table[1].Y);
+    for (i = 2; i < 16; i++) {
+        if (i & 1)
+            geAdd(&table[i], &table[i - 1], &table[1]);
+        else
+            geDouble(&table[i], &table[i / 2], 1);
+    }
+
+    geIdentity(&r);
+    for (i = 51; i >= 0; i--) {
+        for (j = 1; j >= 0; j--) {
+            geDouble(&r, &r, 0);
+            geDouble(&r, &r, 0);
+            geDouble(&r, &r, 0);
+            geDouble(&r, &r, 1);
+            geSelect(&s, table, (scalar[i] >> (4 * j)) & 0xf);
+            geAdd(&r, &r, &s);
+        }
+    }
+
+    if (feIsZero(r.Z))
+        return -1;
+
+    feInvert(zInv, r.Z);
+    feMul(r.X, r.X, zInv);
+    feMul(r.Y, r.Y, zInv);
+    feToBytes(rx, r.X);
+    feToBytes(ry, r.Y);
+
+    memset(table, 0, sizeof(table));
+    memset(&r, 0, sizeof(r));
+    memset(&s, 0, sizeof(s));
+    return 0;
+}
+
+#endif /* HAVE_CURVE3617_64 */
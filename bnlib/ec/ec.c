@@ -17,11 +17,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <bn.h>
 #include <bnprint.h>
 
 #include <ec/ec.h>
+#include <common/zrtpAlgorithms.h>
 
 static BigNum _mpiZero;
 static BigNum _mpiOne;
@@ -110,6 +112,7 @@ static curveData nist521 = {
 };
 
 
+#if ZRTP_WITH_NON_NIST
 /*
  * The data for curve3617 copied from:
  * http://safecurves.cr.yp.to/field.html
@@ -148,6 +151,7 @@ static curveData curve25519 = {
     "9",                                                                  /* Gx */
     "20ae19a1b8a086b4e01edd2c7748d14c923d4d7e6d7c61b229e9c5a27eced3d9",   /* Gy */
 };
+#endif
 
 /*============================================================================*/
 /*    Bignum Shorthand Functions                                              */
@@ -191,6 +195,12 @@ int bnSubQMod_ (struct BigNum *rslt, unsigned n1, struct BigNum *mod)
 
 int bnMulMod_ (struct BigNum *rslt, struct BigNum *n1, struct BigNum *n2, struct BigNum *mod, const EcCurve *curve)
 {
+    /* bnMul allocates a temporary copy of a factor that is also the result, use the scratch product */
+    if (curve && (rslt == n1 || rslt == n2)) {
+        bnMul (curve->prod, n1, n2);
+        curve->modOp(rslt, curve->prod, mod);
+        return 0;
+    }
     bnMul (rslt, n1, n2);
     if (curve)
         curve->modOp(rslt, rslt, mod);
@@ -211,6 +221,11 @@ int bnMulQMod_ (struct BigNum *rslt, struct BigNum *n1, unsigned n2, struct BigN
 
 int bnSquareMod_ (struct BigNum *rslt, struct BigNum *n1, struct BigNum *mod, const EcCurve *curve)
 {
+    if (curve && rslt == n1) {
+        bnSquare (curve->prod, n1);
+        curve->modOp(rslt, curve->prod, mod);
+        return 0;
+    }
     bnSquare (rslt, n1);
     if (curve)
         curve->modOp(rslt, rslt, mod);
@@ -230,27 +245,42 @@ int bnSquareMod_ (struct BigNum *rslt, struct BigNum *n1, struct BigNum *mod, co
  */
 
 static int ecGetAffineNist(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+#if ZRTP_WITH_NON_NIST
 static int ecGetAffineEd(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 static int ecGetAffine25519(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+#endif
 
 static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+#if ZRTP_WITH_NON_NIST
 static int ecDoublePointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 static int ecDoublePoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+#endif
 
 static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
+#if ZRTP_WITH_NON_NIST
 static int ecAddPointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
 static int ecAddPoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
+#endif
 
 static int ecCheckPubKeyNist(const EcCurve *curve, const EcPoint *pub);
+#if ZRTP_WITH_NON_NIST
 static int ecCheckPubKey3617(const EcCurve *curve, const EcPoint *pub);
 static int ecCheckPubKey25519(const EcCurve *curve, const EcPoint *pub);
+#endif
 
 static int ecGenerateRandomNumberNist(const EcCurve *curve, BigNum *d);
+#if ZRTP_WITH_NON_NIST
 static int ecGenerateRandomNumber3617(const EcCurve *curve, BigNum *d);
 static int ecGenerateRandomNumber25519(const EcCurve *curve, BigNum *d);
+#endif
 
 static int ecMulPointScalarNormal(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+#if ZRTP_WITH_NON_NIST
 static int ecMulPointScalar25519(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+#ifdef HAVE_CURVE3617_64
+static int ecMulPointScalar3617(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+#endif
+#endif
 
 /* Forward declaration of new modulo functions for the EC curves */
 static int newMod192(BigNum *r, const BigNum *a, const BigNum *modulo);
@@ -258,8 +288,10 @@ static int newMod256(BigNum *r, const BigNum *a, const BigNum *modulo);
 static int newMod384(BigNum *r, const BigNum *a, const BigNum *modulo);
 static int newMod521(BigNum *r, const BigNum *a, const BigNum *modulo);
 
+#if ZRTP_WITH_NON_NIST
 static int mod3617(BigNum *r, const BigNum *a, const BigNum *modulo);
 static int mod25519(BigNum *r, const BigNum *a, const BigNum *modulo);
+#endif
 
 static void commonInit()
 {
@@ -282,6 +314,28 @@ static void curveCommonInit(EcCurve *curve)
     bnBegin(&curve->_t1); curve->t1 = &curve->_t1;
     bnBegin(&curve->_t2); curve->t2 = &curve->_t2;
     bnBegin(&curve->_t3); curve->t3 = &curve->_t3;
+    bnBegin(&curve->_prod); curve->prod = &curve->_prod;
+    curve->tP = &curve->_tP; INIT_EC_POINT(curve->tP);
+    curve->tQ = &curve->_tQ; INIT_EC_POINT(curve->tQ);
+    curve->tN = &curve->_tN; INIT_EC_POINT(curve->tN);
+    curve->tR = &curve->_tR; INIT_EC_POINT(curve->tR);
+}
+
+/* Preallocate a curve parameter, bnReadAscii would grow it digit by digit */
+static void curveReadParameter(BigNum *bn, const char *str, int radix)
+{
+    bnPrealloc(bn, strlen(str) * 4 + 32);
+    bnReadAscii(bn, (char *)str, radix);
+}
+
+/* Preallocate the coordinates of a point that receives computation results */
+static void curvePreallocPoint(const EcCurve *curve, EcPoint *P)
+{
+    size_t maxBits = bnBits(curve->p) * 2 + 15;
+
+    bnPrealloc(P->x, maxBits);
+    bnPrealloc(P->y, maxBits);
+    bnPrealloc(P->z, maxBits);
 }
 
 static void curveCommonPrealloc(EcCurve *curve)
@@ -297,10 +351,16 @@ static void curveCommonPrealloc(EcCurve *curve)
     bnPrealloc(curve->U1, maxBits);
     bnPrealloc(curve->H, maxBits);
     bnPrealloc(curve->R, maxBits);
-    bnPrealloc(curve->S1, maxBits);
+    bnPrealloc(curve->t0, maxBits);
     bnPrealloc(curve->t1, maxBits);
     bnPrealloc(curve->t2, maxBits);
     bnPrealloc(curve->t3, maxBits);
+    bnPrealloc(curve->prod, maxBits);
+
+    curvePreallocPoint(curve, curve->tP);
+    curvePreallocPoint(curve, curve->tQ);
+    curvePreallocPoint(curve, curve->tN);
+    curvePreallocPoint(curve, curve->tR);
 }
 
 int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
@@ -365,15 +425,15 @@ int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
     curve->randomOp = ecGenerateRandomNumberNist;
     curve->mulScalar = ecMulPointScalarNormal;
 
-    bnReadAscii(curve->p, cd->p, 10);
-    bnReadAscii(curve->n, cd->n, 10);
-    bnReadAscii(curve->SEED, cd->SEED, 16);
-    bnReadAscii(curve->c, cd->c, 16);
+    curveReadParameter(curve->p, cd->p, 10);
+    curveReadParameter(curve->n, cd->n, 10);
+    curveReadParameter(curve->SEED, cd->SEED, 16);
+    curveReadParameter(curve->c, cd->c, 16);
     bnCopy(curve->a, curve->p);
     bnSub(curve->a, mpiThree);
-    bnReadAscii(curve->b, cd->b, 16);
-    bnReadAscii(curve->Gx, cd->Gx, 16);
-    bnReadAscii(curve->Gy, cd->Gy, 16);
+    curveReadParameter(curve->b, cd->b, 16);
+    curveReadParameter(curve->Gx, cd->Gx, 16);
+    curveReadParameter(curve->Gy, cd->Gy, 16);
 
     curveCommonPrealloc(curve);
     curve->id = curveId;
@@ -405,6 +465,7 @@ int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
     curveCommonInit(curve);
 
     switch (curveId) {
+#if ZRTP_WITH_NON_NIST
     case Curve3617:
         cd = &curve3617;
         curve->modOp = mod3617;
@@ -413,7 +474,11 @@ int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
         curve->addOp = ecAddPointEd;
         curve->checkPubOp = ecCheckPubKey3617;
         curve->randomOp = ecGenerateRandomNumber3617;
+#ifdef HAVE_CURVE3617_64
+        curve->mulScalar = ecMulPointScalar3617;
+#else
         curve->mulScalar = ecMulPointScalarNormal;
+#endif
 
         bnReadAscii(curve->a, "3617", 10);
         break;
@@ -430,15 +495,16 @@ int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
 
         bnReadAscii(curve->a, "486662", 10);
         break;
+#endif
 
     default:
         return -2;
     }
-    bnReadAscii(curve->p, cd->p, 16);
-    bnReadAscii(curve->n, cd->n, 16);
+    curveReadParameter(curve->p, cd->p, 16);
+    curveReadParameter(curve->n, cd->n, 16);
 
-    bnReadAscii(curve->Gx, cd->Gx, 16);
-    bnReadAscii(curve->Gy, cd->Gy, 16);
+    curveReadParameter(curve->Gx, cd->Gx, 16);
+    curveReadParameter(curve->Gy, cd->Gy, 16);
 
     curveCommonPrealloc(curve);
     curve->id = curveId;
@@ -454,6 +520,7 @@ void ecFreeCurveNistECp(EcCurve *curve)
     bnEnd(curve->n);
     bnEnd(curve->SEED);
     bnEnd(curve->c);
+    bnEnd(curve->a);
     bnEnd(curve->b);
     bnEnd(curve->Gx);
     bnEnd(curve->Gy);
@@ -466,6 +533,11 @@ void ecFreeCurveNistECp(EcCurve *curve)
     bnEnd(curve->t1);
     bnEnd(curve->t2);
     bnEnd(curve->t3);
+    bnEnd(curve->prod);
+    FREE_EC_POINT(curve->tP);
+    FREE_EC_POINT(curve->tQ);
+    FREE_EC_POINT(curve->tN);
+    FREE_EC_POINT(curve->tR);
 }
 
 /*
@@ -505,45 +577,38 @@ static int ecGetAffineNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 {
     int ret = 0;
 
-    struct BigNum z_1, z_2;
-
-    bnBegin(&z_1);
-    bnBegin(&z_2);
+    /* Use scratch t0 for z_1, t1 for z_2 */
 
     /* affine x = X / Z^2 */
-    bnInv (&z_1, P->z, curve->p);                 /* z_1 = Z^(-1) */
-    bnMulMod_(&z_2, &z_1, &z_1, curve->p, curve); /* z_2 = Z^(-2) */
-    bnMulMod_(R->x, P->x, &z_2, curve->p, curve);
+    bnInv (curve->t0, P->z, curve->p);                       /* z_1 = Z^(-1) */
+    bnMulMod_(curve->t1, curve->t0, curve->t0, curve->p, curve); /* z_2 = Z^(-2) */
+    bnMulMod_(R->x, P->x, curve->t1, curve->p, curve);
 
     /* affine y = Y / Z^3 */
-    bnMulMod_(&z_2, &z_2, &z_1, curve->p, curve); /* z_2 = Z^(-3) */
-    bnMulMod_(R->y, P->y, &z_2, curve->p, curve);
+    bnMulMod_(curve->t1, curve->t1, curve->t0, curve->p, curve); /* z_2 = Z^(-3) */
+    bnMulMod_(R->y, P->y, curve->t1, curve->p, curve);
 
     bnSetQ(R->z, 1);
 
-    bnEnd(&z_1);
-    bnEnd(&z_2);
     return ret;
 }
 
+#if ZRTP_WITH_NON_NIST
 static int ecGetAffineEd(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 {
     int ret = 0;
 
-    struct BigNum z_1;
-
-    bnBegin(&z_1);
+    /* Use scratch t0 for z_1 */
 
     /* affine x = X / Z */
-    bnInv (&z_1, P->z, curve->p);                 /* z_1 = Z^(-1) */
-    bnMulMod_(R->x, P->x, &z_1, curve->p, curve);
+    bnInv (curve->t0, P->z, curve->p);                 /* z_1 = Z^(-1) */
+    bnMulMod_(R->x, P->x, curve->t0, curve->p, curve);
 
     /* affine y = Y / Z */
-    bnMulMod_(R->y, P->y, &z_1, curve->p, curve);
+    bnMulMod_(R->y, P->y, curve->t0, curve->p, curve);
 
     bnSetQ(R->z, 1);
 
-    bnEnd(&z_1);
     return ret;
 
 }
@@ -561,6 +626,7 @@ static int ecGetAffine25519(const EcCurve *curve, EcPoint *R, const EcPoint *P)
     }
     return 0;
 }
+#endif
 
 int ecDoublePoint(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 {
@@ -571,7 +637,6 @@ static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 {
     int ret = 0;
 
-    EcPoint tP;
     const EcPoint *ptP = 0;
 
     if (!bnCmp(P->y, mpiZero) || !bnCmp(P->z, mpiZero)) {
@@ -583,11 +648,10 @@ static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 
     /* Check for overlapping arguments, copy if necessary and set pointer */
     if (P == R) {
-        INIT_EC_POINT(&tP);
-        ptP = &tP;
-        bnCopy(tP.x, P->x);
-        bnCopy(tP.y, P->y);
-        bnCopy(tP.z, P->z);
+        ptP = curve->tP;
+        bnCopy(curve->tP->x, P->x);
+        bnCopy(curve->tP->y, P->y);
+        bnCopy(curve->tP->z, P->z);
     }
     else 
         ptP = P;
@@ -625,24 +689,20 @@ static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
     bnMulMod_(curve->t0, ptP->y, mpiTwo, curve->p, curve);       /* t0 = 2 * Y */
     bnMulMod_(R->z, curve->t0, ptP->z, curve->p, curve);         /* Z' = to * Z */
 
-    if (P == R)
-        FREE_EC_POINT(&tP);
-
     return ret;
 }
 
+#if ZRTP_WITH_NON_NIST
 static int ecDoublePointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 {
-    EcPoint tP;
     const EcPoint *ptP = 0;
 
     /* Check for overlapping arguments, copy if necessary and set pointer */
     if (P == R) {
-        INIT_EC_POINT(&tP);
-        ptP = &tP;
-        bnCopy(tP.x, P->x);
-        bnCopy(tP.y, P->y);
-        bnCopy(tP.z, P->z);
+        ptP = curve->tP;
+        bnCopy(curve->tP->x, P->x);
+        bnCopy(curve->tP->y, P->y);
+        bnCopy(curve->tP->z, P->z);
     }
     else 
         ptP = P;
@@ -676,9 +736,6 @@ static int ecDoublePointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P)
     /* Compute Rz */
     bnMulMod_(R->z, curve->t2, curve->t1, curve->p, curve);    /* J * E */
 
-    if (P == R)
-        FREE_EC_POINT(&tP);
-
     return 0;
 }
 
@@ -689,6 +746,7 @@ static int ecDoublePoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P
 {
     return -2;
 }
+#endif
 
 /* Add two elliptic curve points. Any of them may be the same object. */
 int ecAddPoint(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q)
@@ -700,7 +758,6 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
 {
     int ret = 0;
 
-    EcPoint tP, tQ;
     const EcPoint *ptP = 0;
     const EcPoint *ptQ = 0;
 
@@ -728,21 +785,19 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
 
     /* Check for overlapping arguments, copy if necessary and set pointers */
     if (P == R) {
-        INIT_EC_POINT(&tP);
-        ptP = &tP;
-        bnCopy(tP.x, P->x);
-        bnCopy(tP.y, P->y);
-        bnCopy(tP.z, P->z);
+        ptP = curve->tP;
+        bnCopy(curve->tP->x, P->x);
+        bnCopy(curve->tP->y, P->y);
+        bnCopy(curve->tP->z, P->z);
     }
     else 
         ptP = P;
 
     if (Q == R) {
-        INIT_EC_POINT(&tQ);
-        ptQ = &tQ;
-        bnCopy(tQ.x, Q->x);
-        bnCopy(tQ.y, Q->y);
-        bnCopy(tQ.z, Q->z);
+        ptQ = curve->tQ;
+        bnCopy(curve->tQ->x, Q->x);
+        bnCopy(curve->tQ->y, Q->y);
+        bnCopy(curve->tQ->z, Q->z);
     }
     else
         ptQ = Q;
@@ -803,13 +858,10 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
     bnMulMod_(curve->t2, curve->H, P->z, curve->p, curve);       /* t2 = H * Z1 */
     bnMulMod_(R->z, curve->t2, Q->z, curve->p, curve);           /* Z3 = t2 * Z2 */
 
-    if (P == R)
-        FREE_EC_POINT(&tP);
-    if (Q == R)
-        FREE_EC_POINT(&tQ);
     return ret;
 }
 
+#if ZRTP_WITH_NON_NIST
 /*
  * Refer to the document: Faster addition and doubling on elliptic curves; Daniel J. Bernstein and Tanja Lange
  * section 4.
@@ -819,7 +871,6 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
  */
 static int ecAddPointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q)
 {
-    EcPoint tP, tQ;
     const EcPoint *ptP = 0;
     const EcPoint *ptQ = 0;
 
@@ -841,21 +892,19 @@ static int ecAddPointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, cons
 
     /* Check for overlapping arguments, copy if necessary and set pointers */
     if (P == R) {
-        INIT_EC_POINT(&tP);
-        ptP = &tP;
-        bnCopy(tP.x, P->x);
-        bnCopy(tP.y, P->y);
-        bnCopy(tP.z, P->z);
+        ptP = curve->tP;
+        bnCopy(curve->tP->x, P->x);
+        bnCopy(curve->tP->y, P->y);
+        bnCopy(curve->tP->z, P->z);
     }
     else 
         ptP = P;
 
     if (Q == R) {
-        INIT_EC_POINT(&tQ);
-        ptQ = &tQ;
-        bnCopy(tQ.x, Q->x);
-        bnCopy(tQ.y, Q->y);
-        bnCopy(tQ.z, Q->z);
+        ptQ = curve->tQ;
+        bnCopy(curve->tQ->x, Q->x);
+        bnCopy(curve->tQ->y, Q->y);
+        bnCopy(curve->tQ->z, Q->z);
     }
     else
         ptQ = Q;
@@ -898,11 +947,6 @@ static int ecAddPointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, cons
     bnMulMod_(R->y, curve->t2, R->z, curve->p, curve);           /* Ry = t2 * G */
     bnMulMod_(R->z, curve->t3, R->z, curve->p, curve);           /* Rz = F * G */
 
-    if (P == R)
-        FREE_EC_POINT(&tP);
-    if (Q == R)
-        FREE_EC_POINT(&tQ);
-
     return 0;
 }
 
@@ -913,6 +957,7 @@ static int ecAddPoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P, c
 {
     return -2;
 }
+#endif
 
 int ecMulPointScalar(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar)
 {
@@ -924,12 +969,12 @@ static int ecMulPointScalarNormal(const EcCurve *curve, EcPoint *R, const EcPoin
     int ret = 0;
     int i;
     int bits = bnBits(scalar);
-    EcPoint n;
+    EcPoint *n = curve->tN;
 
-    INIT_EC_POINT(&n);
-    bnCopy(n.x, P->x);
-    bnCopy(n.y, P->y);
-    bnCopy(n.z, P->z);
+    curvePreallocPoint(curve, R);
+    bnCopy(n->x, P->x);
+    bnCopy(n->y, P->y);
+    bnCopy(n->z, P->z);
 
     bnSetQ(R->x, 0);
     bnSetQ(R->y, 0);
@@ -937,15 +982,15 @@ static int ecMulPointScalarNormal(const EcCurve *curve, EcPoint *R, const EcPoin
 
     for (i = 0; i < bits; i++) {
         if (bnReadBit(scalar, i))
-            ecAddPoint(curve, R, R, &n);
+            ecAddPoint(curve, R, R, n);
 
-        /*        ecAddPoint(curve, &n, &n, &n); */
-        ecDoublePoint(curve, &n, &n);
+        /*        ecAddPoint(curve, n, n, n); */
+        ecDoublePoint(curve, n, n);
     }
-    FREE_EC_POINT(&n);
     return ret;
 }
 
+#if ZRTP_WITH_NON_NIST
 /* 
  * This function uses BigNumber only as containers to transport the 32 byte data.
  * This makes it compliant to the other functions and thus higher-level API does not change.
@@ -963,6 +1008,43 @@ static int ecMulPointScalar25519(const EcCurve *curve, EcPoint *R, const EcPoint
     return 0;
 }
 
+#ifdef HAVE_CURVE3617_64
+/*
+ * Use BigNumber only as containers to transport the 52 byte data, the fixed width
+ * functions in curve3617.c do all the work. The result is in affine coordinates.
+ */
+static int ecMulPointScalar3617(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar)
+{
+    uint8_t px[52], py[52], secret[52], rx[52], ry[52];
+    int ret;
+
+    if (bnCmpQ(P->z, 1) != 0) {
+        EcPoint tP;
+        INIT_EC_POINT(&tP);
+        ecGetAffineEd(curve, &tP, P);
+        bnExtractLittleBytes(tP.x, px, 0, 52);
+        bnExtractLittleBytes(tP.y, py, 0, 52);
+        FREE_EC_POINT(&tP);
+    }
+    else {
+        bnExtractLittleBytes(P->x, px, 0, 52);
+        bnExtractLittleBytes(P->y, py, 0, 52);
+    }
+    bnExtractLittleBytes(scalar, secret, 0, 52);
+
+    ret = curve3617_mul(rx, ry, px, py, secret);
+    memset(secret, 0, sizeof(secret));
+    if (ret < 0)
+        return ret;
+
+    bnInsertLittleBytes(R->x, rx, 0, 52);
+    bnInsertLittleBytes(R->y, ry, 0, 52);
+    bnSetQ(R->z, 1);
+    return 0;
+}
+#endif
+#endif /* ZRTP_WITH_NON_NIST */
+
 #ifdef WEAKRANDOM
 #include <fcntl.h>
 
@@ -1002,35 +1084,34 @@ int ecGenerateRandomNumber(const EcCurve *curve, BigNum *d)
 
 static int ecGenerateRandomNumberNist(const EcCurve *curve, BigNum *d)
 {
-    BigNum c, nMinusOne;
+    /* Use scratch t0 for c, t1 for nMinusOne */
+    BigNum *c = curve->t0;
+    BigNum *nMinusOne = curve->t1;
     uint8_t ran[MAX_RANDOM_BYTES];
     size_t randomBytes = ((bnBits(curve->n) + 64) + 7) / 8;
 
     if (randomBytes > MAX_RANDOM_BYTES)
         return -1;
 
-    bnBegin(&c);
-    bnBegin(&nMinusOne);
-
-    bnCopy(&nMinusOne, curve->n);
-    bnSubMod_(&nMinusOne, mpiOne, curve->p);
+    bnCopy(nMinusOne, curve->n);
+    bnSubMod_(nMinusOne, mpiOne, curve->p);
 
     bnSetQ(d, 0);
 
     while (!bnCmpQ(d, 0)) {
         /* use _random function */
         _random(ran, randomBytes);
-        bnInsertBigBytes(&c, ran, 0, randomBytes);
-        bnMod(d, &c, &nMinusOne);
+        bnInsertBigBytes(c, ran, 0, randomBytes);
+        bnMod(d, c, nMinusOne);
         bnAddMod_(d, mpiOne, curve->p);
     }
-
-    bnEnd(&c);
-    bnEnd(&nMinusOne);
+    memset(ran, 0, sizeof(ran));
+    bnSetQ(c, 0);
 
     return 0;
 }
 
+#if ZRTP_WITH_NON_NIST
 static int ecGenerateRandomNumber3617(const EcCurve *curve, BigNum *d)
 {
     unsigned char random[52];
@@ -1065,6 +1146,7 @@ static int ecGenerateRandomNumber25519(const EcCurve *curve, BigNum *d)
     return 0;
 
 }
+#endif
 
 int ecCheckPubKey(const EcCurve *curve, const EcPoint *pub)
 {
@@ -1097,6 +1179,7 @@ static int ecCheckPubKeyNist(const NistECpCurve *curve, const EcPoint *pub)
 
 }
 
+#if ZRTP_WITH_NON_NIST
 static int ecCheckPubKey3617(const EcCurve *curve, const EcPoint *pub)
 {
     /* Represent point at infinity by (0, 0), make sure it's not that */
@@ -1137,11 +1220,15 @@ static int ecCheckPubKey25519(const EcCurve *curve, const EcPoint *pub)
 
 static int mod3617(BigNum *r, const BigNum *a, const BigNum *modulo)
 {
-    unsigned char buffer[52] = {0};
+    /* a holds at most p^2 plus one nimb, (2*414+15) bits, see curveCommonPrealloc.
+     * The top bytes stay zero, the loop below reads hi up to byte 115. */
+    unsigned char buffer[112 + 16] = {0};
+    unsigned char result[64];
+    unsigned int ac;
+    unsigned int hi;
     int cmp;
-    BigNum tmp;
+    int i;
 
-    bnBegin(&tmp);
     cmp = bnCmp(modulo, a);
     if (cmp == 0) {             /* a is equal modulo, set resul to zero */
         bnSetQ(r, 0);
@@ -1151,22 +1238,32 @@ static int mod3617(BigNum *r, const BigNum *a, const BigNum *modulo)
         bnCopy(r, a);
         return 0;
     }
-    bnExtractLittleBytes(a, buffer, 0, 52);
-    buffer[51] &= 0x3f;
+    if (bnBytes(a) > 112)
+        return -1;
 
-    bnCopy(&tmp, a);
-    bnRShift(&tmp, 414);
-    bnCopy(r, &tmp);
-    bnLShift(r, 4);
-    bnAdd(r, &tmp);
+    bnExtractLittleBytes(a, buffer, 0, 112);
 
-    bnInsertLittleBytes(&tmp, buffer, 0, 52);
+    /*
+     * p = 2^414 - 17, thus a = hi * 2^414 + lo = hi * 17 + lo (mod p).
+     * hi starts at bit 6 of byte 51, lo are the 414 bits below.
+     */
+    ac = 0;
+    for (i = 0; i < (int)sizeof(result); i++) {
+        hi = (buffer[51+i] >> 6) | ((unsigned int)buffer[52+i] << 2);
+        ac += (hi & 0xff) * 17;
+        if (i < 51)
+            ac += buffer[i];
+        else if (i == 51)
+            ac += buffer[51] & 0x3f;
+        result[i] = ac & 0xff;
+        ac >>= 8;
+    }
+    bnSetQ(r, 0);               /* r may be a, the insert keeps the bytes above result */
+    bnInsertLittleBytes(r, result, 0, sizeof(result));
 
-    bnAdd(r, &tmp);
     while (bnCmp(r, modulo) >= 0) {
         bnSub(r, modulo);
     }
-    bnEnd(&tmp);
     return 0;
 }
 
@@ -1177,6 +1274,7 @@ static int mod25519(BigNum *r, const BigNum *a, const BigNum *modulo)
 {
     return -2;
 }
+#endif
 
 /*
  * Beware: Here are the dragons.
@@ -1446,12 +1544,10 @@ static int newMod256(BigNum *r, const BigNum *a, const BigNum *modulo)
          * we effectiviely doing a mod(256)
          */
         if (msb > 0) {
-            BigNum tmp;
-            bnBegin(&tmp);
-            bnSetQ (&tmp, 1);
-            bnLShift (&tmp, maxMsb);
-            bnMod(r, r, &tmp);
-            bnEnd(&tmp);
+            /* r mod 2^maxMsb, keep the low bytes, maxMsb is a multiple of 8 */
+            bnExtractBigBytes(r, buffer, 0, maxMsb / 8);
+            bnSetQ(r, 0);
+            bnInsertBigBytes(r, buffer, 0, maxMsb / 8);
         }
     }
     else {
@@ -1639,12 +1735,10 @@ static int newMod384(BigNum *r, const BigNum *a, const BigNum *modulo)
          * we effectiviely doing a mod(384)
          */
         if (msb > 0) {
-            BigNum tmp;
-            bnBegin(&tmp);
-            bnSetQ (&tmp, 1);
-            bnLShift (&tmp, maxMsb);
-            bnMod(r, r, &tmp);
-            bnEnd(&tmp);
+            /* r mod 2^maxMsb, keep the low bytes, maxMsb is a multiple of 8 */
+            bnExtractBigBytes(r, buffer, 0, maxMsb / 8);
+            bnSetQ(r, 0);
+            bnInsertBigBytes(r, buffer, 0, maxMsb / 8);
         }
     }
     else {
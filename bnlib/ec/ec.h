@@ -87,6 +87,15 @@ struct EcCurve {
        avoid to much memory allocation/deallocatio0n overhead */
   BigNum _S1, _U1, _H, _R, _t0, _t1, _t2, _t3;
   BigNum *S1, *U1, *H, *R, *t0, *t1, *t2, *t3;
+  /* product of a modular multiplication whose result overlaps a factor */
+  BigNum _prod;
+  BigNum *prod;
+  /* scratch points, double and add copy overlapping arguments into them */
+  EcPoint _tP, _tQ;
+  EcPoint *tP, *tQ;
+  /* scratch points, scalar multiplication doubles in tN, ECDH computes in tR */
+  EcPoint _tN, _tR;
+  EcPoint *tN, *tR;
   int (*affineOp)(const struct EcCurve *curve, EcPoint *R, const EcPoint *P);
   int (*doubleOp)(const struct EcCurve *curve, EcPoint *R, const EcPoint *P);
   int (*addOp)(const struct EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
@@ -255,6 +264,21 @@ void ecFreeCurvesCurve(EcCurve *curve);
  */
 int curve25519_donna(unsigned char *mypublic, const unsigned char *secret, const unsigned char *basepoint);
 
+#if defined(__SIZEOF_INT128__)
+#define HAVE_CURVE3617_64
+
+/**
+ * Fixed width scalar multiplication for Curve3617, needs 128 bit integer support.
+ *
+ * All values are 52 byte little endian numbers, the point is in affine coordinates.
+ * Computes R = scalar * P and returns R in affine coordinates.
+ *
+ * @returns 0 if OK, -1 if the result is not a valid affine point.
+ */
+int curve3617_mul(unsigned char *rx, unsigned char *ry,
+                  const unsigned char *px, const unsigned char *py, const unsigned char *scalar);
+#endif
+
 /*
  * Some additional functions that are not available in bnlib
  */
@@ -19,32 +19,27 @@
 
 int ecdhGeneratePublic(const EcCurve *curve, EcPoint *Q, const BigNum *d)
 {
-    EcPoint G;
+    /* The base point uses the curve's scratch point */
+    EcPoint *G = curve->tR;
 
-    INIT_EC_POINT(&G);
-    SET_EC_BASE_POINT(curve, &G);
+    SET_EC_BASE_POINT(curve, G);
 
-    ecMulPointScalar(curve, Q, &G, d);
+    ecMulPointScalar(curve, Q, G, d);
     ecGetAffine(curve, Q, Q);
 
-    FREE_EC_POINT(&G);
-
     return ecCheckPubKey(curve, Q);
 }
 
 int ecdhComputeAgreement(const EcCurve *curve, BigNum *agreement, const EcPoint *Q, const BigNum *d)
 {
-    EcPoint t0;
-
-    INIT_EC_POINT(&t0);
+    /* The result point uses the curve's scratch point */
+    EcPoint *t0 = curve->tR;
 
-    ecMulPointScalar(curve, &t0, Q, d);
-    ecGetAffine(curve, &t0, &t0);
+    ecMulPointScalar(curve, t0, Q, d);
+    ecGetAffine(curve, t0, t0);
     /* TODO: check for infinity here */
 
-    bnCopy(agreement, t0.x);
-
-    FREE_EC_POINT(&t0);
+    bnCopy(agreement, t0->x);
 
     return 0;
 }
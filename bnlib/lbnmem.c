@@ -64,6 +64,11 @@ void free();
 #include "lbn.h"
 #include "lbnmem.h"
 
+#include <common/zrtpAllocator.h>
+
+/* Limbs may hold private keys, thus allocate them as secret memory */
+#define LBN_MEM_FLAGS (ZRTP_MEM_BIGNUM | ZRTP_MEM_SECRET)
+
 #include "kludge.h"
 
 /*
@@ -84,26 +89,86 @@ lbnMemWipe(void *ptr, unsigned bytes)
 #define lbnMemWipe(ptr, bytes) memset(ptr, 0, bytes)
 #endif
 
+/*
+ * Scratch area for temporary limbs, see bnScratchBegin() in bn.h.
+ * lbnMemAlloc() takes blocks from the buffer while a scratch window is
+ * open and falls back to the allocator hook when the buffer is exhausted.
+ * The blocks are wiped on free, the area is rewound once the last block
+ * is freed.  lbnRealloc() always uses the allocator hook.
+ */
+#if defined(_MSC_VER)
+#define LBN_THREAD_LOCAL __declspec(thread)
+#else
+#define LBN_THREAD_LOCAL __thread
+#endif
+
+#define LBN_SCRATCH_ALIGN 16
+
+struct lbnScratch {
+	unsigned char *buf;
+	unsigned size;
+	unsigned top;
+	unsigned live;
+};
+
+static LBN_THREAD_LOCAL struct lbnScratch scratch;
+
+void
+bnScratchBegin(void *buf, unsigned bytes)
+{
+	scratch.buf = (unsigned char *)buf;
+	scratch.size = buf ? bytes : 0;
+	scratch.top = 0;
+	scratch.live = 0;
+}
+
+void
+bnScratchEnd(void)
+{
+	scratch.buf = 0;
+	scratch.size = 0;
+	scratch.top = 0;
+	scratch.live = 0;
+}
+
 #ifndef lbnMemAlloc
 void *
 lbnMemAlloc(unsigned bytes)
 {
-	return malloc(bytes);
+	unsigned need = (bytes + LBN_SCRATCH_ALIGN-1) & ~(LBN_SCRATCH_ALIGN-1);
+
+	if (scratch.buf && need <= scratch.size - scratch.top) {
+		void *ptr = scratch.buf + scratch.top;
+
+		scratch.top += need;
+		scratch.live++;
+		return ptr;
+	}
+	return zrtpMemAlloc(bytes, LBN_MEM_FLAGS);
 }
-#define lbnMemAlloc(bytes) malloc(bytes)
+#define lbnMemAlloc(bytes) zrtpMemAlloc(bytes, LBN_MEM_FLAGS)
 #endif
 
 #ifndef lbnMemFree
 void
 lbnMemFree(void *ptr, unsigned bytes)
 {
-	lbnMemWipe(ptr, bytes);
-	free(ptr);
+	unsigned char *p = (unsigned char *)ptr;
+
+	if (scratch.buf && p >= scratch.buf && p < scratch.buf + scratch.size) {
+		(*memset_volatile)(p, 0, bytes);
+		if (--scratch.live == 0)
+			scratch.top = 0;
+		return;
+	}
+	zrtpMemFree(ptr, bytes, LBN_MEM_FLAGS);	/* Wipes the limbs */
 }
 #endif
 
 #ifndef lbnRealloc
-#if defined(lbnMemRealloc) || !BNSECURE
+/* The allocator hook has no realloc, use the copying version unless the
+ * configuration provides lbnMemRealloc */
+#if defined(lbnMemRealloc)
 void *
 lbnRealloc(void *ptr, unsigned oldbytes, unsigned newbytes)
 {
@@ -126,7 +191,7 @@ lbnRealloc(void *ptr, unsigned oldbytes, unsigned newbytes)
 	return ptr;
 }
 
-#else /* BNSECURE */
+#else /* !lbnMemRealloc */
 
 void *
 lbnRealloc(void *oldptr, unsigned oldbytes, unsigned newbytes)
@@ -158,5 +223,5 @@ lbnRealloc(void *oldptr, unsigned oldbytes, unsigned newbytes)
 
 	return newptr;
 }
-#endif /* BNSECURE */
+#endif /* !lbnMemRealloc */
 #endif /* !lbnRealloc */
@@ -548,7 +548,7 @@ bool ZrtpQueue::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
     return true;
 }
 
-void ZrtpQueue::srtpSecretsOn(std::string c, std::string s, bool verified)
+void ZrtpQueue::srtpSecretsOn(const std::string& c, const std::string& s, bool verified)
 {
 
   if (zrtpUserCallback != NULL) {
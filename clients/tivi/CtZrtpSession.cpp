@@ -20,10 +20,12 @@
  */
 
 #include <string>
+#include <vector>
 #include <stdio.h>
 
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpConfigProfile.h>
 
 #include <CtZrtpStream.h>
 #include <CtZrtpCallback.h>
@@ -31,14 +33,20 @@
 
 #include <clients/tivi/timeoutHelper/Thread.h>
 
-static CMutexClass sessionLock;
+static LockClass sessionLockClass("CtZrtpSession");
+static CMutexClass sessionLock(&sessionLockClass);
+
+// Compiled from the global configuration keys on first use, guarded by sessionLock,
+// see resetDefaultProfile
+static std::shared_ptr<const ZrtpConfigProfile> defaultProfile;
 
 const char *getZrtpBuildInfo()
 {
     return zrtpBuildInfo;
 }
 CtZrtpSession::CtZrtpSession() : zrtpMaster(NULL), mitmMode(false), signSas(false), enableParanoidMode(false), isReady(false),
-    zrtpEnabled(true), sdesEnabled(true), discriminatorMode(false) {
+    zrtpEnabled(true), sdesEnabled(true), discriminatorMode(false), parallelHandshake(false),
+    peerParallelHandshake(false) {
 
     clientIdString = clientId;
     streams[AudioStream] = NULL;
@@ -63,22 +71,39 @@ int CtZrtpSession::initCache(const char *zidFilename) {
     return 1;
 }
 
+void CtZrtpSession::setEventLoop(ZrtpEventLoop* loop) {
+    CtZrtpStream::setEventLoop(loop);
+}
+
 int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* config)
+{
+    std::shared_ptr<const ZrtpConfigProfile> profile;
+
+    // Compile an explicit configuration once for both streams
+    if (config != NULL)
+        profile = ZrtpConfigProfile::compile(std::string(), *config);
+    return init(audio, video, callId, profile);
+}
+
+int CtZrtpSession::init(bool audio, bool video, int32_t callId, std::shared_ptr<const ZrtpConfigProfile> profile)
 {
     int32_t ret = 1;
 
     synchEnter();
 
-    ZrtpConfigure* configOwn = NULL;
-    if (config == NULL) {
-        config = configOwn = new ZrtpConfigure();
-        setupConfiguration(config);
-        config->setTrustedMitM(false);
+    // Compile the default profile once, resetDefaultProfile forces a new one
+    if (!profile) {
+        if (!defaultProfile) {
+            ZrtpConfigure config;
+            setupConfiguration(&config);
+            config.setTrustedMitM(false);
 #if defined AXO_SUPPORT
-        config->setSasSignature(true);
+            config.setSasSignature(true);
 #endif
+            defaultProfile = ZrtpConfigProfile::compile(std::string(), config);
+        }
+        profile = defaultProfile;
     }
-    config->setParanoidMode(enableParanoidMode);
     callId_ = callId;
 
     ZIDCache* zf = getZidCacheInstance();
@@ -95,7 +120,8 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
             if (streams[AudioStream] == NULL)
                 streams[AudioStream] = new CtZrtpStream();
             stream = streams[AudioStream];
-            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config, mitmMode, signSas);
+            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, profile, mitmMode, signSas);
+            stream->zrtpEngine->setParanoidMode(enableParanoidMode);
             stream->type = Master;
             stream->index = AudioStream;
             stream->session = this;
@@ -105,7 +131,8 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
             if (streams[VideoStream] == NULL)
                 streams[VideoStream] = new CtZrtpStream();
             stream = streams[VideoStream];
-            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config);
+            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, profile);
+            stream->zrtpEngine->setParanoidMode(enableParanoidMode);
             stream->type = Slave;
             stream->index = VideoStream;
             stream->session = this;
@@ -113,13 +140,17 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
         }
         isReady = true;
     }
-    if (configOwn != NULL) {
-        delete configOwn;
-    }
     synchLeave();
     return ret;
 }
 
+void CtZrtpSession::resetDefaultProfile()
+{
+    sessionLock.Lock();
+    defaultProfile.reset();
+    sessionLock.Unlock();
+}
+
 CtZrtpSession::~CtZrtpSession() {
 
     delete streams[AudioStream];
@@ -328,11 +359,14 @@ void CtZrtpSession::masterStreamSecure(CtZrtpStream *masterStream) {
 
     multiStreamParameter = masterStream->zrtpEngine->getMultiStrParams(&zrtpMaster);
     CtZrtpStream *strm = streams[VideoStream];
-    if (strm->enableZrtp) {
+
+    // A slave that runs a parallel DH mode handshake is already started
+    if (strm->enableZrtp && !strm->started) {
         strm->zrtpEngine->setMultiStrParams(multiStreamParameter, zrtpMaster);
         strm->zrtpEngine->startZrtpEngine();
         strm->started = true;
         strm->tiviState = eLookingPeer;
+        strm->statusChanged();
         if (strm->zrtpUserCallback != 0)
             strm->zrtpUserCallback->onNewZrtpStatus(this, NULL, strm->index);
 
@@ -343,7 +377,7 @@ int CtZrtpSession::startIfNotStarted(unsigned int uiSSRC, int streamNm) {
     if (!(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return 0;
 
-    if ((streamNm == VideoStream && !isSecure(AudioStream)) || streams[streamNm]->started)
+    if ((streamNm == VideoStream && !isSecure(AudioStream) && !isParallelHandshake()) || streams[streamNm]->started)
         return 0;
 
     start(uiSSRC, streamNm == VideoStream ? CtZrtpSession::VideoStream : CtZrtpSession::AudioStream);
@@ -362,6 +396,7 @@ void CtZrtpSession::start(unsigned int uiSSRC, CtZrtpSession::streamName streamN
         stream->zrtpEngine->startZrtpEngine();
         stream->started = true;
         stream->tiviState = eLookingPeer;
+        stream->statusChanged();
         if (stream->zrtpUserCallback != 0)
             stream->zrtpUserCallback->onNewZrtpStatus(this, NULL, stream->index);
         return;
@@ -369,12 +404,18 @@ void CtZrtpSession::start(unsigned int uiSSRC, CtZrtpSession::streamName streamN
     // Process a Slave stream.
     if (!multiStreamParameter.empty()) {        // Multi-stream parameters available
         stream->zrtpEngine->setMultiStrParams(multiStreamParameter, zrtpMaster);
-        stream->zrtpEngine->startZrtpEngine();
-        stream->started = true;
-        stream->tiviState = eLookingPeer;
-        if (stream->zrtpUserCallback != 0)
-            stream->zrtpUserCallback->onNewZrtpStatus(this, NULL, stream->index);
     }
+    else if (isParallelHandshake()) {           // Independent DH mode handshake, the master updates the cache
+        stream->zrtpEngine->setCacheReadOnly(true);
+    }
+    else
+        return;
+    stream->zrtpEngine->startZrtpEngine();
+    stream->started = true;
+    stream->tiviState = eLookingPeer;
+    stream->statusChanged();
+    if (stream->zrtpUserCallback != 0)
+        stream->zrtpUserCallback->onNewZrtpStatus(this, NULL, stream->index);
 }
 
 void CtZrtpSession::stop(streamName streamNm) {
@@ -398,6 +439,27 @@ void CtZrtpSession::release(streamName streamNm) {
     stream->stopStream();                      // stop and reset stream
 }
 
+void CtZrtpSession::releaseSessions(CtZrtpSession** sessions, int32_t count) {
+    std::vector<CtZrtpStream*> group;
+
+    group.reserve(count * AllStreams);
+    for (int32_t i = 0; i < count; i++) {
+        if (sessions[i] == NULL)
+            continue;
+        for (int32_t s = 0; s < AllStreams; s++)
+            group.push_back(sessions[i]->streams[s]);
+    }
+    CtZrtpStream::cancelTimers(group.data(), static_cast<int32_t>(group.size()));
+
+    ZIDCache* zf = getZidCacheInstance();
+    zf->beginBatch();
+    for (int32_t i = 0; i < count; i++) {
+        if (sessions[i] != NULL)
+            sessions[i]->release();
+    }
+    zf->endBatch();
+}
+
 void CtZrtpSession::setLastPeerNameVerify(const char *name, int iIsMitm) {
     CtZrtpStream *stream = streams[AudioStream];
 
@@ -533,6 +595,7 @@ void CtZrtpSession::setVerify(int iVerified) {
         stream->zrtpEngine->resetSASVerified();
         stream->sasVerified = false;
     }
+    stream->statusChanged();
 }
 
 int CtZrtpSession::getInfo(const char *key, uint8_t *buffer, size_t maxLen, streamName streamNm) {
@@ -543,6 +606,28 @@ int CtZrtpSession::getInfo(const char *key, uint8_t *buffer, size_t maxLen, stre
     return stream->getInfo(key, (char*)buffer, (int)maxLen);
 }
 
+int CtZrtpSession::getStatus(CtZrtpStatus* status, streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return -1;
+
+    CtZrtpStream *stream = streams[streamNm];
+    return stream->getStatus(status);
+}
+
+int CtZrtpSession::getStatusBatch(CtZrtpSession* const* sessions, CtZrtpStatus* status, int count, streamName streamNm) {
+    int changed = 0;
+
+    for (int i = 0; i < count; i++) {
+        int rc = (sessions[i] != NULL) ? sessions[i]->getStatus(&status[i], streamNm) : -1;
+        if (rc < 0) {
+            status[i].version = 0;
+            continue;
+        }
+        changed += rc;
+    }
+    return changed;
+}
+
 int CtZrtpSession::getNumberOfCountersZrtp(streamName streamNm) {
     if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return -1;
@@ -693,6 +778,18 @@ bool CtZrtpSession::isDiscriminatorMode() {
     return discriminatorMode;
 }
 
+void CtZrtpSession::setParallelHandshake(bool on) {
+    parallelHandshake = on;
+}
+
+void CtZrtpSession::setPeerParallelHandshake(bool on) {
+    peerParallelHandshake = on;
+}
+
+bool CtZrtpSession::isParallelHandshake() {
+    return parallelHandshake && peerParallelHandshake;
+}
+
 int32_t CtZrtpSession::getSrtpTraceData(SrtpErrorData* data, streamName streamNm) {
     if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return 0;
@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <memory>
 
 #ifndef __EXPORT
   #if (defined _WIN32 || defined __CYGWIN__) && defined(_DLL)
@@ -44,12 +45,83 @@ class CtZrtpStream;
 class CtZrtpCb;
 class CtZrtpSendCb;
 class ZrtpConfigure;
+class ZrtpConfigProfile;
+class ZrtpEventLoop;
 class ZRtp;
 class CMutexClass;
 typedef struct _SrtpErrorData SrtpErrorData;
 
 extern "C" __EXPORT const char *getZrtpBuildInfo();
 
+/// Version of @c CtZrtpStatus, incremented on incompatible changes
+#define CTZRTP_STATUS_VERSION       1
+
+/// Size of the text fields in @c CtZrtpStatus including the terminating nul
+#define CTZRTP_STATUS_TEXT_LENGTH   32
+
+/**
+ * @name Flags of @c CtZrtpStatus
+ * @{
+ */
+#define CTZRTP_STATUS_STARTED           0x01    ///< The stream's ZRTP engine is started
+#define CTZRTP_STATUS_SDES              0x02    ///< Media uses SDES keys, getInfo key "sec_state" bit 0x100
+#define CTZRTP_STATUS_ZRTP_TUNNEL       0x04    ///< ZRTP runs inside the SDES protected stream
+#define CTZRTP_STATUS_SAS_VERIFIED      0x08    ///< getInfo key "v"
+#define CTZRTP_STATUS_FULLY_SECURE      0x10    ///< getInfo key "sc_secure"
+#define CTZRTP_STATUS_PEER_DISCLOSURE   0x20    ///< getInfo key "peerDisclosureFlag"
+#define CTZRTP_STATUS_HELLO_RECEIVED    0x40    ///< Received the peer's Hello
+/** @} */
+
+/**
+ * @name Values of @c CtZrtpStatus::sdpHash, getInfo key "sdp_hash"
+ * @{
+ */
+#define CTZRTP_SDP_HASH_NONE        0           ///< "None", no zrtp-hash in the signaling
+#define CTZRTP_SDP_HASH_GOOD        1           ///< "Good"
+#define CTZRTP_SDP_HASH_BAD         2           ///< "Bad"
+#define CTZRTP_SDP_HASH_NO_HELLO    3           ///< "No hello"
+/** @} */
+
+/**
+ * Status snapshot of a stream.
+ *
+ * The structure holds the data that @c CtZrtpSession::getInfo returns as
+ * strings. The fields before the counters change only if the state of the
+ * stream changes, @c sequence identifies this state. The counters are read
+ * on each call.
+ *
+ * Text fields are nul terminated and truncated if necessary.
+ */
+typedef struct CtZrtpStatus {
+    uint32_t version;                   ///< @c CTZRTP_STATUS_VERSION
+    uint32_t length;                    ///< Size of the structure in bytes
+    uint64_t sequence;                  ///< Change sequence number of the stream state, never 0
+    int64_t  changedAt;                 ///< Time of the last state change, seconds since the epoch
+    int32_t  state;                     ///< Current @c tiviStatus
+    int32_t  previousState;             ///< Previous @c tiviStatus
+    uint32_t flags;                     ///< @c CTZRTP_STATUS_* flags
+    int32_t  role;                      ///< ZRTP role: 0 not set, 1 initiator, 2 responder
+    int32_t  sdpHash;                   ///< @c CTZRTP_SDP_HASH_* value
+    int32_t  rs1;                       ///< getInfo key "rs1": 0 not cached, 1 cached, 2 cached and matched
+    int32_t  rs2;                       ///< getInfo key "rs2"
+    int32_t  aux;                       ///< getInfo key "aux"
+    int32_t  pbx;                       ///< getInfo key "pbx"
+    int32_t  reserved;
+    int64_t  secureSince;               ///< getInfo key "sec_since"
+    char     peerClientId[CTZRTP_STATUS_TEXT_LENGTH];   ///< getInfo key "lbClient"
+    char     peerVersion[CTZRTP_STATUS_TEXT_LENGTH];    ///< getInfo key "lbVersion"
+    char     cipher[CTZRTP_STATUS_TEXT_LENGTH];         ///< getInfo key "lbChiper"
+    char     authLength[CTZRTP_STATUS_TEXT_LENGTH];     ///< getInfo key "lbAuthTag"
+    char     hash[CTZRTP_STATUS_TEXT_LENGTH];           ///< getInfo key "lbHash"
+    char     keyExchange[CTZRTP_STATUS_TEXT_LENGTH];    ///< getInfo key "lbKeyExchange"
+    char     sasType[CTZRTP_STATUS_TEXT_LENGTH];        ///< SAS rendering algorithm
+    uint64_t zrtpProtect;               ///< Packets protected with ZRTP keys
+    uint64_t zrtpUnprotect;             ///< Packets unprotected with ZRTP keys
+    uint64_t sdesProtect;               ///< Packets protected with SDES keys
+    uint64_t sdesUnprotect;             ///< Packets unprotected with SDES keys
+    uint64_t unprotectFailed;           ///< Packets that failed to unprotect
+} CtZrtpStatus;
+
 class __EXPORT CtZrtpSession {
 
 public:
@@ -111,6 +183,23 @@ public:
      */
     static int initCache(const char *zidFilename);
 
+    /**
+     * @brief Run the ZRTP timers on an application event loop.
+     *
+     * By default all sessions share a timer thread. If the application sets
+     * an event loop the sessions arm their timers on this loop instead and
+     * the library does not start the timer thread. The timers then run on
+     * the loop thread, thus the application must call the session functions
+     * that drive the ZRTP protocol, for example @c start and
+     * @c processIncomingRtp, on the loop thread as well.
+     *
+     * Call this function before the first session is created, the loop
+     * must outlive all sessions.
+     *
+     * @param loop the event loop, see ZrtpEventLoop.h
+     */
+    static void setEventLoop(ZrtpEventLoop* loop);
+
     /** @brief Initialize CtZrtpSession.
      *
      * Before an application can use ZRTP it has to initialize the
@@ -151,6 +240,43 @@ public:
      */
     int init(bool audio, bool video, int32_t callId = 0, ZrtpConfigure* config = NULL);
 
+    /**
+     * @brief Initialize CtZrtpSession with a compiled configuration profile.
+     *
+     * Same as the @c init above, but the streams share the profile and do
+     * not copy the configuration. Use this to give all sessions of a tenant
+     * the same, pre-compiled profile, see ZrtpConfigProfile.
+     *
+     * @param audio
+     *     set to @c true if audio stream shout be initialized
+     *
+     * @param video
+     *     set to @c true if video stream shoud be initialized.
+     *
+     * @param callId
+     *     The Tivi engine's call id.
+     *
+     * @param profile
+     *     the configuration profile. If it is empty the session uses the
+     *     default profile that @c setupConfiguration creates.
+     *
+     * @return
+     *     1 on success, ZRTP processing enabled, -1 on failure,
+     *     ZRTP processing disabled.
+     */
+    int init(bool audio, bool video, int32_t callId, std::shared_ptr<const ZrtpConfigProfile> profile);
+
+    /**
+     * @brief Drop the compiled default profile.
+     *
+     * Sessions initialized without a configuration share a default profile
+     * that the first @c init compiles from the global configuration keys.
+     * Applications call this after they changed the keys, the next @c init
+     * then reads them again and compiles a new default profile. Running
+     * sessions keep their profile.
+     */
+    static void resetDefaultProfile();
+
     /**
      * @brief Fills a ZrtpConfiguration based on selected algorithms.
      *
@@ -181,7 +307,8 @@ public:
      * @brief Start a stream if it is not already started.
      *
      * The method starts a stream if it is not already started and it starts
-     * a video stream (Slave) only if the audio stream (Master) is already secure.
+     * a video stream (Slave) only if the audio stream (Master) is already secure
+     * or if parallel handshakes are enabled.
      */
     int startIfNotStarted(unsigned int uiSSRC, int streamNm);
 
@@ -231,6 +358,19 @@ public:
      */
     void release(streamName streamNm);
 
+    /**
+     * @brief Release a group of sessions at once.
+     *
+     * Use this to end many calls at the same time, for example on shutdown.
+     * The function cancels the timers of all streams in one pass and writes
+     * all cache updates in one batch, then releases each session as @c release
+     * does.
+     *
+     * @param sessions array of session pointers, NULL entries are skipped
+     * @param count number of entries in @c sessions
+     */
+    static void releaseSessions(CtZrtpSession** sessions, int32_t count);
+
     /**
      * @brief Set peer name of current call's peer.
      *
@@ -422,6 +562,46 @@ public:
      */
     int getInfo(const char *key, uint8_t *buffer, size_t length, streamName streamNm =AudioStream);
 
+    /**
+     * @brief Get the status snapshot of a stream.
+     *
+     * The stream keeps a snapshot of its state and rebuilds it only after
+     * the state changed. If @c status->sequence equals the sequence of the
+     * stream the function only refreshes the counters, otherwise it copies
+     * the snapshot. Set @c sequence to 0 before the first call.
+     *
+     * The function does not take the stream's ZRTP lock, it may be called
+     * from the client callbacks.
+     *
+     * @param status the snapshot of the previous call or a zeroed structure
+     *
+     * @param streamNm stream, if not specified the default is @c AudioStream
+     *
+     * @return 1 if the state changed since the previous call, 0 if only the
+     *         counters were refreshed, -1 on error
+     */
+    int getStatus(CtZrtpStatus* status, streamName streamNm =AudioStream);
+
+    /**
+     * @brief Get the status snapshots of a stream of several sessions.
+     *
+     * Calls @c getStatus for each session. If a session is not ready or
+     * does not have the stream the function sets @c version of its
+     * snapshot to 0.
+     *
+     * @param sessions the sessions
+     *
+     * @param status one snapshot per session, see @c getStatus
+     *
+     * @param count number of sessions
+     *
+     * @param streamNm stream, if not specified the default is @c AudioStream
+     *
+     * @return number of sessions whose state changed
+     */
+    static int getStatusBatch(CtZrtpSession* const* sessions, CtZrtpStatus* status, int count,
+                              streamName streamNm =AudioStream);
+
     /**
      * @brief Get required buffer size to get all 32-bit statistic counters of ZRTP
      *
@@ -706,6 +886,49 @@ public:
      */
     bool isDiscriminatorMode();
 
+    /**
+     * @brief Enable or disable parallel handshakes of this session.
+     *
+     * By default the video stream starts its handshake in multi-stream mode
+     * after the audio stream is secure. With parallel handshakes
+     * @c startIfNotStarted starts the video stream immediately and it runs
+     * an independent DH mode handshake concurrently with the audio stream.
+     *
+     * Two DH mode handshakes of one call must not both update the retained
+     * secrets, otherwise the peers may keep different secrets and report a
+     * cache mismatch on the next call. With parallel handshakes only the
+     * audio stream updates the ZID cache, the video stream uses it read only.
+     * The peer must follow the same rule, thus the session runs parallel
+     * handshakes only if the application also confirmed that the peer
+     * enabled them, see @c setPeerParallelHandshake. Applications usually
+     * negotiate this through their signaling. Handle SAS verification on the
+     * audio stream.
+     *
+     * Set this before starting the streams.
+     *
+     * @param on Enable parallel handshakes if true, disable if false.
+     */
+    void setParallelHandshake(bool on);
+
+    /**
+     * @brief Confirm that the peer enabled parallel handshakes.
+     *
+     * Call this if the signaling shows that the peer also runs parallel
+     * handshakes and updates its ZID cache only with the audio stream.
+     *
+     * Set this before starting the streams.
+     *
+     * @param on @c true if the peer enabled parallel handshakes.
+     */
+    void setPeerParallelHandshake(bool on);
+
+    /**
+     * @brief Return status of parallel handshakes of this session.
+     *
+     * @return @c true if both ends enabled parallel handshakes, false otherwise.
+     */
+    bool isParallelHandshake();
+
     /**
      * @brief Get SRTP error trace data.
      *
@@ -765,6 +988,8 @@ private:
     bool zrtpEnabled;
     bool sdesEnabled;
     bool discriminatorMode;
+    bool parallelHandshake;
+    bool peerParallelHandshake;
 };
 
 #endif /* _CTZRTPSESSION_H_ */
\ No newline at end of file
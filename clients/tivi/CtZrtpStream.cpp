@@ -20,6 +20,7 @@
  */
 
 #include <stdint.h>
+#include <time.h>
 
 #include <common/osSpecifics.h>
 
@@ -32,6 +33,7 @@
 #include <CtZrtpStream.h>
 #include <CtZrtpCallback.h>
 #include <TiviTimeoutProvider.h>
+#include <libzrtpcpp/ZrtpEventLoop.h>
 #include <cryptcommon/aes.h>
 #include <cryptcommon/ZrtpRandom.h>
 
@@ -53,6 +55,7 @@ int getCallInfo(int iCallID, const char *key, char *p, int iMax);
 #endif
 
 static TimeoutProvider<std::string, CtZrtpStream*>* staticTimeoutProvider = NULL;
+static ZrtpEventLoop* staticEventLoop = NULL;
 
 static std::map<int32_t, std::string*> infoMap;
 static std::map<int32_t, std::string*> warningMap;
@@ -61,6 +64,8 @@ static std::map<int32_t, std::string*> zrtpMap;
 static std::map<int32_t, std::string*> enrollMap;
 static int initialized = 0;
 
+static LockClass streamLockClass("CtZrtpStream");
+
 static const char* peerHelloMismatchMsg = "s2_c050: Received Hello hash does not match computed Hello hash"; 
 static const char* srtpDecodeFailedMsg  = "s2_c051: Parsing of received SRTP packet failed"; 
 static const char* zrtpEncap = "zrtp";
@@ -96,13 +101,17 @@ CtZrtpStream::CtZrtpStream():
     enableZrtp(0), started(false), isStopped(false), discriminatorMode(false), session(NULL), tiviState(CtZrtpSession::eLookingPeer),
     prevTiviState(CtZrtpSession::eLookingPeer), recvSrtp(NULL), recvSrtcp(NULL), sendSrtp(NULL), sendSrtcp(NULL),
     zrtpUserCallback(NULL), zrtpSendCallback(NULL), senderZrtpSeqNo(0), peerSSRC(0), zrtpHashMatch(false),
-    sasVerified(false), helloReceived(false), useSdesForMedia(false), useZrtpTunnel(false), zrtpEncapSignaled(false), 
+    sasVerified(false), helloReceived(false), timersCancelled(false), loopTimer(NULL), useSdesForMedia(false), useZrtpTunnel(false), zrtpEncapSignaled(false), 
     sdes(NULL), supressCounter(0), srtpAuthErrorBurst(0), srtpReplayErrorBurst(0), srtpDecodeErrorBurst(0), 
-    zrtpCrcErrors(0), role(NoRole), errorInfoIndex(0), numErrorArrayWrap(0)
+    zrtpCrcErrors(0), role(NoRole), statusSequence(1), statusChangedAt(0), errorInfoIndex(0), numErrorArrayWrap(0)
 {
-    synchLock = new CMutexClass();
+    synchLock = new CMutexClass(&streamLockClass);
+    memset(&statusCache, 0, sizeof(statusCache));
 
-    if (staticTimeoutProvider == NULL) {
+    if (staticEventLoop != NULL) {
+        loopTimer = new ZrtpLoopTimer(staticEventLoop);
+    }
+    else if (staticTimeoutProvider == NULL) {
         staticTimeoutProvider = new TimeoutProvider<std::string, CtZrtpStream*>();
         staticTimeoutProvider->Event(&staticTimeoutProvider);  // Event argument is dummy, not used
     }
@@ -122,6 +131,8 @@ void CtZrtpStream::setSendCallback(CtZrtpSendCb* scb) {
 
 CtZrtpStream::~CtZrtpStream() {
     stopStream();
+    delete loopTimer;
+    loopTimer = NULL;
     delete synchLock;
     synchLock = NULL;
 }
@@ -169,6 +180,10 @@ void CtZrtpStream::stopStream() {
 
     peerHelloHashes.clear();
 
+    if (loopTimer != NULL) {
+        loopTimer->cancel();
+        loopTimer->setEngine(NULL);
+    }
     delete zrtpEngine;
     zrtpEngine = NULL;
 
@@ -194,6 +209,30 @@ void CtZrtpStream::stopStream() {
     zrtpUserCallback = NULL;
     zrtpSendCallback = NULL;
     session = NULL;
+
+    timersCancelled = false;
+    statusChanged();
+}
+
+void CtZrtpStream::cancelTimers(CtZrtpStream** streams, int32_t count) {
+    std::unordered_set<CtZrtpStream*> group;
+
+    for (int32_t i = 0; i < count; i++) {
+        if (streams[i] != NULL) {
+            streams[i]->timersCancelled = true;
+            if (streams[i]->loopTimer != NULL)
+                streams[i]->loopTimer->cancel();
+            else
+                group.insert(streams[i]);
+        }
+    }
+    if (staticTimeoutProvider != NULL && !group.empty()) {
+        staticTimeoutProvider->cancelRequests(group);
+    }
+}
+
+void CtZrtpStream::setEventLoop(ZrtpEventLoop* loop) {
+    staticEventLoop = loop;
 }
 
 bool CtZrtpStream::processOutgoingRtp(uint8_t *buffer, size_t length, size_t *newLength) {
@@ -428,6 +467,7 @@ void CtZrtpStream::setSignalingHelloHash(const char *hHash) {
     // Could be empty in case Hello was not yet received, will be handled in sendInfo(...) function
     std::string ph = zrtpEngine->getPeerHelloHash();
     if (ph.empty()) {
+        statusChanged();
         synchLeave();
         return;
     }
@@ -450,6 +490,7 @@ void CtZrtpStream::setSignalingHelloHash(const char *hHash) {
             break;
         }
     }
+    statusChanged();
     /*
      * In discriminator mode:
      * If the received zrtp-hash value in the signaling does not match the hash of the actual received ZRTP Hello message, we must drop the call.
@@ -587,6 +628,135 @@ int CtZrtpStream::getInfo(const char *key, char *p, int maxLen) {
     return 0;
 }
 
+static void copyStatusText(char* dest, const char* src) {
+    if (src == NULL)
+        src = "";
+    strncpy(dest, src, CTZRTP_STATUS_TEXT_LENGTH - 1);
+    dest[CTZRTP_STATUS_TEXT_LENGTH - 1] = '\0';
+}
+
+static int32_t secretFlag(const ZRtp::zrtpInfo *info, int32_t secret) {
+    return (!!(info->secretsCached & secret)) << (!!(info->secretsMatchedDH & secret));
+}
+
+void CtZrtpStream::statusChanged() {
+    statusChangedAt.store(time(NULL), std::memory_order_relaxed);
+    statusSequence.fetch_add(1, std::memory_order_release);
+}
+
+void CtZrtpStream::buildStatus(CtZrtpStatus* status) {
+    memset(status, 0, sizeof(CtZrtpStatus));
+    status->version = CTZRTP_STATUS_VERSION;
+    status->length = sizeof(CtZrtpStatus);
+    status->changedAt = statusChangedAt.load(std::memory_order_relaxed);
+    status->state = tiviState;
+    status->previousState = prevTiviState;
+    status->role = role;
+
+    if (started)
+        status->flags |= CTZRTP_STATUS_STARTED;
+    if (useSdesForMedia)
+        status->flags |= CTZRTP_STATUS_SDES;
+    if (useZrtpTunnel)
+        status->flags |= CTZRTP_STATUS_ZRTP_TUNNEL;
+    if (sasVerified)
+        status->flags |= CTZRTP_STATUS_SAS_VERIFIED;
+    if (helloReceived)
+        status->flags |= CTZRTP_STATUS_HELLO_RECEIVED;
+
+    // Same as the "sdp_hash" key of getInfo
+    if (peerHelloHashes.empty())
+        status->sdpHash = CTZRTP_SDP_HASH_NONE;
+    else if (zrtpHashMatch)
+        status->sdpHash = CTZRTP_SDP_HASH_GOOD;
+    else
+        status->sdpHash = !sdes || helloReceived ? CTZRTP_SDP_HASH_BAD : CTZRTP_SDP_HASH_NO_HELLO;
+
+    if (zrtpEngine == NULL)
+        return;
+
+    if (zrtpEngine->isPeerDisclosureFlag())
+        status->flags |= CTZRTP_STATUS_PEER_DISCLOSURE;
+    status->secureSince = zrtpEngine->getSecureSince();
+
+    std::string client = zrtpEngine->getPeerProtcolVersion();
+    if (role != NoRole) {
+        if (useZrtpTunnel)
+            client.append(role == Initiator ? "(IT)" : "(RT)");
+        else
+            client.append(role == Initiator ? "(I)" : "(R)");
+    }
+    copyStatusText(status->peerClientId, zrtpEngine->getPeerClientId().c_str());
+    copyStatusText(status->peerVersion, client.c_str());
+
+    const ZRtp::zrtpInfo *info = NULL;
+    if (recvSrtp != NULL || sendSrtp != NULL) {
+        info = zrtpEngine->getDetailInfo();
+
+        // Same as the "sc_secure" key of getInfo
+        if (zrtpHashMatch && sasVerified && !peerHelloHashes.empty() && tiviState == CtZrtpSession::eSecure &&
+            ((info->secretsCached & ZRtp::Rs1) != 0 || sasVerified) &&
+            ((info->secretsMatched & ZRtp::Rs1) != 0 || sasVerified))
+            status->flags |= CTZRTP_STATUS_FULLY_SECURE;
+
+        copyStatusText(status->sasType, info->sasType);
+        status->rs1 = secretFlag(info, ZRtp::Rs1);
+        status->rs2 = secretFlag(info, ZRtp::Rs2);
+        status->aux = secretFlag(info, ZRtp::Aux);
+        status->pbx = secretFlag(info, ZRtp::Pbx);
+        copyStatusText(status->cipher, info->cipher);
+        copyStatusText(status->authLength, info->authLength);
+        copyStatusText(status->hash, info->hash);
+        copyStatusText(status->keyExchange, info->pubKey);
+    }
+    else if (useSdesForMedia && sdes != NULL) {
+        char mixName[CTZRTP_STATUS_TEXT_LENGTH] = "";
+
+        copyStatusText(status->peerClientId, "SDP/S");
+        copyStatusText(status->peerVersion, "");
+        if (sdes->getHmacTypeMix() == ZrtpSdesStream::MIX_NONE) {
+            copyStatusText(status->keyExchange, "SIP SDP/S");
+        }
+        else {
+            if (sdes->getCryptoMixAttribute(mixName, sizeof(mixName)) <= 0)
+                mixName[0] = '\0';
+            copyStatusText(status->hash, mixName);
+            copyStatusText(status->keyExchange, "SIP SDP/S-MIX");
+        }
+        copyStatusText(status->cipher, sdes->getCipher());
+        copyStatusText(status->authLength, sdes->getAuthAlgo());
+    }
+}
+
+int CtZrtpStream::getStatus(CtZrtpStatus* status) {
+    int changed = 0;
+    uint64_t sequence = statusSequence.load(std::memory_order_acquire);
+
+    if (status->sequence != sequence || status->version != CTZRTP_STATUS_VERSION) {
+        std::lock_guard<std::mutex> lock(statusLock);
+
+        // Rebuild the snapshot if the state changed. A change while building
+        // it bumps the sequence, then build again.
+        for (int32_t tries = 0; statusCache.sequence != sequence; tries++) {
+            buildStatus(&statusCache);
+            uint64_t after = statusSequence.load(std::memory_order_acquire);
+            if (after == sequence || tries == 3) {
+                statusCache.sequence = sequence;    // the next call rebuilds if it changed meanwhile
+                break;
+            }
+            sequence = after;
+        }
+        memcpy(status, &statusCache, sizeof(CtZrtpStatus));
+        changed = 1;
+    }
+    status->zrtpProtect = zrtpProtect;
+    status->zrtpUnprotect = zrtpUnprotect;
+    status->sdesProtect = sdesProtect;
+    status->sdesUnprotect = sdesUnprotect;
+    status->unprotectFailed = unprotectFailed;
+    return changed;
+}
+
 int CtZrtpStream::getNumberOfCountersZrtp() {
     return zrtpEngine->getNumberOfCountersZrtp();
 }
@@ -662,13 +832,14 @@ bool CtZrtpStream::parseSdes(char *recvCryptoStr, size_t recvLength, char *sendC
     }
     if (sdes->getState() == ZrtpSdesStream::SDES_SRTP_ACTIVE) {
         tiviState = CtZrtpSession::eSecureSdes;
-        if (zrtpUserCallback != NULL) {
-            zrtpUserCallback->onNewZrtpStatus(session, NULL, index);    // Inform client about new state
-        }
         useSdesForMedia = true;
         if (zrtpEncapSignaled) {
             useZrtpTunnel = true;
         }
+        statusChanged();
+        if (zrtpUserCallback != NULL) {
+            zrtpUserCallback->onNewZrtpStatus(session, NULL, index);    // Inform client about new state
+        }
         return true;
     }
 
@@ -677,6 +848,7 @@ bool CtZrtpStream::parseSdes(char *recvCryptoStr, size_t recvLength, char *sendC
     useZrtpTunnel = false;
     delete sdes;
     sdes = NULL;
+    statusChanged();
     return false;
 }
 
@@ -713,6 +885,7 @@ void CtZrtpStream::resetSdesContext(bool force) {
         useZrtpTunnel = false;
         delete sdes;
         sdes = NULL;
+        statusChanged();
     }
 }
 
@@ -741,6 +914,7 @@ void CtZrtpStream::setZrtpEncapAttribute(const char *attribute) {
         if (useSdesForMedia) {
             useZrtpTunnel = true;
         }
+        statusChanged();
     }
 }
 
@@ -756,7 +930,28 @@ void CtZrtpStream::setAuxSecret(const unsigned char *secret, uint32_t length) {
  */
 int32_t CtZrtpStream::sendDataZRTP(const unsigned char *data, int32_t length) {
 
-    uint16_t totalLen = length + 12;     /* Fixed number of bytes of ZRTP header */
+    if ((length + ZRTP_FRAME_HEADROOM) > maxZrtpSize)
+        return 0;
+
+    memcpy(zrtpBuffer+ZRTP_FRAME_HEADROOM, data, length);   // Copy ZRTP message data behind the header data
+    return sendZrtpFrame(zrtpBuffer, length + ZRTP_FRAME_HEADROOM);
+}
+
+int32_t CtZrtpStream::sendFrameZRTP(uint8_t *frame, int32_t length) {
+
+    // The SRTP tunnel encrypts the packet in place and would destroy the ZRTP
+    // message, ZRTP needs it to resend the packet. Use the copy in this case.
+    if (useZrtpTunnel)
+        return -1;
+
+    if ((length + ZRTP_FRAME_HEADROOM) > maxZrtpSize)
+        return 0;
+
+    return sendZrtpFrame(frame, length + ZRTP_FRAME_HEADROOM);
+}
+
+int32_t CtZrtpStream::sendZrtpFrame(uint8_t *frame, uint16_t totalLen) {
+
     uint32_t crc;
 
     uint16_t* pus;
@@ -764,25 +959,20 @@ int32_t CtZrtpStream::sendDataZRTP(const unsigned char *data, int32_t length) {
 
     size_t newLength;
 
-    if ((totalLen) > maxZrtpSize)
-        return 0;
-
     /* Get some handy pointers */
-    pus = (uint16_t*)zrtpBuffer;
-    pui = (uint32_t*)zrtpBuffer;
+    pus = (uint16_t*)frame;
+    pui = (uint32_t*)frame;
 
     /* set up fixed ZRTP header */
-    *(zrtpBuffer + 1) = 0;
+    *(frame + 1) = 0;
     pus[1] = zrtpHtons(senderZrtpSeqNo++);
     pui[1] = zrtpHtonl(ZRTP_MAGIC);
     pui[2] = zrtpHtonl(ownSSRC);            // ownSSRC is stored in host order
 
-    memcpy(zrtpBuffer+12, data, length);    // Copy ZRTP message data behind the header data
-
     if (useZrtpTunnel) {
-        *zrtpBuffer = 0x80;                                            // temporarily make it to a real RTP packet 
-        sdes->outgoingZrtpTunnel(zrtpBuffer, totalLen-CRC_SIZE, &newLength);
-        *zrtpBuffer = 0x10;                                            // invalid RTP version - refer to ZRTP spec chap 5
+        *frame = 0x80;                                                 // temporarily make it to a real RTP packet 
+        sdes->outgoingZrtpTunnel(frame, totalLen-CRC_SIZE, &newLength);
+        *frame = 0x10;                                                 // invalid RTP version - refer to ZRTP spec chap 5
         totalLen = newLength;
     }
     else {
@@ -795,15 +985,15 @@ int32_t CtZrtpStream::sendDataZRTP(const unsigned char *data, int32_t length) {
                 zrtpUserCallback->onDiscriminatorException(session, (char*)noZrtpTunnel, index);
             return 0;
         }
-        *zrtpBuffer = 0x10;                                            // invalid RTP version - refer to ZRTP spec chap 5
-        crc = zrtpGenerateCksum(zrtpBuffer, totalLen-CRC_SIZE);        // Setup and compute ZRTP CRC
+        *frame = 0x10;                                                 // invalid RTP version - refer to ZRTP spec chap 5
+        crc = zrtpGenerateCksum(frame, totalLen-CRC_SIZE);             // Setup and compute ZRTP CRC
         crc = zrtpEndCksum(crc);                                       // convert and store CRC in ZRTP packet.
-        *(uint32_t*)(zrtpBuffer+totalLen-CRC_SIZE) = zrtpHtonl(crc);
+        *(uint32_t*)(frame+totalLen-CRC_SIZE) = zrtpHtonl(crc);
     }
 
     /* Send the ZRTP packet using callback */
     if (zrtpSendCallback != NULL) {
-        zrtpSendCallback->sendRtp(session, zrtpBuffer, totalLen, index);
+        zrtpSendCallback->sendRtp(session, frame, totalLen, index);
         return 1;
     }
     return 0;
@@ -982,10 +1172,11 @@ bool CtZrtpStream::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
     if (peerHelloHashes.size() > 0 && recvSrtp != NULL && sendSrtp != NULL) {
         useSdesForMedia = false;
     }
+    statusChanged();
     return true;
 }
 
-void CtZrtpStream::srtpSecretsOn(std::string cipher, std::string sas, bool verified)
+void CtZrtpStream::srtpSecretsOn(const std::string& cipher, const std::string& sas, bool verified)
 {
      // p->setStatus(ctx->peer_mitm_flag || iMitm?CTZRTP::eSecureMitm:CTZRTP::eSecure,&buf[0],iIsVideo);
 
@@ -1002,6 +1193,7 @@ void CtZrtpStream::srtpSecretsOn(std::string cipher, std::string sas, bool verif
         tiviState = CtZrtpSession::eSecureMitm;
     }
     sasVerified = verified;
+    statusChanged();
     if (zrtpUserCallback != NULL) {
         char *strng = NULL;
         std::string sasTmp;
@@ -1042,9 +1234,17 @@ void CtZrtpStream::srtpSecretsOff(EnableSecurity part) {
         recvSrtp = NULL;
         recvSrtcp = NULL;
     }
+    statusChanged();
 }
 
 int32_t CtZrtpStream::activateTimer(int32_t time) {
+    if (timersCancelled) {
+        return 1;
+    }
+    if (loopTimer != NULL) {
+        loopTimer->setEngine(zrtpEngine);
+        return loopTimer->activate(time);
+    }
     std::string s("ZRTP");
     if (staticTimeoutProvider != NULL) {
         staticTimeoutProvider->requestTimeout(time, this, s);
@@ -1053,6 +1253,12 @@ int32_t CtZrtpStream::activateTimer(int32_t time) {
 }
 
 int32_t CtZrtpStream::cancelTimer() {
+    if (timersCancelled) {
+        return 1;
+    }
+    if (loopTimer != NULL) {
+        return loopTimer->cancel();
+    }
     std::string s("ZRTP");
     if (staticTimeoutProvider != NULL) {
         staticTimeoutProvider->cancelRequest(this, s);
@@ -1105,6 +1311,7 @@ void CtZrtpStream::sendInfo(MessageSeverity severity, int32_t subCode) {
                         break;
                     }
                 }
+                statusChanged();
                 /*
                  * In discriminator mode:
                  * If the received zrtp-hash value in the signaling does not match the hash of the actual received ZRTP Hello message, we must drop the call.
@@ -1138,6 +1345,7 @@ void CtZrtpStream::sendInfo(MessageSeverity severity, int32_t subCode) {
                 }
                 prevTiviState = tiviState;
                 tiviState = CtZrtpSession::eGoingSecure;
+                statusChanged();
                 if (zrtpUserCallback != NULL)
                     zrtpUserCallback->onNewZrtpStatus(session, NULL, index);
                 break;
@@ -1199,6 +1407,7 @@ void CtZrtpStream::zrtpNegotiationFailed(MessageSeverity severity, int32_t subCo
 
     prevTiviState = tiviState;
     tiviState = CtZrtpSession::eError;
+    statusChanged();
     if (zrtpUserCallback != NULL) {
         zrtpUserCallback->onNewZrtpStatus(session, (char*)cs.c_str(), index);
     }
@@ -1209,6 +1418,7 @@ void CtZrtpStream::zrtpNotSuppOther() {
     // if other party does not support ZRTP but we have SDES active set SDES state,
     // otherwise inform client about failed ZRTP negotiation.
     tiviState = isSdesActive() ? CtZrtpSession::eSecureSdes : CtZrtpSession::eNoPeer;
+    statusChanged();
     if (zrtpUserCallback != NULL) {
         zrtpUserCallback->onNewZrtpStatus(session, NULL, index);
     }
@@ -22,7 +22,9 @@
 #ifndef _CTZRTPSTREAM_H_
 #define _CTZRTPSTREAM_H_
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <vector>
 
 #include <libzrtpcpp/ZrtpCallback.h>
@@ -50,6 +52,8 @@ class CtZrtpSendCb;
 class CtZrtpSession;
 class ZrtpSdesStream;
 class CMutexClass;
+class ZrtpLoopTimer;
+class ZrtpEventLoop;
 
 class __EXPORT CtZrtpStream: public ZrtpCallback  {
 
@@ -115,6 +119,24 @@ protected:
      */
     void stopStream();
 
+    /**
+     * Cancel the timers of a group of streams in one pass.
+     *
+     * After this call the streams neither start nor cancel timers until
+     * they are stopped with @c stopStream.
+     *
+     * @param streams array of stream pointers, NULL entries are skipped
+     * @param count number of entries in @c streams
+     */
+    static void cancelTimers(CtZrtpStream** streams, int32_t count);
+
+    /**
+     * Arm the timers of streams created from now on on an event loop.
+     *
+     * @see CtZrtpSession::setEventLoop
+     */
+    static void setEventLoop(ZrtpEventLoop* loop);
+
     /**
      * @brief Process outgoing data.
      *
@@ -212,6 +234,11 @@ protected:
      */
     int getInfo(const char *key, char *buffer, int maxLen);
 
+    /**
+     * Return the status snapshot to tivi client, see CtZrtpSession::getStatus.
+     */
+    int getStatus(CtZrtpStatus* status);
+
     /**
      * @brief Get required buffer size to get all 32-bit statistic counters of ZRTP
      *
@@ -455,6 +482,8 @@ protected:
      */
     int32_t sendDataZRTP(const unsigned char* data, int32_t length);
 
+    int32_t sendFrameZRTP(uint8_t* frame, int32_t length);
+
     int32_t activateTimer(int32_t time);
 
     int32_t cancelTimer();
@@ -465,7 +494,7 @@ protected:
 
     void srtpSecretsOff(EnableSecurity part);
 
-    void srtpSecretsOn(std::string c, std::string s, bool verified);
+    void srtpSecretsOn(const std::string& c, const std::string& s, bool verified);
 
     void handleGoClear();
 
@@ -507,6 +536,8 @@ private:
     bool     zrtpHashMatch;
     bool     sasVerified;
     bool     helloReceived;
+    bool     timersCancelled;
+    ZrtpLoopTimer *loopTimer;           //!< timer on the application event loop, NULL if the timer thread is used
     bool     useSdesForMedia;
     bool     useZrtpTunnel;
     bool     zrtpEncapSignaled;
@@ -524,11 +555,36 @@ private:
 
     int role;                               //!< Initiator or Responder role
 
+    std::atomic<uint64_t> statusSequence;   //!< incremented after each change of the state
+    std::atomic<int64_t> statusChangedAt;   //!< time of the last change
+    std::mutex statusLock;                  //!< protects statusCache
+    CtZrtpStatus statusCache;               //!< snapshot of the state, see getStatus()
+
     SrtpErrorData srtpErrorInfo[NumSrtpErrorData];
     int32_t errorInfoIndex;
     uint32_t numErrorArrayWrap;
 
     void initStrings();
+
+    /**
+     * Record a change of the state that getStatus() reports.
+     *
+     * Call after the change and before informing the client.
+     */
+    void statusChanged();
+
+    /**
+     * Fill the state part of a status snapshot, see getInfo().
+     */
+    void buildStatus(CtZrtpStatus* status);
+
+    /**
+     * Setup the fixed ZRTP header and the CRC in a frame and send it.
+     *
+     * The frame contains the fixed ZRTP header room followed by the ZRTP message,
+     * @c totalLen includes both.
+     */
+    int32_t sendZrtpFrame(uint8_t* frame, uint16_t totalLen);
     
     SrtpErrorData* srtpErrorElement();
 };
@@ -33,6 +33,8 @@
  */
 
 #include <list>
+#include <unordered_map>
+#include <unordered_set>
 #include <stdint.h>
 #include <memory>
 
@@ -130,6 +132,14 @@ private:
     TOCommand command;      // Command that will be delivered to the receiver (subscriber) of the timeout.
 };
 
+/**
+ * Lock class shared by the locks of all timeout providers.
+ */
+inline LockClass* timeoutProviderLockClass() {
+    static LockClass lockClass("TimeoutProvider");
+    return &lockClass;
+}
+
 /**
  * Class to generate objects giving timeout functionality.
  *
@@ -143,7 +153,13 @@ private:
 
     // The timeouts are ordered in the order of which they
     // will expire. Nearest in future is first in list.
-    std::list<std::unique_ptr<TPRequest<TOCommand, TOSubscriber> > > requests;
+    typedef std::list<std::unique_ptr<TPRequest<TOCommand, TOSubscriber> > > RequestList;
+    RequestList requests;
+
+    // Position of each pending request in the list, keyed by subscriber.
+    // List iterators stay valid until their element is erased, thus the
+    // cancel functions go directly to the requests of a subscriber.
+    std::unordered_multimap<TOSubscriber, typename RequestList::iterator> requestIndex;
 
     CMutexClass synchLock;
     CEventClass timeEvent;
@@ -158,7 +174,7 @@ public:
     /**
      * Timeout Provider Constructor
      */
-    TimeoutProvider(): requests(), stop(false)  { }
+    TimeoutProvider(): requests(), requestIndex(), synchLock(timeoutProviderLockClass()), stop(false)  { }
 
     /**
      * Destructor also terminates the Timeout thread.
@@ -174,6 +190,7 @@ public:
     void reset() {
         stop = false;
         timeEvent.Reset();
+        requestIndex.clear();
         requests.clear();
     }
 
@@ -201,33 +218,23 @@ public:
         std::unique_ptr<TPRequest<TOCommand, TOSubscriber> > request(
                 new TPRequest<TOCommand, TOSubscriber>(subscriber, time_ms, command));
 
+        typename RequestList::iterator pos;
+
         synchLock.Lock();
 
-        if (requests.size()==0) {
-            requests.push_front(move(request));
-            timeEvent.Set();
-            synchLock.Unlock();
-            return;
-        }
-        if (request->happensBefore(requests.front().get())) {
-            requests.push_front(move(request));
-            timeEvent.Set();
-            synchLock.Unlock();
-            return;
+        if (requests.size()==0 || request->happensBefore(requests.front().get())) {
+            pos = requests.insert(requests.begin(), move(request));
         }
-        if (requests.back()->happensBefore(request.get())){
-            requests.push_back(move(request));
-            timeEvent.Set();
-            synchLock.Unlock();
-            return;
+        else if (requests.back()->happensBefore(request.get())) {
+            pos = requests.insert(requests.end(), move(request));
         }
-
-        for(auto i = requests.begin(); i != requests.end(); i++ ) {
-            if( request->happensBefore((*i).get())) {
-                requests.insert(i, move(request));
-                break;
-            }
+        else {
+            auto i = requests.begin();
+            while (i != requests.end() && !request->happensBefore((*i).get()))
+                i++;
+            pos = requests.insert(i, move(request));
         }
+        requestIndex.insert(std::make_pair(subscriber, pos));
         timeEvent.Set();
         synchLock.Unlock();
     }
@@ -240,10 +247,11 @@ public:
     void cancelRequest(TOSubscriber subscriber, const TOCommand &command)
     {
         synchLock.Lock();
-        for(auto i = requests.begin(); i != requests.end(); ) {
-            if( (*i)->getCommand() == command &&
-                (*i)->getSubscriber() == subscriber) {
-                i = requests.erase(i);
+        auto range = requestIndex.equal_range(subscriber);
+        for (auto i = range.first; i != range.second; ) {
+            if ((*i->second)->getCommand() == command) {
+                requests.erase(i->second);
+                i = requestIndex.erase(i);
                 continue;
             }
             i++;
@@ -251,6 +259,28 @@ public:
         synchLock.Unlock();
     }
 
+    /**
+     * Removes all timeout requests that belong to a set of subscribers.
+     *
+     * Visits only the requests of the given subscribers, independent of the
+     * number of other pending requests. Use this to tear down many subscribers
+     * at the same time instead of calling @c cancelRequest for each of them.
+     *
+     * @see cancelRequest
+     */
+    void cancelRequests(const std::unordered_set<TOSubscriber>& subscribers)
+    {
+        synchLock.Lock();
+        for (const auto& subscriber : subscribers) {
+            auto range = requestIndex.equal_range(subscriber);
+            for (auto i = range.first; i != range.second; i++) {
+                requests.erase(i->second);
+            }
+            requestIndex.erase(range.first, range.second);
+        }
+        synchLock.Unlock();
+    }
+
     virtual BOOL OnTask(LPVOID lpv)
     {
         do {
@@ -266,6 +296,13 @@ public:
                 TOSubscriber subs = req->getSubscriber();
                 TOCommand command = req->getCommand();
 
+                auto range = requestIndex.equal_range(subs);
+                for (auto i = range.first; i != range.second; i++) {
+                    if (i->second == requests.begin()) {
+                        requestIndex.erase(i);
+                        break;
+                    }
+                }
                 requests.pop_front();
                 if (stop) {         // This must be checked so that we will
                     synchLock.Unlock();
@@ -28,7 +28,19 @@
 using namespace std;
 
 CMutexClass::CMutexClass(void)
-:m_bCreated(TRUE)
+:m_stats(NULL), m_lockedAt(0), m_bCreated(TRUE)
+{
+   Init();
+}
+
+CMutexClass::CMutexClass(LockClass *stats)
+:m_stats(stats), m_lockedAt(0), m_bCreated(TRUE)
+{
+   Init();
+}
+
+void
+CMutexClass::Init()
 {
 #ifdef WINDOWS
    m_mutex = CreateMutex(NULL,FALSE,NULL);
@@ -70,11 +82,16 @@ CMutexClass::Lock()
 	try {
 		if(CThread::ThreadIdsEqual(&m_owner,&id) )
 		    throw "\n\tthe same thread can not acquire a mutex twice!\n"; // the mutex is already locked by this thread
+		if( m_stats != NULL && LockStats::isEnabled() )
+			LockTimed();
+		else {
 #ifdef WINDOWS
-		WaitForSingleObject(m_mutex,INFINITE);
+			WaitForSingleObject(m_mutex,INFINITE);
 #else
-		pthread_mutex_lock(&m_mutex);
+			pthread_mutex_lock(&m_mutex);
 #endif
+			m_lockedAt = 0;
+		}
 		m_owner = CThread::ThreadId();
 	}
 	catch( char *psz )
@@ -91,6 +108,35 @@ CMutexClass::Lock()
 
 }
 
+/**
+ *
+ * LockTimed
+ * acquire the mutex and record the acquisition in
+ * the lock class, only a contended acquisition reads
+ * the clock to measure the wait
+ *
+ **/
+void
+CMutexClass::LockTimed()
+{
+#ifdef WINDOWS
+	if( WaitForSingleObject(m_mutex,0) == WAIT_OBJECT_0 )
+#else
+	if( pthread_mutex_trylock(&m_mutex) == 0 )
+#endif
+		m_stats->acquired(false, 0);
+	else {
+		uint64_t start = LockStats::now();
+#ifdef WINDOWS
+		WaitForSingleObject(m_mutex,INFINITE);
+#else
+		pthread_mutex_lock(&m_mutex);
+#endif
+		m_stats->acquired(true, LockStats::now() - start);
+	}
+	m_lockedAt = LockStats::now();
+}
+
 /**
  *
  * Unlock
@@ -108,6 +154,8 @@ CMutexClass::Unlock()
 		throw "\n\tonly the thread that acquires a mutex can release it!"; 
 
 	   memset(&m_owner,0,sizeof(ThreadId_t));
+	   if( m_lockedAt != 0 )
+		   m_stats->released(LockStats::now() - m_lockedAt);
 #ifdef WINDOWS
 	   ReleaseMutex(m_mutex);
 #else
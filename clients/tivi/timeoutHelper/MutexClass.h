@@ -36,6 +36,7 @@
 #include <pthread.h>
 #endif
 #include <clients/tivi/timeoutHelper/Thread.h>
+#include <common/LockStats.h>
 
 class CMutexClass
 {
@@ -46,11 +47,16 @@ private:
 	pthread_mutex_t m_mutex;
 #endif
 	ThreadId_t m_owner;
+	LockClass *m_stats;     // lock class that records contention, may be NULL
+	uint64_t m_lockedAt;    // 0 if the hold time is not measured
+	void Init();
+	void LockTimed();
 public:
 	BOOL m_bCreated;
 	void Lock();
 	void Unlock();
 	CMutexClass(void);
+	explicit CMutexClass(LockClass *stats);
 	~CMutexClass(void);
 };
 #endif
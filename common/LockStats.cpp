@@ -0,0 +1,127 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <chrono>
+
+#include <common/LockStats.h>
+
+// Constant initialized, lock classes may register before any dynamic
+// initialization of this file runs.
+std::atomic<bool> LockStats::enabled(false);
+std::atomic<LockClass*> LockStats::first(nullptr);
+
+static int32_t bucketOf(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    int32_t bucket = 0;
+
+    while (us != 0 && bucket < LOCK_STATS_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void updateMax(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+
+LockClass::LockClass(const char* name): name(name), next(nullptr) {
+    reset();
+    LockClass* head = LockStats::first.load(std::memory_order_relaxed);
+    do {
+        next = head;
+    } while (!LockStats::first.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void LockClass::acquired(bool isContended, uint64_t wait) {
+    acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (!isContended)
+        return;
+    contended.fetch_add(1, std::memory_order_relaxed);
+    waitNs.fetch_add(wait, std::memory_order_relaxed);
+    waitHistogram[bucketOf(wait)].fetch_add(1, std::memory_order_relaxed);
+    updateMax(maxWaitNs, wait);
+}
+
+void LockClass::released(uint64_t hold) {
+    holdNs.fetch_add(hold, std::memory_order_relaxed);
+    holdHistogram[bucketOf(hold)].fetch_add(1, std::memory_order_relaxed);
+    updateMax(maxHoldNs, hold);
+}
+
+void LockClass::snapshot(LockStatsData_t* data) const {
+    strncpy(data->name, name, LOCK_STATS_NAME_LENGTH - 1);
+    data->name[LOCK_STATS_NAME_LENGTH - 1] = '\0';
+    data->acquisitions = acquisitions.load(std::memory_order_relaxed);
+    data->contended = contended.load(std::memory_order_relaxed);
+    data->waitNs = waitNs.load(std::memory_order_relaxed);
+    data->holdNs = holdNs.load(std::memory_order_relaxed);
+    data->maxWaitNs = maxWaitNs.load(std::memory_order_relaxed);
+    data->maxHoldNs = maxHoldNs.load(std::memory_order_relaxed);
+    for (int32_t i = 0; i < LOCK_STATS_BUCKETS; i++) {
+        data->waitHistogram[i] = waitHistogram[i].load(std::memory_order_relaxed);
+        data->holdHistogram[i] = holdHistogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+void LockClass::reset() {
+    acquisitions.store(0, std::memory_order_relaxed);
+    contended.store(0, std::memory_order_relaxed);
+    waitNs.store(0, std::memory_order_relaxed);
+    holdNs.store(0, std::memory_order_relaxed);
+    maxWaitNs.store(0, std::memory_order_relaxed);
+    maxHoldNs.store(0, std::memory_order_relaxed);
+    for (int32_t i = 0; i < LOCK_STATS_BUCKETS; i++) {
+        waitHistogram[i].store(0, std::memory_order_relaxed);
+        holdHistogram[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int32_t LockStats::getStats(LockStatsData_t* data, int32_t maxClasses) {
+    int32_t count = 0;
+
+    for (LockClass* lc = first.load(std::memory_order_acquire); lc != nullptr; lc = lc->next) {
+        if (count < maxClasses && data != NULL)
+            lc->snapshot(&data[count]);
+        count++;
+    }
+    return count;
+}
+
+void LockStats::reset() {
+    for (LockClass* lc = first.load(std::memory_order_acquire); lc != nullptr; lc = lc->next)
+        lc->reset();
+}
+
+uint64_t LockStats::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void InstrumentedMutex::lockTimed() {
+    if (mutex.try_lock()) {
+        lockClass.acquired(false, 0);
+    }
+    else {
+        uint64_t start = LockStats::now();
+        mutex.lock();
+        lockClass.acquired(true, LockStats::now() - start);
+    }
+    lockedAt = LockStats::now();
+}
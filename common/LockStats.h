@@ -0,0 +1,219 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOCKSTATS_H_
+#define _LOCKSTATS_H_
+
+/**
+ * @file LockStats.h
+ * @brief Contention statistics for the library's mutexes
+ *
+ * Each mutex belongs to a lock class, for example all stream locks share
+ * one class. A class counts the acquisitions and the contended acquisitions
+ * and collects the wait and hold times in log2 histograms. The application
+ * reads a snapshot of all classes with @c LockStats::getStats and exports it
+ * to its own metrics system.
+ *
+ * Collecting is off by default. If it is off a lock costs one relaxed load
+ * more than a plain mutex, no clock is read.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+#include <common/osSpecifics.h>
+
+/// Number of histogram buckets, see @c LockStatsData
+#define LOCK_STATS_BUCKETS  16
+
+/// Maximum length of a lock class name including the terminating nul
+#define LOCK_STATS_NAME_LENGTH  40
+
+/**
+ * Snapshot of one lock class.
+ *
+ * Bucket 0 of a histogram counts times below 1 microsecond, bucket @c n
+ * counts times from 2^(n-1) up to 2^n microseconds. The last bucket also
+ * counts all longer times.
+ */
+typedef struct LockStatsData {
+    char     name[LOCK_STATS_NAME_LENGTH];      ///< Name of the lock class
+    uint64_t acquisitions;                      ///< Number of lock acquisitions
+    uint64_t contended;                         ///< Acquisitions that found the lock taken
+    uint64_t waitNs;                            ///< Sum of the wait times of contended acquisitions
+    uint64_t holdNs;                            ///< Sum of the hold times
+    uint64_t maxWaitNs;                         ///< Longest wait time
+    uint64_t maxHoldNs;                         ///< Longest hold time
+    uint64_t waitHistogram[LOCK_STATS_BUCKETS]; ///< Wait times of contended acquisitions
+    uint64_t holdHistogram[LOCK_STATS_BUCKETS]; ///< Hold times
+} LockStatsData_t;
+
+/**
+ * Counters of a lock class.
+ *
+ * Define lock classes as objects with static storage duration, the
+ * constructor links the class into the process wide list of classes.
+ */
+class __EXPORT LockClass {
+public:
+    /**
+     * @brief Create and register a lock class.
+     *
+     * @param name name of the class, a string literal
+     */
+    explicit LockClass(const char* name);
+
+    /**
+     * @brief Record an acquisition.
+     *
+     * @param contended true if the caller had to wait for the lock
+     * @param waitNs time the caller waited, only used if @c contended is set
+     */
+    void acquired(bool contended, uint64_t waitNs);
+
+    /**
+     * @brief Record a release.
+     *
+     * @param holdNs time the lock was held
+     */
+    void released(uint64_t holdNs);
+
+private:
+    friend class LockStats;
+
+    void snapshot(LockStatsData_t* data) const;
+    void reset();
+
+    const char* name;
+    LockClass* next;
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contended;
+    std::atomic<uint64_t> waitNs;
+    std::atomic<uint64_t> holdNs;
+    std::atomic<uint64_t> maxWaitNs;
+    std::atomic<uint64_t> maxHoldNs;
+    std::atomic<uint64_t> waitHistogram[LOCK_STATS_BUCKETS];
+    std::atomic<uint64_t> holdHistogram[LOCK_STATS_BUCKETS];
+};
+
+/**
+ * Process wide switch and snapshot access for the lock classes.
+ *
+ * All functions are static.
+ */
+class __EXPORT LockStats {
+public:
+    /**
+     * @brief Switch collecting on or off.
+     *
+     * Locks that are held while the switch changes do not record their
+     * hold time.
+     */
+    static void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+    /**
+     * @brief Check if collecting is on.
+     */
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get a snapshot of the lock classes.
+     *
+     * The counters of a class are read one by one while other threads may
+     * update them, the values of one class may thus be slightly inconsistent.
+     *
+     * @param data array that receives the snapshots
+     * @param maxClasses number of entries in @c data
+     * @return number of registered lock classes, may be larger than
+     *         @c maxClasses
+     */
+    static int32_t getStats(LockStatsData_t* data, int32_t maxClasses);
+
+    /**
+     * @brief Clear the counters of all lock classes.
+     */
+    static void reset();
+
+    /**
+     * @brief Monotonic clock in nanoseconds.
+     */
+    static uint64_t now();
+
+private:
+    friend class LockClass;
+
+    static std::atomic<bool> enabled;
+    static std::atomic<LockClass*> first;
+};
+
+/**
+ * A mutex that records its contention in a lock class.
+ *
+ * The class satisfies the @c Lockable requirements and works with
+ * @c std::lock_guard and @c std::unique_lock. A lock first tries to take
+ * the mutex, only a contended lock reads the clock to measure the wait.
+ */
+class __EXPORT InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(LockClass& lockClass): lockClass(lockClass), lockedAt(0) {}
+
+    void lock() {
+        if (!LockStats::isEnabled()) {
+            mutex.lock();
+            lockedAt = 0;
+            return;
+        }
+        lockTimed();
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock())
+            return false;
+        if (LockStats::isEnabled()) {
+            lockClass.acquired(false, 0);
+            lockedAt = LockStats::now();
+        }
+        else
+            lockedAt = 0;
+        return true;
+    }
+
+    void unlock() {
+        uint64_t start = lockedAt;
+        if (start != 0)
+            lockClass.released(LockStats::now() - start);
+        mutex.unlock();
+    }
+
+private:
+    InstrumentedMutex(const InstrumentedMutex& other);
+    InstrumentedMutex& operator=(const InstrumentedMutex& other);
+
+    void lockTimed();
+
+    std::mutex mutex;
+    LockClass& lockClass;
+    uint64_t lockedAt;          // 0 if the hold time is not measured
+};
+
+/**
+ * @}
+ */
+#endif // _LOCKSTATS_H_
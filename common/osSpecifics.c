@@ -16,6 +16,7 @@
 
 
 #include <stdint.h>
+#include <string.h>
 #include <common/osSpecifics.h>
 
 
@@ -74,3 +75,52 @@ uint16_t zrtpHtons (uint16_t host)
     return htons(host);
 }
 
+
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * The use of a volatile pointer guarantees that the compiler will
+ * not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+#if defined(_WIN32) || defined(_WIN64)
+void* zrtpAllocProtected(size_t length)
+{
+    void* ptr = VirtualAlloc(NULL, length, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (ptr != NULL)
+        VirtualLock(ptr, length);
+    return ptr;
+}
+
+void zrtpFreeProtected(void* ptr, size_t length)
+{
+    if (ptr == NULL)
+        return;
+    memset_volatile(ptr, 0, length);
+    VirtualUnlock(ptr, length);
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+#else
+# include <sys/mman.h>
+
+void* zrtpAllocProtected(size_t length)
+{
+    void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+        return NULL;
+    mlock(ptr, length);             // best effort, may fail because of RLIMIT_MEMLOCK
+#ifdef MADV_DONTDUMP
+    madvise(ptr, length, MADV_DONTDUMP);
+#endif
+    return ptr;
+}
+
+void zrtpFreeProtected(void* ptr, size_t length)
+{
+    if (ptr == NULL)
+        return;
+    memset_volatile(ptr, 0, length);
+    munlock(ptr, length);
+    munmap(ptr, length);
+}
+#endif
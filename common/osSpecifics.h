@@ -33,6 +33,8 @@
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
+#include <stddef.h>
+
 #ifndef __EXPORT
   #if (defined _WIN32 || defined __CYGWIN__) && defined(_WINDLL)
     #define __EXPORT    __declspec(dllimport)
@@ -117,6 +119,33 @@ extern uint32_t zrtpHtonl (uint32_t host);
  */
 extern uint16_t zrtpHtons (uint16_t host);
 
+/**
+ * Allocate memory to hold secret key material.
+ *
+ * The function allocates page aligned memory and tries to lock it into RAM
+ * to prevent that the OS swaps out the data. If the OS supports it the memory
+ * is also excluded from core dumps. Locking may fail, for example if the
+ * process exceeds its locked memory limit, the function then returns normal,
+ * not locked memory.
+ *
+ * Use this function only for long-living secret data, each allocation uses
+ * at least one memory page.
+ *
+ * @param length number of bytes to allocate.
+ *
+ * @return pointer to the zero initialized memory or @c NULL.
+ */
+extern void* zrtpAllocProtected(size_t length);
+
+/**
+ * Clear and free memory allocated with zrtpAllocProtected().
+ *
+ * @param ptr pointer to the memory, may be @c NULL.
+ *
+ * @param length number of bytes, must be the same as used during allocation.
+ */
+extern void zrtpFreeProtected(void* ptr, size_t length);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPALGORITHMS_H_
+#define _ZRTPALGORITHMS_H_
+
+/**
+ * @file zrtpAlgorithms.h
+ * @brief Compile time selection of the algorithms
+ *
+ * The build selects an algorithm profile. Algorithms that are not part of
+ * the profile are neither compiled nor linked, ZrtpConfigure does not offer
+ * them and the SRTP code paths that select between algorithms collapse to
+ * the remaining algorithm.
+ *
+ * The profiles are:
+ *
+ * - default: all algorithms.
+ * - @c ZRTP_PROFILE_NIST: AES, SHA-256, SHA-384, DH-2048, DH-3072,
+ *   NIST ECDH-256 and ECDH-384, HMAC-SHA1. No Twofish, Skein and no
+ *   non-NIST curves.
+ * - @c ZRTP_PROFILE_MINIMAL: AES, SHA-256, SHA-384, NIST ECDH-256 and
+ *   HMAC-SHA1. Note that this profile does not support the mandatory
+ *   DH-3072 of RFC 6189, thus a peer must support ECDH-256.
+ *
+ * CMake sets the profile with <code>-DZRTP_PROFILE=full|nist|minimal</code>.
+ * Each @c ZRTP_WITH_* macro may also be set on the compiler command line to
+ * override the profile, the build must then also remove the matching
+ * source files.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#if defined(ZRTP_PROFILE_NIST) || defined(ZRTP_PROFILE_MINIMAL)
+# define ZRTP_PROFILE_DEFAULT 0
+#else
+# define ZRTP_PROFILE_DEFAULT 1
+#endif
+
+/** Twofish cipher for ZRTP and SRTP. */
+#ifndef ZRTP_WITH_TWOFISH
+# define ZRTP_WITH_TWOFISH      ZRTP_PROFILE_DEFAULT
+#endif
+
+/** Skein hashes for ZRTP and Skein MAC for SRTP. */
+#ifndef ZRTP_WITH_SKEIN
+# define ZRTP_WITH_SKEIN        ZRTP_PROFILE_DEFAULT
+#endif
+
+/** Finite field Diffie-Hellman, DH-2048 and DH-3072. */
+#ifndef ZRTP_WITH_DH
+# if defined(ZRTP_PROFILE_MINIMAL)
+#  define ZRTP_WITH_DH          0
+# else
+#  define ZRTP_WITH_DH          1
+# endif
+#endif
+
+/** NIST ECDH-384. */
+#ifndef ZRTP_WITH_EC38
+# if defined(ZRTP_PROFILE_MINIMAL)
+#  define ZRTP_WITH_EC38        0
+# else
+#  define ZRTP_WITH_EC38        1
+# endif
+#endif
+
+/** Curve25519 and Curve3617, only with the standalone crypto modules. */
+#ifndef ZRTP_WITH_NON_NIST
+# if defined(SUPPORT_NON_NIST)
+#  define ZRTP_WITH_NON_NIST    ZRTP_PROFILE_DEFAULT
+# else
+#  define ZRTP_WITH_NON_NIST    0
+# endif
+#endif
+
+#if defined(__cplusplus)
+/**
+ * The selected algorithms as constants.
+ *
+ * Code that selects between algorithms at run time tests these constants
+ * first. The compiler then removes the tests if only one algorithm is
+ * left.
+ */
+namespace ZrtpAlgorithms {
+    constexpr bool twofish = ZRTP_WITH_TWOFISH != 0;
+    constexpr bool skein = ZRTP_WITH_SKEIN != 0;
+    constexpr bool dh = ZRTP_WITH_DH != 0;
+    constexpr bool ec38 = ZRTP_WITH_EC38 != 0;
+    constexpr bool nonNist = ZRTP_WITH_NON_NIST != 0;
+}
+#endif
+
+/**
+ * @}
+ */
+#endif // _ZRTPALGORITHMS_H_
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/zrtpAllocator.h>
+
+/*
+ * memset_volatile is a volatile pointer to the memset function. The use of
+ * a volatile pointer guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+/*
+ * The default allocator uses malloc for all requests except locked memory,
+ * which comes from zrtpAllocProtected. Locked memory is used for long living
+ * keys only, the page granularity of zrtpAllocProtected does not matter.
+ */
+static void* defaultAlloc(void* context, size_t size, uint32_t flags)
+{
+    (void)context;
+    if (flags & ZRTP_MEM_LOCKED)
+        return zrtpAllocProtected(size);
+    return malloc(size);
+}
+
+static void defaultRelease(void* context, void* ptr, size_t size, uint32_t flags)
+{
+    (void)context;
+    if (flags & ZRTP_MEM_LOCKED)
+        zrtpFreeProtected(ptr, size);
+    else
+        free(ptr);
+}
+
+static zrtpAllocator_t allocator = { defaultAlloc, defaultRelease, NULL };
+
+/* Set by the first allocation, a plain flag is sufficient because the
+ * application installs its allocator before it starts other threads. */
+static int allocatorUsed = 0;
+
+static uint32_t sizeClass(size_t size)
+{
+    uint32_t n = 0;
+
+    if (size <= 1)
+        return 0;
+#if defined(__GNUC__)
+    n = (uint32_t)(sizeof(unsigned long long) * 8) - (uint32_t)__builtin_clzll((unsigned long long)(size - 1));
+#else
+    size--;
+    while (size != 0) {
+        size >>= 1;
+        n++;
+    }
+#endif
+    return n > 0x3f ? 0x3f : n;
+}
+
+int zrtpSetAllocator(const zrtpAllocator_t* newAllocator)
+{
+    if (allocatorUsed)
+        return -1;
+
+    if (newAllocator == NULL) {
+        allocator.alloc = defaultAlloc;
+        allocator.release = defaultRelease;
+        allocator.context = NULL;
+    }
+    else {
+        allocator = *newAllocator;
+    }
+    return 1;
+}
+
+void* zrtpMemAlloc(size_t size, uint32_t flags)
+{
+    if (!allocatorUsed)
+        allocatorUsed = 1;
+    return allocator.alloc(allocator.context, size, (flags & 0xffffff) | (sizeClass(size) << 24));
+}
+
+void zrtpMemFree(void* ptr, size_t size, uint32_t flags)
+{
+    if (ptr == NULL)
+        return;
+    if (flags & ZRTP_MEM_SECRET)
+        memset_volatile(ptr, 0, size);
+    allocator.release(allocator.context, ptr, size, (flags & 0xffffff) | (sizeClass(size) << 24));
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPALLOCATOR_H_
+#define _ZRTPALLOCATOR_H_
+
+/**
+ * @file zrtpAllocator.h
+ * @brief Library wide allocator hook
+ *
+ * The library allocates its crypto contexts, ZRTP engines, cache records,
+ * hash contexts, bignum limbs and internal containers through one
+ * allocator. By default this is @c malloc and @c free, an application may
+ * install its own allocator, for example to use per thread arenas, huge
+ * page pools or a locked heap for secret data.
+ *
+ * Each request carries flags that tell the allocator what the memory is
+ * used for and the size class of the request, see @c ZRTP_MEM_SECRET and
+ * @c ZRTP_MEM_SIZE_CLASS. The release call gets the same size and flags as
+ * the allocation, thus the allocator does not need to store them.
+ *
+ * The library wipes memory flagged with @c ZRTP_MEM_SECRET before it
+ * returns it to the allocator.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <common/osSpecifics.h>
+
+/** The memory holds key material or other secrets. */
+#define ZRTP_MEM_SECRET         0x0001
+/** The memory shall be locked into RAM and excluded from core dumps. */
+#define ZRTP_MEM_LOCKED         0x0002
+
+/** Long living objects: engines, crypto contexts, cache records. */
+#define ZRTP_MEM_OBJECT         0x0010
+/** Key schedules of block ciphers. */
+#define ZRTP_MEM_KEY            0x0020
+/** Hash and HMAC contexts. */
+#define ZRTP_MEM_HASH           0x0040
+/** Limbs of bignums, short living and of a few sizes only. */
+#define ZRTP_MEM_BIGNUM         0x0080
+/** Storage of internal containers. */
+#define ZRTP_MEM_CONTAINER      0x0100
+/** Temporary buffers. */
+#define ZRTP_MEM_BUFFER         0x0200
+
+/** Mask of the usage bits. */
+#define ZRTP_MEM_USAGE_MASK     0x0ff0
+
+/**
+ * Size class of a request.
+ *
+ * The library sets the size class to the smallest @c n with
+ * <code>size <= 2^n</code>. An allocator may use it to select a pool
+ * without computing it from the size.
+ */
+#define ZRTP_MEM_SIZE_CLASS(flags)  (((flags) >> 24) & 0x3f)
+
+/**
+ * An allocator.
+ */
+typedef struct zrtpAllocator {
+    /**
+     * Allocate memory.
+     *
+     * @param context the context of the allocator
+     * @param size number of bytes
+     * @param flags usage and size class of the request
+     * @return pointer to the memory, suitably aligned for any type, or
+     *         @c NULL
+     */
+    void* (*alloc)(void* context, size_t size, uint32_t flags);
+
+    /**
+     * Release memory.
+     *
+     * @param context the context of the allocator
+     * @param ptr the memory, never @c NULL
+     * @param size number of bytes as given to @c alloc
+     * @param flags flags as given to @c alloc
+     */
+    void (*release)(void* context, void* ptr, size_t size, uint32_t flags);
+
+    /** Context of the allocator, the library passes it to the functions. */
+    void* context;
+} zrtpAllocator_t;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * Install an allocator.
+ *
+ * Call this function before any other function of the library, memory
+ * that the library allocated with the old allocator would be released
+ * with the new allocator.
+ *
+ * @param allocator the allocator, the library copies the structure. @c NULL
+ *        installs the default allocator.
+ * @return 1 on success, -1 if the library already allocated memory
+ */
+extern int zrtpSetAllocator(const zrtpAllocator_t* allocator);
+
+/**
+ * Allocate memory with the installed allocator.
+ *
+ * @param size number of bytes
+ * @param flags usage flags, the function adds the size class
+ * @return pointer to the memory or @c NULL
+ */
+extern void* zrtpMemAlloc(size_t size, uint32_t flags);
+
+/**
+ * Release memory allocated with zrtpMemAlloc().
+ *
+ * Wipes the memory first if @c flags contains @c ZRTP_MEM_SECRET.
+ *
+ * @param ptr the memory, may be @c NULL
+ * @param size number of bytes, must be the same as used during allocation
+ * @param flags usage flags, must be the same as used during allocation
+ */
+extern void zrtpMemFree(void* ptr, size_t size, uint32_t flags);
+
+#if defined(__cplusplus)
+}
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * Class operators that allocate objects with the installed allocator.
+ *
+ * Put this macro into the public part of a class declaration, derived
+ * classes inherit the operators.
+ *
+ * @param flags usage flags of the objects
+ */
+#define ZRTP_MEM_OPERATORS(flags) \
+    static void* operator new(size_t size) { \
+        void* ptr = zrtpMemAlloc(size, (flags)); \
+        if (ptr == NULL) throw std::bad_alloc(); \
+        return ptr; \
+    } \
+    static void operator delete(void* ptr, size_t size) { zrtpMemFree(ptr, size, (flags)); }
+
+/**
+ * Create an object of a type that has no allocator operators.
+ *
+ * @param flags usage flags of the object
+ * @return the default constructed object or @c NULL
+ */
+template <class T>
+T* zrtpNew(uint32_t flags) {
+    void* ptr = zrtpMemAlloc(sizeof(T), flags);
+    return ptr != NULL ? new (ptr) T() : NULL;
+}
+
+/**
+ * Destroy an object created with zrtpNew().
+ *
+ * @param object the object, may be @c NULL
+ * @param flags usage flags as given to zrtpNew()
+ */
+template <class T>
+void zrtpDelete(T* object, uint32_t flags) {
+    if (object != NULL) {
+        object->~T();
+        zrtpMemFree(object, sizeof(T), flags);
+    }
+}
+
+/**
+ * STL allocator that uses the installed allocator.
+ *
+ * @param T value type
+ * @param Flags usage flags, @c ZRTP_MEM_CONTAINER by default
+ */
+template <class T, uint32_t Flags = ZRTP_MEM_CONTAINER>
+class ZrtpStlAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U> struct rebind { typedef ZrtpStlAllocator<U, Flags> other; };
+
+    ZrtpStlAllocator() {}
+    template <class U> ZrtpStlAllocator(const ZrtpStlAllocator<U, Flags>&) {}
+
+    T* allocate(size_t n) {
+        void* ptr = zrtpMemAlloc(n * sizeof(T), Flags);
+        if (ptr == NULL)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t n) { zrtpMemFree(ptr, n * sizeof(T), Flags); }
+
+    size_t max_size() const { return static_cast<size_t>(-1) / sizeof(T); }
+
+    template <class U, class... Args> void construct(U* ptr, Args&&... args) { new (ptr) U(std::forward<Args>(args)...); }
+    template <class U> void destroy(U* ptr) { ptr->~U(); }
+};
+
+template <class T, class U, uint32_t Flags>
+bool operator==(const ZrtpStlAllocator<T, Flags>&, const ZrtpStlAllocator<U, Flags>&) { return true; }
+
+template <class T, class U, uint32_t Flags>
+bool operator!=(const ZrtpStlAllocator<T, Flags>&, const ZrtpStlAllocator<U, Flags>&) { return false; }
+
+/**
+ * Vector that stores its elements with the installed allocator.
+ *
+ * The library uses it for its internal containers. Containers that the
+ * library fills during static initialization, before an application can
+ * install its allocator, stay @c std::vector.
+ */
+template <class T, uint32_t Flags = ZRTP_MEM_CONTAINER>
+using ZrtpVector = std::vector<T, ZrtpStlAllocator<T, Flags> >;
+
+#endif
+
+/**
+ * @}
+ */
+#endif // _ZRTPALLOCATOR_H_
@@ -20,10 +20,12 @@
 #include <cryptcommon/ZrtpRandom.h>
 #include <cryptcommon/aescpp.h>
 #include <zrtp/crypto/sha2.h>
+#include <common/LockStats.h>
 
 static sha512_ctx mainCtx;
 
-static std::mutex lockRandom;
+static LockClass randomLockClass("ZrtpRandom");
+static InstrumentedMutex lockRandom(randomLockClass);
 
 static bool initialized = false;
 
@@ -18,6 +18,8 @@
 #include <cryptcommon/macSkein.h>
 #include <cstdlib>
 
+#include <common/zrtpAllocator.h>
+
 void macSkein(const uint8_t* key, uint64_t key_length,
               const uint8_t* data, uint64_t data_length,
               uint8_t* mac, size_t mac_length, SkeinSize_t skeinSize)
@@ -32,8 +34,8 @@ void macSkein(const uint8_t* key, uint64_t key_length,
 }
 
 void macSkein(const uint8_t* key, uint64_t key_length,
-              std::vector<const uint8_t*> data,
-              std::vector<uint64_t> dataLength,
+              ZrtpVector<const uint8_t*> data,
+              ZrtpVector<uint64_t> dataLength,
               uint8_t* mac, size_t mac_length, SkeinSize_t skeinSize)
 {
     SkeinCtx_t ctx = {};
@@ -50,7 +52,7 @@ void macSkein(const uint8_t* key, uint64_t key_length,
 void* createSkeinMacContext(const uint8_t* key, uint64_t key_length,
                             size_t mac_length, SkeinSize_t skeinSize)
 {
-    auto* ctx = (SkeinCtx_t*)malloc(sizeof(SkeinCtx_t));
+    auto* ctx = (SkeinCtx_t*)zrtpMemAlloc(sizeof(SkeinCtx_t), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     if (ctx == nullptr)
         return nullptr;
 
@@ -78,8 +80,8 @@ void macSkeinCtx(void* ctx, const uint8_t* data, uint64_t data_length, uint8_t*
 }
 
 void macSkeinCtx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength,
                  uint8_t* mac)
 {
     auto* pctx = (SkeinCtx_t*)ctx;
@@ -93,6 +95,5 @@ void macSkeinCtx(void* ctx,
 
 void freeSkeinMacContext(void* ctx)
 {
-    if (ctx)
-        free(ctx);
+    zrtpMemFree(ctx, sizeof(SkeinCtx_t), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
@@ -20,6 +20,7 @@
 
 #include <cryptcommon/skeinApi.h>
 #include <vector>
+#include <common/zrtpAllocator.h>
 /**
  * @file macSkein.h
  * @brief Function that provide Skein MAC support
@@ -77,8 +78,8 @@ void macSkein(const uint8_t* key, uint64_t keyLength,
  *    The Skein size to use.
  */
 void macSkein(const uint8_t* key, uint64_t keyLength,
-              std::vector<const uint8_t*> data,
-              std::vector<uint64_t> dataLength,
+              ZrtpVector<const uint8_t*> data,
+              ZrtpVector<uint64_t> dataLength,
               uint8_t* mac, size_t macLength, SkeinSize_t skeinSize);
 
 /**
@@ -151,8 +152,8 @@ void macSkeinCtx(void* ctx, const uint8_t* data, uint64_t dataLength, uint8_t* m
  * @param mac
  *    Points to a buffer that receives the computed digest.
  */
-void macSkeinCtx(void* ctx, const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+void macSkeinCtx(void* ctx, const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength,
                  uint8_t* mac);
 
 /**
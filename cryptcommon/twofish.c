@@ -1209,6 +1209,15 @@ static Twofish_UInt32 h( int k, Twofish_Byte L[], int kCycles )
     } 
  
  
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
 /* 
  * Pre-compute the keyed S-boxes. 
  * Fill the pre-computed S-box array in the expanded key structure. 
@@ -1220,6 +1229,11 @@ static Twofish_UInt32 h( int k, Twofish_Byte L[], int kCycles )
  * 
  * This function takes most of the time of a key expansion. 
  * 
+ * The S vector is copied into a local array first. The compiler cannot
+ * know that the stores into the S-box array do not modify the bytes of
+ * the S argument and would reload the S bytes for every S-box entry.
+ * It can keep the bytes of the local copy in registers instead. 
+ * 
  * Arguments: 
  * S        pointer to array of 8*kCycles Bytes containing the S vector. 
  * kCycles  number of key words, must be in the set {2,3,4} 
@@ -1228,39 +1242,45 @@ static Twofish_UInt32 h( int k, Twofish_Byte L[], int kCycles )
 static int fill_keyed_sboxes( Twofish_Byte S[], int kCycles, Twofish_key * xkey ) 
     { 
     int i; 
+    Twofish_Byte L[32]; 
+
+    memcpy( L, S, sizeof( L ) ); 
     switch( kCycles ) { 
         /* We code all 3 cases separately for speed reasons. */ 
     case 2: 
         for( i=0; i<256; i++ ) 
             { 
-            xkey->s[0][i]= H02( i, S ); 
-            xkey->s[1][i]= H12( i, S ); 
-            xkey->s[2][i]= H22( i, S ); 
-            xkey->s[3][i]= H32( i, S ); 
+            xkey->s[0][i]= H02( i, L ); 
+            xkey->s[1][i]= H12( i, L ); 
+            xkey->s[2][i]= H22( i, L ); 
+            xkey->s[3][i]= H32( i, L ); 
             } 
         break; 
     case 3: 
         for( i=0; i<256; i++ ) 
             { 
-            xkey->s[0][i]= H03( i, S ); 
-            xkey->s[1][i]= H13( i, S ); 
-            xkey->s[2][i]= H23( i, S ); 
-            xkey->s[3][i]= H33( i, S ); 
+            xkey->s[0][i]= H03( i, L ); 
+            xkey->s[1][i]= H13( i, L ); 
+            xkey->s[2][i]= H23( i, L ); 
+            xkey->s[3][i]= H33( i, L ); 
             } 
         break; 
     case 4: 
         for( i=0; i<256; i++ ) 
             { 
-            xkey->s[0][i]= H04( i, S ); 
-            xkey->s[1][i]= H14( i, S ); 
-            xkey->s[2][i]= H24( i, S ); 
-            xkey->s[3][i]= H34( i, S ); 
+            xkey->s[0][i]= H04( i, L ); 
+            xkey->s[1][i]= H14( i, L ); 
+            xkey->s[2][i]= H24( i, L ); 
+            xkey->s[3][i]= H34( i, L ); 
             } 
         break; 
     default:  
         /* This is always a coding error, which is fatal. */ 
       Twofish_fatal( "Twofish fill_keyed_sboxes(): Illegal argument", ERR_ILL_ARG ); 
         }
+
+    /* Wipe array that contained key material. */ 
+    (*memset_volatile)( L, 0, sizeof( L ) );
     return SUCCESS;
     }
  
@@ -1314,15 +1334,6 @@ int Twofish_initialise()
 static unsigned int rs_poly_const[] = {0, 0x14d}; 
 static unsigned int rs_poly_div_const[] = {0, 0xa6 }; 
  
-/*
- * memset_volatile is a volatile pointer to the memset function.
- * You can call (*memset_volatile)(buf, val, len) or even
- * memset_volatile(buf, val, len) just as you would call
- * memset(buf, val, len), but the use of a volatile pointer
- * guarantees that the compiler will not optimise the call away.
- */
-static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
-
 /* 
  * Prepare a key for use in encryption and decryption. 
  * Like most block ciphers, Twofish allows the key schedule  
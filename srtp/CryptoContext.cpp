@@ -21,12 +21,41 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdint>
+#include <system_error>
+#include <utility>
 
 #include <common/osSpecifics.h>
+#include <common/zrtpAllocator.h>
+#include <common/zrtpAlgorithms.h>
 
 #include "srtp/CryptoContext.h"
 #include "crypto/SrtpSymCrypto.h"
 
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+// Master key, salt and session keys, zrtpMemFree wipes them
+#define CTX_KEY_FLAGS   (ZRTP_MEM_KEY | ZRTP_MEM_SECRET)
+
+/*
+ * Compare two tags in constant time. The loop does not exit early, the run
+ * time does not depend on the position of the first differing byte.
+ */
+static bool tagsEqual(const uint8_t* a, const uint8_t* b, int32_t length)
+{
+    uint8_t diff = 0;
+
+    for (int32_t i = 0; i < length; i++)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
 CryptoContext::CryptoContext( uint32_t ssrc,
                               int32_t roc,
                               int64_t key_deriv_rate,
@@ -42,10 +71,13 @@ CryptoContext::CryptoContext( uint32_t ssrc,
                               int32_t tagLength):
 
         ssrcCtx(ssrc), mkiLength(0),mki(NULL), roc(roc),guessed_roc(0),
-        s_l(0),key_deriv_rate(key_deriv_rate), labelBase(0), seqNumSet(false), 
-        macCtx(NULL), cipher(NULL), f8Cipher(NULL)
+        s_l(0),key_deriv_rate(key_deriv_rate), authFailures(0), replayFailures(0),
+        rocRecovery(true), failureRun(0), rocRecoveries(0), rccRate(0), protectedLength(0),
+        labelBase(0), seqNumSet(false), activeKeys(&sessionKeys[0]), spareKeys(&sessionKeys[1]),
+        checkKeys(&sessionKeys[2])
 {
     replay_window[0] = replay_window[1] = 0;
+    memset(sessionKeys, 0, sizeof(sessionKeys));
     this->ealg = ealg;
     this->aalg = aalg;
     this->ekeyl = ekeyl;
@@ -53,11 +85,24 @@ CryptoContext::CryptoContext( uint32_t ssrc,
     this->skeyl = skeyl;
 
     this->master_key_length = master_key_length;
-    this->master_key = new uint8_t[master_key_length];
-    memcpy(this->master_key, master_key, master_key_length);
-
     this->master_salt_length = master_salt_length;
-    this->master_salt = new uint8_t[master_salt_length];
+
+    // A context with a key derivation rate needs the master key and salt during its
+    // whole lifetime, thus keep them in locked memory.
+    uint8_t* protectedMem = NULL;
+    if (key_deriv_rate != 0) {
+        protectedMem = (uint8_t*)zrtpMemAlloc(master_key_length + master_salt_length, CTX_KEY_FLAGS | ZRTP_MEM_LOCKED);
+    }
+    if (protectedMem != NULL) {
+        protectedLength = master_key_length + master_salt_length;
+        this->master_key = protectedMem;
+        this->master_salt = protectedMem + master_key_length;
+    }
+    else {
+        this->master_key = (uint8_t*)zrtpMemAlloc(master_key_length, CTX_KEY_FLAGS);
+        this->master_salt = (uint8_t*)zrtpMemAlloc(master_salt_length, CTX_KEY_FLAGS);
+    }
+    memcpy(this->master_key, master_key, master_key_length);
     memcpy(this->master_salt, master_salt, master_salt_length);
 
     switch (ealg) {
@@ -65,29 +110,15 @@ CryptoContext::CryptoContext( uint32_t ssrc,
             n_e = 0;
             k_e = NULL;
             n_s = 0;
-            k_s = NULL;
             break;
 
         case SrtpEncryptionTWOF8:
-            f8Cipher = new SrtpSymCrypto(SrtpEncryptionTWOF8);
-
         case SrtpEncryptionTWOCM:
-            n_e = ekeyl;
-            k_e = new uint8_t[n_e];
-            n_s = skeyl;
-            k_s = new uint8_t[n_s];
-            cipher = new SrtpSymCrypto(SrtpEncryptionTWOCM);
-            break;
-
         case SrtpEncryptionAESF8:
-            f8Cipher = new SrtpSymCrypto(SrtpEncryptionAESF8);
-
         case SrtpEncryptionAESCM:
             n_e = ekeyl;
-            k_e = new uint8_t[n_e];
+            k_e = (uint8_t*)zrtpMemAlloc(n_e, CTX_KEY_FLAGS);
             n_s = skeyl;
-            k_s = new uint8_t[n_s];
-            cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
             break;
     }
 
@@ -101,59 +132,76 @@ CryptoContext::CryptoContext( uint32_t ssrc,
         case SrtpAuthenticationSha1Hmac:
         case SrtpAuthenticationSkeinHmac:
             n_a = akeyl;
-            k_a = new uint8_t[n_a];
+            k_a = (uint8_t*)zrtpMemAlloc(n_a, CTX_KEY_FLAGS);
             this->tagLength = tagLength;
             break;
     }
-}
 
-/*
- * memset_volatile is a volatile pointer to the memset function.
- * You can call (*memset_volatile)(buf, val, len) or even
- * memset_volatile(buf, val, len) just as you would call
- * memset(buf, val, len), but the use of a volatile pointer
- * guarantees that the compiler will not optimise the call away.
- */
-static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+    // The spare and check sets of session keys are required only if we need to re-derive keys
+    int numKeySets = (key_deriv_rate != 0) ? 3 : 1;
+    for (int i = 0; i < numKeySets; i++) {
+        SessionKeys* keys = &sessionKeys[i];
+
+        switch (ealg) {
+            case SrtpEncryptionTWOF8:
+                keys->f8Cipher = new SrtpSymCrypto(SrtpEncryptionTWOF8);
+
+            case SrtpEncryptionTWOCM:
+                keys->cipher = new SrtpSymCrypto(SrtpEncryptionTWOCM);
+                break;
+
+            case SrtpEncryptionAESF8:
+                keys->f8Cipher = new SrtpSymCrypto(SrtpEncryptionAESF8);
+
+            case SrtpEncryptionAESCM:
+                keys->cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
+                break;
+        }
+        if (n_s > 0)
+            keys->k_s = (uint8_t*)zrtpMemAlloc(n_s, CTX_KEY_FLAGS);
+    }
+}
 
 CryptoContext::~CryptoContext() {
 
+    // Never release keys while the background derivation may still use them
+    if (nextKeys.valid())
+        nextKeys.wait();
+
     if (mki)
         delete [] mki;
 
+    if (protectedLength > 0) {
+        zrtpMemFree(master_key, protectedLength, CTX_KEY_FLAGS | ZRTP_MEM_LOCKED);
+        protectedLength = 0;
+        master_key_length = 0;
+        master_salt_length = 0;
+    }
     if (master_key_length > 0) {
-        memset_volatile(master_key, 0, master_key_length);
+        zrtpMemFree(master_key, master_key_length, CTX_KEY_FLAGS);
         master_key_length = 0;
-        delete [] master_key;
     }
     if (master_salt_length > 0) {
-        memset_volatile(master_salt, 0, master_salt_length);
+        zrtpMemFree(master_salt, master_salt_length, CTX_KEY_FLAGS);
         master_salt_length = 0;
-        delete [] master_salt;
     }
     if (n_e > 0) {
-        memset_volatile(k_e, 0, n_e);
-        n_e = 0;
-        delete [] k_e;
-    }
-    if (n_s > 0) {
-        memset_volatile(k_s, 0, n_s);
-        n_s = 0;
-        delete [] k_s;
+        zrtpMemFree(k_e, n_e, CTX_KEY_FLAGS);
     }
     if (n_a > 0) {
-        memset_volatile(k_a, 0, n_a);
-        n_a = 0;
-        delete [] k_a;
-    }
-    if (cipher != NULL) {
-        delete cipher;
-        cipher = NULL;
+        zrtpMemFree(k_a, n_a, CTX_KEY_FLAGS);
     }
-    if (f8Cipher != NULL) {
-        delete f8Cipher;
-        f8Cipher = NULL;
+    for (int i = 0; i < 3; i++) {
+        SessionKeys* keys = &sessionKeys[i];
+
+        zrtpMemFree(keys->k_s, n_s, CTX_KEY_FLAGS);
+        if (keys->cipher != NULL)
+            delete keys->cipher;
+        if (keys->f8Cipher != NULL)
+            delete keys->f8Cipher;
+        memset_volatile(&keys->hmacCtx, 0, sizeof(HmacCtx));
     }
+    n_e = n_a = n_s = 0;
 }
 
 void CryptoContext::srtpEncrypt(uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc ) {
@@ -161,53 +209,102 @@ void CryptoContext::srtpEncrypt(uint8_t* pkt, uint8_t* payload, uint32_t paylen,
     if (ealg == SrtpEncryptionNull) {
         return;
     }
+    SessionKeys* keys = sessionKeysForIndex(index);
+
     if (ealg == SrtpEncryptionAESCM || ealg == SrtpEncryptionTWOCM) {
+        unsigned char iv[16];
 
-        /* Compute the CM IV (refer to chapter 4.1.1 in RFC 3711):
-         *
-         * k_s   XX XX XX XX XX XX XX XX XX XX XX XX XX XX
-         * SSRC              XX XX XX XX
-         * index                         XX XX XX XX XX XX
-         * ------------------------------------------------------XOR
-         * IV    XX XX XX XX XX XX XX XX XX XX XX XX XX XX 00 00
-         */
+        computeCmIv(keys->k_s, index, ssrc, iv);
+        keys->cipher->ctr_encrypt(payload, paylen, iv);
+    }
 
+    if (ealg == SrtpEncryptionAESF8 || ealg == SrtpEncryptionTWOF8) {
         unsigned char iv[16];
-        memcpy(iv, k_s, 4);
-
-        int i;
-        for (i = 4; i < 8; i++ ) {
-            iv[i] = (0xFF & (ssrc >> ((7-i)*8))) ^ k_s[i];
-        }
-        for (i = 8; i < 14; i++ ) {
-            iv[i] = (0xFF & (unsigned char)(index >> ((13-i)*8) ) ) ^ k_s[i];
-        }
-        iv[14] = iv[15] = 0;
 
-        cipher->ctr_encrypt(payload, paylen, iv);
+        computeF8Iv(pkt, index, iv);
+        keys->cipher->f8_encrypt(payload, paylen, iv, keys->f8Cipher);
     }
+}
 
-    if (ealg == SrtpEncryptionAESF8 || ealg == SrtpEncryptionTWOF8) {
+bool CryptoContext::srtpTranscrypt(CryptoContext* to, uint8_t* pkt, uint8_t* payload, uint32_t paylen,
+                                   uint64_t index, uint64_t toIndex, uint32_t ssrc) {
 
-        /* Create the F8 IV (refer to chapter 4.1.2.2 in RFC 3711):
-         *
-         * IV = 0x00 || M || PT || SEQ  ||      TS    ||    SSRC   ||    ROC
-         *      8Bit  1bit  7bit  16bit       32bit        32bit        32bit
-         * ------------\     /--------------------------------------------------
-         *       XX       XX      XX XX   XX XX XX XX   XX XX XX XX  XX XX XX XX
-         */
+    bool isCm = ealg == SrtpEncryptionAESCM || ealg == SrtpEncryptionTWOCM;
+    bool toCm = to->ealg == SrtpEncryptionAESCM || to->ealg == SrtpEncryptionTWOCM;
 
+    if (isCm && toCm) {
         unsigned char iv[16];
-        uint32_t *ui32p = (uint32_t *)iv;
+        unsigned char toIv[16];
+        SessionKeys* keys = sessionKeysForIndex(index);
+        SessionKeys* toKeys = to->sessionKeysForIndex(toIndex);
+
+        computeCmIv(keys->k_s, index, ssrc, iv);
+        computeCmIv(toKeys->k_s, toIndex, ssrc, toIv);
+        return SrtpSymCrypto::ctr_transcrypt(keys->cipher, iv, toKeys->cipher, toIv, payload, paylen);
+    }
+    // Each F8 key stream block depends on the previous one, F8 and the NULL
+    // cipher take the two pass path
+    srtpEncrypt(pkt, payload, paylen, index, ssrc);
+    to->srtpEncrypt(pkt, payload, paylen, toIndex, ssrc);
+    return true;
+}
 
-        memcpy(iv, pkt, 12);
-        iv[0] = 0;
+void CryptoContext::computeCmIv(const uint8_t* k_s, uint64_t index, uint32_t ssrc, uint8_t* iv) {
 
-        // set ROC in network order into IV
-        ui32p[3] = zrtpHtonl(roc);
+    /* Compute the CM IV (refer to chapter 4.1.1 in RFC 3711):
+     *
+     * k_s   XX XX XX XX XX XX XX XX XX XX XX XX XX XX
+     * SSRC              XX XX XX XX
+     * index                         XX XX XX XX XX XX
+     * ------------------------------------------------------XOR
+     * IV    XX XX XX XX XX XX XX XX XX XX XX XX XX XX 00 00
+     */
+    memcpy(iv, k_s, 4);
 
-        cipher->f8_encrypt(payload, paylen, iv, f8Cipher);
+    int i;
+    for (i = 4; i < 8; i++ ) {
+        iv[i] = (0xFF & (ssrc >> ((7-i)*8))) ^ k_s[i];
+    }
+    for (i = 8; i < 14; i++ ) {
+        iv[i] = (0xFF & (unsigned char)(index >> ((13-i)*8) ) ) ^ k_s[i];
     }
+    iv[14] = iv[15] = 0;
+}
+
+void CryptoContext::computeF8Iv(const uint8_t* pkt, uint64_t index, uint8_t* iv) {
+
+    /* Create the F8 IV (refer to chapter 4.1.2.2 in RFC 3711):
+     *
+     * IV = 0x00 || M || PT || SEQ  ||      TS    ||    SSRC   ||    ROC
+     *      8Bit  1bit  7bit  16bit       32bit        32bit        32bit
+     * ------------\     /--------------------------------------------------
+     *       XX       XX      XX XX   XX XX XX XX   XX XX XX XX  XX XX XX XX
+     */
+    uint32_t *ui32p = (uint32_t *)iv;
+
+    memcpy(iv, pkt, 12);
+    iv[0] = 0;
+
+    // set ROC of the packet index in network order into IV
+    ui32p[3] = zrtpHtonl((uint32_t)(index >> 16));
+}
+
+bool CryptoContext::srtpPrepareF8(const uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, F8_JOB* job) {
+
+    // With a key derivation rate a later packet of the batch may replace the
+    // session keys that an earlier packet uses
+    if ((ealg != SrtpEncryptionAESF8 && ealg != SrtpEncryptionTWOF8) || key_deriv_rate != 0) {
+        return false;
+    }
+    SessionKeys* keys = sessionKeysForIndex(index);
+
+    computeF8Iv(pkt, index, job->iv);
+    job->in = payload;
+    job->out = payload;
+    job->length = paylen;
+    job->cipher = keys->cipher;
+    job->f8Cipher = keys->f8Cipher;
+    return true;
 }
 
 /* Warning: tag must have been initialized */
@@ -217,38 +314,133 @@ void CryptoContext::srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc
     if (aalg == SrtpAuthenticationNull) {
         return;
     }
+    // The session keys depend on the packet index, the RTP sequence number are bytes 2 and 3
+    uint64_t index = ((uint64_t)roc << 16) | (uint64_t)((pkt[2] << 8) | pkt[3]);
+    computeTag(sessionKeysForIndex(index), pkt, pktlen, roc, tag);
+}
+
+void CryptoContext::computeTag(SessionKeys* keys, uint8_t* pkt, uint32_t pktlen, uint32_t roc, uint8_t* tag)
+{
     uint32_t macL;
 
     unsigned char temp[20];
+    uint16_t seq = (pkt[2] << 8) | pkt[3];
 
-    std::vector<const uint8_t*>chunks;
-    std::vector<uint64_t> chunkLength;
     uint32_t beRoc = zrtpHtonl(roc);
 
-    chunks.push_back(pkt);
-    chunkLength.push_back(pktlen);
+    macChunks.clear();
+    macChunkLength.clear();
+
+    macChunks.push_back(pkt);
+    macChunkLength.push_back(pktlen);
 
-    chunks.push_back((unsigned char *)&beRoc);
-    chunkLength.push_back(4);
+    macChunks.push_back((unsigned char *)&beRoc);
+    macChunkLength.push_back(4);
 
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
-        hmacSha1Ctx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
+        hmacSha1Ctx(keys->macCtx,
+                    macChunks,        // data chunks to hash
+                    macChunkLength,   // length of the data to hash
                     temp, &macL);
-        /* truncate the result */
-        memcpy(tag, temp, getTagLength());
         break;
+#if ZRTP_WITH_SKEIN
     case SrtpAuthenticationSkeinHmac:
-        macSkeinCtx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
+        macSkeinCtx(keys->macCtx,
+                    macChunks,        // data chunks to hash
+                    macChunkLength,   // length of the data to hash
                     temp);
-        /* truncate the result */
-        memcpy(tag, temp, getTagLength());
         break;
+#endif
+    }
+    /* RFC 4771, RCCm1: the tag carries the ROC and the MAC truncated by 4 bytes */
+    if (rccRate != 0 && seq % rccRate == 0) {
+        memcpy(tag, &beRoc, 4);
+        memcpy(tag + 4, temp, getTagLength() - 4);
+        return;
+    }
+    /* truncate the result */
+    memcpy(tag, temp, getTagLength());
+}
+
+bool CryptoContext::srtpVerify(uint8_t* pkt, uint32_t pktlen, uint32_t roc, const uint8_t* tag)
+{
+    uint8_t mac[20];
+
+    if (getTagLength() == 0)
+        return true;
+
+    uint64_t index = ((uint64_t)roc << 16) | (uint64_t)((pkt[2] << 8) | pkt[3]);
+    computeTag(verifyKeysForIndex(index), pkt, pktlen, roc, mac);
+    if (!tagsEqual(tag, mac, getTagLength())) {
+        authFailures++;
+        failureRun++;
+        return false;
+    }
+    failureRun = 0;
+    return true;
+}
+
+bool CryptoContext::recoverIndex(uint8_t* pkt, uint32_t pktlen, const uint8_t* tag, uint64_t* index)
+{
+    uint8_t mac[20];
+    uint32_t candidates[4];
+    int32_t numCandidates = 0;
+
+    if (getTagLength() == 0 || !seqNumSet)
+        return false;
+
+    uint16_t seq = (pkt[2] << 8) | pkt[3];
+    // The highest index that authenticated so far. Never go back behind it,
+    // a captured packet of an older ROC authenticates with that ROC.
+    uint64_t localIndex = ((uint64_t)roc << 16) | s_l;
+
+    if (rccRate != 0 && seq % rccRate == 0) {
+        uint32_t carried;
+        memcpy(&carried, tag, 4);
+        candidates[numCandidates++] = zrtpNtohl(carried);
+    }
+    else if (rocRecovery && failureRun >= rocRecoveryThreshold &&
+             (failureRun - rocRecoveryThreshold) % rocRecoveryInterval == 0) {
+        // The local ROC and the next ROCs, without the guessed ROC itself:
+        // two or three candidates
+        const uint32_t neighbours[] = {roc, roc + 1, guessed_roc + 1};
+        for (size_t n = 0; n < sizeof(neighbours) / sizeof(neighbours[0]); n++) {
+            bool known = neighbours[n] == guessed_roc;
+            for (int32_t i = 0; i < numCandidates && !known; i++)
+                known = candidates[i] == neighbours[n];
+            if (!known)
+                candidates[numCandidates++] = neighbours[n];
+        }
+    }
+
+    for (int32_t i = 0; i < numCandidates; i++) {
+        uint64_t candidateIndex = ((uint64_t)candidates[i] << 16) | seq;
+        if (candidateIndex <= localIndex)
+            continue;
+
+        computeTag(verifyKeysForIndex(candidateIndex), pkt, pktlen, candidates[i], mac);
+        if (!tagsEqual(tag, mac, getTagLength()))
+            continue;
+
+        // Resynchronize, the packet becomes the highest packet received so far
+        updateIndex(candidateIndex);
+        failureRun = 0;
+        rocRecoveries++;
+        *index = candidateIndex;
+        return true;
+    }
+    return false;
+}
+
+bool CryptoContext::setRccRate(uint16_t rate)
+{
+    if (rate != 0 && getTagLength() < 8) {
+        rccRate = 0;
+        return false;
     }
+    rccRate = rate;
+    return true;
 }
 
 /* used by the key derivation method */
@@ -287,12 +479,37 @@ static void computeIv(unsigned char* iv, uint64_t label, uint64_t index,
 
 /* Derive the srtp session keys from the master key */
 void CryptoContext::deriveSrtpKeys(uint64_t index)
+{
+    // A running background derivation uses the scratch key buffers
+    if (nextKeys.valid())
+        nextKeys.get();
+
+    activeKeys = &sessionKeys[0];
+    spareKeys = &sessionKeys[1];
+    checkKeys = &sessionKeys[2];
+    spareKeys->valid = false;
+    checkKeys->valid = false;
+    deriveSessionKeys(activeKeys, index);
+
+    // Without a key derivation rate we don't need the master key and salt anymore
+    if (key_deriv_rate == 0) {
+        memset_volatile(master_key, 0, master_key_length);
+        memset_volatile(master_salt, 0, master_salt_length);
+    }
+}
+
+/*
+ * Derive one set of session keys. Only one derivation runs at a time, either
+ * on the caller's thread or as background task, thus the scratch buffers k_e and
+ * k_a are safe to use.
+ */
+void CryptoContext::deriveSessionKeys(SessionKeys* keys, uint64_t index)
 {
     uint8_t iv[16];
+    SrtpSymCrypto* cipher = keys->cipher;
 
     // prepare cipher to compute derived keys.
     cipher->setNewKey(master_key, master_key_length);
-    memset(master_key, 0, master_key_length);
 
     // compute the session encryption key
     uint64_t label = labelBase + 0;
@@ -307,29 +524,104 @@ void CryptoContext::deriveSrtpKeys(uint64_t index)
     // Initialize MAC context with the derived key
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
-        macCtx = &hmacCtx.hmacSha1Ctx;
-        macCtx = initializeSha1HmacContext(macCtx, k_a, n_a);
+        keys->macCtx = &keys->hmacCtx.hmacSha1Ctx;
+        keys->macCtx = initializeSha1HmacContext(keys->macCtx, k_a, n_a);
         break;
+#if ZRTP_WITH_SKEIN
     case SrtpAuthenticationSkeinHmac:
-        macCtx = &hmacCtx.hmacSkeinCtx;
+        keys->macCtx = &keys->hmacCtx.hmacSkeinCtx;
 
         // Skein MAC uses number of bits as MAC size, not just bytes
-        macCtx = initializeSkeinMacContext(macCtx, k_a, n_a, tagLength*8, Skein512);
+        keys->macCtx = initializeSkeinMacContext(keys->macCtx, k_a, n_a, tagLength*8, Skein512);
         break;
+#endif
     }
-    memset(k_a, 0, n_a);
+    memset_volatile(k_a, 0, n_a);
 
     // compute the session salt
     label = labelBase + 0x02;
     computeIv(iv, label, index, key_deriv_rate, master_salt);
-    cipher->get_ctr_cipher_stream(k_s, n_s, iv);
-    memset(master_salt, 0, master_salt_length);
+    cipher->get_ctr_cipher_stream(keys->k_s, n_s, iv);
 
     // as last step prepare cipher with derived key.
     cipher->setNewKey(k_e, n_e);
-    if (f8Cipher != NULL)
-        cipher->f8_deriveForIV(f8Cipher, k_e, n_e, k_s, n_s);
-    memset(k_e, 0, n_e);
+    if (keys->f8Cipher != NULL)
+        cipher->f8_deriveForIV(keys->f8Cipher, k_e, n_e, keys->k_s, n_s);
+    memset_volatile(k_e, 0, n_e);
+
+    keys->keyId = (key_deriv_rate == 0) ? 0 : index / key_deriv_rate;
+    keys->valid = true;
+}
+
+CryptoContext::SessionKeys* CryptoContext::sessionKeysForIndex(uint64_t index)
+{
+    if (key_deriv_rate == 0)
+        return activeKeys;
+
+    uint64_t keyId = index / key_deriv_rate;
+
+    if (!activeKeys->valid || activeKeys->keyId != keyId) {
+        // The packet belongs to another key derivation period. The background
+        // derivation must be complete before we can check the spare keys.
+        if (nextKeys.valid())
+            nextKeys.get();
+
+        // No pre-derived keys available, for example after a large index jump. The
+        // packet may have been verified with the check keys, take them instead.
+        if (!spareKeys->valid || spareKeys->keyId != keyId) {
+            if (checkKeys->valid && checkKeys->keyId == keyId)
+                std::swap(spareKeys, checkKeys);
+            else
+                deriveSessionKeys(spareKeys, index);
+        }
+
+        // Late packets of the previous period use the previous keys, don't switch back
+        if (activeKeys->valid && keyId < activeKeys->keyId)
+            return spareKeys;
+
+        std::swap(activeKeys, spareKeys);
+    }
+
+    // Start to derive the keys of the next period when the index passes the middle of
+    // the current period. The previous keys are not required anymore at this point:
+    // older packets are outside of the replay window. Short key derivation periods
+    // don't benefit from a background derivation, they derive on demand (see above).
+    if (!nextKeys.valid() && key_deriv_rate >= 2 * REPLAY_WINDOW_SIZE &&
+        (uint64_t)(index % key_deriv_rate) >= (uint64_t)(key_deriv_rate / 2) &&
+        !(spareKeys->valid && spareKeys->keyId == keyId + 1)) {
+
+        spareKeys->valid = false;
+        try {
+            nextKeys = std::async(std::launch::async, &CryptoContext::deriveSessionKeys, this,
+                                  spareKeys, (keyId + 1) * key_deriv_rate);
+        } catch (const std::system_error&) {
+            // No thread available, derive on demand at the period boundary
+        }
+    }
+    return activeKeys;
+}
+
+CryptoContext::SessionKeys* CryptoContext::verifyKeysForIndex(uint64_t index)
+{
+    if (key_deriv_rate == 0)
+        return activeKeys;
+
+    uint64_t keyId = index / key_deriv_rate;
+    if (activeKeys->valid && activeKeys->keyId == keyId)
+        return activeKeys;
+
+    // The background derivation writes the spare keys and uses the scratch buffers
+    if (nextKeys.valid())
+        nextKeys.get();
+
+    if (spareKeys->valid && spareKeys->keyId == keyId)
+        return spareKeys;
+
+    // Derive into the check keys, they never become active before a packet of
+    // their period authenticated. Keep them, the next packet likely needs them too.
+    if (!checkKeys->valid || checkKeys->keyId != keyId)
+        deriveSessionKeys(checkKeys, index);
+    return checkKeys;
 }
 
 /* Based on the algorithm provided in Appendix A - draft-ietf-srtp-05.txt */
@@ -410,11 +702,19 @@ bool CryptoContext::checkReplay(uint16_t newSeq)
 // ahead by more than REPLAY_WINDOW_SIZE.
 void CryptoContext::update(uint16_t newSeq)
 {
-    // Get the index of the new sequence number and compute the delta to the
-    // index of the highest sequence number we received so far. If the delta 
-    // is negative then we received an older packet, thus we will not
-    // update the locally stored remote sequence number (s_l) below.
-    int64_t delta = guessIndex(newSeq) - (((uint64_t)roc) << 16 | s_l );
+    updateIndex(guessIndex(newSeq));
+}
+
+void CryptoContext::updateIndex(uint64_t newIndex)
+{
+    uint16_t newSeq = (uint16_t)newIndex;
+    uint32_t newRoc = (uint32_t)(newIndex >> 16);
+
+    // Compute the delta to the index of the highest sequence number we
+    // received so far. If the delta is negative then we received an older
+    // packet, thus we will not update the locally stored remote sequence
+    // number (s_l) below.
+    int64_t delta = newIndex - (((uint64_t)roc) << 16 | s_l );
     int64_t rocDelta = delta;
     uint64_t carry = 0;
 
@@ -451,11 +751,15 @@ void CryptoContext::update(uint16_t newSeq)
         s_l = newSeq;
     }
     // Reset local stored sequence number (low 16 bits) also if ROC increases
-    // The guessed_roc is bigger than roc only if we received a not yet seen packet.
-    if (guessed_roc > roc) {
-        roc = guessed_roc;
+    // The new ROC is bigger than roc only if we received a not yet seen packet.
+    if (newRoc > roc) {
+        roc = newRoc;
         s_l = newSeq;
     }
+    // The packet authenticated, now it may switch the session keys or start
+    // the derivation of the next keys
+    if (key_deriv_rate != 0)
+        sessionKeysForIndex(newIndex);
 }
 
 CryptoContext* CryptoContext::newCryptoContextForSSRC(uint32_t ssrc, int roc, int64_t keyDerivRate)
@@ -475,5 +779,7 @@ CryptoContext* CryptoContext::newCryptoContextForSSRC(uint32_t ssrc, int roc, in
         this->skeyl,                             // session salt len
         this->tagLength);                        // authentication tag len
 
+    pcc->setRccRate(rccRate);
+    pcc->setRocRecovery(rocRecovery);
     return pcc;
 }
@@ -40,6 +40,10 @@ const int SrtpEncryptionTWOF8 = 4;
 #ifndef CRYPTOCONTEXTCTRL_H
 
 #include <stdint.h>
+#include <future>
+#include <vector>
+
+#include <common/zrtpAllocator.h>
 #ifdef ZRTP_OPENSSL
 #include <openssl/hmac.h>
 #endif
@@ -47,6 +51,7 @@ const int SrtpEncryptionTWOF8 = 4;
 #include "cryptcommon/macSkein.h"
 
 class SrtpSymCrypto;
+struct _f8_job;
 
 /**
  * @brief Implementation for a SRTP cryptographic context.
@@ -128,12 +133,30 @@ class SrtpSymCrypto;
  * CryptoContext templates if the application cannot protect the templates against
  * reading from other possibly rogue applications.
  *
+ * <b>Key derivation rate</b>
+ *
+ * If the application sets a key derivation rate other than zero (RFC 3711,
+ * chapter 4.3.1) the CryptoContext re-derives the session keys each time the
+ * packet index crosses a multiple of the key derivation rate. The CryptoContext
+ * holds two sets of session keys. When the packet index passes the middle of
+ * the current key derivation period the CryptoContext starts to derive the next
+ * set of session keys in the background. It switches to the new keys exactly at
+ * the first packet index of the next period, thus the protect and unprotect
+ * functions usually don't need to wait for a key derivation. The previous set of
+ * session keys remains available to process late, re-ordered packets.
+ *
+ * To re-derive the keys the CryptoContext must keep the master key and master salt.
+ * In this case it does not clear them after the first key derivation but stores them
+ * in locked memory (see zrtpAllocProtected()) until the CryptoContext is destroyed.
+ *
  * @sa SrtpHandler
  * 
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 class CryptoContext {
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
+
     /**
      * @brief Constructor for an active SRTP cryptographic context.
      *
@@ -275,6 +298,69 @@ public:
      */
     void srtpEncrypt(uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc);
 
+    /**
+     * @brief Re-encrypt a packet from this context to another context.
+     *
+     * Removes the encryption of this context and applies the encryption of
+     * @c to. If both contexts use a counter mode cipher the function XORs
+     * both key streams into the payload in one pass and the payload never
+     * holds the plain text. Otherwise it decrypts and encrypts in two
+     * passes.
+     *
+     * @param to
+     *    The context to encrypt the payload with.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer, used for F8.
+     *
+     * @param payload
+     *    The data to re-encrypt.
+     *
+     * @param paylen
+     *    Length of payload.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index of this context.
+     *
+     * @param toIndex
+     *    The 48 bit SRTP packet index of the context @c to.
+     *
+     * @param ssrc
+     *    The RTP SSRC data in <em>host</em> order.
+     *
+     * @return
+     *    @c false if the one pass path has no cipher key, the payload is unchanged.
+     */
+    bool srtpTranscrypt(CryptoContext* to, uint8_t* pkt, uint8_t* payload, uint32_t paylen,
+                        uint64_t index, uint64_t toIndex, uint32_t ssrc);
+
+    /**
+     * @brief Prepare the F8 encryption of a packet for a batch.
+     *
+     * If the context uses F8 the method fills in @c job, the caller then
+     * runs @c SrtpSymCrypto::f8_encryptBatch with the jobs of several packets.
+     * Otherwise, or if the context uses a key derivation rate, the caller must
+     * use @c srtpEncrypt.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer.
+     *
+     * @param payload
+     *    The data to encrypt.
+     *
+     * @param paylen
+     *    Length of payload.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index.
+     *
+     * @param job
+     *    The F8 job to fill in.
+     *
+     * @return @c true if the job is ready
+     */
+    bool srtpPrepareF8(const uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, struct _f8_job* job);
+
     /**
      * @brief Compute the authentication tag.
      *
@@ -292,10 +378,34 @@ public:
      *
      * @param tag
      *    Points to a buffer that hold the computed tag. This buffer must
-     *    be able to hold <code>tagLength</code> bytes.
+     *    be able to hold <code>tagLength</code> bytes. If ROC carriage is
+     *    enabled the tag may carry the ROC, see @c setRccRate.
      */
     void srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc, uint8_t* tag);
 
+    /**
+     * @brief Verify the authentication tag of a received packet.
+     *
+     * Computes the tag and compares it in constant time with the received
+     * tag. A failed check increments the authentication failure counter,
+     * also if @c recoverIndex later accepts the packet.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer that contains the data to authenticate.
+     *
+     * @param pktlen
+     *    Length of the RTP packet buffer without tag and MKI
+     *
+     * @param roc
+     *    The 32 bit SRTP roll-over-counter.
+     *
+     * @param tag
+     *    Points to the received tag.
+     *
+     * @return true if the tags match.
+     */
+    bool srtpVerify(uint8_t* pkt, uint32_t pktlen, uint32_t roc, const uint8_t* tag);
+
     /**
      * @brief Perform key derivation according to SRTP specification
      *
@@ -304,7 +414,9 @@ public:
      * SRTP Cryptograhic context was set up.
      *
      * This method clears the key data once it was processed by the encryptions'
-     * set key functions.
+     * set key functions. If the key derivation rate is not zero the method keeps
+     * the master key and master salt to derive the keys for the following key
+     * derivation periods.
      *
      * @param index
      *    The 48 bit SRTP packet index. See the <code>guessIndex</code>
@@ -375,6 +487,107 @@ public:
      */
     uint32_t getSsrc() const { return ssrcCtx; }
 
+    /**
+     * @brief Count a packet that failed the replay check.
+     */
+    void countReplayFailure() { replayFailures++; failureRun++; }
+
+    /**
+     * @brief Get the number of packets that failed authentication.
+     */
+    uint64_t getAuthFailures() const { return authFailures; }
+
+    /**
+     * @brief Get the number of packets that failed the replay check.
+     */
+    uint64_t getReplayFailures() const { return replayFailures; }
+
+    /**
+     * @brief Reset the failure counters.
+     */
+    void resetFailureCounters() { authFailures = replayFailures = rocRecoveries = 0; }
+
+    /**
+     * @brief Try to recover the ROC of a packet that failed the checks.
+     *
+     * Call this method if a packet failed the replay check or the
+     * authentication with the guessed index. After a long gap or a lost
+     * ROC update the guessed ROC may be off by one. The method then tries
+     * the local ROC, the local ROC plus one and the guessed ROC plus one, at
+     * most three MACs. If a tag matches the packet becomes the highest
+     * packet received so far: the method advances the ROC and the highest
+     * sequence number and shifts the replay window as for any new packet.
+     *
+     * The method tries the alternate ROCs only after @c rocRecoveryThreshold
+     * consecutive failures and then only every @c rocRecoveryInterval
+     * failures, thus forged packets cost at most a few additional MACs.
+     * The method accepts an index only if it is above the highest index
+     * that authenticated so far, thus a replayed packet never moves the
+     * ROC backwards.
+     *
+     * If ROC carriage is enabled (see @c setRccRate) and the packet carries
+     * the sender's ROC the method checks this ROC only, without a
+     * threshold, the same restriction applies.
+     *
+     * @param pkt
+     *    Pointer to the received packet without tag and MKI
+     *
+     * @param pktlen
+     *    Length of the packet without tag and MKI
+     *
+     * @param tag
+     *    Points to the received tag.
+     *
+     * @param index
+     *    Receives the recovered 48 bit index.
+     *
+     * @return true if the packet authenticated with a recovered ROC.
+     */
+    bool recoverIndex(uint8_t* pkt, uint32_t pktlen, const uint8_t* tag, uint64_t* index);
+
+    /**
+     * @brief Enable or disable the ROC recovery.
+     *
+     * The recovery is enabled by default, see @c recoverIndex.
+     */
+    void setRocRecovery(bool enable) { rocRecovery = enable; }
+
+    /**
+     * @brief Get the number of successful ROC recoveries.
+     */
+    uint64_t getRocRecoveries() const { return rocRecoveries; }
+
+    /**
+     * @brief Enable ROC carriage in the authentication tag.
+     *
+     * Implements mode RCCm1 of RFC 4771: the tag of every packet with a
+     * sequence number that is a multiple of @c rate carries the 32 bit ROC
+     * of the sender in network order, followed by the MAC truncated to the
+     * tag length minus 4 bytes. The receiver takes the ROC from these
+     * packets and does not depend on its estimate.
+     *
+     * Both parties must agree on the rate, the mode is not negotiated by
+     * ZRTP. Set the same rate on the sender's and the receiver's context.
+     *
+     * @param rate
+     *    The rate R, 0 disables ROC carriage.
+     *
+     * @return false if the tag is shorter than 8 bytes. ROC carriage
+     *    is disabled in this case.
+     */
+    bool setRccRate(uint16_t rate);
+
+    /**
+     * @brief Get the ROC carriage rate, 0 if disabled.
+     */
+    uint16_t getRccRate() const { return rccRate; }
+
+    /// Consecutive failures before @c recoverIndex tries alternate ROCs
+    static const uint32_t rocRecoveryThreshold = 4;
+
+    /// Number of failures between two tries of alternate ROCs
+    static const uint32_t rocRecoveryInterval = 16;
+
     /**
      * @brief Set the start (base) number to compute the PRF labels.
      *
@@ -438,18 +651,85 @@ private:
     /* bitmask for replay check */
     uint64_t replay_window[2];
 
+    uint64_t authFailures;
+    uint64_t replayFailures;
+
+    /* ROC recovery and RFC 4771 ROC carriage */
+    bool     rocRecovery;
+    uint32_t failureRun;            // consecutive failed packets
+    uint64_t rocRecoveries;
+    uint16_t rccRate;
+
+    /* Scratch lists for the MAC computation, avoid allocations per packet */
+    ZrtpVector<const uint8_t*> macChunks;
+    ZrtpVector<uint64_t> macChunkLength;
+
+    /* One set of session keys, valid for one key derivation period */
+    typedef struct _sessionKeys {
+        uint64_t keyId;             ///< index / key_deriv_rate of the period
+        bool     valid;
+        uint8_t* k_s;               ///< session salt
+        void*    macCtx;
+        HmacCtx  hmacCtx;
+        SrtpSymCrypto* cipher;
+        SrtpSymCrypto* f8Cipher;
+    } SessionKeys;
+
+    /**
+     * Derive the session keys for the key derivation period of @c index.
+     */
+    void deriveSessionKeys(SessionKeys* keys, uint64_t index);
+
+    /**
+     * Return the session keys to process the packet with @c index.
+     *
+     * Switches to the next set of session keys at a key derivation boundary
+     * and starts the background derivation of the next set if necessary.
+     */
+    SessionKeys* sessionKeysForIndex(uint64_t index);
+
+    /**
+     * Return the session keys to verify a received packet with @c index.
+     *
+     * Never switches the active keys or starts a background derivation, an
+     * unauthenticated packet must not change the key state. Keys of another
+     * period are derived into the check set.
+     */
+    SessionKeys* verifyKeysForIndex(uint64_t index);
+
+    /**
+     * Compute the authentication tag of a packet with the given session keys.
+     */
+    void computeTag(SessionKeys* keys, uint8_t* pkt, uint32_t pktlen, uint32_t roc, uint8_t* tag);
+
+    /**
+     * Update the ROC, the highest sequence number and the replay window
+     * with the 48 bit index of an authenticated packet.
+     */
+    void updateIndex(uint64_t newIndex);
+
+    /**
+     * Compute the F8 IV of a packet, refer to chapter 4.1.2.2 in RFC 3711.
+     */
+    static void computeF8Iv(const uint8_t* pkt, uint64_t index, uint8_t* iv);
+
+    /**
+     * Compute the CM IV of a packet, refer to chapter 4.1.1 in RFC 3711.
+     */
+    static void computeCmIv(const uint8_t* k_s, uint64_t index, uint32_t ssrc, uint8_t* iv);
+
     uint8_t* master_key;
     uint32_t master_key_length;
     uint8_t* master_salt;
     uint32_t master_salt_length;
+    size_t   protectedLength;       // > 0 if master key/salt use protected memory
 
     /* Session Encryption, Authentication keys, Salt */
     int32_t  n_e;
-    uint8_t* k_e;
+    uint8_t* k_e;                   // scratch buffer during key derivation
     int32_t  n_a;
-    uint8_t* k_a;
+    uint8_t* k_a;                   // scratch buffer during key derivation
     int32_t  n_s;
-    uint8_t* k_s;
 
     int32_t ealg;
     int32_t aalg;
@@ -460,11 +740,12 @@ private:
     uint8_t labelBase;
     bool  seqNumSet;
 
-    void*   macCtx;
-    HmacCtx hmacCtx;
+    SessionKeys  sessionKeys[3];
+    SessionKeys* activeKeys;
+    SessionKeys* spareKeys;         // keys of the previous or the next period
+    SessionKeys* checkKeys;         // verify packets of other periods, never active
 
-    SrtpSymCrypto* cipher;
-    SrtpSymCrypto* f8Cipher;
+    std::future<void> nextKeys;     // background derivation of the next session keys
 };
 
 #endif
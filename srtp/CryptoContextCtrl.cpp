@@ -23,12 +23,17 @@
 #include <cstdint>
 
 #include <common/osSpecifics.h>
+#include <common/zrtpAllocator.h>
+#include <common/zrtpAlgorithms.h>
 
 #include "srtp/CryptoContextCtrl.h"
 #include "srtp/CryptoContext.h"
 
 #include "srtp/crypto/SrtpSymCrypto.h"
 
+// Master key, salt and session keys, zrtpMemFree wipes them
+#define CTX_KEY_FLAGS   (ZRTP_MEM_KEY | ZRTP_MEM_SECRET)
+
 
 CryptoContextCtrl::CryptoContextCtrl(uint32_t ssrc,
                                 const int32_t ealg,
@@ -41,8 +46,9 @@ CryptoContextCtrl::CryptoContextCtrl(uint32_t ssrc,
                                 int32_t akeyl,
                                 int32_t skeyl,
                                 int32_t tagLength):
-ssrcCtx(ssrc), mkiLength(0),mki(NULL), replay_window(0), srtcpIndex(0),
-labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels start at 3
+ssrcCtx(ssrc), mkiLength(0),mki(NULL), s_l(0), replay_window(0), authFailures(0), replayFailures(0), srtcpIndex(0),
+labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL),       // SRTCP labels start at 3
+ssrcFamily(false), ssrcTableUsed(0)
 
 {
     this->ealg = ealg;
@@ -52,11 +58,11 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
     this->skeyl = skeyl;
 
     this->master_key_length = master_key_length;
-    this->master_key = new uint8_t[master_key_length];
+    this->master_key = (uint8_t*)zrtpMemAlloc(master_key_length, CTX_KEY_FLAGS);
     memcpy(this->master_key, master_key, master_key_length);
 
     this->master_salt_length = master_salt_length;
-    this->master_salt = new uint8_t[master_salt_length];
+    this->master_salt = (uint8_t*)zrtpMemAlloc(master_salt_length, CTX_KEY_FLAGS);
     memcpy(this->master_salt, master_salt, master_salt_length);
 
     switch (ealg) {
@@ -72,9 +78,9 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
 
         case SrtpEncryptionTWOCM:
             n_e = ekeyl;
-            k_e = new uint8_t[n_e];
+            k_e = (uint8_t*)zrtpMemAlloc(n_e, CTX_KEY_FLAGS);
             n_s = skeyl;
-            k_s = new uint8_t[n_s];
+            k_s = (uint8_t*)zrtpMemAlloc(n_s, CTX_KEY_FLAGS);
             cipher = new SrtpSymCrypto(SrtpEncryptionTWOCM);
             break;
 
@@ -83,9 +89,9 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
 
         case SrtpEncryptionAESCM:
             n_e = ekeyl;
-            k_e = new uint8_t[n_e];
+            k_e = (uint8_t*)zrtpMemAlloc(n_e, CTX_KEY_FLAGS);
             n_s = skeyl;
-            k_s = new uint8_t[n_s];
+            k_s = (uint8_t*)zrtpMemAlloc(n_s, CTX_KEY_FLAGS);
             cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
             break;
     }
@@ -100,20 +106,24 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
         case SrtpAuthenticationSha1Hmac:
         case SrtpAuthenticationSkeinHmac:
             n_a = akeyl;
-            k_a = new uint8_t[n_a];
+            k_a = (uint8_t*)zrtpMemAlloc(n_a, CTX_KEY_FLAGS);
             this->tagLength = tagLength;
             break;
     }
 }
 
 /*
- * memset_volatile is a volatile pointer to the memset function.
- * You can call (*memset_volatile)(buf, val, len) or even
- * memset_volatile(buf, val, len) just as you would call
- * memset(buf, val, len), but the use of a volatile pointer
- * guarantees that the compiler will not optimise the call away.
+ * Compare two tags in constant time. The loop does not exit early, the run
+ * time does not depend on the position of the first differing byte.
  */
-static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+static bool tagsEqual(const uint8_t* a, const uint8_t* b, int32_t length)
+{
+    uint8_t diff = 0;
+
+    for (int32_t i = 0; i < length; i++)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
+}
 
 CryptoContextCtrl::~CryptoContextCtrl(){
 
@@ -121,29 +131,24 @@ CryptoContextCtrl::~CryptoContextCtrl(){
         delete [] mki;
 
     if (master_key_length > 0) {
-        memset_volatile(master_key, 0, master_key_length);
+        zrtpMemFree(master_key, master_key_length, CTX_KEY_FLAGS);
         master_key_length = 0;
-        delete [] master_key;
     }
     if (master_salt_length > 0) {
-        memset_volatile(master_salt, 0, master_salt_length);
+        zrtpMemFree(master_salt, master_salt_length, CTX_KEY_FLAGS);
         master_salt_length = 0;
-        delete [] master_salt;
     }
     if (n_e > 0) {
-        memset_volatile(k_e, 0, n_e);
+        zrtpMemFree(k_e, n_e, CTX_KEY_FLAGS);
         n_e = 0;
-        delete [] k_e;
     }
     if (n_s > 0) {
-        memset_volatile(k_s, 0, n_s);
+        zrtpMemFree(k_s, n_s, CTX_KEY_FLAGS);
         n_s = 0;
-        delete [] k_s;
     }
     if (n_a > 0) {
+        zrtpMemFree(k_a, n_a, CTX_KEY_FLAGS);
         n_a = 0;
-        memset_volatile(k_a, 0, n_a);
-        delete [] k_a;
     }
     if (cipher != NULL) {
         delete cipher;
@@ -233,34 +238,52 @@ void CryptoContextCtrl::srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t in
     uint32_t macL;
 
     unsigned char temp[20];
-    std::vector<const uint8_t*>chunks;
-    std::vector<uint64_t> chunkLength;
     uint32_t beIndex = zrtpHtonl(index);
 
-    chunks.push_back(rtp);
-    chunkLength.push_back(len);
+    macChunks.clear();
+    macChunkLength.clear();
+
+    macChunks.push_back(rtp);
+    macChunkLength.push_back(len);
 
-    chunks.push_back((unsigned char *)&beIndex);
-    chunkLength.push_back(4);
+    macChunks.push_back((unsigned char *)&beIndex);
+    macChunkLength.push_back(4);
 
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
         hmacSha1Ctx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
+                    macChunks,        // data chunks to hash
+                    macChunkLength,   // length of the data to hash
                     temp, &macL);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
         break;
+#if ZRTP_WITH_SKEIN
     case SrtpAuthenticationSkeinHmac:
         macSkeinCtx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
+                    macChunks,        // data chunks to hash
+                    macChunkLength,   // length of the data to hash
                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
         break;
+#endif
+    }
+}
+
+bool CryptoContextCtrl::srtcpVerify(uint8_t* rtp, int32_t len, uint32_t index, const uint8_t* tag)
+{
+    uint8_t mac[20];
+
+    if (getTagLength() == 0)
+        return true;
+
+    srtcpAuthenticate(rtp, len, index, mac);
+    if (!tagsEqual(tag, mac, getTagLength())) {
+        authFailures++;
+        return false;
     }
+    return true;
 }
 
 /* used by the key derivation method */
@@ -306,12 +329,14 @@ void CryptoContextCtrl::deriveSrtcpKeys()
         macCtx = &hmacCtx.hmacSha1Ctx;
         macCtx = initializeSha1HmacContext(macCtx, k_a, n_a);
         break;
+#if ZRTP_WITH_SKEIN
     case SrtpAuthenticationSkeinHmac:
         macCtx = &hmacCtx.hmacSkeinCtx;
 
         // Skein MAC uses number of bits as MAC size, not just bytes
         macCtx = initializeSkeinMacContext(macCtx, k_a, n_a, tagLength*8, Skein512);
         break;
+#endif
     }
     memset(k_a, 0, n_a);
 
@@ -328,24 +353,23 @@ void CryptoContextCtrl::deriveSrtcpKeys()
     memset(k_e, 0, n_e);
 }
 
-bool CryptoContextCtrl::checkReplay( uint32_t index )
+/*
+ * Replay check and update on a (s_l, window) pair, shared by the single
+ * context state and the per SSRC state of a context family.
+ */
+static bool replayCheck(uint32_t s_l, uint64_t window, uint32_t index)
 {
-    if ( aalg == SrtpAuthenticationNull && ealg == SrtpEncryptionNull ) {
-        /* No security policy, don't use the replay protection */
-        return true;
-    }
-
-    int64_t delta = index - s_l;
+    int64_t delta = static_cast<int64_t>(index) - static_cast<int64_t>(s_l);
     if (delta > 0) {
         /* Packet not yet received*/
         return true;
     }
     else {
-        if( -delta >= REPLAY_WINDOW_SIZE ) {
-            return false;       /* Packet too old */
+        if( -delta >= 64 ) {
+            return false;       /* Packet too old, the SRTCP window has 64 bits */
         }
         else {
-            if((replay_window >> (-delta)) & 0x1) {
+            if((window >> (-delta)) & 0x1) {
                 return false;   /* Packet already received ! */
             }
             else {
@@ -355,22 +379,36 @@ bool CryptoContextCtrl::checkReplay( uint32_t index )
     }
 }
 
-void CryptoContextCtrl::update(uint32_t index)
+static void replayUpdate(uint32_t& s_l, uint64_t& window, uint32_t index)
 {
-    int64_t delta = index - s_l;
+    int64_t delta = static_cast<int64_t>(index) - static_cast<int64_t>(s_l);
 
     /* update the replay bitmask */
     if( delta > 0 ){
-        replay_window = replay_window << delta;
-        replay_window |= 1;
+        window = (delta < 64) ? window << delta : 0;
+        window |= 1;
     }
-    else {
-        replay_window |= ( (uint64_t)1 << -delta );
+    else if (-delta < 64) {
+        window |= ( (uint64_t)1 << -delta );
     }
     if (index > s_l)
         s_l = index;
 }
 
+bool CryptoContextCtrl::checkReplay( uint32_t index )
+{
+    if ( aalg == SrtpAuthenticationNull && ealg == SrtpEncryptionNull ) {
+        /* No security policy, don't use the replay protection */
+        return true;
+    }
+    return replayCheck(s_l, replay_window, index);
+}
+
+void CryptoContextCtrl::update(uint32_t index)
+{
+    replayUpdate(s_l, replay_window, index);
+}
+
 CryptoContextCtrl* CryptoContextCtrl::newCryptoContextForSSRC(uint32_t ssrc)
 {
     CryptoContextCtrl* pcc = new CryptoContextCtrl(
@@ -388,3 +426,133 @@ CryptoContextCtrl* CryptoContextCtrl::newCryptoContextForSSRC(uint32_t ssrc)
 
     return pcc;
 }
+
+void CryptoContextCtrl::enableSsrcFamily(uint32_t expectedSsrcs)
+{
+    uint32_t size = 16;
+
+    // keep the load below 3/4
+    while (size * 3 / 4 < expectedSsrcs)
+        size <<= 1;
+
+    ssrcFamily = true;
+    if (size > ssrcTable.size()) {
+        ZrtpVector<SsrcState> old;
+        old.swap(ssrcTable);
+        ssrcTable.assign(size, SsrcState());
+        ssrcTableUsed = 0;
+        for (size_t i = 0; i < old.size(); i++) {
+            if (old[i].used)
+                *findSsrc(old[i].ssrc, true) = old[i];
+        }
+    }
+}
+
+static inline uint32_t ssrcHash(uint32_t ssrc)
+{
+    uint32_t h = ssrc * 2654435761U;
+    return h ^ (h >> 16);
+}
+
+void CryptoContextCtrl::growSsrcTable()
+{
+    enableSsrcFamily(static_cast<uint32_t>(ssrcTable.size()));
+}
+
+CryptoContextCtrl::SsrcState* CryptoContextCtrl::findSsrc(uint32_t ssrc, bool create)
+{
+    if (ssrcTable.empty()) {
+        if (!create)
+            return NULL;
+        enableSsrcFamily();
+    }
+    uint32_t mask = static_cast<uint32_t>(ssrcTable.size()) - 1;
+
+    for (uint32_t i = ssrcHash(ssrc) & mask; ; i = (i + 1) & mask) {
+        SsrcState* entry = &ssrcTable[i];
+        if (entry->used && entry->ssrc == ssrc)
+            return entry;
+        if (!entry->used) {
+            if (!create)
+                return NULL;
+            if ((ssrcTableUsed + 1) * 4 > ssrcTable.size() * 3) {
+                growSsrcTable();
+                return findSsrc(ssrc, true);
+            }
+            memset(entry, 0, sizeof(SsrcState));
+            entry->ssrc = ssrc;
+            entry->used = 1;
+            ssrcTableUsed++;
+            return entry;
+        }
+    }
+}
+
+bool CryptoContextCtrl::checkReplay(uint32_t ssrc, uint32_t index)
+{
+    if (!ssrcFamily)
+        return checkReplay(index);
+
+    if ( aalg == SrtpAuthenticationNull && ealg == SrtpEncryptionNull ) {
+        return true;
+    }
+    SsrcState* entry = findSsrc(ssrc, false);
+    if (entry == NULL)
+        return true;            /* Nothing received from this SSRC yet */
+    return replayCheck(entry->s_l, entry->replayWindow, index);
+}
+
+void CryptoContextCtrl::update(uint32_t ssrc, uint32_t index)
+{
+    if (!ssrcFamily) {
+        update(index);
+        return;
+    }
+    SsrcState* entry = findSsrc(ssrc, true);
+    replayUpdate(entry->s_l, entry->replayWindow, index);
+}
+
+uint32_t CryptoContextCtrl::getSrtcpIndex(uint32_t ssrc)
+{
+    if (!ssrcFamily)
+        return srtcpIndex;
+
+    SsrcState* entry = findSsrc(ssrc, false);
+    return (entry == NULL) ? 0 : entry->srtcpIndex;
+}
+
+void CryptoContextCtrl::setSrtcpIndex(uint32_t ssrc, uint32_t index)
+{
+    if (!ssrcFamily) {
+        srtcpIndex = index;
+        return;
+    }
+    findSsrc(ssrc, true)->srtcpIndex = index;
+}
+
+bool CryptoContextCtrl::removeSsrc(uint32_t ssrc)
+{
+    SsrcState* entry = findSsrc(ssrc, false);
+    if (entry == NULL)
+        return false;
+
+    // Backward shift deletion keeps the probe sequences intact
+    uint32_t mask = static_cast<uint32_t>(ssrcTable.size()) - 1;
+    uint32_t hole = static_cast<uint32_t>(entry - &ssrcTable[0]);
+    uint32_t i = hole;
+
+    while (true) {
+        i = (i + 1) & mask;
+        if (!ssrcTable[i].used)
+            break;
+        uint32_t home = ssrcHash(ssrcTable[i].ssrc) & mask;
+        // move the entry if its home slot is not in (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            ssrcTable[hole] = ssrcTable[i];
+            hole = i;
+        }
+    }
+    memset(&ssrcTable[hole], 0, sizeof(SsrcState));
+    ssrcTableUsed--;
+    return true;
+}
@@ -25,6 +25,10 @@
  * @{
  */
 
+#include <vector>
+
+#include <common/zrtpAllocator.h>
+
 #include "crypto/hmac.h"
 #include "cryptcommon/macSkein.h"
 
@@ -48,12 +52,21 @@ class SrtpSymCrypto;
  * (RFC6189). After key management negotiated the data the application
  * can setup the SRTCP cryptographic context and enable SRTCP processing.
  *
+ * SRTCP key derivation does not depend on the SSRC. An application that
+ * handles RTCP of many sources with the same master key, for example on one
+ * rtcp-mux transport, can use one context for all of them: after
+ * enableSsrcFamily() the context keeps only the SRTCP index and the replay
+ * state for each SSRC in a compact table and shares the derived keys, the
+ * cipher and MAC contexts.
+ *
  * @sa CryptoContext
  *
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 class CryptoContextCtrl {
     public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
+
     /**
      * @brief Constructor for an active SRTCP cryptographic context.
      *
@@ -181,6 +194,28 @@ class CryptoContextCtrl {
      */
     void srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t index, uint8_t* tag);
 
+    /**
+     * @brief Verify the authentication tag of a received packet.
+     *
+     * Computes the tag and compares it in constant time with the received
+     * tag. A failed check increments the authentication failure counter.
+     *
+     * @param rtp
+     *    The RTCP packet buffer including the SRTCP index.
+     *
+     * @param len
+     *    Length of the RTCP packet without SRTCP index, MKI and tag
+     *
+     * @param index
+     *    The 31 bit SRTCP index and the E flag as received.
+     *
+     * @param tag
+     *    Points to the received tag.
+     *
+     * @return true if the tags match.
+     */
+    bool srtcpVerify(uint8_t* rtp, int32_t len, uint32_t index, const uint8_t* tag);
+
     /**
      * @brief Perform key derivation according to SRTCP specification
      *
@@ -229,6 +264,26 @@ class CryptoContextCtrl {
      */
     inline int32_t getTagLength() const { return tagLength; }
 
+    /**
+     * @brief Count a packet that failed the replay check.
+     */
+    void countReplayFailure() { replayFailures++; }
+
+    /**
+     * @brief Get the number of packets that failed authentication.
+     */
+    uint64_t getAuthFailures() const { return authFailures; }
+
+    /**
+     * @brief Get the number of packets that failed the replay check.
+     */
+    uint64_t getReplayFailures() const { return replayFailures; }
+
+    /**
+     * @brief Reset the failure counters.
+     */
+    void resetFailureCounters() { authFailures = replayFailures = 0; }
+
     /**
      * @brief Get the length of the MKI in bytes.
      *
@@ -294,6 +349,63 @@ class CryptoContextCtrl {
      */
     CryptoContextCtrl* newCryptoContextForSSRC(uint32_t ssrc);
 
+    /**
+     * @brief Use this context for all SSRCs that share its master key.
+     *
+     * After this call the SSRC based functions keep a separate SRTCP index and
+     * replay window for each SSRC, the derived keys remain shared. Each SSRC costs
+     * one table entry of 24 bytes. Without this call the SSRC based functions
+     * ignore the SSRC and use the single state of the context.
+     *
+     * @param expectedSsrcs
+     *     Number of SSRCs to reserve table space for, the table grows as required.
+     */
+    void enableSsrcFamily(uint32_t expectedSsrcs = 0);
+
+    /**
+     * @brief Check if this context serves a family of SSRCs.
+     */
+    bool isSsrcFamily() const { return ssrcFamily; }
+
+    /**
+     * @brief Check for packet replay of the given SSRC.
+     *
+     * @sa checkReplay(uint32_t)
+     */
+    bool checkReplay(uint32_t ssrc, uint32_t newSeqNumber);
+
+    /**
+     * @brief Update the SRTCP packet index of the given SSRC.
+     *
+     * Creates the SSRC's entry if necessary. Call this only after the packet
+     * was authenticated.
+     *
+     * @sa update(uint32_t)
+     */
+    void update(uint32_t ssrc, uint32_t newSeqNumber);
+
+    /**
+     * @brief Get the SRTCP index of the given SSRC, 0 for a new SSRC.
+     */
+    uint32_t getSrtcpIndex(uint32_t ssrc);
+
+    /**
+     * @brief Set the SRTCP index of the given SSRC.
+     */
+    void setSrtcpIndex(uint32_t ssrc, uint32_t index);
+
+    /**
+     * @brief Remove the state of a SSRC, for example after a RTCP BYE.
+     *
+     * @return @c true if the SSRC was known.
+     */
+    bool removeSsrc(uint32_t ssrc);
+
+    /**
+     * @brief Get the number of SSRCs in the family table.
+     */
+    uint32_t getNumberOfSsrcs() const { return ssrcTableUsed; }
+
     private:
 
         typedef union _hmacCtx {
@@ -310,6 +422,13 @@ class CryptoContextCtrl {
         /* bitmask for replay check */
         uint64_t replay_window;
 
+        uint64_t authFailures;
+        uint64_t replayFailures;
+
+        /* Scratch lists for the MAC computation, avoid allocations per packet */
+        ZrtpVector<const uint8_t*> macChunks;
+        ZrtpVector<uint64_t> macChunkLength;
+
         uint8_t* master_key;
         uint32_t master_key_length;
         uint8_t* master_salt;
@@ -337,6 +456,22 @@ class CryptoContextCtrl {
 
         SrtpSymCrypto* cipher;
         SrtpSymCrypto* f8Cipher;
+
+        /* Per SSRC state of a context family, open addressing with linear probing */
+        typedef struct _ssrcState {
+            uint32_t ssrc;
+            uint32_t used;
+            uint32_t s_l;
+            uint32_t srtcpIndex;
+            uint64_t replayWindow;
+        } SsrcState;
+
+        bool ssrcFamily;
+        ZrtpVector<SsrcState> ssrcTable;
+        uint32_t ssrcTableUsed;
+
+        SsrcState* findSsrc(uint32_t ssrc, bool create);
+        void growSsrcTable();
     };
 
 /**
@@ -28,6 +28,7 @@
 #include "srtp/SrtpHandler.h"
 #include "srtp/CryptoContext.h"
 #include "srtp/CryptoContextCtrl.h"
+#include "srtp/crypto/SrtpSymCrypto.h"
 
 bool SrtpHandler::decodeRtp(uint8_t* buffer, int32_t length, uint32_t *ssrc, uint16_t *seq, uint8_t** payload, int32_t *payloadlen)
 {
@@ -122,18 +123,16 @@ bool SrtpHandler::protect(CryptoContext* pcc, uint8_t* buffer, size_t length, si
     return true;
 }
 
-int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData)
+int32_t SrtpHandler::checkSrtp(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData,
+                               uint8_t** payload, int32_t* payloadlen, uint64_t* index, uint32_t* ssrc)
 {
-    uint8_t* payload = NULL;
-    int32_t payloadlen = 0;
     uint16_t seqnum;
-    uint32_t ssrc;
 
     if (pcc == NULL) {
         return 0;
     }
 
-    if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen)) {
+    if (!decodeRtp(buffer, length, ssrc, &seqnum, payload, payloadlen)) {
         if (errorData != NULL)
             fillErrorData(errorData, DecodeError, buffer, length, 0);
         return 0;
@@ -156,7 +155,7 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
     *newLength = length;
 
     // recompute payloadlen by subtracting SRTP data
-    payloadlen -= pcc->getTagLength() + pcc->getMkiLength();
+    *payloadlen -= pcc->getTagLength() + pcc->getMkiLength();
 
     // MKI is unused, so just skip it
     // const uint8* mki = buffer + srtpDataIndex;
@@ -165,33 +164,168 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
     /* Guess the index */
     uint64_t guessedIndex = pcc->guessIndex(seqnum);
 
-    /* Replay control */
+    /* Replay control, a packet that looks old may be new if the guessed ROC is wrong */
     if (!pcc->checkReplay(seqnum)) {
-        if (errorData != NULL)
-            fillErrorData(errorData, ReplayError, buffer, length, guessedIndex);
-        return -2;
+        pcc->countReplayFailure();
+        if (!pcc->recoverIndex(buffer, (uint32_t)length, tag, &guessedIndex)) {
+            if (errorData != NULL)
+                fillErrorData(errorData, ReplayError, buffer, length, guessedIndex);
+            return -2;
+        }
     }
-
-    if (pcc->getTagLength() > 0) {
-        uint32_t guessedRoc = guessedIndex >> 16;
-        uint8_t mac[20];
-
-        pcc->srtpAuthenticate(buffer, (uint32_t)length, guessedRoc, mac);
-        if (memcmp(tag, mac, pcc->getTagLength()) != 0) {
+    /* Drop a forged packet before it touches the cipher or the replay window */
+    else if (!pcc->srtpVerify(buffer, (uint32_t)length, (uint32_t)(guessedIndex >> 16), tag)) {
+        if (!pcc->recoverIndex(buffer, (uint32_t)length, tag, &guessedIndex)) {
             if (errorData != NULL)
                 fillErrorData(errorData, AuthError, buffer, length, guessedIndex);
             return -1;
         }
     }
+    *index = guessedIndex;
+    return 1;
+}
+
+int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData)
+{
+    uint8_t* payload = NULL;
+    int32_t payloadlen = 0;
+    uint64_t guessedIndex;
+    uint32_t ssrc;
+
+    int32_t rc = checkSrtp(pcc, buffer, length, newLength, errorData, &payload, &payloadlen, &guessedIndex, &ssrc);
+    if (rc != 1)
+        return rc;
+
+    /* Update the Crypto-context, the packet authenticated and may switch the session keys */
+    pcc->update((uint16_t)guessedIndex);
+
     /* Decrypt the content */
     pcc->srtpEncrypt(buffer, payload, payloadlen, guessedIndex, ssrc);
 
-    /* Update the Crypto-context */
-    pcc->update(seqnum);
+    return 1;
+}
+
+int32_t SrtpHandler::transcrypt(CryptoContext* in, CryptoContext* out, uint8_t* buffer, size_t length, size_t* newLength,
+                                SrtpErrorData* errorData)
+{
+    uint8_t* payload = NULL;
+    int32_t payloadlen = 0;
+    uint64_t guessedIndex;
+    uint32_t ssrc;
+    size_t rtpLength;
 
+    if (out == NULL) {
+        return 0;
+    }
+    int32_t rc = checkSrtp(in, buffer, length, &rtpLength, errorData, &payload, &payloadlen, &guessedIndex, &ssrc);
+    if (rc != 1)
+        return rc;
+
+    /* Re-encrypt the content with the index of each leg */
+    uint16_t seqnum = (uint16_t)guessedIndex;
+    uint32_t roc = out->getRoc();
+    uint64_t outIndex = ((uint64_t)roc << 16) | (uint64_t)seqnum;
+
+    in->update(seqnum);
+    if (!in->srtpTranscrypt(out, buffer, payload, payloadlen, guessedIndex, outIndex, ssrc))
+        return 0;
+
+    /* Compute MAC of the outbound leg, it replaces the inbound MKI and tag */
+    if (out->getTagLength() > 0) {
+        out->srtpAuthenticate(buffer, rtpLength, roc, buffer + rtpLength);
+    }
+    *newLength = rtpLength + out->getTagLength();
+
+    /* Update the ROC if necessary, see protect */
+    if (seqnum == 0xFFFF ) {
+        out->setRoc(roc + 1);
+    }
     return 1;
 }
 
+void SrtpHandler::protectBatch(CryptoContext** pcc, uint8_t** buffers, const size_t* lengths, size_t* newLengths,
+                               bool* results, int32_t count)
+{
+    F8_JOB jobs[SrtpSymCrypto::f8BatchLanes];
+    uint32_t rocs[SrtpSymCrypto::f8BatchLanes];
+
+    for (int32_t first = 0; first < count; first += SrtpSymCrypto::f8BatchLanes) {
+        int32_t last = first + SrtpSymCrypto::f8BatchLanes;
+        if (last > count)
+            last = count;
+        int32_t numJobs = 0;
+
+        /* Encrypt the packets or prepare the F8 jobs, see protect */
+        for (int32_t i = first; i < last; i++) {
+            uint8_t* payload = NULL;
+            int32_t payloadlen = 0;
+            uint16_t seqnum;
+            uint32_t ssrc;
+
+            results[i] = false;
+            if (pcc[i] == NULL || !decodeRtp(buffers[i], lengths[i], &ssrc, &seqnum, &payload, &payloadlen))
+                continue;
+
+            rocs[i - first] = pcc[i]->getRoc();
+            uint64_t index = ((uint64_t)rocs[i - first] << 16) | (uint64_t)seqnum;
+
+            if (pcc[i]->srtpPrepareF8(buffers[i], payload, payloadlen, index, &jobs[numJobs]))
+                numJobs++;
+            else
+                pcc[i]->srtpEncrypt(buffers[i], payload, payloadlen, index, ssrc);
+
+            /* Update the ROC now, the next packet of this context may be in the same batch */
+            if (seqnum == 0xFFFF ) {
+                pcc[i]->setRoc(pcc[i]->getRoc() + 1);
+            }
+            results[i] = true;
+        }
+        SrtpSymCrypto::f8_encryptBatch(jobs, numJobs);
+
+        /* Compute MAC and store at end of RTP packet data */
+        for (int32_t i = first; i < last; i++) {
+            if (!results[i])
+                continue;
+            if (pcc[i]->getTagLength() > 0) {
+                pcc[i]->srtpAuthenticate(buffers[i], lengths[i], rocs[i - first], buffers[i] + lengths[i]);
+            }
+            newLengths[i] = lengths[i] + pcc[i]->getTagLength();
+        }
+    }
+}
+
+void SrtpHandler::unprotectBatch(CryptoContext** pcc, uint8_t** buffers, const size_t* lengths, size_t* newLengths,
+                                 int32_t* results, int32_t count)
+{
+    F8_JOB jobs[SrtpSymCrypto::f8BatchLanes];
+
+    for (int32_t first = 0; first < count; first += SrtpSymCrypto::f8BatchLanes) {
+        int32_t last = first + SrtpSymCrypto::f8BatchLanes;
+        if (last > count)
+            last = count;
+        int32_t numJobs = 0;
+
+        for (int32_t i = first; i < last; i++) {
+            uint8_t* payload = NULL;
+            int32_t payloadlen = 0;
+            uint64_t guessedIndex;
+            uint32_t ssrc;
+
+            results[i] = checkSrtp(pcc[i], buffers[i], lengths[i], &newLengths[i], NULL, &payload, &payloadlen, &guessedIndex, &ssrc);
+            if (results[i] != 1)
+                continue;
+
+            /* Update the replay state now, a duplicate may be in the same batch */
+            pcc[i]->update((uint16_t)guessedIndex);
+
+            if (pcc[i]->srtpPrepareF8(buffers[i], payload, payloadlen, guessedIndex, &jobs[numJobs]))
+                numJobs++;
+            else
+                pcc[i]->srtpEncrypt(buffers[i], payload, payloadlen, guessedIndex, ssrc);
+        }
+        SrtpSymCrypto::f8_encryptBatch(jobs, numJobs);
+    }
+}
 
 bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t length, size_t* newLength)
 {
@@ -203,7 +337,7 @@ bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t le
     uint32_t ssrc = *(reinterpret_cast<uint32_t*>(buffer + 4)); // always SSRC of sender
     ssrc = zrtpNtohl(ssrc);
 
-    uint32_t encIndex = pcc->getSrtcpIndex();
+    uint32_t encIndex = pcc->getSrtcpIndex(ssrc);
     pcc->srtcpEncrypt(buffer + 8, length - 8, encIndex, ssrc);
 
     encIndex |= 0x80000000;                                     // set the E flag
@@ -220,7 +354,7 @@ bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t le
 
     encIndex++;
     encIndex &= ~0x80000000;                                // clear the E-flag and modulo 2^31
-    pcc->setSrtcpIndex(encIndex);
+    pcc->setSrtcpIndex(ssrc, encIndex);
     *newLength = length + pcc->getTagLength() + sizeof(uint32_t);
 
     return true;
@@ -243,30 +377,28 @@ int32_t SrtpHandler::unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size
     uint32_t encIndex = zrtpNtohl(*index);
     uint32_t remoteIndex = encIndex & ~0x80000000;    // get index without Encryption flag
 
-    if (!pcc->checkReplay(remoteIndex)) {
-       return -2;
-    }
+    uint32_t ssrc = *(reinterpret_cast<uint32_t*>(buffer + 4)); // always SSRC of sender
+    ssrc = zrtpNtohl(ssrc);
 
-    uint8_t mac[20];
+    if (!pcc->checkReplay(ssrc, remoteIndex)) {
+        pcc->countReplayFailure();
+        return -2;
+    }
 
     // Now get a pointer to the authentication tag field
     const uint8_t* tag = buffer + (length - pcc->getTagLength());
 
     // Authenticate includes the index, but not MKI and not (obviously) the tag itself
-    pcc->srtcpAuthenticate(buffer, payloadLen, encIndex, mac);
-    if (memcmp(tag, mac, pcc->getTagLength()) != 0) {
+    if (!pcc->srtcpVerify(buffer, payloadLen, encIndex, tag)) {
         return -1;
     }
 
-    uint32_t ssrc = *(reinterpret_cast<uint32_t*>(buffer + 4)); // always SSRC of sender
-    ssrc = zrtpNtohl(ssrc);
-
     // Decrypt the content, exclude the very first SRTCP header (fixed, 8 bytes)
     if (encIndex & 0x80000000)
         pcc->srtcpEncrypt(buffer + 8, payloadLen - 8, remoteIndex, ssrc);
 
     // Update the Crypto-context
-    pcc->update(remoteIndex);
+    pcc->update(ssrc, remoteIndex);
 
     return 1;
 }
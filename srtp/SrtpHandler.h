@@ -63,6 +63,11 @@ public:
      * in case of an error return. The caller may store and evaluate this data to further
      * trace the problem.
      *
+     * A packet that fails the replay check or authentication is dropped before
+     * decryption and does not change the replay state. The context counts these
+     * failures, see CryptoContext::getAuthFailures. Before it drops a packet the
+     * context may try to recover a lost ROC, see CryptoContext::recoverIndex.
+     *
      * @param pcc the SRTP CryptoContext instance
      *
      * @param buffer the SRTP packet to unprotect
@@ -81,6 +86,38 @@ public:
      */
     static int32_t unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData=NULL);
 
+    /**
+     * @brief Transcrypt a SRTP packet from one context to another.
+     *
+     * Bridges, for example an SBC, use this function to forward a SRTP
+     * packet between two legs that use different keys. The function checks
+     * the packet as @c unprotect does, re-encrypts the payload with
+     * CryptoContext::srtpTranscrypt and adds the tag of the outbound
+     * context. With counter mode ciphers on both legs this needs one pass
+     * over the payload and the plain text never appears in the buffer.
+     *
+     * The RTP header is forwarded unchanged, the outbound context must use
+     * the same SSRC. If the outbound tag is longer than the inbound tag
+     * and MKI the buffer must have room for the difference.
+     *
+     * @param in the SRTP CryptoContext of the inbound leg
+     *
+     * @param out the SRTP CryptoContext of the outbound leg
+     *
+     * @param buffer the SRTP packet to transcrypt
+     *
+     * @param length the length of the inbound SRTP packet data in bytes
+     *
+     * @param newLength the length of the resulting SRTP packet data in bytes
+     *
+     * @param errorData Pointer to @c errorData structure or @c NULL, default is @c NULL
+     *
+     * @return the result code, see @c unprotect. 0 also if a counter mode
+     *         context has no key.
+     */
+    static int32_t transcrypt(CryptoContext* in, CryptoContext* out, uint8_t* buffer, size_t length, size_t* newLength,
+                              SrtpErrorData* errorData=NULL);
+
     /**
      * @brief Protect an RTCP packet.
      *
@@ -115,8 +152,55 @@ public:
      */
     static int32_t unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t length, size_t* newLength);
 
+    /**
+     * @brief Protect several RTP packets.
+     *
+     * The function protects the packets as @c protect does. Packets that use
+     * an F8 crypto suite are encrypted in lockstep, see
+     * @c SrtpSymCrypto::f8_encryptBatch. The packets may belong to different
+     * crypto contexts and to the same context. Packets of the same context
+     * must be in sending order.
+     *
+     * @param pcc the SRTP CryptoContext instance of each packet
+     *
+     * @param buffers the RTP packets to protect
+     *
+     * @param lengths the length of each RTP packet in bytes
+     *
+     * @param newLengths the length of each resulting SRTP packet in bytes
+     *
+     * @param results the result of each packet, see @c protect
+     *
+     * @param count number of packets
+     */
+    static void protectBatch(CryptoContext** pcc, uint8_t** buffers, const size_t* lengths, size_t* newLengths,
+                             bool* results, int32_t count);
+
+    /**
+     * @brief Unprotect several SRTP packets.
+     *
+     * The batch counterpart of @c unprotect, see @c protectBatch.
+     *
+     * @param pcc the SRTP CryptoContext instance of each packet
+     *
+     * @param buffers the SRTP packets to unprotect
+     *
+     * @param lengths the length of each SRTP packet in bytes
+     *
+     * @param newLengths the length of each resulting RTP packet in bytes
+     *
+     * @param results the result code of each packet, see @c unprotect
+     *
+     * @param count number of packets
+     */
+    static void unprotectBatch(CryptoContext** pcc, uint8_t** buffers, const size_t* lengths, size_t* newLengths,
+                               int32_t* results, int32_t count);
+
 private:
     static bool decodeRtp(uint8_t* buffer, int32_t length, uint32_t *ssrc, uint16_t *seq, uint8_t** payload, int32_t *payloadlen);
 
+    static int32_t checkSrtp(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData,
+                             uint8_t** payload, int32_t* payloadlen, uint64_t* index, uint32_t* ssrc);
+
 };
 #endif // _SRTPHANDLER_H_
\ No newline at end of file
@@ -0,0 +1,402 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <common/osSpecifics.h>
+#include <cryptcommon/ZrtpRandom.h>
+
+#include "srtp/SrtpKeyChannel.h"
+#include "srtp/CryptoContext.h"
+#include "srtp/CryptoContextCtrl.h"
+#include "crypto/SrtpSymCrypto.h"
+#include "crypto/hmac.h"
+
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+namespace {
+
+const uint16_t channelVersion = 1;
+const int32_t macLength = 20;
+
+// The encrypted part of an entry: everything after the serial number
+const size_t sealedOffset = offsetof(SrtpKeyEntry_t, ssrc);
+const size_t sealedLength = sizeof(SrtpKeyEntry_t) - sealedOffset;
+
+/*
+ * The channel header at the start of the shared memory region.
+ */
+struct ChannelHeader {
+    char     magic[4];          // "SKCH"
+    uint16_t version;
+    uint16_t slotSize;
+    uint32_t slots;
+    uint8_t  nonce[8];          // random per channel, part of the IV
+    uint8_t  check[macLength];  // proves knowledge of the channel key
+    std::atomic<uint64_t> head; // serial number of the next entry
+    uint8_t  reserved[16];
+};
+
+/*
+ * One ring slot. The writer sets seq to 2 * serial + 1 while it updates
+ * the slot and to 2 * serial + 2 when the slot is complete.
+ */
+struct ChannelSlot {
+    std::atomic<uint64_t> seq;
+    uint8_t sealed[sealedLength];
+    uint8_t mac[macLength];
+    uint8_t reserved[4];
+};
+
+inline ChannelHeader* header(uint8_t* memory) {
+    return reinterpret_cast<ChannelHeader*>(memory);
+}
+
+inline ChannelSlot* slotAt(uint8_t* memory, uint32_t slots, uint64_t serial) {
+    return reinterpret_cast<ChannelSlot*>(memory + sizeof(ChannelHeader)) + (serial & (slots - 1));
+}
+
+void computeHmac(void* ctx, const uint8_t* data1, uint64_t length1, const uint8_t* data2, uint64_t length2, uint8_t* mac) {
+    ZrtpVector<const uint8_t*> chunks;
+    ZrtpVector<uint64_t> chunkLength;
+    uint32_t macL;
+
+    chunks.push_back(data1);
+    chunkLength.push_back(length1);
+    if (data2 != NULL) {
+        chunks.push_back(data2);
+        chunkLength.push_back(length2);
+    }
+    hmacSha1Ctx(ctx, chunks, chunkLength, mac, &macL);
+}
+
+bool equalMac(const uint8_t* a, const uint8_t* b) {
+    uint8_t diff = 0;
+    for (int32_t i = 0; i < macLength; i++)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+}
+
+LockClass SrtpKeyChannel::publishLockClass("SrtpKeyChannel");
+
+size_t SrtpKeyChannel::requiredSize(uint32_t slots) {
+    if (slots == 0 || (slots & (slots - 1)) != 0)
+        return 0;
+    return sizeof(ChannelHeader) + slots * sizeof(ChannelSlot);
+}
+
+SrtpKeyChannel::SrtpKeyChannel(uint8_t* mem, uint32_t numSlots, const uint8_t* channelKey):
+        memory(mem), slots(numSlots), readSerial(0), cipher(NULL), macCtx(NULL), publishLock(publishLockClass) {
+    deriveKeys(channelKey);
+}
+
+SrtpKeyChannel::~SrtpKeyChannel() {
+    delete cipher;
+    if (macCtx != NULL)
+        freeSha1HmacContext(macCtx);
+}
+
+SrtpKeyChannel* SrtpKeyChannel::create(void* mem, size_t size, uint32_t slots, const uint8_t* channelKey) {
+    size_t needed = requiredSize(slots);
+    if (mem == NULL || channelKey == NULL || needed == 0 || size < needed)
+        return NULL;
+
+    uint8_t* memory = static_cast<uint8_t*>(mem);
+    memset(memory, 0, needed);
+
+    SrtpKeyChannel* channel = new SrtpKeyChannel(memory, slots, channelKey);
+
+    ChannelHeader* hdr = new (memory) ChannelHeader;
+    hdr->head.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slots; i++)
+        new (slotAt(memory, slots, i)) ChannelSlot;
+
+    hdr->version = channelVersion;
+    hdr->slotSize = sizeof(ChannelSlot);
+    hdr->slots = slots;
+    ZrtpRandom::getRandomData(hdr->nonce, sizeof(hdr->nonce));
+    channel->computeCheck(hdr->nonce, hdr->check);
+
+    // The magic marks the channel as ready, write it last
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(hdr->magic, "SKCH", sizeof(hdr->magic));
+    return channel;
+}
+
+SrtpKeyChannel* SrtpKeyChannel::attach(void* mem, size_t size, const uint8_t* channelKey) {
+    if (mem == NULL || channelKey == NULL || size < sizeof(ChannelHeader))
+        return NULL;
+
+    uint8_t* memory = static_cast<uint8_t*>(mem);
+    ChannelHeader* hdr = header(memory);
+
+    if (memcmp(hdr->magic, "SKCH", sizeof(hdr->magic)) != 0)
+        return NULL;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (hdr->version != channelVersion || hdr->slotSize != sizeof(ChannelSlot))
+        return NULL;
+    size_t needed = requiredSize(hdr->slots);
+    if (needed == 0 || size < needed)
+        return NULL;
+
+    SrtpKeyChannel* channel = new SrtpKeyChannel(memory, hdr->slots, channelKey);
+
+    uint8_t check[macLength];
+    channel->computeCheck(hdr->nonce, check);
+    if (!equalMac(check, hdr->check)) {
+        delete channel;
+        return NULL;
+    }
+    uint64_t head = hdr->head.load(std::memory_order_acquire);
+    channel->readSerial = (head > channel->slots) ? head - channel->slots : 0;
+    return channel;
+}
+
+void SrtpKeyChannel::deriveKeys(const uint8_t* channelKey) {
+    static const char encLabel[] = "SrtpKeyChannel encryption";
+    static const char macLabel[] = "SrtpKeyChannel authentication";
+
+    uint8_t encKey[macLength];
+    uint8_t macKey[macLength];
+
+    void* keyCtx = createSha1HmacContext(channelKey, channelKeyLength);
+    computeHmac(keyCtx, (const uint8_t*)encLabel, strlen(encLabel), NULL, 0, encKey);
+    computeHmac(keyCtx, (const uint8_t*)macLabel, strlen(macLabel), NULL, 0, macKey);
+    freeSha1HmacContext(keyCtx);
+
+    cipher = new SrtpSymCrypto(encKey, 16, SrtpEncryptionAESCM);
+    macCtx = createSha1HmacContext(macKey, sizeof(macKey));
+    memset_volatile(encKey, 0, sizeof(encKey));
+    memset_volatile(macKey, 0, sizeof(macKey));
+}
+
+void SrtpKeyChannel::computeIv(const uint8_t* nonce, uint64_t serial, uint8_t* iv) {
+    // nonce (6) || serial (8, network order) || block counter (2)
+    memcpy(iv, nonce, 6);
+    for (int32_t i = 0; i < 8; i++)
+        iv[6 + i] = (uint8_t)(serial >> (56 - 8 * i));
+    iv[14] = iv[15] = 0;
+}
+
+void SrtpKeyChannel::computeMac(const uint8_t* nonce, uint64_t serial, const uint8_t* data, uint8_t* mac) {
+    // MAC input: nonce || serial || sealed entry
+    uint8_t iv[16];
+
+    computeIv(nonce, serial, iv);
+    computeHmac(macCtx, iv, 14, data, sealedLength, mac);
+}
+
+void SrtpKeyChannel::computeCheck(const uint8_t* nonce, uint8_t* check) {
+    computeHmac(macCtx, (const uint8_t*)"SKCH", 4, nonce, 8, check);
+}
+
+bool SrtpKeyChannel::publish(uint32_t ssrc, const SrtpSecret_t* secrets, EnableSecurity part, uint32_t roc) {
+    SrtpKeyEntry_t entry;
+    memset(&entry, 0, sizeof(entry));
+
+    entry.ssrc = ssrc;
+    entry.roc = roc;
+    entry.part = (uint8_t)part;
+
+    if (secrets->symEncAlgorithm == Aes)
+        entry.ealg = SrtpEncryptionAESCM;
+    else if (secrets->symEncAlgorithm == TwoFish)
+        entry.ealg = SrtpEncryptionTWOCM;
+    else
+        return false;
+
+    if (secrets->authAlgorithm == Sha1) {
+        entry.aalg = SrtpAuthenticationSha1Hmac;
+        entry.authKeyLength = 20;
+    }
+    else if (secrets->authAlgorithm == Skein) {
+        entry.aalg = SrtpAuthenticationSkeinHmac;
+        entry.authKeyLength = 32;
+    }
+    else
+        return false;
+
+    // To encrypt packets: intiator uses initiator keys, responder uses responder keys,
+    // to decrypt it is the other way round.
+    bool useInitiator = (part == ForSender) == (secrets->role == Initiator);
+    const uint8_t* key = useInitiator ? secrets->keyInitiator : secrets->keyResponder;
+    const uint8_t* salt = useInitiator ? secrets->saltInitiator : secrets->saltResponder;
+    int32_t keyLength = (useInitiator ? secrets->initKeyLen : secrets->respKeyLen) / 8;
+    int32_t saltLength = (useInitiator ? secrets->initSaltLen : secrets->respSaltLen) / 8;
+
+    if (keyLength > (int32_t)sizeof(entry.masterKey) || saltLength > (int32_t)sizeof(entry.masterSalt))
+        return false;
+
+    entry.keyLength = (uint8_t)keyLength;
+    entry.saltLength = (uint8_t)saltLength;
+    entry.tagLength = (uint8_t)(secrets->srtpAuthTagLen / 8);
+    memcpy(entry.masterKey, key, keyLength);
+    memcpy(entry.masterSalt, salt, saltLength);
+
+    bool result = publish(entry);
+    clearEntry(&entry);
+    return result;
+}
+
+bool SrtpKeyChannel::publish(const SrtpKeyEntry_t& entry) {
+    if (entry.keyLength > sizeof(entry.masterKey) || entry.saltLength > sizeof(entry.masterSalt))
+        return false;
+
+    // Serial and IV must be unique per entry and the MAC context is not
+    // reentrant: take the serial and write the slot under the lock
+    std::lock_guard<InstrumentedMutex> lock(publishLock);
+
+    ChannelHeader* hdr = header(memory);
+    uint64_t serial = hdr->head.load(std::memory_order_relaxed);
+    ChannelSlot* slot = slotAt(memory, slots, serial);
+
+    SrtpKeyEntry_t plain = entry;
+    plain.serial = serial;
+    if (plain.type != KeyRevoke)
+        plain.type = KeyAdd;
+
+    uint8_t sealed[sealedLength];
+    uint8_t mac[macLength];
+    uint8_t iv[16];
+
+    computeIv(hdr->nonce, serial, iv);
+    cipher->ctr_encrypt(reinterpret_cast<uint8_t*>(&plain) + sealedOffset, sealedLength, sealed, iv);
+    computeMac(hdr->nonce, serial, sealed, mac);
+    clearEntry(&plain);
+
+    slot->seq.store(2 * serial + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slot->sealed, sealed, sealedLength);
+    memcpy(slot->mac, mac, macLength);
+    slot->seq.store(2 * serial + 2, std::memory_order_release);
+
+    hdr->head.store(serial + 1, std::memory_order_release);
+    return true;
+}
+
+void SrtpKeyChannel::revoke(uint32_t ssrc, EnableSecurity part) {
+    SrtpKeyEntry_t entry;
+    memset(&entry, 0, sizeof(entry));
+
+    entry.type = KeyRevoke;
+    entry.ssrc = ssrc;
+    entry.part = (uint8_t)part;
+    publish(entry);
+}
+
+int32_t SrtpKeyChannel::next(SrtpKeyEntry_t* entry) {
+    ChannelHeader* hdr = header(memory);
+    uint64_t head = hdr->head.load(std::memory_order_acquire);
+
+    if (readSerial == head)
+        return NextEmpty;
+
+    if (head - readSerial > slots) {
+        readSerial = head - slots;
+        return NextLost;
+    }
+    ChannelSlot* slot = slotAt(memory, slots, readSerial);
+    uint64_t expected = 2 * readSerial + 2;
+
+    uint8_t sealed[sealedLength];
+    uint8_t mac[macLength];
+
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    memcpy(sealed, slot->sealed, sealedLength);
+    memcpy(mac, slot->mac, macLength);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // The writer overtook us while we read the slot
+    if (seq != expected || slot->seq.load(std::memory_order_relaxed) != expected) {
+        head = hdr->head.load(std::memory_order_acquire);
+        readSerial = head - slots + 1;
+        return NextLost;
+    }
+
+    uint8_t check[macLength];
+    computeMac(hdr->nonce, readSerial, sealed, check);
+    if (!equalMac(check, mac)) {
+        readSerial++;
+        return NextAuthFailed;
+    }
+
+    uint8_t iv[16];
+    computeIv(hdr->nonce, readSerial, iv);
+    cipher->ctr_encrypt(sealed, sealedLength, reinterpret_cast<uint8_t*>(entry) + sealedOffset, iv);
+    memset_volatile(sealed, 0, sealedLength);
+    entry->serial = readSerial++;
+    return NextEntry;
+}
+
+CryptoContext* SrtpKeyChannel::createCryptoContext(const SrtpKeyEntry_t& entry) {
+    if (entry.type != KeyAdd)
+        return NULL;
+
+    CryptoContext* context =
+        new CryptoContext(entry.ssrc,
+                          entry.roc,
+                          0L,                                 // keyderivation << 48,
+                          entry.ealg,
+                          entry.aalg,
+                          const_cast<uint8_t*>(entry.masterKey),
+                          entry.keyLength,
+                          const_cast<uint8_t*>(entry.masterSalt),
+                          entry.saltLength,
+                          entry.keyLength,                    // encryption keyl
+                          entry.authKeyLength,
+                          entry.saltLength,                   // session salt len
+                          entry.tagLength);
+    context->deriveSrtpKeys(0L);
+    return context;
+}
+
+CryptoContextCtrl* SrtpKeyChannel::createCryptoContextCtrl(const SrtpKeyEntry_t& entry) {
+    if (entry.type != KeyAdd)
+        return NULL;
+
+    CryptoContextCtrl* context =
+        new CryptoContextCtrl(entry.ssrc,
+                              entry.ealg,
+                              entry.aalg,
+                              const_cast<uint8_t*>(entry.masterKey),
+                              entry.keyLength,
+                              const_cast<uint8_t*>(entry.masterSalt),
+                              entry.saltLength,
+                              entry.keyLength,                // encryption keyl
+                              entry.authKeyLength,
+                              entry.saltLength,               // session salt len
+                              entry.tagLength);
+    context->deriveSrtcpKeys();
+    return context;
+}
+
+void SrtpKeyChannel::clearEntry(SrtpKeyEntry_t* entry) {
+    memset_volatile(entry, 0, sizeof(SrtpKeyEntry_t));
+}
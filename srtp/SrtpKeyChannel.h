@@ -0,0 +1,243 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPKEYCHANNEL_H_
+#define _SRTPKEYCHANNEL_H_
+
+/**
+ * @file SrtpKeyChannel.h
+ * @brief Hand SRTP keys from a ZRTP process to SRTP worker processes
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <common/LockStats.h>
+
+class CryptoContext;
+class CryptoContextCtrl;
+class SrtpSymCrypto;
+
+/**
+ * The SRTP parameters of one key channel entry.
+ *
+ * A @c KeyAdd entry holds everything to set up the SRTP and SRTCP crypto
+ * contexts of one SSRC and direction. A @c KeyRevoke entry tells the workers
+ * to drop the contexts of the SSRC and direction, only @c ssrc and @c part
+ * are set.
+ */
+typedef struct SrtpKeyEntry {
+    uint64_t serial;            ///< Position of the entry in the channel
+    uint32_t ssrc;              ///< SSRC the keys are bound to
+    uint32_t roc;               ///< Initial SRTP roll-over counter
+    uint8_t  type;              ///< SrtpKeyChannel::KeyAdd or SrtpKeyChannel::KeyRevoke
+    uint8_t  part;              ///< EnableSecurity value, ForSender or ForReceiver
+    uint8_t  ealg;              ///< SRTP encryption algorithm, SrtpEncryption*
+    uint8_t  aalg;              ///< SRTP authentication algorithm, SrtpAuthentication*
+    uint8_t  keyLength;         ///< Master key length in bytes
+    uint8_t  saltLength;        ///< Master salt length in bytes
+    uint8_t  authKeyLength;     ///< Session authentication key length in bytes
+    uint8_t  tagLength;         ///< Authentication tag length in bytes
+    uint8_t  masterKey[32];     ///< Master key
+    uint8_t  masterSalt[14];    ///< Master salt
+    uint8_t  reserved[2];
+} SrtpKeyEntry_t;
+
+/**
+ * A lock-free key distribution channel in shared memory.
+ *
+ * The control process that runs ZRTP publishes the SRTP keys of each stream
+ * into a ring in a memory region that it shares with the data-plane
+ * processes. The data-plane workers poll the ring and create their crypto
+ * contexts from the entries. No lock is shared between the processes and
+ * no system call is needed to hand over a key.
+ *
+ * The class does not create the shared memory, the application maps the
+ * region (for example with @c shm_open and @c mmap) in all processes and
+ * hands the address to @c create or @c attach. The region must be at least
+ * @c requiredSize bytes and suitably aligned for 64 bit atomics.
+ *
+ * All processes know a common channel key. The ring never holds plain key
+ * material: each entry is encrypted with AES counter mode and authenticated
+ * with HMAC SHA1, both keys are derived from the channel key. A worker that
+ * does not know the channel key cannot attach.
+ *
+ * The ring is a broadcast ring: every worker sees every entry and keeps its
+ * own read position. A worker picks the entries for the SSRCs it handles. If
+ * a worker falls behind by more than the ring size it loses entries, @c next
+ * reports this and continues with the oldest entry still in the ring. Size
+ * the ring for the key change rate and the worker's poll interval.
+ *
+ * Several threads may publish through the channel that @c create returned,
+ * for example the per-stream threads that call
+ * @c ZrtpCallback::srtpSecretsReady. The channel serializes them with a
+ * process local lock, the workers never take it. Each worker uses its own
+ * SrtpKeyChannel instance.
+ */
+class SrtpKeyChannel {
+public:
+    /// Entry types
+    enum KeyType {
+        KeyAdd = 1,         ///< New keys for an SSRC and direction
+        KeyRevoke           ///< Keys of an SSRC and direction are no longer valid
+    };
+
+    /// Return codes of @c next
+    enum NextResult {
+        NextEntry = 1,      ///< An entry was read
+        NextEmpty = 0,      ///< No new entry
+        NextLost = -1,      ///< The reader fell behind, entries were lost
+        NextAuthFailed = -2 ///< An entry failed authentication and was skipped
+    };
+
+    /// Length of the channel key in bytes
+    static const int32_t channelKeyLength = 32;
+
+    /**
+     * @brief Compute the size of a channel's shared memory region.
+     *
+     * @param slots number of entries in the ring, a power of two
+     * @return size of the region in bytes, 0 if @c slots is invalid
+     */
+    static size_t requiredSize(uint32_t slots);
+
+    /**
+     * @brief Create a new channel in a shared memory region.
+     *
+     * The control process calls this once. It initializes the region and
+     * drops all data that it contained.
+     *
+     * @param memory start of the region
+     * @param size size of the region in bytes
+     * @param slots number of entries in the ring, a power of two
+     * @param channelKey the channel key, @c channelKeyLength bytes
+     * @return the publishing channel or @c NULL if the parameters are invalid
+     */
+    static SrtpKeyChannel* create(void* memory, size_t size, uint32_t slots, const uint8_t* channelKey);
+
+    /**
+     * @brief Attach to an existing channel.
+     *
+     * A worker starts reading at the oldest entry that is still in the ring.
+     *
+     * @param memory start of the region, created by @c create
+     * @param size size of the region in bytes
+     * @param channelKey the channel key, @c channelKeyLength bytes
+     * @return the reading channel or @c NULL if the region holds no channel
+     *         or the channel key does not match
+     */
+    static SrtpKeyChannel* attach(void* memory, size_t size, const uint8_t* channelKey);
+
+    /**
+     * @brief Destructor clears the derived channel keys.
+     *
+     * The shared memory region is not touched.
+     */
+    ~SrtpKeyChannel();
+
+    /**
+     * @brief Publish the SRTP keys of a stream.
+     *
+     * Call this from @c ZrtpCallback::srtpSecretsReady. The function selects
+     * the initiator or responder keys depending on @c part and the role as
+     * the ZRTP clients do when they set up their own crypto contexts.
+     *
+     * @param ssrc the SSRC the keys belong to
+     * @param secrets the secrets that ZRTP computed
+     * @param part sender or receiver keys
+     * @param roc initial roll-over counter
+     * @return @c false if the secrets hold unsupported algorithms or lengths
+     */
+    bool publish(uint32_t ssrc, const SrtpSecret_t* secrets, EnableSecurity part, uint32_t roc = 0);
+
+    /**
+     * @brief Publish a prepared entry.
+     *
+     * @c serial and @c type are set by the function. The function is thread
+     * safe, each entry gets its own serial number and thus its own IV.
+     *
+     * @param entry the SRTP parameters
+     * @return @c false if the entry holds invalid lengths
+     */
+    bool publish(const SrtpKeyEntry_t& entry);
+
+    /**
+     * @brief Revoke the keys of a stream.
+     *
+     * @param ssrc the SSRC
+     * @param part sender or receiver keys
+     */
+    void revoke(uint32_t ssrc, EnableSecurity part);
+
+    /**
+     * @brief Read the next entry.
+     *
+     * The caller should clear the entry with @c clearEntry after it set up
+     * the crypto contexts.
+     *
+     * @param entry receives the entry if the function returns @c NextEntry
+     * @return one of the NextResult codes. After @c NextLost or
+     *         @c NextAuthFailed the caller may call @c next again.
+     */
+    int32_t next(SrtpKeyEntry_t* entry);
+
+    /**
+     * @brief Create and initialize a SRTP crypto context from an entry.
+     *
+     * The context has its session keys derived and is ready to use.
+     *
+     * @return the context or @c NULL if the entry is not a @c KeyAdd entry
+     */
+    static CryptoContext* createCryptoContext(const SrtpKeyEntry_t& entry);
+
+    /**
+     * @brief Create and initialize a SRTCP crypto context from an entry.
+     *
+     * @return the context or @c NULL if the entry is not a @c KeyAdd entry
+     */
+    static CryptoContextCtrl* createCryptoContextCtrl(const SrtpKeyEntry_t& entry);
+
+    /**
+     * @brief Clear the key material of an entry.
+     */
+    static void clearEntry(SrtpKeyEntry_t* entry);
+
+private:
+    SrtpKeyChannel(uint8_t* memory, uint32_t slots, const uint8_t* channelKey);
+
+    void deriveKeys(const uint8_t* channelKey);
+    void computeMac(const uint8_t* nonce, uint64_t serial, const uint8_t* data, uint8_t* mac);
+    void computeIv(const uint8_t* nonce, uint64_t serial, uint8_t* iv);
+    void computeCheck(const uint8_t* nonce, uint8_t* check);
+
+    uint8_t* memory;
+    uint32_t slots;
+    uint64_t readSerial;
+    SrtpSymCrypto* cipher;
+    void* macCtx;
+
+    static LockClass publishLockClass;
+    InstrumentedMutex publishLock;  // serializes publishers, guards head and macCtx
+};
+
+/**
+ * @}
+ */
+#endif // _SRTPKEYCHANNEL_H_
@@ -22,11 +22,20 @@
 
 #include <stdlib.h>
 #include <crypto/SrtpSymCrypto.h>
+#include <common/zrtpAlgorithms.h>
+#if ZRTP_WITH_TWOFISH
 #include <cryptcommon/twofish.h>
+#endif
 #include <cryptcommon/aesopt.h>
 #include <string.h>
 #include <stdio.h>
 #include <common/osSpecifics.h>
+#include <common/zrtpAllocator.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SRTP_AESNI
+#include <wmmintrin.h>
+#endif
 
 SrtpSymCrypto::SrtpSymCrypto(int algo):key(NULL), algorithm(algo) {
 }
@@ -39,56 +48,58 @@ SrtpSymCrypto::SrtpSymCrypto( uint8_t* k, int32_t keyLength, int algo):
 
 SrtpSymCrypto::~SrtpSymCrypto() {
     if (key != NULL) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-            AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
-            memset(saAes->cx, 0, sizeof(aes_encrypt_ctx));
-            delete saAes;
-        }
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-            delete[] (uint8_t*)key;
-        }
-        key = NULL;
+        freeKey();
     }
 }
 
+void SrtpSymCrypto::freeKey() {
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+        zrtpDelete(reinterpret_cast<AESencrypt*>(key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+    }
+#if ZRTP_WITH_TWOFISH
+    else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
+        zrtpMemFree(key, sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+    }
+#endif
+    key = NULL;
+}
+
+#if ZRTP_WITH_TWOFISH
 static int twoFishInit = 0;
+#endif
 
 bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
     // release an existing key before setting a new one
     if (key != NULL) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-            AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
-            memset(saAes->cx, 0, sizeof(aes_encrypt_ctx));
-            delete saAes;
-        }
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-            delete[] (uint8_t*)key;
-        }
-        key = NULL;
+        freeKey();
     }
 
     if (!(keyLength == 16 || keyLength == 32)) {
         return false;
     }
     if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-        AESencrypt *saAes = new AESencrypt();
+        AESencrypt *saAes = zrtpNew<AESencrypt>(ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        if (saAes == NULL)
+            return false;
         if (keyLength == 16)
             saAes->key128(k);
         else
             saAes->key256(k);
         key = saAes;
     }
+#if ZRTP_WITH_TWOFISH
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         if (!twoFishInit) {
             Twofish_initialise();
             twoFishInit = 1;
         }
-        key = new uint8_t[sizeof(Twofish_key)];
+        key = zrtpMemAlloc(sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        if (key == NULL)
+            return false;
         memset(key, 0, sizeof(Twofish_key));
         Twofish_prepare_key((Twofish_Byte*)k, keyLength,  (Twofish_key*)key);
     }
+#endif
     else
         return false;
 
@@ -96,20 +107,26 @@ bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
 }
 
 void SrtpSymCrypto::encrypt(const uint8_t* input, uint8_t* output) {
-    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+    // Without Twofish setNewKey() accepts AES only, thus skip the test
+    if (!ZrtpAlgorithms::twofish || algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
         AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
         saAes->encrypt(input, output);
     }
+#if ZRTP_WITH_TWOFISH
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         Twofish_encrypt((Twofish_key*)key, (Twofish_Byte*)input,
                         (Twofish_Byte*)output); 
     }
+#endif
 }
 
 void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length, uint8_t* iv) {
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
+    if (key == NULL)
+        return;
+
     for(ctr = 0; ctr < length/SRTP_BLOCK_SIZE; ctr++) {
         //compute the cipher stream
         iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
@@ -272,6 +289,61 @@ void SrtpSymCrypto::f8_encrypt(const uint8_t* in, uint32_t in_length, uint8_t* o
     }
 }
 
+#ifdef SRTP_AESNI
+/*
+ * Encrypt blocks of several AES keys with the AES instructions and interleave
+ * the rounds of the blocks. The key schedule of the AES code in cryptcommon
+ * holds the round keys in the byte order that the instructions expect.
+ */
+__attribute__((target("aes,sse2")))
+static void aesniEncryptBlocks(const aes_encrypt_ctx* const* ctx, uint8_t* const* blocks, int32_t n, int32_t rounds) {
+    __m128i state[SrtpSymCrypto::f8BatchLanes];
+
+    for (int32_t i = 0; i < n; i++) {
+        state[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)blocks[i]),
+                                 _mm_loadu_si128((const __m128i*)ctx[i]->ks));
+    }
+    for (int32_t r = 1; r < rounds; r++) {
+        for (int32_t i = 0; i < n; i++)
+            state[i] = _mm_aesenc_si128(state[i], _mm_loadu_si128((const __m128i*)(ctx[i]->ks + 4 * r)));
+    }
+    for (int32_t i = 0; i < n; i++) {
+        state[i] = _mm_aesenclast_si128(state[i], _mm_loadu_si128((const __m128i*)(ctx[i]->ks + 4 * rounds)));
+        _mm_storeu_si128((__m128i*)blocks[i], state[i]);
+    }
+}
+
+static bool aesniAvailable() {
+    static const bool available = __builtin_cpu_supports("aes");
+    return available;
+}
+#endif
+
+void SrtpSymCrypto::encryptBlocks(SrtpSymCrypto* const* ciphers, uint8_t* const* blocks, int32_t n) {
+#ifdef SRTP_AESNI
+    if (n > 0 && n <= f8BatchLanes && aesniAvailable()) {
+        const aes_encrypt_ctx* ctx[f8BatchLanes];
+        bool sameRounds = true;
+
+        for (int32_t i = 0; i < n && sameRounds; i++) {
+            int32_t algo = ciphers[i]->algorithm;
+            if (algo != SrtpEncryptionAESCM && algo != SrtpEncryptionAESF8) {
+                sameRounds = false;
+                break;
+            }
+            ctx[i] = reinterpret_cast<AESencrypt*>(ciphers[i]->key)->cx;
+            sameRounds = ctx[i]->inf.b[0] == ctx[0]->inf.b[0];
+        }
+        if (sameRounds) {
+            aesniEncryptBlocks(ctx, blocks, n, ctx[0]->inf.b[0] >> 4);
+            return;
+        }
+    }
+#endif
+    for (int32_t i = 0; i < n; i++)
+        ciphers[i]->encrypt(blocks[i], blocks[i]);
+}
+
 int SrtpSymCrypto::processBlock(F8_CIPHER_CTX *f8ctx, const uint8_t* in, int32_t length, uint8_t* out) {
 
     int i;
@@ -38,6 +38,20 @@ typedef struct _f8_ctx {
     uint32_t J;                 ///< Counter
 } F8_CIPHER_CTX;
 
+class SrtpSymCrypto;
+
+/**
+ * One packet of an F8 batch, see SrtpSymCrypto::f8_encryptBatch.
+ */
+typedef struct _f8_job {
+    const uint8_t* in;          ///< Input data
+    uint8_t* out;               ///< Output buffer, may be the same as @c in
+    uint32_t length;            ///< Number of bytes to process
+    uint8_t iv[SRTP_BLOCK_SIZE];    ///< The F8 IV of the packet
+    SrtpSymCrypto* cipher;      ///< The packet's cipher context
+    SrtpSymCrypto* f8Cipher;    ///< The packet's cipher context to compute IV'
+} F8_JOB;
+
 /**
  * @brief Implments the SRTP encryption modes as defined in RFC3711
  *
@@ -57,6 +71,8 @@ typedef struct _f8_ctx {
  */
 class SrtpSymCrypto {
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
+
     /**
      * @brief Constructor that does not initialize key data
      *
@@ -168,6 +184,39 @@ public:
      */
     void ctr_encrypt(uint8_t* data, uint32_t data_length, uint8_t* iv );
 
+    /**
+     * @brief Counter-mode re-encryption with two keys, in place.
+     *
+     * Removes the key stream of @c from and applies the key stream of
+     * @c to in one pass over the data. Both key stream blocks of a step
+     * are computed before the data is touched, thus the data never holds
+     * the plain text.
+     *
+     * @param from
+     *    The cipher context the data is encrypted with.
+     *
+     * @param fromIv
+     *    The initialization vector of @c from, see @c ctr_encrypt.
+     *
+     * @param to
+     *    The cipher context to encrypt the data with.
+     *
+     * @param toIv
+     *    The initialization vector of @c to.
+     *
+     * @param data
+     *    Pointer to input and output block, must be <code>dataLen</code>
+     *    bytes.
+     *
+     * @param dataLen
+     *    Number of bytes to process.
+     *
+     * @return
+     *    @c false if one of the contexts has no key, the data is unchanged.
+     */
+    static bool ctr_transcrypt(SrtpSymCrypto* from, uint8_t* fromIv, SrtpSymCrypto* to, uint8_t* toIv,
+                               uint8_t* data, uint32_t dataLen);
+
     /**
      * @brief Derive a cipher context to compute the IV'.
      *
@@ -235,8 +284,41 @@ public:
      */
     void f8_encrypt(const uint8_t* data, uint32_t dataLen, uint8_t* out, uint8_t* iv, SrtpSymCrypto* f8Cipher);
 
+    /// Number of packets that f8_encryptBatch processes in lockstep
+    static const int32_t f8BatchLanes = 8;
+
+    /**
+     * @brief F8 mode encryption of several packets.
+     *
+     * Inside one packet each F8 key stream block depends on the previous
+     * block. This function advances the key streams of up to @c f8BatchLanes
+     * packets in lockstep, thus the block encryptions of one step are
+     * independent of each other and the CPU can overlap them. The packets
+     * may use different keys. The result is the same as calling f8_encrypt
+     * for each packet.
+     *
+     * @param jobs
+     *    The packets to process.
+     *
+     * @param count
+     *    Number of packets.
+     */
+    static void f8_encryptBatch(F8_JOB* jobs, int32_t count);
+
 private:
     int processBlock(F8_CIPHER_CTX* f8ctx, const uint8_t* in, int32_t length, uint8_t* out);
+
+    /*
+     * Wipe and release the key schedule.
+     */
+    void freeKey();
+
+    /*
+     * Encrypt one block for each cipher, in place. The blocks are independent
+     * of each other, the implementation may interleave them.
+     */
+    static void encryptBlocks(SrtpSymCrypto* const* ciphers, uint8_t* const* blocks, int32_t n);
+
     void* key;
     int32_t algorithm;
 };
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Batch F8 mode and counter mode transcryption, independent of the crypto
+ * backend. The backends provide encrypt() and encryptBlocks().
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+
+#include <string.h>
+
+#include <crypto/SrtpSymCrypto.h>
+#include <common/osSpecifics.h>
+
+void SrtpSymCrypto::f8_encryptBatch(F8_JOB* jobs, int32_t count) {
+
+    unsigned char ivAccent[f8BatchLanes][SRTP_BLOCK_SIZE];
+    unsigned char S[f8BatchLanes][SRTP_BLOCK_SIZE];
+    uint32_t length[f8BatchLanes];
+    SrtpSymCrypto* ciphers[f8BatchLanes];
+    uint8_t* blocks[f8BatchLanes];
+
+    for (int32_t first = 0; first < count; first += f8BatchLanes) {
+        F8_JOB* job = jobs + first;
+        int32_t lanes = (count - first < f8BatchLanes) ? count - first : f8BatchLanes;
+        uint32_t maxLength = 0;
+
+        /*
+         * Compute IV' of all packets, see f8_encrypt. A lane without a key
+         * gets length zero and is left untouched.
+         */
+        for (int32_t l = 0; l < lanes; l++) {
+            length[l] = (job[l].cipher->key == NULL) ? 0 : job[l].length;
+            if (length[l] == 0)
+                continue;
+            job[l].f8Cipher->encrypt(job[l].iv, ivAccent[l]);
+            memset(S[l], 0, SRTP_BLOCK_SIZE);
+            if (length[l] > maxLength)
+                maxLength = length[l];
+        }
+
+        /*
+         * One key stream block of each packet per step, the same steps as
+         * processBlock.
+         */
+        uint32_t J = 0;
+        for (uint32_t offset = 0; offset < maxLength; offset += SRTP_BLOCK_SIZE, J++) {
+            uint32_t ctr = zrtpHtonl(J);
+
+            for (int32_t l = 0; l < lanes; l++) {
+                if (offset >= length[l])
+                    continue;
+                for (int i = 0; i < SRTP_BLOCK_SIZE; i++)
+                    S[l][i] ^= ivAccent[l][i];
+                reinterpret_cast<uint32_t*>(S[l])[3] ^= ctr;
+            }
+            int32_t active = 0;
+            for (int32_t l = 0; l < lanes; l++) {
+                if (offset < length[l]) {
+                    ciphers[active] = job[l].cipher;
+                    blocks[active++] = S[l];
+                }
+            }
+            encryptBlocks(ciphers, blocks, active);
+            for (int32_t l = 0; l < lanes; l++) {
+                if (offset >= length[l])
+                    continue;
+                uint32_t n = length[l] - offset;
+                if (n > SRTP_BLOCK_SIZE)
+                    n = SRTP_BLOCK_SIZE;
+                const uint8_t* in = job[l].in + offset;
+                uint8_t* out = job[l].out + offset;
+                for (uint32_t i = 0; i < n; i++)
+                    out[i] = in[i] ^ S[l][i];
+            }
+        }
+    }
+    memset(S, 0, sizeof(S));
+}
+
+bool SrtpSymCrypto::ctr_transcrypt(SrtpSymCrypto* from, uint8_t* fromIv, SrtpSymCrypto* to, uint8_t* toIv,
+                                   uint8_t* data, uint32_t data_length) {
+
+    if (from->key == NULL || to->key == NULL)
+        return false;
+
+    unsigned char stream[2][SRTP_BLOCK_SIZE];
+    SrtpSymCrypto* ciphers[2] = {from, to};
+    uint8_t* blocks[2] = {stream[0], stream[1]};
+
+    for (uint32_t offset = 0, ctr = 0; offset < data_length; offset += SRTP_BLOCK_SIZE, ctr++) {
+        fromIv[14] = toIv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
+        fromIv[15] = toIv[15] = (uint8_t)((ctr & 0x00FF));
+        memcpy(stream[0], fromIv, SRTP_BLOCK_SIZE);
+        memcpy(stream[1], toIv, SRTP_BLOCK_SIZE);
+
+        // The two blocks are independent, see encryptBlocks
+        encryptBlocks(ciphers, blocks, 2);
+
+        uint32_t n = data_length - offset;
+        if (n > SRTP_BLOCK_SIZE)
+            n = SRTP_BLOCK_SIZE;
+        for (uint32_t i = 0; i < n; i++)
+            data[offset + i] ^= stream[0][i] ^ stream[1][i];
+    }
+    memset(stream, 0, sizeof(stream));
+    return true;
+}
@@ -19,6 +19,7 @@
  */
 
 #include "crypto/hmac.h"
+#include "common/zrtpAllocator.h"
 #include <cstring>
 #include <cstdio>
 
@@ -105,8 +106,8 @@ void hmac_sha1(const uint8_t *key, uint64_t keyLength, const uint8_t* data, uint
 }
 
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
-               const std::vector<const uint8_t*>& data,
-               const std::vector<uint64_t>& dataLength,
+               const ZrtpVector<const uint8_t*>& data,
+               const ZrtpVector<uint64_t>& dataLength,
                uint8_t* mac, uint32_t* macLength )
 {
     hmacSha1Context ctx = {};
@@ -122,7 +123,7 @@ void hmac_sha1(const uint8_t* key, uint64_t keyLength,
 
 void* createSha1HmacContext(const uint8_t* key, uint64_t keyLength)
 {
-    auto *ctx = reinterpret_cast<hmacSha1Context*>(malloc(sizeof(hmacSha1Context)));
+    auto *ctx = reinterpret_cast<hmacSha1Context*>(zrtpMemAlloc(sizeof(hmacSha1Context), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
     if (ctx == nullptr)
         return nullptr;
 
@@ -150,8 +151,8 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha1Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength,
                  uint8_t* mac, uint32_t* macLength )
 {
     auto *pctx = (hmacSha1Context*)ctx;
@@ -167,7 +168,6 @@ void hmacSha1Ctx(void* ctx,
 void freeSha1HmacContext(void* ctx)
 {
     if (ctx) {
-        memset(ctx, 0, sizeof(hmacSha1Context));
-        free(ctx);
+        zrtpMemFree(ctx, sizeof(hmacSha1Context), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     }
 }
\ No newline at end of file
@@ -33,6 +33,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 #include "srtp/crypto/sha1.h"
 
 #ifndef SHA1_DIGEST_LENGTH
@@ -91,8 +92,8 @@ void hmac_sha1(const uint8_t* key, int64_t keyLength,
  *    Point to an integer that receives the length of the computed HMAC.
  */
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
-               const std::vector<const uint8_t*>& data,
-               const std::vector<uint64_t>& dataLength,
+               const ZrtpVector<const uint8_t*>& data,
+               const ZrtpVector<uint64_t>& dataLength,
                uint8_t* mac, int32_t* macLength);
 
 /**
@@ -164,8 +165,8 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
  *    Point to an integer that receives the length of the computed HMAC.
  */
 void hmacSha1Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength,
                  uint8_t* mac, uint32_t* macLength);
 
 /**
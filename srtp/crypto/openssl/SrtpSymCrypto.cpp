@@ -21,9 +21,14 @@
 #define MAKE_F8_TEST
 
 #include <cstdlib>
+#include <cstring>
 #include <openssl/aes.h>                // the include of openSSL
 #include <srtp/crypto/SrtpSymCrypto.h>
+#include <common/zrtpAlgorithms.h>
+#if ZRTP_WITH_TWOFISH
 #include <cryptcommon/twofish.h>
+#endif
+#include <common/zrtpAllocator.h>
 
 SrtpSymCrypto::SrtpSymCrypto(int algo):key(nullptr), algorithm(algo) {
 }
@@ -36,41 +41,52 @@ SrtpSymCrypto::SrtpSymCrypto( uint8_t* k, int32_t keyLength, int algo ):
 
 SrtpSymCrypto::~SrtpSymCrypto() {
     if (key != nullptr) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-            memset(key, 0, sizeof(AES_KEY) );
-        }
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-        }
-        delete[] (uint8_t*)key;
-        key = nullptr;
+        freeKey();
     }
 }
 
+void SrtpSymCrypto::freeKey() {
+#if ZRTP_WITH_TWOFISH
+    if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8)
+        zrtpMemFree(key, sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+    else
+#endif
+        zrtpMemFree(key, sizeof(AES_KEY), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+    key = nullptr;
+}
+
+#if ZRTP_WITH_TWOFISH
 static int twoFishInit = 0;
+#endif
 
 bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
     // release an existing key before setting a new one
     if (key != nullptr)
-        delete[] (uint8_t*)key;
+        freeKey();
 
     if (!(keyLength == 16 || keyLength == 32)) {
         return false;
     }
     if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-        key = new uint8_t[sizeof(AES_KEY)];
+        key = zrtpMemAlloc(sizeof(AES_KEY), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        if (key == nullptr)
+            return false;
         memset(key, 0, sizeof(AES_KEY) );
         AES_set_encrypt_key(k, keyLength*8, (AES_KEY *)key);
     }
+#if ZRTP_WITH_TWOFISH
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         if (!twoFishInit) {
             Twofish_initialise();
             twoFishInit = 1;
         }
-        key = new uint8_t[sizeof(Twofish_key)];
+        key = zrtpMemAlloc(sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        if (key == nullptr)
+            return false;
         memset(key, 0, sizeof(Twofish_key));
         Twofish_prepare_key((Twofish_Byte*)k, keyLength,  (Twofish_key*)key);
     }
+#endif
     else
         return false;
 
@@ -79,13 +95,16 @@ bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
 
 
 void SrtpSymCrypto::encrypt(const uint8_t* input, uint8_t* output ) {
-    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+    // Without Twofish setNewKey() accepts AES only, thus skip the test
+    if (!ZrtpAlgorithms::twofish || algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
         AES_encrypt(input, output, (AES_KEY *)key);
     }
+#if ZRTP_WITH_TWOFISH
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         Twofish_encrypt((Twofish_key*)key, (Twofish_Byte*)input,
                         (Twofish_Byte*)output); 
     }
+#endif
 }
 
 void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length,
@@ -93,6 +112,9 @@ void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length,
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
+    if (key == nullptr)
+        return;
+
     for(ctr = 0; ctr < length/SRTP_BLOCK_SIZE; ctr++) {
         //compute the cipher stream
         iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
@@ -256,6 +278,11 @@ void SrtpSymCrypto::f8_encrypt(const uint8_t* in, uint32_t in_length, uint8_t* o
     }
 }
 
+void SrtpSymCrypto::encryptBlocks(SrtpSymCrypto* const* ciphers, uint8_t* const* blocks, int32_t n) {
+    for (int32_t i = 0; i < n; i++)
+        ciphers[i]->encrypt(blocks[i], blocks[i]);
+}
+
 int SrtpSymCrypto::processBlock(F8_CIPHER_CTX *f8ctx, const uint8_t* in, int32_t length, uint8_t* out) {
 
     int i;
@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <openssl/hmac.h>
 #include <srtp/crypto/hmac.h>
+#include <common/zrtpAllocator.h>
 #include <vector>
 
 void hmac_sha1(const uint8_t* key, int64_t keyLength,
@@ -33,8 +34,8 @@ void hmac_sha1(const uint8_t* key, int64_t keyLength,
 }
 
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
-               const std::vector<const uint8_t*>& data,
-               const std::vector<uint64_t>& dataLength,
+               const ZrtpVector<const uint8_t*>& data,
+               const ZrtpVector<uint64_t>& dataLength,
                uint8_t* mac, int32_t* macLength) {
     HMAC_CTX ctx = {};
     HMAC_CTX_init(&ctx);
@@ -48,7 +49,7 @@ void hmac_sha1(const uint8_t* key, uint64_t keyLength,
 
 void* createSha1HmacContext(const uint8_t* key, uint64_t keyLength)
 {
-    auto* ctx = (HMAC_CTX*)malloc(sizeof(HMAC_CTX));
+    auto* ctx = (HMAC_CTX*)zrtpMemAlloc(sizeof(HMAC_CTX), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 
     HMAC_CTX_init(ctx);
     HMAC_Init_ex(ctx, key, static_cast<int>(keyLength), EVP_sha1(), nullptr);
@@ -75,8 +76,8 @@ void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
 }
 
 void hmacSha1Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength,
                  uint8_t* mac, uint32_t* macLength)
 {
     auto* pctx = (HMAC_CTX*)ctx;
@@ -92,6 +93,6 @@ void freeSha1HmacContext(void* ctx)
 {
     if (ctx) {
         HMAC_CTX_cleanup((HMAC_CTX*)ctx);
-        free(ctx);
+        zrtpMemFree(ctx, sizeof(HMAC_CTX), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     }
 }
\ No newline at end of file
@@ -22,10 +22,14 @@
 #include <string>
 #include <ctime>
 #include <cstdlib>
+#include <system_error>
 
 #include <libzrtpcpp/ZIDCacheDb.h>
 #include <cryptcommon/aes.h>
 
+// The SQLite connection serializes its calls internally. This lock makes
+// the wait visible and also protects the shared error buffer.
+LockClass ZIDCacheDb::cacheLockClass("ZIDCacheDb");
 
 static ZIDCacheDb* instance;
 
@@ -50,6 +54,7 @@ ZIDCacheDb::~ZIDCacheDb() {
 }
 
 int ZIDCacheDb::open(char* name) {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
 
     // check for an already active ZID file
     if (zidFile != nullptr) {
@@ -66,6 +71,7 @@ int ZIDCacheDb::open(char* name) {
 }
 
 void ZIDCacheDb::close() {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
 
     if (zidFile != NULL) {
         cacheOps.closeCache(zidFile);
@@ -76,6 +82,15 @@ void ZIDCacheDb::close() {
 ZIDRecord *ZIDCacheDb::getRecord(unsigned char *zid) {
     ZIDRecordDb *zidRecord = new ZIDRecordDb();
 
+    readRecord(zid, zidRecord);
+    return zidRecord;
+}
+
+bool ZIDCacheDb::readRecord(unsigned char *zid, ZIDRecord *zidRec) {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
+    ZIDRecordDb *zidRecord = reinterpret_cast<ZIDRecordDb *>(zidRec);
+
+    *zidRecord = ZIDRecordDb();
     cacheOps.readRemoteZidRecord(zidFile, zid, associatedZid, zidRecord->getRecordData(), errorBuffer);
 
     zidRecord->setZid(zid);
@@ -86,19 +101,46 @@ ZIDRecord *ZIDCacheDb::getRecord(unsigned char *zid) {
         zidRecord->getRecordData()->secureSince = (int64_t)time(NULL);
         cacheOps.insertRemoteZidRecord(zidFile, zid, associatedZid, zidRecord->getRecordData(), errorBuffer);
     }
-    return zidRecord;
+    return true;
+}
+
+std::future<ZIDRecord*> ZIDCacheDb::getRecordAsync(const unsigned char *zid) {
+    std::array<unsigned char, IDENTIFIER_LEN> peerZid;
+    memcpy(peerZid.data(), zid, IDENTIFIER_LEN);
+
+    // cacheLock serializes the read with all other calls, thus it can run
+    // in its own thread. Fall back to a read on demand if we get no thread.
+    try {
+        return std::async(std::launch::async, [this, peerZid]() mutable { return getRecord(peerZid.data()); });
+    } catch (std::system_error&) {
+        return std::future<ZIDRecord*>();
+    }
 }
 
 unsigned int ZIDCacheDb::saveRecord(ZIDRecord *zidRec) {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
     ZIDRecordDb *zidRecord = reinterpret_cast<ZIDRecordDb *>(zidRec);
 
     cacheOps.updateRemoteZidRecord(zidFile, zidRecord->getIdentifier(), associatedZid, zidRecord->getRecordData(), errorBuffer);
     return 1;
 }
 
+void ZIDCacheDb::beginBatch() {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
+    if (batchDepth++ == 0 && zidFile != NULL)
+        cacheOps.beginTransaction(zidFile, errorBuffer);
+}
+
+void ZIDCacheDb::endBatch() {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
+    if (batchDepth > 0 && --batchDepth == 0 && zidFile != NULL)
+        cacheOps.commitTransaction(zidFile, errorBuffer);
+}
+
 int32_t ZIDCacheDb::getPeerName(const uint8_t *peerZid, std::string *name) {
     zidNameRecord_t nameRec;
     char buffer[201] = {'\0'};
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
 
     nameRec.name = buffer;
     nameRec.nameLength = 200;
@@ -113,6 +155,7 @@ int32_t ZIDCacheDb::getPeerName(const uint8_t *peerZid, std::string *name) {
 void ZIDCacheDb::putPeerName(const uint8_t *peerZid, const std::string name) {
     zidNameRecord_t nameRec;
     char buffer[201] = {'\0'};
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
 
     nameRec.name = buffer;
     nameRec.nameLength = 200;
@@ -132,11 +175,13 @@ void ZIDCacheDb::putPeerName(const uint8_t *peerZid, const std::string name) {
 }
 
 void ZIDCacheDb::cleanup() {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
     cacheOps.cleanCache(zidFile, errorBuffer);
     cacheOps.readLocalZid(zidFile, associatedZid, NULL, errorBuffer);
 }
 
 void *ZIDCacheDb::prepareReadAll() {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
     return cacheOps.prepareReadAllZid(zidFile, errorBuffer);
 }
 
@@ -182,6 +227,7 @@ void *ZIDCacheDb::readNextRecord(void *stmt, std::string *output) {
     zidNameRecord_t nameRec;
     ZIDRecordDb zidRec;
     char buffer[201] = {'\0'};
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
 
     nameRec.name = buffer;
     nameRec.nameLength = 200;
@@ -199,5 +245,6 @@ void *ZIDCacheDb::readNextRecord(void *stmt, std::string *output) {
 }
 
 void ZIDCacheDb::closeOpenStatment(void *stmt) {
+    std::lock_guard<InstrumentedMutex> lock(cacheLock);
     cacheOps.closeStatement(stmt);
 }
@@ -61,6 +61,12 @@ ZIDRecord *ZIDCacheEmpty::getRecord(unsigned char *zid) {
     return new ZIDRecordEmpty();
 }
 
+bool ZIDCacheEmpty::readRecord(unsigned char *zid, ZIDRecord *zidRecord) {
+    (void) zid;
+    (void) zidRecord;
+    return true;
+}
+
 unsigned int ZIDCacheEmpty::saveRecord(ZIDRecord *zidRec) {
     (void) zidRec;
     return 1;
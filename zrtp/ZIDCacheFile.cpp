@@ -198,10 +198,16 @@ void ZIDCacheFile::close() {
 }
 
 ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
+    ZIDRecordFile *zidRecord = new ZIDRecordFile();
+
+    readRecord(zid, zidRecord);
+    return zidRecord;
+}
+
+bool ZIDCacheFile::readRecord(unsigned char *zid, ZIDRecord *zidRec) {
     unsigned long pos;
     int numRead;
-    //    ZIDRecordFile rec;
-    ZIDRecordFile *zidRecord = new ZIDRecordFile();
+    ZIDRecordFile *zidRecord = reinterpret_cast<ZIDRecordFile *>(zidRec);
 
     // set read pointer behind first record (
     fseek(zidFile, zidRecord->getRecordLength(), SEEK_SET);
@@ -225,8 +231,7 @@ ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
     // found. We need to create a new ZID record.
     if (numRead == 0) {
         // create new record
-        delete(zidRecord);
-        zidRecord = new ZIDRecordFile();
+        *zidRecord = ZIDRecordFile();
         zidRecord->setZid(zid);
         zidRecord->setValid();
         if (fwrite(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) < 1)
@@ -234,7 +239,7 @@ ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
     }
     //  remember position of record in file for save operation
     zidRecord->setPosition(pos);
-    return zidRecord;
+    return true;
 }
 
 unsigned int ZIDCacheFile::saveRecord(ZIDRecord *zidRec) {
@@ -243,10 +248,20 @@ unsigned int ZIDCacheFile::saveRecord(ZIDRecord *zidRec) {
     fseek(zidFile, zidRecord->getPosition(), SEEK_SET);
     if (fwrite(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) < 1)
         ++errors;
-    fflush(zidFile);
+    if (batchDepth == 0)
+        fflush(zidFile);
     return 1;
 }
 
+void ZIDCacheFile::beginBatch() {
+    batchDepth++;
+}
+
+void ZIDCacheFile::endBatch() {
+    if (batchDepth > 0 && --batchDepth == 0 && zidFile != NULL)
+        fflush(zidFile);
+}
+
 int32_t ZIDCacheFile::getPeerName(const uint8_t *peerZid, std::string *name) {
     return 0;
 }
@@ -19,16 +19,19 @@
  */
 #include <sstream>
 
+#include <common/zrtpAlgorithms.h>
 #include <crypto/zrtpDH.h>
 #include <crypto/hmac256.h>
 #include <crypto/sha256.h>
 #include <crypto/hmac384.h>
 #include <crypto/sha384.h>
 
+#if ZRTP_WITH_SKEIN
 #include <crypto/skeinMac256.h>
 #include <crypto/skein256.h>
 #include <crypto/skeinMac384.h>
 #include <crypto/skein384.h>
+#endif
 
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
@@ -37,6 +40,15 @@
 
 using namespace GnuZrtpCodes;
 
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
 /*
  * This method simplifies detection of libzrtpcpp inside Automake, configure
  * and friends
@@ -53,22 +65,33 @@ extern "C" {
 #endif
 
 ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport):
-        callback(cb), dhContext(nullptr), DHss(nullptr), auxSecret(nullptr), auxSecretLength(0), rs1Valid(false),
+        ZRtp(myZid, cb, id, ZrtpConfigProfile::compile(std::string(), *config), mitm, sasSignSupport) {
+}
+
+ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, std::shared_ptr<const ZrtpConfigProfile> profile,
+           bool mitm, bool sasSignSupport):
+        callback(cb), dhContext(nullptr), numDhContexts(0), auxSecret(nullptr), auxSecretLength(0), auxSecretSize(0), rs1Valid(false),
         rs2Valid(false), msgShaContext(nullptr), hash(nullptr), cipher(nullptr), pubKey(nullptr), sasType(nullptr), authLength(nullptr),
         multiStream(false), multiStreamAvailable(false), peerIsEnrolled(false), mitmSeen(false), pbxSecretTmp(nullptr),
-        enrollmentMode(false), configureAlgos(*config), zidRec(nullptr), saveZidRecord(true), signSasSeen(false),
+        enrollmentMode(false), configProfile(profile), configureAlgos(profile->getConfigure()), zidRec(nullptr), zidRecStore(nullptr), saveZidRecord(true), cacheReadOnly(false), signSasSeen(false),
         masterStream(nullptr), peerDisclosureFlagSeen(false) {
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
-    enableMitmEnrollment = config->isTrustedMitM();
+    enableMitmEnrollment = configureAlgos.isTrustedMitM();
 #pragma message "ZRTP SAS relay support is enabled."
 #else
     enableMitmEnrollment = false;
 #endif
 
     signatureData = nullptr;
-    paranoidMode = config->isParanoidMode();
-    sasSignSupport = config->isSasSignature();
+    zrtpCipherI = zrtpCipherR = nullptr;
+    zrtpCipherFuncs = nullptr;
+    numCipherPool = 0;
+    paranoidMode = configureAlgos.isParanoidMode();
+    fastStart = configureAlgos.isFastStart();
+    traceId = ZrtpTrace::newSession();
+    myRole = NoRole;
+    sasSignSupport = configureAlgos.isSasSignature();
 
     // setup the implicit hash function pointers and length. The casts show that we use different
     // functions
@@ -89,13 +112,13 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
     sha256(H2, HASH_IMAGE_SIZE, H3);        // H3
 
     // configure all supported Hello packet versions
-    zrtpHello_11.configureHello(&configureAlgos);
+    zrtpHello_11.configureHello(configProfile.get());
     zrtpHello_11.setH3(H3);                    // set H3 in Hello, included in helloHash
     zrtpHello_11.setZid(ownZid);
     zrtpHello_11.setVersion((uint8_t*)zrtpVersion_11);
 
 
-    zrtpHello_12.configureHello(&configureAlgos);
+    zrtpHello_12.configureHello(configProfile.get());
     zrtpHello_12.setH3(H3);                 // set H3 in Hello, included in helloHash
     zrtpHello_12.setZid(ownZid);
     zrtpHello_12.setVersion((uint8_t*)zrtpVersion_12);
@@ -122,39 +145,80 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
     helloPackets[SUPPORTED_ZRTP_VERSIONS].packet = nullptr;
     peerHelloVersion[0] = 0;
 
+    // The S0 computation hashes up to 12 chunks
+    hashChunks.reserve(12);
+    hashChunkLength.reserve(12);
+
+    // The handshake assigns these strings, reserve the longest values
+    peerClientId.reserve(ZRTP_WORD_SIZE * 4);
+    SAS.reserve(32);
+    cipherInfo.reserve(64);
+
+    // Create the Confirm cipher contexts now, the handshake sets the keys
+    for (int32_t i = 0; i < configureAlgos.getNumConfiguredAlgos(CipherAlgorithm); i++) {
+        AlgorithmEnum& cp = configureAlgos.getAlgoAt(CipherAlgorithm, i);
+        const cipherContext_t* funcs = cp.getCipherContext();
+        int32_t k = 0;
+        while (k < numCipherPool && cipherPoolFuncs[k] != funcs)
+            k++;
+        if (funcs != nullptr && k == numCipherPool)
+            addCipherPool(funcs, cp.getKeylen());
+    }
+
+    // The handshakes read the peer's ZID cache record into this record
+    zidRecStore = getZidCacheInstance()->createRecord();
+
+    // Set up the DH contexts now, the handshake only generates new key pairs
+    for (int32_t i = 0; i < configureAlgos.getNumConfiguredAlgos(PubKeyAlgorithm); i++) {
+        AlgorithmEnum& pk = configureAlgos.getAlgoAt(PubKeyAlgorithm, i);
+        if (*(int32_t*)(pk.getName()) == *(int32_t*)mult)
+            continue;
+        auto* context = new ZrtpDH(pk.getName());
+        if (context->getDHtype() == nullptr) {
+            delete context;
+            continue;
+        }
+        dhContexts[numDhContexts++] = context;
+    }
+
     stateEngine = new ZrtpStateClass(this);
 }
 
 ZRtp::~ZRtp() {
     stopZrtp();
-    if (DHss != nullptr) {
-        delete DHss;
-        DHss = nullptr;
-    }
     if (stateEngine != nullptr) {
         delete stateEngine;
         stateEngine = nullptr;
     }
-    if (dhContext != nullptr) {
-        delete dhContext;
-        dhContext = nullptr;
+    dhContext = nullptr;
+    for (int32_t i = 0; i < numDhContexts; i++) {
+        delete dhContexts[i];
     }
+    numDhContexts = 0;
+    memset_volatile(DHss, 0, sizeof(DHss));
     if (msgShaContext != nullptr) {
         closeHashCtx(msgShaContext, nullptr);
         msgShaContext = nullptr;
     }
     if (auxSecret != nullptr) {
-        delete auxSecret;
+        zrtpMemFree(auxSecret, auxSecretSize, ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
         auxSecret = nullptr;
         auxSecretLength = 0;
+        auxSecretSize = 0;
     }
-    if (zidRec != nullptr) {
+    if (zidRecPending.valid()) {
+        delete zidRecPending.get();
+    }
+    if (zidRec != zidRecStore) {
         delete zidRec;
-        zidRec = nullptr;
     }
+    zidRec = nullptr;
+    delete zidRecStore;
+    zidRecStore = nullptr;
     memset(hmacKeyI, 0, MAX_DIGEST_LENGTH);
     memset(hmacKeyR, 0, MAX_DIGEST_LENGTH);
 
+    freeZrtpCiphers();
     memset(zrtpKeyI, 0, MAX_DIGEST_LENGTH);
     memset(zrtpKeyR, 0, MAX_DIGEST_LENGTH);
     /*
@@ -224,6 +288,7 @@ void ZRtp::startZrtpEngine() {
     Event ev;
 
     if (stateEngine != nullptr && stateEngine->inState(Initial)) {
+        traceEvent(TraceStart);
         ev.type = ZrtpInitial;
         stateEngine->processEvent(&ev);
     }
@@ -233,6 +298,7 @@ void ZRtp::stopZrtp() {
     Event ev;
 
     if (stateEngine != nullptr) {
+        traceEvent(TraceStop);
         ev.type = ZrtpClose;
         stateEngine->processEvent(&ev);
     }
@@ -263,11 +329,18 @@ ZrtpPacketHelloAck* ZRtp::prepareHelloAck() {
  */
 ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg) {
 
+    if (!acceptPeerHello(hello, errMsg))
+        return nullptr;
+    return finishCommit();
+}
+
+bool ZRtp::acceptPeerHello(ZrtpPacketHello *hello, uint32_t* errMsg) {
+
     myRole = Initiator;
 
     if (!hello->isLengthOk()) {
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
     // Save data before detailed checks - may aid in analysing problems
     peerClientId.assign((char*)hello->getClientId(), ZRTP_WORD_SIZE * 4);
@@ -278,8 +351,13 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
     memcpy(peerZid, hello->getZid(), ZID_SIZE);
     if (memcmp(peerZid, ownZid, ZID_SIZE) == 0) {       // peers have same ZID????
         *errMsg = EqualZIDHello;
-        return nullptr;
+        return false;
     }
+    // Start to read the peer's record now, the cache may do this in the
+    // background while we check the Hello, generate our DH key and wait for
+    // the peer's HelloAck or Commit. Multi-stream mode does not use it.
+    if (!multiStream)
+        prefetchZidRecord();
     memcpy(peerH3, hello->getH3(), HASH_IMAGE_SIZE);
 
     uint32_t helloLen = hello->getLength() * ZRTP_WORD_SIZE;
@@ -309,7 +387,7 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
         pubKey = findBestPubkey(hello);                 // Check for public key algorithm first, must set 'hash' as well
         if (hash == nullptr) {
             *errMsg = UnsuppHashType;
-            return nullptr;
+            return false;
         }
         if (cipher == nullptr)                             // public key selection may have set the cipher already
             cipher = findBestCipher(hello, pubKey);
@@ -319,46 +397,65 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
     }
     else {
         if (checkMultiStream(hello)) {
-            return prepareCommitMultiStream(hello);
+            storeMsgTemp(hello);
+            return true;
         }
         else {
             // we are in multi-stream but peer does not offer multi-stream
             // return error code to other party - unsupported PK, must be Mult
             *errMsg = UnsuppPKExchange;
-            return nullptr;
+            return false;
         }
     }
     setNegotiatedHash(hash);
 
-    // Modify here when introducing new DH key agreement, for example
-    // elliptic curves.
-    dhContext = new ZrtpDH(pubKey->getName());
-    dhContext->generatePublicKey();
-
+    dhContext = prepareDhContext(pubKey);
+    if (dhContext == nullptr) {
+        *errMsg = UnsuppPKExchange;
+        return false;
+    }
     dhContext->getPubKeyBytes(pubKeyBytes);
     sendInfo(Info, InfoCommitDHGenerated);
 
     // Prepare IV data that we will use during confirm packet encryption.
     randomZRTP(randomIV, sizeof(randomIV));
 
+#ifdef ZRTP_SAS_RELAY_SUPPORT
+    // Check if a PBX application set the MitM flag.
+    mitmSeen = hello->isMitmMode();
+#endif
+
+    signSasSeen = hello->isSasSign();
+
+    // store Hello data temporarily until we build the Commit and until we can
+    // check HMAC after receiving Commit as Responder or DHPart1 as Initiator
+    storeMsgTemp(hello);
+    return true;
+}
+
+ZrtpPacketCommit* ZRtp::finishCommit() {
+
+    // The peer's Hello that acceptPeerHello() stored
+    ZrtpPacketHello peerHello(tempMsgBuffer);
+    ZrtpPacketHello* hello = &peerHello;
+
+    if (multiStream) {
+        return prepareCommitMultiStream(hello);
+    }
+    uint32_t helloLen = hello->getLength() * ZRTP_WORD_SIZE;
+
     /*
      * Prepare our DHPart2 packet here. Required to compute HVI. If we stay
      * in Initiator role then we reuse this packet later in prepareDHPart2().
      * To create this DH packet we have to compute the retained secret ids,
      * thus get our peer's retained secret data first.
      */
-    zidRec = getZidCacheInstance()->getRecord(peerZid);
+    if (zidRec == nullptr)
+        zidRec = fetchZidRecord();
 
     //Compute the Initiator's and Responder's retained secret ids.
     computeSharedSecretSet(zidRec);
 
-#ifdef ZRTP_SAS_RELAY_SUPPORT
-    // Check if a PBX application set the MitM flag.
-    mitmSeen = hello->isMitmMode();
-#endif
-
-    signSasSeen = hello->isSasSign();
-
     // Construct a DHPart2 message (Initiator's DH message). This packet
     // is required to compute the HVI (Hash Value Initiator), refer to
     // chapter 5.4.1.1.
@@ -410,10 +507,6 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
     hashCtxFunction(msgShaContext, (unsigned char*)hello->getHeaderBase(), helloLen);
     hashCtxFunction(msgShaContext, (unsigned char*)zrtpCommit.getHeaderBase(), len);
 
-    // store Hello data temporarily until we can check HMAC after receiving Commit as
-    // Responder or DHPart1 as Initiator
-    storeMsgTemp(hello);
-
     return &zrtpCommit;
 }
 
@@ -451,10 +544,6 @@ ZrtpPacketCommit* ZRtp::prepareCommitMultiStream(ZrtpPacketHello *hello) {
     hashCtxFunction(msgShaContext, (unsigned char*)hello->getHeaderBase(), helloLen);
     hashCtxFunction(msgShaContext, (unsigned char*)zrtpCommit.getHeaderBase(), len);
 
-    // store Hello data temporarily until we can check HMAC after receiving Commit as
-    // Responder or DHPart1 as Initiator
-    storeMsgTemp(hello);
-
     return &zrtpCommit;
 }
 
@@ -535,6 +624,13 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
         setNegotiatedHash(hash);
         // Compute the Initator's and Responder's retained secret ids
         // with the committed hash.
+        if (zidRec != nullptr)
+            computeSharedSecretSet(zidRec);
+    }
+    // The peer committed before we built our own Commit: collect the record
+    // that acceptPeerHello() prefetched
+    if (zidRec == nullptr) {
+        zidRec = fetchZidRecord();
         computeSharedSecretSet(zidRec);
     }
     // check if we support the commited pub key type
@@ -559,14 +655,15 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
     }
     sasType = cp;
 
-    // dhContext cannot be nullptr - always setup during prepareCommit()
-    // check if we can use the dhContext prepared by prepareCommit(),
-    // if not delete old DH context and generate new one
+    // check if we can use the dhContext prepared by acceptPeerHello(),
+    // if not generate a key pair for the committed algorithm
     // The algorithm names are 4 chars only, thus we can cast to int32_t
-    if (*(int32_t*)(dhContext->getDHtype()) != *(int32_t*)(pubKey->getName())) {
-        delete dhContext;
-        dhContext = new ZrtpDH(pubKey->getName());
-        dhContext->generatePublicKey();
+    if (dhContext == nullptr || *(int32_t*)(dhContext->getDHtype()) != *(int32_t*)(pubKey->getName())) {
+        dhContext = prepareDhContext(pubKey);
+        if (dhContext == nullptr) {
+            *errMsg = UnsuppPKExchange;
+            return nullptr;
+        }
     }
     sendInfo(Info, InfoDH1DHGenerated);
 
@@ -656,9 +753,7 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
         return nullptr;
     }
 
-    // get memory to store DH result TODO: make it fixed memory
-    DHss = new uint8_t[dhContext->getDhSize()];
-    if (DHss == nullptr) {
+    if (dhContext->getDhSize() > sizeof(DHss)) {
         *errMsg = CriticalSWError;
         return nullptr;
     }
@@ -689,7 +784,7 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
     // also performs sign SAS callback if it's active.
     generateKeysInitiator(dhPart1, zidRec);
 
-    delete dhContext;
+    dhContext->clearPrivateKey();
     dhContext = nullptr;
 
     // TODO: at initiator we can call signSAS at this point, don't delay until confirm1 received
@@ -738,8 +833,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
         *errMsg = DHErrorWrongHVI;
         return nullptr;
     }
-    DHss = new uint8_t[dhContext->getDhSize()];
-    if (DHss == nullptr) {
+    if (dhContext->getDhSize() > sizeof(DHss)) {
         *errMsg = CriticalSWError;
         return nullptr;
     }
@@ -765,7 +859,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
      */
     generateKeysResponder(dhPart2, zidRec);
 
-    delete dhContext;
+    dhContext->clearPrivateKey();
     dhContext = nullptr;
 
     // Fill in Confirm1 packet.
@@ -802,7 +896,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
 
     // Encrypt and HMAC with Responder's key - we are Responder here
     uint32_t hmLen = (zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, zrtpConfirm1.getHashH0(), hmLen);
+    zrtpCipherFuncs->encrypt(zrtpCipherR, randomIV, zrtpConfirm1.getHashH0(), hmLen);
     hmacFunction(hmacKeyR, hashLength, zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
 
     zrtpConfirm1.setHmac(confMac);
@@ -919,7 +1013,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
 
     // Encrypt and HMAC with Responder's key - we are Respondere here
     uint32_t hmLen = (zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, zrtpConfirm1.getHashH0(), hmLen);
+    zrtpCipherFuncs->encrypt(zrtpCipherR, randomIV, zrtpConfirm1.getHashH0(), hmLen);
 
     // Use negotiated HMAC (hash)
     hmacFunction(hmacKeyR, hashLength, zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
@@ -956,7 +1050,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
         *errMsg = ConfirmHMACWrong;
         return nullptr;
     }
-    cipher->getDecrypt()(zrtpKeyR, cipher->getKeylen(), (uint8_t*)confirm1->getIv(), confirm1->getHashH0(), hmlen);
+    zrtpCipherFuncs->decrypt(zrtpCipherR, (uint8_t*)confirm1->getIv(), confirm1->getHashH0(), hmlen);
 
     // Check HMAC of DHPart1 packet stored in temporary buffer. The
     // HMAC key of the DHPart1 packet is peer's H0 that is contained in
@@ -993,7 +1087,8 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
     }
     // now we are ready to save the new RS1 which inherits the verified
     // flag from old RS1
-    zidRec->setNewRs1((const uint8_t*)newRs1);
+    if (!cacheReadOnly)
+        zidRec->setNewRs1((const uint8_t*)newRs1);
 
     // now generate my Confirm2 message
     zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
@@ -1029,12 +1124,12 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
         }
     }
 #endif
-    if (saveZidRecord)
+    if (saveZidRecord && !cacheReadOnly)
         getZidCacheInstance()->saveRecord(zidRec);
 
     // Encrypt and HMAC with Initiator's key - we are Initiator here
     hmlen = (zrtpConfirm2.getLength() - (uint)9) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, zrtpConfirm2.getHashH0(), hmlen);
+    zrtpCipherFuncs->encrypt(zrtpCipherI, randomIV, zrtpConfirm2.getHashH0(), hmlen);
 
     // Use negotiated HMAC (hash)
     hmacFunction(hmacKeyI, hashLength, zrtpConfirm2.getHashH0(), hmlen, confMac, &macLen);
@@ -1095,7 +1190,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1,
         return nullptr;
     }
     // Cast away the const for the IV - the standalone AES CFB modifies IV on return
-    cipher->getDecrypt()(zrtpKeyR, cipher->getKeylen(), (uint8_t*)confirm1->getIv(), confirm1->getHashH0(), hmLen);
+    zrtpCipherFuncs->decrypt(zrtpCipherR, (uint8_t*)confirm1->getIv(), confirm1->getHashH0(), hmLen);
 
     // Because we are initiator the protocol engine didn't receive Commit and
     // because we are using multi-stream mode here we also did not receive a DHPart1 and
@@ -1129,7 +1224,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1,
 
     // Encrypt and HMAC with Initiator's key - we are Initiator here
     hmLen = (zrtpConfirm2.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, zrtpConfirm2.getHashH0(), hmLen);
+    zrtpCipherFuncs->encrypt(zrtpCipherI, randomIV, zrtpConfirm2.getHashH0(), hmLen);
 
     // Use negotiated HMAC (hash)
     hmacFunction(hmacKeyI, hashLength, zrtpConfirm2.getHashH0(), hmLen, confMac, &macLen);
@@ -1164,7 +1259,7 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
         return nullptr;
     }
     // Cast away the const for the IV - the standalone AES CFB modifies IV on return
-    cipher->getDecrypt()(zrtpKeyI, cipher->getKeylen(), (uint8_t*)confirm2->getIv(), confirm2->getHashH0(), hmlen);
+    zrtpCipherFuncs->decrypt(zrtpCipherI, (uint8_t*)confirm2->getIv(), confirm2->getHashH0(), hmlen);
 
     if (!multiStream) {
         // Check HMAC of DHPart2 packet stored in temporary buffer. The
@@ -1192,9 +1287,11 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
             // TODO: error handling if checkSASSignature returns false.
         }
         // save new RS1, this inherits the verified flag from old RS1
-        zidRec->setNewRs1((const uint8_t*)newRs1);
-        if (saveZidRecord)
-            getZidCacheInstance()->saveRecord(zidRec);
+        if (!cacheReadOnly) {
+            zidRec->setNewRs1((const uint8_t*)newRs1);
+            if (saveZidRecord)
+                getZidCacheInstance()->saveRecord(zidRec);
+        }
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
         // Ask for enrollment only if enabled via configuration and the
@@ -1310,7 +1407,7 @@ static string sasDigit(const uint8_t* sasHash)
     return sas;
 }
 
-ZrtpPacketRelayAck* ZRtp::prepareRelayAck(ZrtpPacketSASrelay* srly, const uint32_t* errMsg) {
+ZrtpPacketRelayAck* ZRtp::prepareRelayAck(ZrtpPacketSASrelay* srly, uint32_t* errMsg) {
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // handle and render SAS relay data only if the peer announced that it is a trusted
@@ -1318,19 +1415,25 @@ ZrtpPacketRelayAck* ZRtp::prepareRelayAck(ZrtpPacketSASrelay* srly, const uint32
     if (!mitmSeen || paranoidMode)
         return &zrtpRelayAck;
 
+    // A SASrelay before the Confirm keys are ready cannot be authenticated
+    if (zrtpCipherFuncs == nullptr) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
     if (!srly->isLengthOk()) {
         *errMsg = CriticalSWError;
         return nullptr;
     }
-    uint8_t* hkey, *ekey;
+    uint8_t* hkey;
+    void* ecipher;
     // If we are responder then the PBX used it's Initiator keys
     if (myRole == Responder) {
         hkey = hmacKeyI;
-        ekey = zrtpKeyI;
+        ecipher = zrtpCipherI;
     }
     else {
         hkey = hmacKeyR;
-        ekey = zrtpKeyR;
+        ecipher = zrtpCipherR;
     }
 
     uint8_t confMac[MAX_DIGEST_LENGTH];
@@ -1346,7 +1449,7 @@ ZrtpPacketRelayAck* ZRtp::prepareRelayAck(ZrtpPacketSASrelay* srly, const uint32
         return nullptr;                // TODO - check error handling
     }
     // Cast away the const for the IV - the standalone AES CFB modifies IV on return
-    cipher->getDecrypt()(ekey, cipher->getKeylen(), (uint8_t*)srly->getIv(), (uint8_t*)srly->getFiller(), hmlen);
+    zrtpCipherFuncs->decrypt(ecipher, (uint8_t*)srly->getIv(), (uint8_t*)srly->getFiller(), hmlen);
 
     const uint8_t* newSasHash = srly->getTrustedSas();
     bool sasHashNull = true;
@@ -1380,13 +1483,13 @@ ZrtpPacketRelayAck* ZRtp::prepareRelayAck(ZrtpPacketSASrelay* srly, const uint32
         sasBytes[2] = newSasHash[2] & 0xf0;
         sasBytes[3] = 0;
         if (*(int32_t*)b32 == *(int32_t*)(renderAlgo->getName())) {
-            SAS = Base32(sasBytes, 20).getEncoded();
+            SAS.assign(Base32(sasBytes, 20).getEncoded());
         }
         else if (*(int32_t*)b32e == *(int32_t*)(renderAlgo->getName())) {
-            SAS = *EmojiBase32::u32StringToUtf8(EmojiBase32(sasBytes, 20).getEncoded());
+            SAS.assign(*EmojiBase32::u32StringToUtf8(EmojiBase32(sasBytes, 20).getEncoded()));
         }
         else if (*(int32_t*)b10d == *(int32_t*)(renderAlgo->getName())) {
-            SAS = sasDigit(sasHash);
+            SAS.assign(sasDigit(sasHash));
             if (SAS.empty()) {
                 // report fatal error
             }
@@ -1552,7 +1655,7 @@ AlgorithmEnum* ZRtp::findBestPubkey(ZrtpPacketHello *hello) {
             continue;                               // skip multi-stream mode
         }
         for (int ii = 0; ii < numAlgosPeer; ii++) {
-            if (*(int32_t*)(ownIntersect[numOwnIntersect]->getName()) == *(int32_t*)(zrtpPubKeys.getByName((const char*)hello->getPubKeyType(ii)).getName())) {
+            if (ownIntersect[numOwnIntersect]->getNameId() == AlgorithmEnum::nameToId((const char*)hello->getPubKeyType(ii))) {
                 numOwnIntersect++;
                 break;
             }
@@ -1565,7 +1668,7 @@ AlgorithmEnum* ZRtp::findBestPubkey(ZrtpPacketHello *hello) {
     for (int i = 0; i < numAlgosPeer; i++) {
         peerIntersect[numPeerIntersect] = &zrtpPubKeys.getByName((const char*)hello->getPubKeyType(i));
         for (int ii = 0; ii < numOwnIntersect; ii++) {
-            if (*(int32_t*)(ownIntersect[ii]->getName()) == *(int32_t*)(peerIntersect[numPeerIntersect]->getName())) {
+            if (ownIntersect[ii]->getNameId() == peerIntersect[numPeerIntersect]->getNameId()) {
                 numPeerIntersect++;
                 break;
             }
@@ -1833,8 +1936,10 @@ bool ZRtp::verifyH2(ZrtpPacketCommit *commit) {
 
 void ZRtp::computeHvi(ZrtpPacketDHPart* dh, ZrtpPacketHello *hello) {
 
-    std::vector<const uint_8t *>data;
-    std::vector<uint64_t >length;
+    ZrtpVector<const uint8_t*>& data = hashChunks;
+    ZrtpVector<uint64_t>& length = hashChunkLength;
+    data.clear();
+    length.clear();
     /*
      * populate the vector to compute the HVI hash according to the
      * ZRTP specification.
@@ -1847,6 +1952,51 @@ void ZRtp::computeHvi(ZrtpPacketDHPart* dh, ZrtpPacketHello *hello) {
     hashListFunction(data, length, hvi);
 }
 
+void ZRtp::prefetchZidRecord() {
+    if (zidRecPending.valid()) {
+        delete zidRecPending.get();
+    }
+    if (zidRec != zidRecStore) {    // a repeated discovery, read the record again
+        delete zidRec;
+    }
+    zidRec = nullptr;
+    zidRecPending = getZidCacheInstance()->getRecordAsync(peerZid);
+}
+
+ZIDRecord* ZRtp::fetchZidRecord() {
+    if (zidRecPending.valid()) {
+        return zidRecPending.get();
+    }
+    if (zidRecStore != nullptr && getZidCacheInstance()->readRecord(peerZid, zidRecStore)) {
+        return zidRecStore;
+    }
+    return getZidCacheInstance()->getRecord(peerZid);
+}
+
+ZrtpDH* ZRtp::prepareDhContext(AlgorithmEnum* pk) {
+    ZrtpDH* context = nullptr;
+
+    // The algorithm names are 4 chars only, thus we can cast to int32_t
+    for (int32_t i = 0; i < numDhContexts; i++) {
+        if (*(int32_t*)(dhContexts[i]->getDHtype()) == *(int32_t*)(pk->getName())) {
+            context = dhContexts[i];
+            break;
+        }
+    }
+    if (context == nullptr) {
+        if (numDhContexts >= ZrtpConfigure::maxNoOfAlgos)
+            return nullptr;
+        context = new ZrtpDH(pk->getName());
+        if (context->getDHtype() == nullptr) {
+            delete context;
+            return nullptr;
+        }
+        dhContexts[numDhContexts++] = context;
+    }
+    context->generateKeyPair();
+    return context;
+}
+
 void ZRtp:: computeSharedSecretSet(ZIDRecord *zidRec) {
 
     /*
@@ -1916,15 +2066,6 @@ void ZRtp::computeAuxSecretIds() {
     }
 }
 
-/*
- * memset_volatile is a volatile pointer to the memset function.
- * You can call (*memset_volatile)(buf, val, len) or even
- * memset_volatile(buf, val, len) just as you would call
- * memset(buf, val, len), but the use of a volatile pointer
- * guarantees that the compiler will not optimise the call away.
- */
-static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
-
 /*
  * The DH packet for this function is DHPart1 and contains the Responder's
  * retained secret ids. Compare them with the expected secret ids (refer
@@ -2021,8 +2162,10 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
      * hashed to create S0.  According to the formula the max number of
      * elements to hash is 12, add one for the terminating "nullptr"
      */
-    std::vector<const uint_8t*> data;
-    std::vector<uint64_t> length;
+    ZrtpVector<const uint8_t*>& data = hashChunks;
+    ZrtpVector<uint64_t>& length = hashChunkLength;
+    data.clear();
+    length.clear();
 
     // we need a number of length data items, so define them here
     uint32_t counter, sLen[3];
@@ -2084,8 +2227,6 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 //  hexdump("S0 I", s0, hashLength);
 
     memset_volatile(DHss, 0, dhContext->getDhSize());
-    delete[] DHss;
-    DHss = nullptr;
 
     computeSRTPKeys();
     memset(s0, 0, MAX_DIGEST_LENGTH);
@@ -2183,8 +2324,10 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
      * These arrays hold the pointers and lengths of the data that must be
      * hashed to create S0.
      */
-    std::vector<const uint_8t*> data;
-    std::vector<uint64_t> length;
+    ZrtpVector<const uint8_t*>& data = hashChunks;
+    ZrtpVector<uint64_t>& length = hashChunkLength;
+    data.clear();
+    length.clear();
 
     // we need a number of length data items, so define them here
     uint32_t counter, sLen[3];
@@ -2246,8 +2389,6 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 //  hexdump("S0 R", s0, hashLength);
 
     memset_volatile(DHss, 0, dhContext->getDhSize());
-    delete[] DHss;
-    DHss = nullptr;
 
     computeSRTPKeys();
     memset(s0, 0, MAX_DIGEST_LENGTH);
@@ -2257,8 +2398,10 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 void ZRtp::KDF(uint8_t* key, size_t keyLength, uint8_t* label, size_t labelLength,
                uint8_t* context, size_t contextLength, size_t L, uint8_t* output) {
 
-    std::vector<const uint8_t*>data;
-    std::vector<uint64_t> length;
+    ZrtpVector<const uint8_t*>& data = hashChunks;
+    ZrtpVector<uint64_t>& length = hashChunkLength;
+    data.clear();
+    length.clear();
     uint32_t macLen = 0;
 
     // Very first element is a fixed counter, big endian
@@ -2331,6 +2474,91 @@ void ZRtp::computePBXSecret() {
 #endif
 }
 
+int32_t ZRtp::addCipherPool(const cipherContext_t* funcs, int32_t keyLength) {
+    uint8_t noKey[MAX_DIGEST_LENGTH] = {0};
+
+    if (numCipherPool >= ZrtpConfigure::maxNoOfAlgos)
+        return -1;
+
+    void* ctxI = funcs->create(noKey, keyLength);
+    void* ctxR = funcs->create(noKey, keyLength);
+    if (ctxI == nullptr || ctxR == nullptr) {
+        if (ctxI != nullptr)
+            funcs->free(ctxI);
+        if (ctxR != nullptr)
+            funcs->free(ctxR);
+        return -1;
+    }
+    cipherPoolFuncs[numCipherPool] = funcs;
+    cipherPoolI[numCipherPool] = ctxI;
+    cipherPoolR[numCipherPool] = ctxR;
+    return numCipherPool++;
+}
+
+void ZRtp::createZrtpCiphers() {
+    const cipherContext_t* funcs = cipher->getCipherContext();
+    int32_t keyLength = cipher->getKeylen();
+
+    zrtpCipherFuncs = nullptr;
+    int32_t k = 0;
+    while (k < numCipherPool && cipherPoolFuncs[k] != funcs)
+        k++;
+    if (k == numCipherPool)
+        k = addCipherPool(funcs, keyLength);
+    if (k < 0)
+        return;
+
+    if (!funcs->setKey(cipherPoolI[k], zrtpKeyI, keyLength) || !funcs->setKey(cipherPoolR[k], zrtpKeyR, keyLength))
+        return;
+    zrtpCipherI = cipherPoolI[k];
+    zrtpCipherR = cipherPoolR[k];
+    zrtpCipherFuncs = funcs;
+}
+
+void ZRtp::freeZrtpCiphers() {
+    zrtpCipherFuncs = nullptr;
+    zrtpCipherI = zrtpCipherR = nullptr;
+
+    for (int32_t i = 0; i < numCipherPool; i++) {
+        cipherPoolFuncs[i]->free(cipherPoolI[i]);
+        cipherPoolFuncs[i]->free(cipherPoolR[i]);
+    }
+    numCipherPool = 0;
+}
+
+void ZRtp::traceEvent(uint8_t event, uint8_t message, uint32_t data, uint16_t length, uint8_t retries) {
+    if (!ZrtpTrace::isActive())
+        return;
+
+    ZrtpTraceRecord_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.session = traceId;
+    rec.data = data;
+    rec.length = length;
+    rec.event = event;
+    rec.state = (stateEngine != nullptr) ? static_cast<uint8_t>(stateEngine->getState()) : 0;
+    rec.message = message;
+    rec.retries = retries;
+    rec.role = static_cast<uint8_t>(myRole);
+    rec.flags = multiStream ? 1 : 0;
+    ZrtpTrace::record(rec);
+}
+
+void ZRtp::traceAlgorithms() {
+    if (!ZrtpTrace::isActive())
+        return;
+
+    AlgorithmEnum* algos[numberOfTraceAlgos] = {hash, cipher, authLength, pubKey, sasType};
+
+    for (int32_t i = 0; i < numberOfTraceAlgos; i++) {
+        if (algos[i] == nullptr)
+            continue;
+        uint32_t name = 0;
+        memcpy(&name, algos[i]->getName(), ZRTP_WORD_SIZE);
+        traceEvent(TraceAlgorithm, static_cast<uint8_t>(i), name);
+    }
+}
+
 void ZRtp::computeSRTPKeys() {
 
     // allocate the maximum size, compute real size to use
@@ -2364,6 +2592,8 @@ void ZRtp::computeSRTPKeys() {
     // The keys for Confirm messages
     KDF(s0, hashLength, (unsigned char*)iniZrtpKey, strlen(iniZrtpKey)+1, KDFcontext, kdfSize, keyLen, zrtpKeyI);
     KDF(s0, hashLength, (unsigned char*)respZrtpKey, strlen(respZrtpKey)+1, KDFcontext, kdfSize, keyLen, zrtpKeyR);
+    createZrtpCiphers();
+    traceAlgorithms();
 
     detailInfo.pubKey = detailInfo.sasType = nullptr;
     if (!multiStream) {
@@ -2389,13 +2619,13 @@ void ZRtp::computeSRTPKeys() {
         sasBytes[2] = sasHash[2] & static_cast<uint8_t>(0xf0);
         sasBytes[3] = 0;
         if (*(int32_t*)b32 == *(int32_t*)(sasType->getName())) {
-            SAS = Base32(sasBytes, 20).getEncoded();
+            SAS.assign(Base32(sasBytes, 20).getEncoded());
         }
         else if (*(int32_t*)b32e == *(int32_t*)(sasType->getName())) {
-            SAS = *EmojiBase32::u32StringToUtf8(EmojiBase32(sasBytes, 20).getEncoded());
+            SAS.assign(*EmojiBase32::u32StringToUtf8(EmojiBase32(sasBytes, 20).getEncoded()));
         }
         else if (*(int32_t*)b10d == *(int32_t*)(sasType->getName())) {
-            SAS = sasDigit(sasHash);
+            SAS.assign(sasDigit(sasHash));
             if (SAS.empty()) {
                 // report fatal error
             }
@@ -2444,18 +2674,18 @@ bool ZRtp::srtpSecretsReady(EnableSecurity part) {
 
     // The call state engine calls ForSender always after ForReceiver.
     if (part == ForSender) {
-        std::string cs(cipher->getReadable());
+        cipherInfo.assign(cipher->getReadable());
         if (!multiStream) {
-            cs.append("/").append(pubKey->getName());
+            cipherInfo.append("/").append(pubKey->getName());
             if (mitmSeen)
-                cs.append("/EndAtMitM");
-            callback->srtpSecretsOn(cs, SAS, zidRec->isSasVerified());
+                cipherInfo.append("/EndAtMitM");
+            callback->srtpSecretsOn(cipherInfo, SAS, zidRec->isSasVerified());
         }
         else {
             std::string cs1;
             if (mitmSeen)
-                cs.append("/EndAtMitM");
-            callback->srtpSecretsOn(cs, cs1, true);
+                cipherInfo.append("/EndAtMitM");
+            callback->srtpSecretsOn(cipherInfo, cs1, true);
         }
     }
     return rc;
@@ -2465,11 +2695,11 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
     switch (zrtpHashes.getOrdinal(*hash)) {
     case 0:
         hashLength = SHA256_DIGEST_LENGTH;
-        hashListFunction = sha256; // static_cast<void (*)(const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(sha256);;
+        hashListFunction = sha256; // static_cast<void (*)(const ZrtpVector<const uint8_t*>&, const ZrtpVector<uint64_t>&, uint8_t *)>(sha256);;
 
         hmacFunction = static_cast<void (*)(const uint8_t*, uint64_t, const uint8_t *, uint64_t, uint8_t *c, uint32_t *)>(hmac_sha256);
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&,
-                                                const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha256);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const ZrtpVector<const uint8_t*>&,
+                                                const ZrtpVector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha256);
 
         createHashCtx = initializeSha256Context;
         msgShaContext = &hashCtx.sha256Ctx;
@@ -2479,11 +2709,11 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
 
     case 1:
         hashLength = SHA384_DIGEST_LENGTH;
-        hashListFunction = sha384; // static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(sha384);
+        hashListFunction = sha384; // static_cast<void (*) (const ZrtpVector<const uint8_t*>&, const ZrtpVector<uint64_t>&, uint8_t *)>(sha384);
 
         hmacFunction = hmac_sha384;
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&,
-                                                const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha384);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const ZrtpVector<const uint8_t*>&,
+                                                const ZrtpVector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha384);
 
         createHashCtx = initializeSha384Context;
         msgShaContext = &hashCtx.sha384Ctx;
@@ -2491,12 +2721,13 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
         hashCtxFunction = sha384Ctx;
         break;
 
+#if ZRTP_WITH_SKEIN
     case 2:
         hashLength = SKEIN256_DIGEST_LENGTH;
-        hashListFunction = static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(skein256);
+        hashListFunction = static_cast<void (*) (const ZrtpVector<const uint8_t*>&, const ZrtpVector<uint64_t>&, uint8_t *)>(skein256);
 
         hmacFunction = macSkein256;
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein256);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const ZrtpVector<const uint8_t*>&, const ZrtpVector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein256);
 
         createHashCtx = initializeSkein256Context;
         msgShaContext = &hashCtx.skeinCtx;
@@ -2506,16 +2737,17 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
 
     case 3:
         hashLength = SKEIN384_DIGEST_LENGTH;
-        hashListFunction = static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(skein384);
+        hashListFunction = static_cast<void (*) (const ZrtpVector<const uint8_t*>&, const ZrtpVector<uint64_t>&, uint8_t *)>(skein384);
 
         hmacFunction = macSkein384;
-        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein384);
+        hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const ZrtpVector<const uint8_t*>&, const ZrtpVector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein384);
 
         createHashCtx = initializeSkein384Context;
         msgShaContext = &hashCtx.skeinCtx;
         closeHashCtx = finalizeSkein384Context;
         hashCtxFunction = skein384Ctx;
         break;
+#endif
 
     default:
         break;
@@ -2533,13 +2765,15 @@ void ZRtp::SASVerified() {
 
     zidRec->setSasVerified();
     saveZidRecord = true;
-    getZidCacheInstance()->saveRecord(zidRec);
+    if (!cacheReadOnly)
+        getZidCacheInstance()->saveRecord(zidRec);
 }
 
 void ZRtp::resetSASVerified() {
 
     zidRec->resetSasVerified();
-    getZidCacheInstance()->saveRecord(zidRec);
+    if (!cacheReadOnly)
+        getZidCacheInstance()->saveRecord(zidRec);
 }
 
 bool ZRtp::isSASVerified() {
@@ -2550,7 +2784,7 @@ void ZRtp::setRs2Valid() {
 
     if (zidRec != nullptr) {
         zidRec->setRs2Valid();
-        if (saveZidRecord)
+        if (saveZidRecord && !cacheReadOnly)
             getZidCacheInstance()->saveRecord(zidRec);
     }
 }
@@ -2570,12 +2804,14 @@ void ZRtp::sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
         memset(srtpSaltI, 0, 112/8);
         memset(srtpKeyR, 0, cipher->getKeylen());
         memset(srtpSaltR, 0, 112/8);
+        traceEvent(TraceSecure);
     }
     callback->sendInfo(severity, subCode);
 }
 
 
 void ZRtp::zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
+    traceEvent(TraceFailed, 0, (static_cast<uint32_t>(severity) << 16) | (static_cast<uint32_t>(subCode) & 0xffff));
     callback->zrtpNegotiationFailed(severity, subCode);
 }
 
@@ -2592,8 +2828,22 @@ void ZRtp::synchLeave() {
 }
 
 int32_t ZRtp::sendPacketZRTP(ZrtpPacketBase *packet) {
-    return ((packet == nullptr) ? 0 :
-            callback->sendDataZRTP(packet->getHeaderBase(), (packet->getLength() * 4) + 4));
+    if (packet == nullptr)
+        return 0;
+
+    int32_t length = (packet->getLength() * ZRTP_WORD_SIZE) + CRC_SIZE;
+
+    if (ZrtpTrace::isActive())
+        traceEvent(TracePacketSent, ZrtpTrace::messageCode(packet->getHeaderBase() + 4), 0, static_cast<uint16_t>(length));
+
+    // Packets that we created have a frame, let the client send it without a copy if it can
+    uint8_t* frame = packet->getFrameBase();
+    if (frame != nullptr) {
+        int32_t rc = callback->sendFrameZRTP(frame, length);
+        if (rc >= 0)
+            return rc;
+    }
+    return callback->sendDataZRTP(packet->getHeaderBase(), length);
 }
 
 int32_t ZRtp::activateTimer(int32_t tm) {
@@ -2606,7 +2856,16 @@ int32_t ZRtp::cancelTimer() {
 
 void ZRtp::setAuxSecret(uint8_t* data, uint32_t length) {
     if (length > 0) {
-        auxSecret = new uint8_t[length];
+        // Keep the storage of a previous aux secret if it is large enough
+        if (length > auxSecretSize) {
+            zrtpMemFree(auxSecret, auxSecretSize, ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+            auxSecret = (uint8_t*)zrtpMemAlloc(length, ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+            if (auxSecret == nullptr) {
+                auxSecretSize = auxSecretLength = 0;
+                return;
+            }
+            auxSecretSize = length;
+        }
         auxSecretLength = length;
         memcpy(auxSecret, data, length);
     }
@@ -2825,17 +3084,22 @@ bool ZRtp::sendSASRelayPacket(uint8_t* sh, std::string render) {
 
     uint8_t confMac[MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    uint8_t* hkey, *ekey;
+    uint8_t* hkey;
+    void* ecipher;
+
+    // No SASrelay before the Confirm keys are ready
+    if (zrtpCipherFuncs == nullptr)
+        return false;
 
     // If we are responder then the PBX used it's Initiator keys
     if (myRole == Responder) {
         hkey = hmacKeyR;
-        ekey = zrtpKeyR;
+        ecipher = zrtpCipherR;
         // TODO: check signature length in zrtpConfirm1 and if not zero copy Signature data
     }
     else {
         hkey = hmacKeyI;
-        ekey = zrtpKeyI;
+        ecipher = zrtpCipherI;
         // TODO: check signature length in zrtpConfirm2 and if not zero copy Signature data
     }
     // Prepare IV data that we will use during confirm packet encryption.
@@ -2845,7 +3109,7 @@ bool ZRtp::sendSASRelayPacket(uint8_t* sh, std::string render) {
     zrtpSasRelay.setSasAlgo((uint8_t*)render.c_str());
 
     uint32_t hmlen = (zrtpSasRelay.getLength() - (uint)9) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(ekey, cipher->getKeylen(), randomIV, (uint8_t*)zrtpSasRelay.getFiller(), hmlen);
+    zrtpCipherFuncs->encrypt(ecipher, randomIV, (uint8_t*)zrtpSasRelay.getFiller(), hmlen);
 
     // Use negotiated HMAC (hash)
     hmacFunction(hkey, hashLength, (unsigned char*)zrtpSasRelay.getFiller(), hmlen, confMac, &macLen);
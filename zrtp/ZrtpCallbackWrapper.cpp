@@ -82,7 +82,7 @@ void ZrtpCallbackWrapper::srtpSecretsOff (EnableSecurity part )
     c_callbacks->zrtp_srtpSecretsOff(zrtpCtx, (int32_t)part);
 }
 
-void ZrtpCallbackWrapper::srtpSecretsOn ( std::string c, std::string s, bool verified )
+void ZrtpCallbackWrapper::srtpSecretsOn ( const std::string& c, const std::string& s, bool verified )
 {
     char* cc = new char [c.size()+1];
     char* cs = new char [s.size()+1];
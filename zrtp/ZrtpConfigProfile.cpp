@@ -0,0 +1,79 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <mutex>
+#include <string.h>
+
+#include <libzrtpcpp/ZrtpConfigProfile.h>
+#include <libzrtpcpp/zrtpPacket.h>
+
+typedef std::map<std::string, std::shared_ptr<const ZrtpConfigProfile> > ProfileMap;
+
+// Function statics: applications may publish profiles during static
+// initialization.
+static std::mutex& profileLock() {
+    static std::mutex lock;
+    return lock;
+}
+
+static ProfileMap& profiles() {
+    static ProfileMap map;
+    return map;
+}
+
+ZrtpConfigProfile::ZrtpConfigProfile(const std::string& name, const ZrtpConfigure& config):
+        name(name), config(config), helloAlgosLength(0) {
+
+    // Same order as in the Hello packet, see ZrtpPacketHello::configureHello
+    static const AlgoTypes helloOrder[] = {HashAlgorithm, CipherAlgorithm, AuthLength, PubKeyAlgorithm, SasType};
+
+    memset(helloAlgos, 0, sizeof(helloAlgos));
+    for (size_t t = 0; t < sizeof(helloOrder) / sizeof(helloOrder[0]); t++) {
+        int32_t num = config.getNumConfiguredAlgos(helloOrder[t]);
+        for (int32_t i = 0; i < num; i++) {
+            memcpy(helloAlgos + helloAlgosLength, config.getAlgoAt(helloOrder[t], i).getName(), ZRTP_WORD_SIZE);
+            helloAlgosLength += ZRTP_WORD_SIZE;
+        }
+    }
+}
+
+std::shared_ptr<const ZrtpConfigProfile> ZrtpConfigProfile::compile(const std::string& name, const ZrtpConfigure& config) {
+    return std::shared_ptr<const ZrtpConfigProfile>(new ZrtpConfigProfile(name, config));
+}
+
+bool ZrtpConfigProfile::publish(const std::shared_ptr<const ZrtpConfigProfile>& profile) {
+    if (!profile || profile->name.empty())
+        return false;
+
+    std::lock_guard<std::mutex> lock(profileLock());
+    profiles()[profile->name] = profile;
+    return true;
+}
+
+std::shared_ptr<const ZrtpConfigProfile> ZrtpConfigProfile::find(const std::string& name) {
+    std::lock_guard<std::mutex> lock(profileLock());
+
+    ProfileMap::const_iterator it = profiles().find(name);
+    if (it == profiles().end())
+        return std::shared_ptr<const ZrtpConfigProfile>();
+    return it->second;
+}
+
+bool ZrtpConfigProfile::withdraw(const std::string& name) {
+    std::lock_guard<std::mutex> lock(profileLock());
+    return profiles().erase(name) != 0;
+}
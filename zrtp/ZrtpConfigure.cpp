@@ -18,16 +18,19 @@
  * Authors: Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
+#include <common/zrtpAlgorithms.h>
 #include <crypto/aesCFB.h>
+#if ZRTP_WITH_TWOFISH
 #include <crypto/twoCFB.h>
+#endif
 #include <libzrtpcpp/ZrtpConfigure.h>
 #include <libzrtpcpp/ZrtpTextData.h>
 
 AlgorithmEnum::AlgorithmEnum(const AlgoTypes type, const char* name, 
                              uint32_t klen, const char* ra, encrypt_t en,
-                             decrypt_t de, SrtpAlgorithms alId):
-    algoType(type) , algoName(name), keyLen(klen), readable(ra), encrypt(en),
-    decrypt(de), algoId(alId) {
+                             decrypt_t de, SrtpAlgorithms alId, const cipherContext_t* ctx):
+    algoType(type) , algoName(name), nameId(nameToId(name)), keyLen(klen), readable(ra), encrypt(en),
+    decrypt(de), algoId(alId), cipherContext(ctx) {
 }
 
 AlgorithmEnum::~AlgorithmEnum()
@@ -38,6 +41,16 @@ const char* AlgorithmEnum::getName() {
     return algoName.c_str(); 
 }
 
+uint32_t AlgorithmEnum::nameToId(const char* name) {
+    uint32_t id = 0;
+    size_t length = 0;
+
+    while (length < sizeof(id) && name[length] != '\0')
+        length++;
+    memcpy(&id, name, length);
+    return id;
+}
+
 const char* AlgorithmEnum::getReadable() {
     return readable.c_str();
 }
@@ -58,6 +71,10 @@ decrypt_t AlgorithmEnum::getDecrypt() {
     return decrypt;
 }
 
+const cipherContext_t* AlgorithmEnum::getCipherContext() {
+    return cipherContext;
+}
+
 AlgoTypes AlgorithmEnum::getAlgoType() { 
     return algoType; 
 }
@@ -92,10 +109,10 @@ void EnumBase::insert(const char* name) {
 }
 
 void EnumBase::insert(const char* name, uint32_t klen, const char* ra,
-                      encrypt_t enc, decrypt_t dec, SrtpAlgorithms alId) {
+                      encrypt_t enc, decrypt_t dec, SrtpAlgorithms alId, const cipherContext_t* ctx) {
     if (!name)
         return;
-    AlgorithmEnum* e = new AlgorithmEnum(algoType, name, klen, ra, enc, dec, alId);
+    AlgorithmEnum* e = new AlgorithmEnum(algoType, name, klen, ra, enc, dec, alId, ctx);
     algos.push_back(e);
 }
 
@@ -108,11 +125,15 @@ AlgoTypes EnumBase::getAlgoType() {
 }
 
 AlgorithmEnum& EnumBase::getByName(const char* name) {
+    return getById(AlgorithmEnum::nameToId(name));
+}
+
+AlgorithmEnum& EnumBase::getById(uint32_t id) {
     std::vector<AlgorithmEnum* >::iterator b = algos.begin();
     std::vector<AlgorithmEnum* >::iterator e = algos.end();
 
     for (; b != e; b++) {
-        if (strncmp((*b)->getName(), name, 4) == 0) {
+        if ((*b)->getNameId() == id) {
             return *(*b);
         }
     }
@@ -165,8 +186,10 @@ std::list<std::string>* EnumBase::getAllNames() {
 HashEnum::HashEnum() : EnumBase(HashAlgorithm) {
     insert(s256, 0, "SHA-256", NULL, NULL, None);
     insert(s384, 0, "SHA-384", NULL, NULL, None);
+#if ZRTP_WITH_SKEIN
     insert(skn2, 0, "Skein-256", NULL, NULL, None);
     insert(skn3, 0, "Skein-384", NULL, NULL, None);
+#endif
 }
 
 HashEnum::~HashEnum() {}
@@ -174,11 +197,23 @@ HashEnum::~HashEnum() {}
 /**
  * Set up the enumeration list for available symmetric cipher algorithms
  */
+static const cipherContext_t aesCfbContext = {
+    createAesCfbContext, setAesCfbContextKey, aesCfbEncryptCtx, aesCfbDecryptCtx, freeAesCfbContext
+};
+
+#if ZRTP_WITH_TWOFISH
+static const cipherContext_t twoCfbContext = {
+    createTwoCfbContext, setTwoCfbContextKey, twoCfbEncryptCtx, twoCfbDecryptCtx, freeTwoCfbContext
+};
+#endif
+
 SymCipherEnum::SymCipherEnum() : EnumBase(CipherAlgorithm) {
-    insert(aes3, 32, "AES-256", aesCfbEncrypt, aesCfbDecrypt, Aes);
-    insert(aes1, 16, "AES-128", aesCfbEncrypt, aesCfbDecrypt, Aes);
-    insert(two3, 32, "Twofish-256", twoCfbEncrypt, twoCfbDecrypt, TwoFish);
-    insert(two1, 16, "TwoFish-128", twoCfbEncrypt, twoCfbDecrypt, TwoFish);
+    insert(aes3, 32, "AES-256", aesCfbEncrypt, aesCfbDecrypt, Aes, &aesCfbContext);
+    insert(aes1, 16, "AES-128", aesCfbEncrypt, aesCfbDecrypt, Aes, &aesCfbContext);
+#if ZRTP_WITH_TWOFISH
+    insert(two3, 32, "Twofish-256", twoCfbEncrypt, twoCfbDecrypt, TwoFish, &twoCfbContext);
+    insert(two1, 16, "TwoFish-128", twoCfbEncrypt, twoCfbDecrypt, TwoFish, &twoCfbContext);
+#endif
 }
 
 SymCipherEnum::~SymCipherEnum() {}
@@ -187,12 +222,18 @@ SymCipherEnum::~SymCipherEnum() {}
  * Set up the enumeration list for available public key algorithms
  */
 PubKeyEnum::PubKeyEnum() : EnumBase(PubKeyAlgorithm) {
+#if ZRTP_WITH_DH
     insert(dh2k, 0, "DH-2048", NULL, NULL, None);
+#endif
     insert(ec25, 0, "NIST ECDH-256", NULL, NULL, None);
+#if ZRTP_WITH_DH
     insert(dh3k, 0, "DH-3072", NULL, NULL, None);
+#endif
+#if ZRTP_WITH_EC38
     insert(ec38, 0, "NIST ECDH-384", NULL, NULL, None);
+#endif
     insert(mult, 0, "Multi-stream",  NULL, NULL, None);
-#ifdef SUPPORT_NON_NIST
+#if ZRTP_WITH_NON_NIST
     insert(e255, 0, "ECDH-255", NULL, NULL, None);
     insert(e414, 0, "ECDH-414", NULL, NULL, None);
 #endif
@@ -218,8 +259,10 @@ SasTypeEnum::~SasTypeEnum() {}
 AuthLengthEnum::AuthLengthEnum() : EnumBase(AuthLength) {
     insert(hs32, 32, "HMAC-SHA1 32 bit", NULL, NULL, Sha1);
     insert(hs80, 80, "HMAC-SHA1 80 bit", NULL, NULL, Sha1);
+#if ZRTP_WITH_SKEIN
     insert(sk32, 32, "Skein-MAC 32 bit", NULL, NULL, Skein);
     insert(sk64, 64, "Skein-MAC 64 bit", NULL, NULL, Skein);
+#endif
 }
 
 AuthLengthEnum::~AuthLengthEnum() {}
@@ -237,7 +280,7 @@ AuthLengthEnum zrtpAuthLengths;
  * The public methods are mainly a facade to the private methods.
  */
 ZrtpConfigure::ZrtpConfigure(): enableTrustedMitM(false), enableSasSignature(false), enableParanoidMode(false),
-selectionPolicy(Standard){}
+enableFastStart(false), selectionPolicy(Standard){}
 
 ZrtpConfigure::~ZrtpConfigure() {}
 
@@ -273,7 +316,7 @@ void ZrtpConfigure::setMandatoryOnly() {
 
     addAlgo(CipherAlgorithm, zrtpSymCiphers.getByName(aes1));
 
-    addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(dh3k));
+    addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(mandatoryPubKey));
     addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(mult));
 
     addAlgo(SasType, zrtpSasTypes.getByName(b32));
@@ -301,7 +344,7 @@ int32_t ZrtpConfigure::addAlgoAt(AlgoTypes algoType, AlgorithmEnum& algo, int32_
     return addAlgoAt(getEnum(algoType), algo, index);
 }
 
-AlgorithmEnum& ZrtpConfigure::getAlgoAt(AlgoTypes algoType, int32_t index) {
+AlgorithmEnum& ZrtpConfigure::getAlgoAt(AlgoTypes algoType, int32_t index) const {
 
     return getAlgoAt(getEnum(algoType), index);
 }
@@ -311,17 +354,17 @@ int32_t ZrtpConfigure::removeAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
     return removeAlgo(getEnum(algoType), algo);
 }
 
-int32_t ZrtpConfigure::getNumConfiguredAlgos(AlgoTypes algoType) {
+int32_t ZrtpConfigure::getNumConfiguredAlgos(AlgoTypes algoType) const {
 
     return getNumConfiguredAlgos(getEnum(algoType));
 }
 
-bool ZrtpConfigure::containsAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
+bool ZrtpConfigure::containsAlgo(AlgoTypes algoType, AlgorithmEnum& algo) const {
 
     return containsAlgo(getEnum(algoType), algo);
 }
 
-void ZrtpConfigure::printConfiguredAlgos(AlgoTypes algoType) {
+void ZrtpConfigure::printConfiguredAlgos(AlgoTypes algoType) const {
 
     printConfiguredAlgos(getEnum(algoType));
 }
@@ -330,13 +373,13 @@ void ZrtpConfigure::printConfiguredAlgos(AlgoTypes algoType) {
  * The next methods are the private methods that implement the real
  * details.
  */
-AlgorithmEnum& ZrtpConfigure::getAlgoAt(std::vector<AlgorithmEnum* >& a, int32_t index) {
+AlgorithmEnum& ZrtpConfigure::getAlgoAt(const ZrtpVector<AlgorithmEnum* >& a, int32_t index) const {
 
     if (index >= (int)a.size())
         return invalidAlgo;
 
-    std::vector<AlgorithmEnum* >::iterator b = a.begin();
-    std::vector<AlgorithmEnum* >::iterator e = a.end();
+    ZrtpVector<AlgorithmEnum* >::const_iterator b = a.begin();
+    ZrtpVector<AlgorithmEnum* >::const_iterator e = a.end();
 
     for (int i = 0; b != e; ++b) {
         if (i == index) {
@@ -347,7 +390,7 @@ AlgorithmEnum& ZrtpConfigure::getAlgoAt(std::vector<AlgorithmEnum* >& a, int32_t
     return invalidAlgo;
 }
 
-int32_t ZrtpConfigure::addAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
+int32_t ZrtpConfigure::addAlgo(ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
     int size = (int)a.size();
     if (size >= maxNoOfAlgos)
         return -1;
@@ -362,7 +405,7 @@ int32_t ZrtpConfigure::addAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& a
     return (maxNoOfAlgos - (int)a.size());
 }
 
-int32_t ZrtpConfigure::addAlgoAt(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo, int32_t index) {
+int32_t ZrtpConfigure::addAlgoAt(ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo, int32_t index) {
     if (index >= maxNoOfAlgos)
         return -1;
 
@@ -377,8 +420,8 @@ int32_t ZrtpConfigure::addAlgoAt(std::vector<AlgorithmEnum* >& a, AlgorithmEnum&
         a.push_back(&algo);
         return maxNoOfAlgos - (int)a.size();
     }
-    std::vector<AlgorithmEnum* >::iterator b = a.begin();
-    std::vector<AlgorithmEnum* >::iterator e = a.end();
+    ZrtpVector<AlgorithmEnum* >::iterator b = a.begin();
+    ZrtpVector<AlgorithmEnum* >::iterator e = a.end();
 
     for (int i = 0; b != e; ++b) {
         if (i == index) {
@@ -390,13 +433,13 @@ int32_t ZrtpConfigure::addAlgoAt(std::vector<AlgorithmEnum* >& a, AlgorithmEnum&
     return (maxNoOfAlgos - (int)a.size());
 }
 
-int32_t ZrtpConfigure::removeAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
+int32_t ZrtpConfigure::removeAlgo(ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
 
     if ((int)a.size() == 0 || !algo.isValid())
         return maxNoOfAlgos;
 
-    std::vector<AlgorithmEnum* >::iterator b = a.begin();
-    std::vector<AlgorithmEnum* >::iterator e = a.end();
+    ZrtpVector<AlgorithmEnum* >::iterator b = a.begin();
+    ZrtpVector<AlgorithmEnum* >::iterator e = a.end();
 
     for (; b != e; ++b) {
         if (strcmp((*b)->getName(), algo.getName()) == 0) {
@@ -407,17 +450,17 @@ int32_t ZrtpConfigure::removeAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum
     return (maxNoOfAlgos - (int)a.size());
 }
 
-int32_t ZrtpConfigure::getNumConfiguredAlgos(std::vector<AlgorithmEnum* >& a) {
+int32_t ZrtpConfigure::getNumConfiguredAlgos(const ZrtpVector<AlgorithmEnum* >& a) const {
     return (int32_t)a.size();
 }
 
-bool ZrtpConfigure::containsAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
+bool ZrtpConfigure::containsAlgo(const ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo) const {
 
     if ((int)a.size() == 0 || !algo.isValid())
         return false;
 
-    std::vector<AlgorithmEnum* >::iterator b = a.begin();
-    std::vector<AlgorithmEnum* >::iterator e = a.end();
+    ZrtpVector<AlgorithmEnum* >::const_iterator b = a.begin();
+    ZrtpVector<AlgorithmEnum* >::const_iterator e = a.end();
 
     for (; b != e; ++b) {
         if (strcmp((*b)->getName(), algo.getName()) == 0) {
@@ -427,17 +470,22 @@ bool ZrtpConfigure::containsAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum&
     return false;
 }
 
-void ZrtpConfigure::printConfiguredAlgos(std::vector<AlgorithmEnum* >& a) {
+void ZrtpConfigure::printConfiguredAlgos(const ZrtpVector<AlgorithmEnum* >& a) const {
 
-    std::vector<AlgorithmEnum* >::iterator b = a.begin();
-    std::vector<AlgorithmEnum* >::iterator e = a.end();
+    ZrtpVector<AlgorithmEnum* >::const_iterator b = a.begin();
+    ZrtpVector<AlgorithmEnum* >::const_iterator e = a.end();
 
     for (; b != e; ++b) {
         printf("print configured: name: %s\n", (*b)->getName());
     }
 }
 
-std::vector<AlgorithmEnum* >& ZrtpConfigure::getEnum(AlgoTypes algoType) {
+ZrtpVector<AlgorithmEnum* >& ZrtpConfigure::getEnum(AlgoTypes algoType) {
+
+    return const_cast<ZrtpVector<AlgorithmEnum* >& >(static_cast<const ZrtpConfigure*>(this)->getEnum(algoType));
+}
+
+const ZrtpVector<AlgorithmEnum* >& ZrtpConfigure::getEnum(AlgoTypes algoType) const {
 
     switch(algoType) {
         case HashAlgorithm:
@@ -465,7 +513,7 @@ void ZrtpConfigure::setTrustedMitM(bool yesNo) {
     enableTrustedMitM = yesNo;
 }
 
-bool ZrtpConfigure::isTrustedMitM() {
+bool ZrtpConfigure::isTrustedMitM() const {
     return enableTrustedMitM;
 }
 
@@ -473,7 +521,7 @@ void ZrtpConfigure::setSasSignature(bool yesNo) {
     enableSasSignature = yesNo;
 }
 
-bool ZrtpConfigure::isSasSignature() {
+bool ZrtpConfigure::isSasSignature() const {
     return enableSasSignature;
 }
 
@@ -481,7 +529,7 @@ void ZrtpConfigure::setParanoidMode(bool yesNo) {
     enableParanoidMode = yesNo;
 }
 
-bool ZrtpConfigure::isParanoidMode() {
+bool ZrtpConfigure::isParanoidMode() const {
     return enableParanoidMode;
 }
 
@@ -489,10 +537,18 @@ void ZrtpConfigure::setDisclosureFlag(bool yesNo) {
     enableDisclosureFlag = yesNo;
 }
 
-bool ZrtpConfigure::isDisclosureFlag() {
+bool ZrtpConfigure::isDisclosureFlag() const {
     return enableDisclosureFlag;
 }
 
+void ZrtpConfigure::setFastStart(bool yesNo) {
+    enableFastStart = yesNo;
+}
+
+bool ZrtpConfigure::isFastStart() const {
+    return enableFastStart;
+}
+
 #if 0
 ZrtpConfigure config;
 
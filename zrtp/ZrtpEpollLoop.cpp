@@ -0,0 +1,115 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <libzrtpcpp/ZrtpEpollLoop.h>
+
+ZrtpEpollLoop::ZrtpEpollLoop(int epollFd): epollFd(epollFd), timerFd(-1), ownEpoll(false), timerHandler(this) {
+    if (this->epollFd < 0) {
+        this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        ownEpoll = true;
+    }
+    if (this->epollFd < 0)
+        return;
+
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd >= 0 && !addReader(timerFd, &timerHandler)) {
+        close(timerFd);
+        timerFd = -1;
+    }
+}
+
+ZrtpEpollLoop::~ZrtpEpollLoop() {
+    if (timerFd >= 0) {
+        if (!ownEpoll)
+            removeReader(timerFd);
+        close(timerFd);
+    }
+    if (ownEpoll && epollFd >= 0)
+        close(epollFd);
+}
+
+bool ZrtpEpollLoop::addReader(int fd, ZrtpIoHandler* handler) {
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = handler;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool ZrtpEpollLoop::removeReader(int fd) {
+    struct epoll_event event;       // kernels before 2.6.9 need a non-NULL event
+
+    memset(&event, 0, sizeof(event));
+    return epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, &event) == 0;
+}
+
+int32_t ZrtpEpollLoop::poll(int32_t maxWait) {
+    struct epoll_event events[32];
+
+    int32_t count = epoll_wait(epollFd, events, sizeof(events) / sizeof(events[0]), maxWait);
+    if (count < 0)
+        return errno == EINTR ? 0 : -1;
+
+    for (int32_t i = 0; i < count; i++)
+        dispatch(events[i]);
+    return count;
+}
+
+void ZrtpEpollLoop::dispatch(const struct epoll_event& event) {
+    ZrtpIoHandler* handler = static_cast<ZrtpIoHandler*>(event.data.ptr);
+    handler->ioReady(event.events);
+}
+
+void ZrtpEpollLoop::timerReady() {
+    uint64_t expirations;
+
+    // Drain the expiration count, the file descriptor stays readable otherwise
+    if (read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        return;
+    runTimers();
+}
+
+uint64_t ZrtpEpollLoop::now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void ZrtpEpollLoop::scheduleWakeup(int32_t time) {
+    struct itimerspec spec;
+
+    if (timerFd < 0)
+        return;
+
+    // An all zero it_value disarms the timer, thus use 1ns for an immediate wakeup
+    memset(&spec, 0, sizeof(spec));
+    if (time > 0) {
+        spec.it_value.tv_sec = time / 1000;
+        spec.it_value.tv_nsec = (time % 1000) * 1000000L;
+    }
+    else if (time == 0) {
+        spec.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timerFd, 0, &spec, NULL);
+}
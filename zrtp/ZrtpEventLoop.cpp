@@ -0,0 +1,177 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libzrtpcpp/ZrtpEventLoop.h>
+#include <libzrtpcpp/ZRtp.h>
+
+ZrtpLoopTimer::ZrtpLoopTimer(ZrtpEventLoop* loop): loop(loop), engine(NULL), deadline(0), heapIndex(-1) {
+    loop->addTimer();
+}
+
+ZrtpLoopTimer::~ZrtpLoopTimer() {
+    cancel();
+    loop->removeTimer();
+}
+
+int32_t ZrtpLoopTimer::activate(int32_t time) {
+    loop->startTimer(this, time);
+    return 1;
+}
+
+int32_t ZrtpLoopTimer::cancel() {
+    if (heapIndex >= 0)
+        loop->stopTimer(this);
+    return 1;
+}
+
+void ZrtpLoopTimer::timeout() {
+    if (engine != NULL)
+        engine->processTimeout();
+}
+
+ZrtpEventLoop::ZrtpEventLoop(): numberOfTimers(0), wakeupAt(0), runNow(0), running(false) {
+}
+
+ZrtpEventLoop::~ZrtpEventLoop() {
+    for (size_t i = 0; i < heap.size(); i++)
+        heap[i]->heapIndex = -1;
+}
+
+uint64_t ZrtpEventLoop::now() {
+    return zrtpGetTickCount();
+}
+
+// Grow the heap when a timer is created, startTimer() then never allocates
+void ZrtpEventLoop::addTimer() {
+    if (++numberOfTimers > heap.capacity())
+        heap.reserve(numberOfTimers * 2);
+}
+
+void ZrtpEventLoop::startTimer(ZrtpLoopTimer* timer, int32_t time) {
+    uint64_t deadline = now() + (time > 0 ? time : 0);
+
+    // A timer that a timeout handler arms again must not run in the same
+    // runTimers() call, otherwise a zero timeout loops forever.
+    if (running && deadline <= runNow)
+        deadline = runNow + 1;
+
+    timer->deadline = deadline;
+    if (timer->heapIndex < 0) {
+        heap.push_back(timer);
+        timer->heapIndex = static_cast<int32_t>(heap.size() - 1);
+        siftUp(timer->heapIndex);
+    }
+    else {
+        siftUp(timer->heapIndex);
+        siftDown(timer->heapIndex);
+    }
+
+    // runTimers() schedules the next wakeup when it is done
+    if (!running && (wakeupAt == 0 || heap[0]->deadline < wakeupAt)) {
+        wakeupAt = heap[0]->deadline;
+        scheduleWakeup(nextTimeout());
+    }
+}
+
+void ZrtpEventLoop::stopTimer(ZrtpLoopTimer* timer) {
+    removeAt(timer->heapIndex);
+
+    // Keep a wakeup for a later timer, an early wakeup does no harm and is
+    // cheaper than rescheduling the native timer on every cancel.
+    if (!running && heap.empty() && wakeupAt != 0) {
+        wakeupAt = 0;
+        scheduleWakeup(-1);
+    }
+}
+
+int32_t ZrtpEventLoop::runTimers() {
+    int32_t count = 0;
+
+    running = true;
+    runNow = now();
+    while (!heap.empty() && heap[0]->deadline <= runNow) {
+        ZrtpLoopTimer* timer = heap[0];
+        removeAt(0);
+        count++;
+        timer->timeout();
+    }
+    running = false;
+
+    if (heap.empty()) {
+        if (wakeupAt != 0) {
+            wakeupAt = 0;
+            scheduleWakeup(-1);
+        }
+    }
+    else {
+        wakeupAt = heap[0]->deadline;
+        scheduleWakeup(nextTimeout());
+    }
+    return count;
+}
+
+int32_t ZrtpEventLoop::nextTimeout() {
+    if (heap.empty())
+        return -1;
+
+    uint64_t current = now();
+    uint64_t deadline = heap[0]->deadline;
+    return deadline > current ? static_cast<int32_t>(deadline - current) : 0;
+}
+
+void ZrtpEventLoop::removeAt(int32_t index) {
+    ZrtpLoopTimer* timer = heap[index];
+    ZrtpLoopTimer* last = heap.back();
+
+    heap.pop_back();
+    timer->heapIndex = -1;
+    if (last != timer) {
+        setAt(index, last);
+        siftUp(index);
+        siftDown(last->heapIndex);
+    }
+}
+
+void ZrtpEventLoop::siftUp(int32_t index) {
+    ZrtpLoopTimer* timer = heap[index];
+
+    while (index > 0) {
+        int32_t parent = (index - 1) / 2;
+        if (heap[parent]->deadline <= timer->deadline)
+            break;
+        setAt(index, heap[parent]);
+        index = parent;
+    }
+    setAt(index, timer);
+}
+
+void ZrtpEventLoop::siftDown(int32_t index) {
+    ZrtpLoopTimer* timer = heap[index];
+    int32_t size = static_cast<int32_t>(heap.size());
+
+    while (true) {
+        int32_t child = 2 * index + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && heap[child + 1]->deadline < heap[child]->deadline)
+            child++;
+        if (timer->deadline <= heap[child]->deadline)
+            break;
+        setAt(index, heap[child]);
+        index = child;
+    }
+    setAt(index, timer);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libzrtpcpp/ZrtpPacketBase.h>
+
+namespace {
+// The message types as 64 bit words, index is the message code - 1
+struct MessageIds {
+    uint64_t ids[MsgRelayAck];
+
+    MessageIds() {
+        const char* const types[MsgRelayAck] = {
+            HelloMsg, HelloAckMsg, CommitMsg, DHPart1Msg, DHPart2Msg, Confirm1Msg, Confirm2Msg, Conf2AckMsg,
+            ErrorMsg, ErrorAckMsg, GoClearMsg, ClearAckMsg, PingMsg, PingAckMsg, SasRelayMsg, RelayAckMsg
+        };
+        for (int32_t i = 0; i < MsgRelayAck; i++)
+            memcpy(&ids[i], types[i], sizeof(uint64_t));
+    }
+};
+}
+
+ZrtpMessageCode ZrtpPacketBase::getMessageCode(const uint8_t* type) {
+    static const MessageIds messageIds;
+    uint64_t id;
+
+    memcpy(&id, type, sizeof(id));
+    for (int32_t i = 0; i < MsgRelayAck; i++) {
+        if (messageIds.ids[i] == id)
+            return static_cast<ZrtpMessageCode>(i + 1);
+    }
+    return MsgUnknown;
+}
@@ -23,7 +23,8 @@
 ZrtpPacketClearAck::ZrtpPacketClearAck() {
     DEBUGOUT((fprintf(stdout, "Creating ClearAck packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
 
     setZrtpId();
     setLength((sizeof(ClearAckPacket_t) / ZRTP_WORD_SIZE) - 1);
@@ -23,8 +23,9 @@
 ZrtpPacketCommit::ZrtpPacketCommit() {
     DEBUGOUT((fprintf(stdout, "Creating commit packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
-    commitHeader = &data.commit;
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
+    commitHeader = &frame.message.commit;
 
     setZrtpId();
     setLength((sizeof (CommitPacket_t) / ZRTP_WORD_SIZE) - 1);
@@ -32,7 +33,7 @@ ZrtpPacketCommit::ZrtpPacketCommit() {
 }
 
 void ZrtpPacketCommit::setNonce(uint8_t* text) {
-    memcpy(commitHeader->hvi, text, sizeof(data.commit.hvi)-4*ZRTP_WORD_SIZE);
+    memcpy(commitHeader->hvi, text, sizeof(frame.message.commit.hvi)-4*ZRTP_WORD_SIZE);
     uint16_t len = getLength();
     len -= 4;
     setLength(len);
@@ -23,7 +23,8 @@
 ZrtpPacketConf2Ack::ZrtpPacketConf2Ack() {
     DEBUGOUT((fprintf(stdout, "Creating Conf2Ack packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
 
     setZrtpId();
     setLength((sizeof (Conf2AckPacket_t) / ZRTP_WORD_SIZE) - 1);
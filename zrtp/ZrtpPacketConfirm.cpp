@@ -33,10 +33,11 @@ ZrtpPacketConfirm::ZrtpPacketConfirm(uint32_t sl) {
 }
 
 void ZrtpPacketConfirm::initialize() {
-    void* allocated = &data;
-    memset(allocated, 0, sizeof(data));
+    void* allocated = &frame.message;
+    memset(allocated, 0, sizeof(frame.message));
 
     zrtpHeader = (zrtpPacketHeader_t *)&((ConfirmPacket_t *)allocated)->hdr;	// the standard header
+    frameBase = frame.headroom;
     confirmHeader = (Confirm_t *)&((ConfirmPacket_t *)allocated)->confirm;
 
     setZrtpId();
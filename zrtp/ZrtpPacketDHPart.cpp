@@ -33,10 +33,11 @@ ZrtpPacketDHPart::ZrtpPacketDHPart(const char* pkt) {
 
 void ZrtpPacketDHPart::initialize() {
 
-    void* allocated = &data;
-    memset(allocated, 0, sizeof(data));
+    void* allocated = &frame.message;
+    memset(allocated, 0, sizeof(frame.message));
 
     zrtpHeader = &((DHPartPacket_t *)allocated)->hdr; // the standard header
+    frameBase = frame.headroom;
     DHPartHeader = &((DHPartPacket_t *)allocated)->dhPart;
     pv = ((uint8_t*)allocated) + sizeof(DHPartPacket_t);    // point to the public key value
 
@@ -24,8 +24,9 @@
 ZrtpPacketError::ZrtpPacketError() {
     DEBUGOUT((fprintf(stdout, "Creating Error packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
-    errorHeader = &data.error;
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
+    errorHeader = &frame.message.error;
 
     setZrtpId();
     setLength((sizeof(ErrorPacket_t) / ZRTP_WORD_SIZE) - 1);
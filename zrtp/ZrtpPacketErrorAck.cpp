@@ -23,7 +23,8 @@
 ZrtpPacketErrorAck::ZrtpPacketErrorAck() {
     DEBUGOUT((fprintf(stdout, "Creating ErrorAck packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
 
     setZrtpId();
     setLength((sizeof (ErrorAckPacket_t) / ZRTP_WORD_SIZE) - 1);
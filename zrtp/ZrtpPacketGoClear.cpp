@@ -24,8 +24,9 @@
 ZrtpPacketGoClear::ZrtpPacketGoClear() {
     DEBUGOUT((fprintf(stdout, "Creating GoClear packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
-    clearHeader = &data.goClear;
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
+    clearHeader = &frame.message.goClear;
 
     setZrtpId();
     setLength((sizeof(GoClearPacket_t) / ZRTP_WORD_SIZE) - 1);
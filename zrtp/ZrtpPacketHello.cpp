@@ -26,7 +26,7 @@ ZrtpPacketHello::ZrtpPacketHello() {
     DEBUGOUT((fprintf(stdout, "Creating Hello packet without data\n")));
 }
 
-void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
+void ZrtpPacketHello::configureHello(const ZrtpConfigure* config) {
     // The NumSupported* data is in ZrtpTextData.h 
     nHash = config->getNumConfiguredAlgos(HashAlgorithm);
     nCipher = config->getNumConfiguredAlgos(CipherAlgorithm);
@@ -34,6 +34,52 @@ void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
     nSas = config->getNumConfiguredAlgos(SasType);
     nAuth = config->getNumConfiguredAlgos(AuthLength);
 
+    setupHello();
+
+    for (int32_t i = 0; i < nHash; i++) {
+        AlgorithmEnum& hash = config->getAlgoAt(HashAlgorithm, i);
+        setHashType(i, (int8_t*)hash.getName());
+    }
+
+    for (int32_t i = 0; i < nCipher; i++) {
+        AlgorithmEnum& cipher = config->getAlgoAt(CipherAlgorithm, i);
+        setCipherType(i, (int8_t*)cipher.getName());
+    }
+
+    for (int32_t i = 0; i < nAuth; i++) {
+        AlgorithmEnum& length = config->getAlgoAt(AuthLength, i);
+        setAuthLen(i, (int8_t*)length.getName());
+    }
+
+    for (int32_t i = 0; i < nPubkey; i++) {
+        AlgorithmEnum& pubKey = config->getAlgoAt(PubKeyAlgorithm, i);
+        setPubKeyType(i, (int8_t*)pubKey.getName());
+    }
+
+    for (int32_t i = 0; i < nSas; i++) {
+        AlgorithmEnum& sas = config->getAlgoAt(SasType, i);
+        setSasType(i, (int8_t*)sas.getName());
+    }
+}
+
+void ZrtpPacketHello::configureHello(const ZrtpConfigProfile* profile) {
+    const ZrtpConfigure& config = profile->getConfigure();
+
+    nHash = config.getNumConfiguredAlgos(HashAlgorithm);
+    nCipher = config.getNumConfiguredAlgos(CipherAlgorithm);
+    nPubkey = config.getNumConfiguredAlgos(PubKeyAlgorithm);
+    nSas = config.getNumConfiguredAlgos(SasType);
+    nAuth = config.getNumConfiguredAlgos(AuthLength);
+
+    setupHello();
+
+    // The profile holds the names in the order of the Hello packet
+    int32_t length;
+    const uint8_t* algos = profile->getHelloAlgos(&length);
+    memcpy(((uint8_t*)helloHeader)+oHash, algos, length);
+}
+
+void ZrtpPacketHello::setupHello() {
     // length is fixed Header plus HMAC size (2*ZRTP_WORD_SIZE)
     int32_t length = sizeof(HelloPacket_t) + (2 * ZRTP_WORD_SIZE);
     length += nHash * ZRTP_WORD_SIZE;
@@ -50,10 +96,11 @@ void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
     oSas = oPubkey + (nPubkey * ZRTP_WORD_SIZE);
     oHmac = oSas + (nSas * ZRTP_WORD_SIZE);         // offset to HMAC
 
-    void* allocated = &data;
-    memset(allocated, 0, sizeof(data));
+    void* allocated = &frame.message;
+    memset(allocated, 0, sizeof(frame.message));
 
     zrtpHeader = (zrtpPacketHeader_t *)&((HelloPacket_t *)allocated)->hdr;	// the standard header
+    frameBase = frame.headroom;
     helloHeader = (Hello_t *)&((HelloPacket_t *)allocated)->hello;
 
     setZrtpId();
@@ -63,34 +110,10 @@ void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
     setMessageType((uint8_t*)HelloMsg);
 
     uint32_t lenField = nHash << 16;
-    for (int32_t i = 0; i < nHash; i++) {
-        AlgorithmEnum& hash = config->getAlgoAt(HashAlgorithm, i);
-        setHashType(i, (int8_t*)hash.getName());
-    }
-
     lenField |= nCipher << 12;
-    for (int32_t i = 0; i < nCipher; i++) {
-        AlgorithmEnum& cipher = config->getAlgoAt(CipherAlgorithm, i);
-        setCipherType(i, (int8_t*)cipher.getName());
-    }
-
     lenField |= nAuth << 8;
-    for (int32_t i = 0; i < nAuth; i++) {
-        AlgorithmEnum& length = config->getAlgoAt(AuthLength, i);
-        setAuthLen(i, (int8_t*)length.getName());
-    }
-
     lenField |= nPubkey << 4;
-    for (int32_t i = 0; i < nPubkey; i++) {
-        AlgorithmEnum& pubKey = config->getAlgoAt(PubKeyAlgorithm, i);
-        setPubKeyType(i, (int8_t*)pubKey.getName());
-    }
-
     lenField |= nSas;
-    for (int32_t i = 0; i < nSas; i++) {
-        AlgorithmEnum& sas = config->getAlgoAt(SasType, i);
-        setSasType(i, (int8_t*)sas.getName());
-    }
     *((uint32_t*)&helloHeader->flags) = zrtpHtonl(lenField);
 }
 
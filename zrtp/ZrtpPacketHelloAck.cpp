@@ -23,7 +23,8 @@
 ZrtpPacketHelloAck::ZrtpPacketHelloAck() {
     DEBUGOUT((fprintf(stdout, "Creating HelloAck packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
 
     setZrtpId();
     setLength((sizeof(HelloAckPacket_t) / ZRTP_WORD_SIZE) - 1);
@@ -23,8 +23,9 @@
 ZrtpPacketPing::ZrtpPacketPing() {
     DEBUGOUT((fprintf(stdout, "Creating Ping packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
-    pingHeader = &data.ping;
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
+    pingHeader = &frame.message.ping;
 
     setZrtpId();
     setLength((sizeof(PingPacket_t) / ZRTP_WORD_SIZE) - 1);
@@ -23,8 +23,9 @@
 ZrtpPacketPingAck::ZrtpPacketPingAck() {
     DEBUGOUT((fprintf(stdout, "Creating PingAck packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
-    pingAckHeader = &data.pingAck;
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
+    pingAckHeader = &frame.message.pingAck;
 
     setZrtpId();
     setLength((sizeof(PingAckPacket_t) / ZRTP_WORD_SIZE) - 1);
@@ -23,7 +23,8 @@
 ZrtpPacketRelayAck::ZrtpPacketRelayAck() {
     DEBUGOUT((fprintf(stdout, "Creating RelayAck packet without data\n")));
 
-    zrtpHeader = &data.hdr;	// the standard header
+    zrtpHeader = &frame.message.hdr;	// the standard header
+    frameBase = frame.headroom;
 
     setZrtpId();
     setLength((sizeof (RelayAckPacket_t) / ZRTP_WORD_SIZE) - 1);
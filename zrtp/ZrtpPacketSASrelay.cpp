@@ -33,10 +33,11 @@ ZrtpPacketSASrelay::ZrtpPacketSASrelay(uint32_t sl) {
 }
 
 void ZrtpPacketSASrelay::initialize() {
-    void* allocated = &data;
-    memset(allocated, 0, sizeof(data));
+    void* allocated = &frame.message;
+    memset(allocated, 0, sizeof(frame.message));
 
     zrtpHeader = (zrtpPacketHeader_t *)&((SASrelayPacket_t *)allocated)->hdr;	// the standard header
+    frameBase = frame.headroom;
     sasRelayHeader = (SASrelay_t *)&((SASrelayPacket_t *)allocated)->sasrelay;
 
     setZrtpId();
@@ -417,8 +417,8 @@ static int b64Decode(const char *b64Data, int32_t b64length, uint8_t *binData, i
 
 void* createSha384HmacContext(const uint8_t* key, uint64_t keyLength);
 void freeSha384HmacContext(void* ctx);
-void hmacSha384Ctx(void* ctx, const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
+void hmacSha384Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data,
+                   const ZrtpVector<uint64_t>& dataLength,
                    uint8_t* mac, uint32_t* macLength );
 
 static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen, int32_t L, uint32_t hashLen, uint8_t* outbuffer)
@@ -427,8 +427,8 @@ static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen
     uint8_t *T;
     void* hmacCtx;
 
-    std::vector<const uint8_t*>data;
-    std::vector<uint64_t> dataLen;
+    ZrtpVector<const uint8_t*>data;
+    ZrtpVector<uint64_t> dataLen;
 
     uint8_t counter;
     uint32_t macLength;
@@ -439,12 +439,14 @@ static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen
     n = (L + (hashLen-1)) / hashLen;
 
     // T points to buffer that holds concatenated T(1) || T(2) || ... T(N))
-    T = reinterpret_cast<uint8_t*>(malloc(n * hashLen));
+    T = reinterpret_cast<uint8_t*>(zrtpMemAlloc(n * hashLen, ZRTP_MEM_BUFFER | ZRTP_MEM_SECRET));
+    if (T == NULL)
+        return -1;
 
     if (hashLen == 384/8)
         hmacCtx = createSha384HmacContext(prk, prkLen);
     else {
-        free(T);
+        zrtpMemFree(T, n * hashLen, ZRTP_MEM_BUFFER | ZRTP_MEM_SECRET);
         return -1;
     }
 
@@ -470,7 +472,7 @@ static int expand(uint8_t* prk, uint32_t prkLen, uint8_t* info, uint32_t infoLen
     }
     freeSha384HmacContext(hmacCtx);
     memcpy(outbuffer, T, L);
-    free(T);
+    zrtpMemFree(T, n * hashLen, ZRTP_MEM_BUFFER | ZRTP_MEM_SECRET);
     return 0;
 }
 
@@ -20,7 +20,6 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <ctype.h>
 
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
@@ -45,7 +44,7 @@ state_t states[numberOfStates] = {
 };
 
 
-ZrtpStateClass::ZrtpStateClass(ZRtp *p) : parent(p), commitPkt(NULL), t1Resend(20), t1ResendExtend(60), t2Resend(10),
+ZrtpStateClass::ZrtpStateClass(ZRtp *p) : parent(p), msgCode(MsgUnknown), t1Resend(20), t1ResendExtend(60), t2Resend(10),
                                           multiStream(false), secSubstate(Normal), sentVersion(0) {
 
     engine = new ZrtpStates(states, numberOfStates, Initial);
@@ -79,7 +78,6 @@ ZrtpStateClass::~ZrtpStateClass(void) {
 
 void ZrtpStateClass::processEvent(Event *ev) {
 
-    char *msg, first, middle, last;
     uint8_t *pkt;
 
     parent->synchEnter();
@@ -87,10 +85,23 @@ void ZrtpStateClass::processEvent(Event *ev) {
     event = ev;
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-        first = tolower(*msg);
-        middle = tolower(*(msg+4));
-        last = tolower(*(msg+7));
+
+        // Drop short packets, packets without the ZRTP id and unknown messages
+        // before any other work. The length includes the 12 byte fixed header
+        // and the CRC.
+        if (ev->length < 12 + sizeof(zrtpPacketHeader_t) + sizeof(uint32_t) ||
+            zrtpNtohs(*(uint16_t*)pkt) != zrtpId) {
+            parent->synchLeave();
+            return;
+        }
+        msgCode = ZrtpPacketBase::getMessageCode(pkt + 4);
+        if (msgCode == MsgUnknown) {
+            parent->synchLeave();
+            return;
+        }
+
+        if (ZrtpTrace::isActive())
+            parent->traceEvent(TracePacketRecv, static_cast<uint8_t>(msgCode), 0, static_cast<uint16_t>(ev->length));
 
         // Sanity check of packet size for all states except WaitErrorAck.
         if (!inState(WaitErrorAck)) {
@@ -107,7 +118,7 @@ void ZrtpStateClass::processEvent(Event *ev) {
         }
 
         // Check if this is an Error packet.
-        if (first == 'e' && middle =='r' && last == ' ') {
+        if (msgCode == MsgError) {
             /*
              * Process a received Error packet.
              *
@@ -122,7 +133,7 @@ void ZrtpStateClass::processEvent(Event *ev) {
             parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(eapkt));
             event->type = ErrorPkt;
         }
-        else if (first == 'p' && middle == ' ' && last == ' ') {
+        else if (msgCode == MsgPing) {
             ZrtpPacketPing ppkt(pkt);
             ZrtpPacketPingAck* ppktAck = parent->preparePingAck(&ppkt);
             if (ppktAck != NULL) {          // ACK only to valid PING packet, otherwise ignore it
@@ -131,10 +142,10 @@ void ZrtpStateClass::processEvent(Event *ev) {
             parent->synchLeave();
             return;
         }
-        else if (first == 's' && last == 'y') {
+        else if (msgCode == MsgSasRelay) {
             uint32_t errorCode = 0;
-            ZrtpPacketSASrelay* srly = new ZrtpPacketSASrelay(pkt);
-            ZrtpPacketRelayAck* rapkt = parent->prepareRelayAck(srly, &errorCode);
+            ZrtpPacketSASrelay srly(pkt);
+            ZrtpPacketRelayAck* rapkt = parent->prepareRelayAck(&srly, &errorCode);
             parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(rapkt));
             parent->synchLeave();
             return;
@@ -219,7 +230,6 @@ void ZrtpStateClass::evDetect(void) {
 
     DEBUGOUT((cout << "Checking for match in Detect.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
@@ -229,10 +239,7 @@ void ZrtpStateClass::evDetect(void) {
      */
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
         /*
          * HelloAck:
          * - our peer acknowledged our Hello packet, we have not seen the peer's Hello yet
@@ -241,7 +248,7 @@ void ZrtpStateClass::evDetect(void) {
          * 
          * When we receive an HelloAck this also means that our partner accepted our protocol version.
          */
-        if (first == 'h' && last =='k') {
+        if (msgCode == MsgHelloAck) {
             cancelTimer();
             sentPacket = NULL;
             nextState(AckDetected);
@@ -258,7 +265,7 @@ void ZrtpStateClass::evDetect(void) {
          *   peer acknowledges this
          * - Don't clear sentPacket, points to Hello
          */
-        if (first == 'h' && last ==' ') {
+        if (msgCode == MsgHello) {
             ZrtpPacketHello hpkt(pkt);
 
             cancelTimer();
@@ -317,12 +324,12 @@ void ZrtpStateClass::evDetect(void) {
                 parent->zrtpNegotiationFailed(Severe, SevereCannotSend);
                 return;
             }
-            // Use peer's Hello packet to create my commit packet, store it 
-            // for possible later usage in state AckSent
-            commitPkt = parent->prepareCommit(&hpkt, &errorCode);
+            // Check peer's Hello packet and start to read its cache record,
+            // state AckSent builds my Commit packet if the peer sends a HelloAck
+            bool accepted = parent->acceptPeerHello(&hpkt, &errorCode);
 
             nextState(AckSent);
-            if (commitPkt == NULL) {
+            if (!accepted) {
                 sendErrorPacket(errorCode);    // switches to Error state
                 return;
             }
@@ -342,7 +349,6 @@ void ZrtpStateClass::evDetect(void) {
         retryCounters[HelloRetry]++;
 
         if (nextTimer(&T1) <= 0) {
-            commitPkt = NULL;
             parent->zrtpNotSuppOther();
             nextState(Detect);
         }
@@ -387,7 +393,7 @@ void ZrtpStateClass::evDetect(void) {
  *
  * When entering this transition function:
  * - The instance variabe sentPacket contains own Hello packet
- * - The instance variabe commitPkt points to prepared Commit packet 
+ * - The peer's Hello is accepted, parent->finishCommit() builds the Commit
  * - Timer T1 is active
  *
  * Possible events in this state are:
@@ -405,7 +411,6 @@ void ZrtpStateClass::evAckSent(void) {
 
     DEBUGOUT((cout << "Checking for match in AckSent.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
@@ -415,10 +420,6 @@ void ZrtpStateClass::evAckSent(void) {
      */
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
 
         /*
          * HelloAck:
@@ -429,13 +430,12 @@ void ZrtpStateClass::evAckSent(void) {
          * - send own Commit message
          * - switch state to CommitSent, start Commit timer, assume Initiator
          */
-        if (first == 'h' && last =='k') {
+        if (msgCode == MsgHelloAck) {
             cancelTimer();
 
             // remember packet for easy resend in case timer triggers
             // Timer trigger received in new state CommitSend
-            sentPacket = static_cast<ZrtpPacketBase *>(commitPkt);
-            commitPkt = NULL;                    // now stored in sentPacket
+            sentPacket = static_cast<ZrtpPacketBase *>(parent->finishCommit());
             nextState(CommitSent);
             if (!parent->sendPacketZRTP(sentPacket)) {
                 sendFailed();             // returns to state Initial
@@ -458,7 +458,7 @@ void ZrtpStateClass::evAckSent(void) {
          * timeout sends the following Hello.
          */
 
-        if (first == 'h' && last ==' ') {
+        if (msgCode == MsgHello) {
             ZrtpPacketHelloAck* helloAck = parent->prepareHelloAck();
 
             if (!parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(helloAck))) {
@@ -476,7 +476,7 @@ void ZrtpStateClass::evAckSent(void) {
          * - switch to state WaitDHPart2 and wait for peer's DHPart2
          * - don't start timer, we are responder
          */
-        if (first == 'c' && last == ' ') {
+        if (msgCode == MsgCommit) {
             cancelTimer();
             ZrtpPacketCommit cpkt(pkt);
 
@@ -490,7 +490,6 @@ void ZrtpStateClass::evAckSent(void) {
                     }
                     return;
                 }
-                commitPkt = NULL;
                 sentPacket = static_cast<ZrtpPacketBase *>(dhPart1);
                 nextState(WaitDHPart2);
             }
@@ -527,7 +526,6 @@ void ZrtpStateClass::evAckSent(void) {
 
         if (nextTimer(&T1) <= 0) {
             parent->zrtpNotSuppOther();
-            commitPkt = NULL;
             // Stay in state Detect to be prepared get an hello from
             // other peer any time later
             nextState(Detect);
@@ -537,7 +535,6 @@ void ZrtpStateClass::evAckSent(void) {
         if (event->type != ZrtpClose) {
             parent->zrtpNegotiationFailed(Severe, SevereProtocolError);
         }
-        commitPkt = NULL;
         sentPacket = NULL;
         nextState(Initial);
     }
@@ -558,59 +555,23 @@ void ZrtpStateClass::evAckSent(void) {
  * Hello: we have to choices
  *  1) we can acknowledge the peer's Hello with a HelloAck
  *  2) we can acknowledge the peer's Hello with a Commit
- *  Both choices are implemented and may be enabled by setting a compile
- *  time #if (see code below). Currently we use choice 1) here because
- *  it's more aligned to the ZRTP specification
+ *  Both choices are implemented. We use choice 1) by default because
+ *  it's more aligned to the ZRTP specification. Choice 2) saves a round
+ *  trip, the application enables it with ZrtpConfigure::setFastStart().
+ *  The peer is in state AckSent and accepts our Commit as implicit HelloAck.
  */
 void ZrtpStateClass::evAckDetected(void) {
 
     DEBUGOUT((cout << "Checking for match in AckDetected.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
-#if 1
-        /*
-         * Implementation for choice 1)
-         * Hello:
-         * - Acknowledge peer's Hello, sending HelloACK (F4)
-         * - switch to state WaitCommit, wait for peer's Commit
-         * - we are going to be in the Responder role
-         */
-
-        if (first == 'h' && last ==' ') {
-            // Parse Hello packet and build an own Commit packet even if the
-            // Commit is not send to the peer. We need to do this to check the
-            // Hello packet and prepare the shared secret stuff.
-            ZrtpPacketHello hpkt(pkt);
-            ZrtpPacketCommit* commit = parent->prepareCommit(&hpkt, &errorCode);
 
-            // Something went wrong during processing of the Hello packet, for
-            // example wrong version, duplicate ZID.
-            if (commit == NULL) {
-                sendErrorPacket(errorCode);
-                return;
-            }
-            ZrtpPacketHelloAck *helloAck = parent->prepareHelloAck();
-            nextState(WaitCommit);
-
-            // remember packet for easy resend
-            sentPacket = static_cast<ZrtpPacketBase *>(helloAck);
-            if (!parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(helloAck))) {
-                sendFailed();
-            }
-        }
-#else
         /*
-         * Implementation for choice 2)
+         * Implementation for choice 2), only if fast start is enabled
          * Hello:
          * - Acknowledge peer's Hello by sending Commit (F5)
          *   instead of HelloAck (F4)
@@ -618,7 +579,7 @@ void ZrtpStateClass::evAckDetected(void) {
          * - Initiator role, thus start timer T2 to monitor timeout for Commit
          */
 
-        if (first == 'h' && last == ' ') {
+        if (msgCode == MsgHello && parent->fastStart) {
             // Parse peer's packet data into a Hello packet
             ZrtpPacketHello hpkt(pkt);
             ZrtpPacketCommit* commit = parent->prepareCommit(&hpkt, &errorCode);
@@ -639,8 +600,37 @@ void ZrtpStateClass::evAckDetected(void) {
             if (startTimer(&T2) <= 0) {
                 timerFailed(SevereNoTimer);
             }
+            return;
+        }
+        /*
+         * Implementation for choice 1)
+         * Hello:
+         * - Acknowledge peer's Hello, sending HelloACK (F4)
+         * - switch to state WaitCommit, wait for peer's Commit
+         * - we are going to be in the Responder role
+         */
+
+        if (msgCode == MsgHello) {
+            // Parse and check the Hello packet, prepare the DH key and start
+            // to read the peer's cache record. We do not send a Commit, the
+            // record is used when the peer's Commit arrives.
+            ZrtpPacketHello hpkt(pkt);
+
+            // Something went wrong during processing of the Hello packet, for
+            // example wrong version, duplicate ZID.
+            if (!parent->acceptPeerHello(&hpkt, &errorCode)) {
+                sendErrorPacket(errorCode);
+                return;
+            }
+            ZrtpPacketHelloAck *helloAck = parent->prepareHelloAck();
+            nextState(WaitCommit);
+
+            // remember packet for easy resend
+            sentPacket = static_cast<ZrtpPacketBase *>(helloAck);
+            if (!parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(helloAck))) {
+                sendFailed();
+            }
         }
-#endif
     }
     else {  // unknown Event type for this state (covers Error and ZrtpClose)
         if (event->type != ZrtpClose) {
@@ -668,22 +658,18 @@ void ZrtpStateClass::evWaitCommit(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitCommit.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
         /*
          * Hello:
          * - resend HelloAck
          * - stay in WaitCommit
          */
-        if (first == 'h' && last == ' ') {
+        if (msgCode == MsgHello) {
             if (!parent->sendPacketZRTP(sentPacket)) {
                 sendFailed();       // returns to state Initial
             }
@@ -696,7 +682,7 @@ void ZrtpStateClass::evWaitCommit(void) {
          * - switch state to WaitDHPart2 or WaitConfirm2 if multi stream mode
          * - don't start timer, we are responder
          */
-        if (first == 'c' && last == ' ') {
+        if (msgCode == MsgCommit) {
             ZrtpPacketCommit cpkt(pkt);
 
             if (!multiStream) {
@@ -764,18 +750,11 @@ void ZrtpStateClass::evCommitSent(void) {
 
     DEBUGOUT((cout << "Checking for match in CommitSend.\n"));
 
-    char *msg, first, middle, last, secondLast;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        middle = tolower(*(msg+4));
-        last = tolower(*(msg+7));
-        secondLast = tolower(*(msg+6));
 
         /*
          * HelloAck or Hello:
@@ -783,7 +762,7 @@ void ZrtpStateClass::evCommitSent(void) {
          *   ignore it
          * - no switch in state, leave timer as it is
          */
-        if (first == 'h' && middle == 'o' && (last =='k' || last == ' ')) {
+        if (msgCode == MsgHello || msgCode == MsgHelloAck) {
             return;
         }
 
@@ -800,7 +779,7 @@ void ZrtpStateClass::evCommitSent(void) {
          *   - prepare and send DH1Packt,
          *   - switch to state WaitDHPart2, implies Responder path
          */
-        if (first == 'c' && last == ' ') {
+        if (msgCode == MsgCommit) {
             ZrtpPacketCommit zpCo(pkt);
 
             if (!parent->verifyH2(&zpCo)) {
@@ -865,7 +844,7 @@ void ZrtpStateClass::evCommitSent(void) {
          * - switch to WaitConfirm1
          * - start timer to resend DHPart2 if necessary, we are Initiator
          */
-        if (first == 'd' && secondLast == '1') {
+        if (msgCode == MsgDHPart1) {
             cancelTimer();
             sentPacket = NULL;
             ZrtpPacketDHPart dpkt(pkt);
@@ -902,7 +881,7 @@ void ZrtpStateClass::evCommitSent(void) {
          * - switch off resending commit
          * - prepare Confirm2
          */
-        if (multiStream && (first == 'c' && last == '1')) {
+        if (multiStream && msgCode == MsgConfirm1) {
             cancelTimer();
             ZrtpPacketConfirm cpkt(pkt);
 
@@ -974,23 +953,18 @@ void ZrtpStateClass::evWaitDHPart2(void) {
 
     DEBUGOUT((cout << "Checking for match in DHPart2.\n"));
 
-    char *msg, first, secondLast, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-        secondLast = tolower(*(msg+6));
         /*
          * Commit:
          * - resend DHPart1
          * - stay in state
          */
-        if (first == 'c' && last == ' ') {
+        if (msgCode == MsgCommit) {
             if (!parent->sendPacketZRTP(sentPacket)) {
                 return sendFailed();       // returns to state Initial
             }
@@ -1002,7 +976,7 @@ void ZrtpStateClass::evWaitDHPart2(void) {
          * - switch to WaitConfirm2
          * - No timer, we are responder
          */
-        if (first == 'd' && secondLast == '2') {
+        if (msgCode == MsgDHPart2) {
             ZrtpPacketDHPart dpkt(pkt);
             ZrtpPacketConfirm* confirm = parent->prepareConfirm1(&dpkt, &errorCode);
 
@@ -1052,16 +1026,11 @@ void ZrtpStateClass::evWaitConfirm1(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitConfirm1.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
 
         /*
          * Confirm1:
@@ -1070,7 +1039,7 @@ void ZrtpStateClass::evWaitConfirm1(void) {
          * - switch to state WaitConfAck
          * - set timer to monitor Confirm2 packet, we are initiator
          */
-        if (first == 'c' && last == '1') {
+        if (msgCode == MsgConfirm1) {
             cancelTimer();
             ZrtpPacketConfirm cpkt(pkt);
 
@@ -1145,24 +1114,18 @@ void ZrtpStateClass::evWaitConfirm2(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitConfirm2.\n"));
 
-    char *msg, first, secondLast, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        secondLast = tolower(*(msg+6));
-        last = tolower(*(msg+7));
 
         /*
          * DHPart2 or Commit in multi stream mode:
          * - resend Confirm1 packet
          * - stay in state
          */
-        if ((first == 'd' && secondLast == '2') || (multiStream && (first == 'c' && last == ' '))) {
+        if (msgCode == MsgDHPart2 || (multiStream && msgCode == MsgCommit)) {
             if (!parent->sendPacketZRTP(sentPacket)) {
                 sendFailed();             // returns to state Initial
             }
@@ -1174,7 +1137,7 @@ void ZrtpStateClass::evWaitConfirm2(void) {
          * - switch on security (SRTP)
          * - switch to SecureState
          */
-        if (first == 'c' && last == '2') {
+        if (msgCode == MsgConfirm2) {
             ZrtpPacketConfirm cpkt(pkt);
             ZrtpPacketConf2Ack* confack = parent->prepareConf2Ack(&cpkt, &errorCode);
 
@@ -1228,21 +1191,13 @@ void ZrtpStateClass::evWaitConfAck(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitConfAck.\n"));
 
-    char *msg, first, last;
-    uint8_t *pkt;
-
     if (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
          /*
          * ConfAck:
          * - Switch off resending Confirm2
          * - switch to SecureState
          */
-        if (first == 'c' && last == 'k') {
+        if (msgCode == MsgConf2Ack) {
             cancelTimer();
             sentPacket = NULL;
             // Receiver was already enabled after sending Confirm2 packet
@@ -1311,22 +1266,13 @@ void ZrtpStateClass::evWaitClearAck(void) {
 void ZrtpStateClass::evWaitErrorAck(void) {
     DEBUGOUT((cout << "Checking for match in ErrorAck.\n"));
 
-    char *msg, first, last;
-    uint8_t *pkt;
-
     if (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
         /*
          * Errorck:
          * - stop resending Error,
          * - switch to state Initial
          */
-        if (first == 'e' && last =='k') {
+        if (msgCode == MsgErrorAck) {
             cancelTimer();
             sentPacket = NULL;
             nextState(Initial);
@@ -1357,9 +1303,6 @@ void ZrtpStateClass::evSecureState(void) {
 
     DEBUGOUT((cout << "Checking for match in SecureState.\n"));
 
-    char *msg, first, last;
-    uint8_t *pkt;
-
     /*
      * Handle a possible substate. If substate handling was ok just return.
      */
@@ -1369,18 +1312,12 @@ void ZrtpStateClass::evSecureState(void) {
     }
 
     if (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
         /*
          * Confirm2:
          * - resend Conf2Ack packet
          * - stay in state
          */
-        if (first == 'c' && last == '2') {
+        if (msgCode == MsgConfirm2) {
             if (sentPacket != NULL && !parent->sendPacketZRTP(sentPacket)) {
                 sentPacket = NULL;
                 nextState(Initial);
@@ -1393,7 +1330,7 @@ void ZrtpStateClass::evSecureState(void) {
         /*
          * GoClear received, handle it. TODO fix go clear handling
          *
-        if (first == 'g' && last == 'r') {
+        if (msgCode == MsgGoClear) {
             ZrtpPacketGoClear gpkt(pkt);
             ZrtpPacketClearAck* clearAck = parent->prepareClearAck(&gpkt);
 
@@ -1426,25 +1363,16 @@ void ZrtpStateClass::evSecureState(void) {
 }
 
 bool ZrtpStateClass::subEvWaitRelayAck() {
-    char *msg, first, last;
-    uint8_t* pkt;
-
     /*
      * First check the general event type, then discrimnate the real event.
      */
     if  (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
         /*
          * SAS relayAck:
          * - stop resending SASRelay,
          * - switch to secure substate Normal
          */
-        if (first == 'r' && last =='k') {
+        if (msgCode == MsgRelayAck) {
             cancelTimer();
             secSubstate = Normal;
             sentPacket = NULL;
@@ -1480,9 +1408,11 @@ int32_t ZrtpStateClass::nextTimer(zrtpTimer_t *t) {
     t->time = (t->time > t->capping)? t->capping : t->time;
     if (t->maxResend > 0) {
         t->counter++;
-        if (t->counter > t->maxResend) {
-            return -1;
-        }
+    }
+    if (ZrtpTrace::isActive())
+        parent->traceEvent(TraceRetransmit, 0, static_cast<uint32_t>(t->time), 0, static_cast<uint8_t>(t->counter));
+    if (t->maxResend > 0 && t->counter > t->maxResend) {
+        return -1;
     }
     return parent->activateTimer(t->time);
 }
@@ -17,6 +17,9 @@
 /*
  * Authors: Werner Dittmann <Werner.Dittmann@t-online.de>
  */
+
+#include <common/zrtpAlgorithms.h>
+
 //                             1
 //                    1234567890123456
 char clientId[] =    "GNU ZRTP 4.6.4  "; // 16 chars max.
@@ -87,7 +90,11 @@ char ec38[] = "EC38";
 char e255[] = "E255";
 char e414[] = "E414";
 char mult[] = "Mult";
+#if ZRTP_WITH_DH
 const char* mandatoryPubKey = dh3k;
+#else
+const char* mandatoryPubKey = ec25;     // profile without DH, peer must support EC25
+#endif
 
 char b32[] =  "B32 ";
 char b256[] = "B256";
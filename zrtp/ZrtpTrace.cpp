@@ -0,0 +1,256 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <system_error>
+
+#include <libzrtpcpp/ZrtpTrace.h>
+#include <libzrtpcpp/ZrtpTextData.h>
+#include <libzrtpcpp/zrtpPacket.h>
+#include <libzrtpcpp/ZrtpPacketBase.h>
+
+std::atomic<bool> ZrtpTrace::active(false);
+
+namespace {
+
+/*
+ * Single producer, single consumer ring. The owning thread moves head,
+ * the flush thread moves tail.
+ */
+struct TraceRing {
+    TraceRing(): head(0), tail(0), dropped(0) {}
+
+    ZrtpTraceRecord_t records[ZrtpTrace::ringSize];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> dropped;
+};
+
+// ringLock protects the ring list, the file and the flush thread state
+std::mutex ringLock;
+std::condition_variable flushCond;
+std::vector<TraceRing*> rings;
+FILE* traceFile = nullptr;
+bool stopFlush = false;
+std::thread flushThread;
+std::chrono::steady_clock::time_point traceBase;
+std::atomic<uint32_t> sessionCounter(0);
+
+const int32_t flushIntervalMs = 100;
+
+void drainRing(TraceRing* ring) {
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+
+    if (traceFile != nullptr) {
+        while (tail != head) {
+            uint32_t idx = tail % ZrtpTrace::ringSize;
+            uint32_t count = std::min(head - tail, ZrtpTrace::ringSize - idx);
+            fwrite(&ring->records[idx], sizeof(ZrtpTraceRecord_t), count, traceFile);
+            tail += count;
+        }
+        uint32_t dropped = ring->dropped.exchange(0);
+        if (dropped > 0) {
+            ZrtpTraceRecord_t rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - traceBase).count();
+            rec.event = TraceDropped;
+            rec.data = dropped;
+            fwrite(&rec, sizeof(rec), 1, traceFile);
+        }
+    }
+    ring->tail.store(head, std::memory_order_release);
+}
+
+void drainAll() {
+    for (TraceRing* ring : rings)
+        drainRing(ring);
+    if (traceFile != nullptr)
+        fflush(traceFile);
+}
+
+void flushLoop() {
+    std::unique_lock<std::mutex> lock(ringLock);
+    while (!stopFlush) {
+        flushCond.wait_for(lock, std::chrono::milliseconds(flushIntervalMs));
+        drainAll();
+    }
+}
+
+/*
+ * Owns the ring of one thread. The ring is registered on first use and
+ * drained and removed when the thread exits.
+ */
+struct RingHolder {
+    RingHolder(): ring(nullptr) {}
+
+    ~RingHolder() {
+        if (ring == nullptr)
+            return;
+        std::lock_guard<std::mutex> lock(ringLock);
+        drainRing(ring);
+        rings.erase(std::remove(rings.begin(), rings.end(), ring), rings.end());
+        delete ring;
+    }
+
+    TraceRing* get() {
+        if (ring == nullptr) {
+            ring = new TraceRing();
+            std::lock_guard<std::mutex> lock(ringLock);
+            rings.push_back(ring);
+        }
+        return ring;
+    }
+
+    TraceRing* ring;
+};
+
+thread_local RingHolder ringHolder;
+
+const char* const messageTypes[] = {
+    HelloMsg, HelloAckMsg, CommitMsg, DHPart1Msg, DHPart2Msg, Confirm1Msg, Confirm2Msg, Conf2AckMsg,
+    ErrorMsg, ErrorAckMsg, GoClearMsg, ClearAckMsg, PingMsg, PingAckMsg, SasRelayMsg, RelayAckMsg
+};
+const uint8_t numberOfMessageTypes = sizeof(messageTypes) / sizeof(messageTypes[0]);
+
+const char* const eventNames[numberOfTraceEvents] = {
+    "?", "start", "stop", "sent", "recv", "state", "retransmit", "algorithm", "secure", "failed", "dropped"
+};
+
+// Same order as enum zrtpStates in ZrtpStateClass.h
+const char* const stateNames[] = {
+    "Initial", "Detect", "AckDetected", "AckSent", "WaitCommit", "CommitSent", "WaitDHPart2",
+    "WaitConfirm1", "WaitConfirm2", "WaitConfAck", "WaitClearAck", "SecureState", "WaitErrorAck"
+};
+const uint8_t numberOfStateNames = sizeof(stateNames) / sizeof(stateNames[0]);
+
+const char* const algoNames[numberOfTraceAlgos] = {
+    "hash", "cipher", "authLength", "pubKey", "sas"
+};
+}
+
+bool ZrtpTrace::open(const std::string& fileName) {
+    std::lock_guard<std::mutex> lock(ringLock);
+
+    if (traceFile != nullptr)
+        return true;
+
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    ZrtpTraceHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "ZTRC", sizeof(header.magic));
+    header.version = formatVersion;
+    header.recordSize = sizeof(ZrtpTraceRecord_t);
+    header.endian = 0x01020304;
+    header.wallClockUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return false;
+    }
+
+    // Discard records left over from a previous trace
+    for (TraceRing* ring : rings)
+        ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+
+    traceFile = file;
+    traceBase = std::chrono::steady_clock::now();
+    stopFlush = false;
+    try {
+        flushThread = std::thread(flushLoop);
+    } catch (std::system_error&) {
+        traceFile = nullptr;
+        fclose(file);
+        return false;
+    }
+    active.store(true, std::memory_order_release);
+    return true;
+}
+
+void ZrtpTrace::close() {
+    {
+        std::lock_guard<std::mutex> lock(ringLock);
+        if (traceFile == nullptr)
+            return;
+        active.store(false, std::memory_order_release);
+        stopFlush = true;
+    }
+    flushCond.notify_one();
+    flushThread.join();
+
+    std::lock_guard<std::mutex> lock(ringLock);
+    drainAll();
+    fclose(traceFile);
+    traceFile = nullptr;
+}
+
+void ZrtpTrace::record(ZrtpTraceRecord_t& rec) {
+    if (!isActive())
+        return;
+
+    rec.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - traceBase).count();
+
+    TraceRing* ring = ringHolder.get();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t used = head - ring->tail.load(std::memory_order_acquire);
+
+    if (used >= ringSize) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->records[head % ringSize] = rec;
+    ring->head.store(head + 1, std::memory_order_release);
+
+    // Wake up the flush thread early if the ring fills up
+    if (used + 1 == (ringSize * 3) / 4)
+        flushCond.notify_one();
+}
+
+uint32_t ZrtpTrace::newSession() {
+    return sessionCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+uint8_t ZrtpTrace::messageCode(const uint8_t* type) {
+    return static_cast<uint8_t>(ZrtpPacketBase::getMessageCode(type));
+}
+
+const char* ZrtpTrace::messageName(uint8_t code) {
+    if (code == 0 || code > numberOfMessageTypes)
+        return "?";
+    return messageTypes[code - 1];
+}
+
+const char* ZrtpTrace::eventName(uint8_t event) {
+    return (event < numberOfTraceEvents) ? eventNames[event] : "?";
+}
+
+const char* ZrtpTrace::stateName(uint8_t state) {
+    return (state < numberOfStateNames) ? stateNames[state] : "?";
+}
+
+const char* ZrtpTrace::algoName(uint8_t algo) {
+    return (algo < numberOfTraceAlgos) ? algoNames[algo] : "?";
+}
@@ -22,37 +22,80 @@
 
 #include <zrtp/crypto/aesCFB.h>
 #include <cryptcommon/aescpp.h>
+#include <common/zrtpAllocator.h>
 
-void aesCfbEncrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+void* createAesCfbContext(uint8_t* key, int32_t keyLength)
+{
+    auto* saAes = zrtpNew<AESencrypt>(ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+    if (saAes == NULL)
+        return NULL;
+
+    if (!setAesCfbContextKey(saAes, key, keyLength)) {
+        zrtpDelete(saAes, ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        return NULL;
+    }
+    return saAes;
+}
+
+int32_t setAesCfbContextKey(void* ctx, uint8_t* key, int32_t keyLength)
 {
-    auto* saAes = new AESencrypt();
+    auto* saAes = static_cast<AESencrypt*>(ctx);
 
+    if (saAes == NULL)
+        return 0;
     if (keyLength == 16)
         saAes->key128(key);
     else if (keyLength == 32)
         saAes->key256(key);
     else
-        return;
+        return 0;
+    return 1;
+}
+
+void aesCfbEncryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    auto* saAes = static_cast<AESencrypt*>(ctx);
 
     // Note: maybe copy IV to an internal array if we encounter strange things.
     // the cfb encrypt modifies the IV on return. Same for output data (inplace encryption)
     saAes->cfb_encrypt(data, data, dataLength, IV);
-    delete saAes;
 }
 
-
-void aesCfbDecrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+void aesCfbDecryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength)
 {
-    auto* saAes = new AESencrypt();
-    if (keyLength == 16)
-        saAes->key128(key);
-    else if (keyLength == 32)
-        saAes->key256(key);
-    else
-        return;
+    auto* saAes = static_cast<AESencrypt*>(ctx);
 
     // Note: maybe copy IV to an internal array if we encounter strange things.
     // the cfb encrypt modifies the IV on return. Same for output data (inplace encryption)
     saAes->cfb_decrypt(data, data, dataLength, IV);
-    delete saAes;
+}
+
+void freeAesCfbContext(void* ctx)
+{
+    auto* saAes = static_cast<AESencrypt*>(ctx);
+
+    if (saAes == NULL)
+        return;
+    zrtpDelete(saAes, ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+}
+
+void aesCfbEncrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    void* ctx = createAesCfbContext(key, keyLength);
+    if (ctx == NULL)
+        return;
+
+    aesCfbEncryptCtx(ctx, IV, data, dataLength);
+    freeAesCfbContext(ctx);
+}
+
+
+void aesCfbDecrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    void* ctx = createAesCfbContext(key, keyLength);
+    if (ctx == NULL)
+        return;
+
+    aesCfbDecryptCtx(ctx, IV, data, dataLength);
+    freeAesCfbContext(ctx);
 }
@@ -80,6 +80,74 @@ void aesCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
 
 void aesCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
                    int32_t dataLength);
+/**
+ * Create a AES CFB context and prepare the key schedule.
+ *
+ * An application uses this context to encrypt or decrypt several data
+ * chunks with the same key without repeating the key schedule.
+ *
+ * @param key
+ *    Points to the key bytes.
+ * @param keyLength
+ *    Length of the key in bytes
+ * @return Returns a pointer to the initialized context or @c NULL if the
+ *    key length is not supported.
+ */
+void* createAesCfbContext(uint8_t* key, int32_t keyLength);
+
+/**
+ * Replace the key schedule of an AES CFB context.
+ *
+ * Reuses the memory of the context for a new key.
+ *
+ * @param ctx
+ *    Pointer to AES CFB context
+ * @param key
+ *    Points to the key bytes.
+ * @param keyLength
+ *    Length of the key in bytes
+ * @return 1 on success, 0 if the key length is not supported.
+ */
+int32_t setAesCfbContextKey(void* ctx, uint8_t* key, int32_t keyLength);
+
+/**
+ * Encrypt data with AES CFB mode using a prepared context.
+ *
+ * @param ctx
+ *    Pointer to AES CFB context
+ * @param IV
+ *    The initialization vector which must be AES_BLOCK_SIZE (16) bytes.
+ * @param data
+ *    Points to a buffer that contains and receives the computed
+ *    the data (in-place encryption).
+ * @param dataLength
+ *    Length of the data in bytes
+ */
+void aesCfbEncryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength);
+
+/**
+ * Decrypt data with AES CFB mode using a prepared context.
+ *
+ * @param ctx
+ *    Pointer to AES CFB context
+ * @param IV
+ *    The initialization vector which must be AES_BLOCK_SIZE (16) bytes.
+ * @param data
+ *    Points to a buffer that contains and receives the computed
+ *    the data (in-place decryption).
+ * @param dataLength
+ *    Length of the data in bytes
+ */
+void aesCfbDecryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength);
+
+/**
+ * Wipe the key schedule and free a AES CFB context.
+ *
+ * @param ctx
+ *    Pointer to AES CFB context, may be @c NULL
+ */
+void freeAesCfbContext(void* ctx);
+
 /**
  * @}
  */
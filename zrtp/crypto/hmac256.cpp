@@ -23,6 +23,7 @@
 #include <cstdio>
 #include "zrtp/crypto/sha2.h"
 #include "zrtp/crypto/hmac256.h"
+#include "common/zrtpAllocator.h"
 
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "OCUnusedGlobalDeclarationInspection"
@@ -116,8 +117,8 @@ void hmac_sha256(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 void hmacSha256(const uint8_t* key, uint64_t keyLength,
-                const std::vector<const uint8_t*>& dataChunks,
-                const std::vector<uint64_t>& dataChunkLength,
+                const ZrtpVector<const uint8_t*>& dataChunks,
+                const ZrtpVector<uint64_t>& dataChunkLength,
                 uint8_t* mac, uint32_t* macLength )
 {
     hmacSha256Context ctx= {};
@@ -133,7 +134,7 @@ void hmacSha256(const uint8_t* key, uint64_t keyLength,
 
 void* createSha256HmacContext(uint8_t* key, uint64_t keyLength)
 {
-    auto* ctx = reinterpret_cast<hmacSha256Context*>(malloc(sizeof(hmacSha256Context)));
+    auto* ctx = reinterpret_cast<hmacSha256Context*>(zrtpMemAlloc(sizeof(hmacSha256Context), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
 
     if (ctx != nullptr) {
         hmacSha256Init(ctx, key, keyLength);
@@ -153,8 +154,8 @@ void hmacSha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha256Ctx(void* ctx,
-                   const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
+                   const ZrtpVector<const uint8_t*>& data,
+                   const ZrtpVector<uint64_t>& dataLength,
                    uint8_t* mac, uint32_t* macLength )
 {
     auto *pctx = (hmacSha256Context*)ctx;
@@ -170,8 +171,7 @@ void hmacSha256Ctx(void* ctx,
 void freeSha256HmacContext(void* ctx)
 {
     if (ctx) {
-        memset(ctx, 0, sizeof(hmacSha256Context));
-        free(ctx);
+        zrtpMemFree(ctx, sizeof(hmacSha256Context), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     }
 }
 #pragma clang diagnostic pop
\ No newline at end of file
@@ -23,6 +23,7 @@
 #include <cstdio>
 #include "zrtp/crypto/sha2.h"
 #include "zrtp/crypto/hmac384.h"
+#include "common/zrtpAllocator.h"
 
 typedef struct _hmacSha384Context {
     sha384_ctx ctx;
@@ -113,8 +114,8 @@ void hmac_sha384(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 void hmacSha384(const uint8_t* key, uint64_t keyLength,
-                const std::vector<const uint8_t*>& data,
-                const std::vector<uint64_t>& dataLength,
+                const ZrtpVector<const uint8_t*>& data,
+                const ZrtpVector<uint64_t>& dataLength,
                 uint8_t* mac, uint32_t* macLength )
 {
     hmacSha384Context ctx = {};
@@ -130,7 +131,7 @@ void hmacSha384(const uint8_t* key, uint64_t keyLength,
 
 void* createSha384HmacContext(const uint8_t* key, uint64_t keyLength)
 {
-    auto *ctx = reinterpret_cast<hmacSha384Context*>(malloc(sizeof(hmacSha384Context)));
+    auto *ctx = reinterpret_cast<hmacSha384Context*>(zrtpMemAlloc(sizeof(hmacSha384Context), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
 
     if (ctx != nullptr) {
         hmacSha384Init(ctx, key, keyLength);
@@ -150,8 +151,8 @@ void hmacSha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
 }
 
 void hmacSha384Ctx(void* ctx,
-                   const std::vector<const uint8_t*>& data,
-                   const std::vector<uint64_t>& dataLength,
+                   const ZrtpVector<const uint8_t*>& data,
+                   const ZrtpVector<uint64_t>& dataLength,
                    uint8_t* mac, uint32_t* macLength )
 {
     auto* pctx = (hmacSha384Context*)ctx;
@@ -167,7 +168,6 @@ void hmacSha384Ctx(void* ctx,
 void freeSha384HmacContext(void* ctx)
 {
     if (ctx) {
-        memset(ctx, 0, sizeof(hmacSha384Context));
-        free(ctx);
+        zrtpMemFree(ctx, sizeof(hmacSha384Context), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     }
 }
\ No newline at end of file
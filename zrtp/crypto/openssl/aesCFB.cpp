@@ -19,51 +19,83 @@
 #include <string.h>
 
 #include <zrtp/crypto/aesCFB.h>
+#include <common/zrtpAllocator.h>
 
 // extern void initializeOpenSSL();
 
 
-void aesCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
-                   int32_t dataLength)
+void* createAesCfbContext(uint8_t* key, int32_t keyLength)
 {
-    AES_KEY aesKey;
-    int usedBytes = 0;
+    auto* aesKey = static_cast<AES_KEY*>(zrtpMemAlloc(sizeof(AES_KEY), ZRTP_MEM_KEY | ZRTP_MEM_SECRET));
+    if (aesKey == NULL)
+        return NULL;
 
-//    initializeOpenSSL();
+    memset(aesKey, 0, sizeof( AES_KEY ) );
+    if (!setAesCfbContextKey(aesKey, key, keyLength)) {
+        zrtpMemFree(aesKey, sizeof(AES_KEY), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        return NULL;
+    }
+    return aesKey;
+}
 
-    memset(&aesKey, 0, sizeof( AES_KEY ) );
+int32_t setAesCfbContextKey(void* ctx, uint8_t* key, int32_t keyLength)
+{
+    if (ctx == NULL)
+        return 0;
     if (keyLength == 16) {
-        AES_set_encrypt_key(key, 128, &aesKey);
+        AES_set_encrypt_key(key, 128, static_cast<AES_KEY*>(ctx));
     }
     else if (keyLength == 32) {
-        AES_set_encrypt_key(key, 256, &aesKey);
+        AES_set_encrypt_key(key, 256, static_cast<AES_KEY*>(ctx));
     }
     else {
-        return;
+        return 0;
     }
-    AES_cfb128_encrypt(data, data, dataLength, &aesKey,
+    return 1;
+}
+
+void aesCfbEncryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    int usedBytes = 0;
+
+    AES_cfb128_encrypt(data, data, dataLength, static_cast<AES_KEY*>(ctx),
                        IV, &usedBytes, AES_ENCRYPT);
 }
 
+void aesCfbDecryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    int usedBytes = 0;
 
-void aesCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
+    AES_cfb128_encrypt(data, data, dataLength, static_cast<AES_KEY*>(ctx),
+                       IV, &usedBytes, AES_DECRYPT);
+}
+
+void freeAesCfbContext(void* ctx)
+{
+    if (ctx == NULL)
+        return;
+    zrtpMemFree(ctx, sizeof(AES_KEY), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+}
+
+void aesCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
                    int32_t dataLength)
 {
-    AES_KEY aesKey;
-    int usedBytes = 0;
+    void* ctx = createAesCfbContext(key, keyLength);
+    if (ctx == NULL)
+        return;
 
-//    initializeOpenSSL();
+    aesCfbEncryptCtx(ctx, IV, data, dataLength);
+    freeAesCfbContext(ctx);
+}
 
-    memset(&aesKey, 0, sizeof( AES_KEY ) );
-    if (keyLength == 16) {
-        AES_set_encrypt_key(key, 128, &aesKey);
-    }
-    else if (keyLength == 32) {
-        AES_set_encrypt_key(key, 256, &aesKey);
-    }
-    else {
+
+void aesCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
+                   int32_t dataLength)
+{
+    void* ctx = createAesCfbContext(key, keyLength);
+    if (ctx == NULL)
         return;
-    }
-    AES_cfb128_encrypt(data, data, dataLength, &aesKey,
-                       IV, &usedBytes, AES_DECRYPT);
+
+    aesCfbDecryptCtx(ctx, IV, data, dataLength);
+    freeAesCfbContext(ctx);
 }
@@ -27,8 +27,8 @@ void hmac_sha384(const uint8_t* key, uint64_t key_length,
 }
 
 void hmacSha384(const uint8_t* key, uint64_t key_length,
-                const std::vector<const uint8_t*>& data,
-                const std::vector<uint64_t>& dataLength,
+                const ZrtpVector<const uint8_t*>& data,
+                const ZrtpVector<uint64_t>& dataLength,
                 uint8_t* mac, uint32_t* mac_length)
 {
     unsigned int tmp;
@@ -18,13 +18,14 @@
 #include <openssl/sha.h>
 
 #include <crypto/sha256.h>
+#include <common/zrtpAllocator.h>
 
 void sha256(const uint8_t *data, uint64_t data_length, uint8_t *digest)
 {
 	SHA256(data, data_length, digest);
 }
 
-void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t >& dataLength, uint8_t *digest)
+void sha256(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength, uint8_t *digest)
 {
 	SHA256_CTX ctx = {};
 	SHA256_Init( &ctx);
@@ -36,7 +37,7 @@ void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t
 
 void* createSha256Context()
 {
-    auto* ctx = (SHA256_CTX*)malloc(sizeof (SHA256_CTX));
+    auto* ctx = (SHA256_CTX*)zrtpMemAlloc(sizeof(SHA256_CTX), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     if (ctx == nullptr)
         return nullptr;
     SHA256_Init(ctx);
@@ -50,7 +51,7 @@ void closeSha256Context(void* ctx, uint8_t * digest)
     if (digest != nullptr && hd != nullptr) {
         SHA256_Final(digest, hd);
     }
-    free(hd);
+    zrtpMemFree(hd, sizeof(SHA256_CTX), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
 
 void* initializeSha256Context(void* ctx) 
@@ -74,7 +75,7 @@ void sha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     SHA256_Update(hd, data, dataLength);
 }
 
-void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha256Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength)
 {
     auto* hd = (SHA256_CTX*)ctx;
 
@@ -18,13 +18,14 @@
 #include <openssl/sha.h>
 
 #include <crypto/sha384.h>
+#include <common/zrtpAllocator.h>
 
 void sha384(const uint8_t *data, uint64_t dataLength, uint8_t *digest)
 {
 	SHA384(data, dataLength, digest);
 }
 
-void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t* digest)
+void sha384(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength, uint8_t* digest)
 {
 	SHA512_CTX ctx = {};
 	SHA384_Init( &ctx);
@@ -36,7 +37,7 @@ void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>
 
 void* createSha384Context()
 {
-    auto* ctx = (SHA512_CTX*)malloc(sizeof (SHA512_CTX));
+    auto* ctx = (SHA512_CTX*)zrtpMemAlloc(sizeof(SHA512_CTX), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
     if (ctx == nullptr)
         return nullptr;
     SHA384_Init(ctx);
@@ -50,7 +51,7 @@ void closeSha384Context(void* ctx, uint8_t * digest)
     if (digest != nullptr) {
         SHA384_Final(digest, hd);
     }
-    free(hd);
+    zrtpMemFree(hd, sizeof(SHA512_CTX), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
 
 void* initializeSha384Context(void* ctx)
@@ -75,7 +76,7 @@ void sha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     SHA384_Update(hd, data, dataLength);
 }
 
-void sha384Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha384Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength)
 {
     auto* hd = (SHA512_CTX*)ctx;
 
@@ -289,6 +289,29 @@ int32_t ZrtpDH::generatePublicKey()
     return 0;
 }
 
+int32_t ZrtpDH::generateKeyPair()
+{
+    uint8_t random[32];
+
+    if (pkType == DH2K || pkType == DH3K) {
+        DH* tmpCtx = static_cast<DH*>(ctx);
+        RAND_bytes(random, sizeof(random));
+        tmpCtx->priv_key = BN_bin2bn(random, sizeof(random), tmpCtx->priv_key);
+        memset(random, 0, sizeof(random));
+    }
+    return generatePublicKey();
+}
+
+void ZrtpDH::clearPrivateKey()
+{
+    // The EC key is replaced and cleared by the next EC_KEY_generate_key, the DH key is kept in place
+    if (pkType == DH2K || pkType == DH3K) {
+        DH* tmpCtx = static_cast<DH*>(ctx);
+        if (tmpCtx->priv_key != nullptr)
+            BN_clear(tmpCtx->priv_key);
+    }
+}
+
 uint32_t ZrtpDH::getDhSize() const
 {
     if (pkType == DH2K || pkType == DH3K)
@@ -20,6 +20,7 @@
 
 #include <zrtp/crypto/sha2.h>
 #include <zrtp/crypto/sha256.h>
+#include <common/zrtpAllocator.h>
 
 void sha256(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
 {
@@ -30,7 +31,7 @@ void sha256(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
     sha256_end(digest, &ctx);
 }
 
-void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t *digest)
+void sha256(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength, uint8_t *digest)
 {
     sha256_ctx ctx  = {};
 
@@ -43,7 +44,7 @@ void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>
 
 void* createSha256Context()
 {
-    auto *ctx = reinterpret_cast<sha256_ctx*>(malloc(sizeof(sha256_ctx)));
+    auto *ctx = reinterpret_cast<sha256_ctx*>(zrtpMemAlloc(sizeof(sha256_ctx), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
     sha256_begin(ctx);
     return (void*)ctx;
 }
@@ -55,7 +56,7 @@ void closeSha256Context(void* ctx, uint8_t * digest)
     if (digest != nullptr && hd != nullptr) {
         sha256_end(digest, hd);
     }
-    free(hd);
+    zrtpMemFree(hd, sizeof(sha256_ctx), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
 
 void* initializeSha256Context(void* ctx)
@@ -84,7 +85,7 @@ void sha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     sha256_hash(data, dataLength, hd);
 }
 
-void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha256Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength)
 {
     auto* hd = reinterpret_cast<sha256_ctx*>(ctx);
 
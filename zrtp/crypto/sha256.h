@@ -34,6 +34,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 
 #ifndef SHA256_DIGEST_LENGTH
 #define SHA256_DIGEST_LENGTH 32
@@ -73,7 +74,7 @@ void sha256(const uint8_t *data,
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 32 bytes (SHA256_DIGEST_LENGTH).
  */
-void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t >& dataLength, uint8_t *digest);
+void sha256(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength, uint8_t *digest);
 
 /**
  * Create and initialize a SHA256 context.
@@ -157,7 +158,7 @@ void sha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  *    Vector of integers that hold the length of each data chunk.
  *
  */
-void sha256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength);
+void sha256Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength);
 
 /**
  * @}
@@ -20,6 +20,7 @@
 
 #include <zrtp/crypto/sha2.h>
 #include <zrtp/crypto/sha384.h>
+#include <common/zrtpAllocator.h>
 
 void sha384(const uint_8t *data, uint64_t dataLength, uint8_t *digest )
 {
@@ -30,7 +31,7 @@ void sha384(const uint_8t *data, uint64_t dataLength, uint8_t *digest )
     sha384_end(digest, &ctx);
 }
 
-void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t *digest)
+void sha384(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength, uint8_t *digest)
 {
     sha384_ctx ctx = {};
 
@@ -43,7 +44,7 @@ void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>
 
 void* createSha384Context()
 {
-    auto* ctx = reinterpret_cast<sha384_ctx*>(malloc(sizeof(sha384_ctx)));
+    auto* ctx = reinterpret_cast<sha384_ctx*>(zrtpMemAlloc(sizeof(sha384_ctx), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
     if (ctx != nullptr) {
         sha384_begin(ctx);
     }
@@ -57,7 +58,7 @@ void closeSha384Context(void* ctx, uint_8t* digest)
     if (digest != nullptr && hd != nullptr) {
         sha384_end(digest, hd);
     }
-    free(hd);
+    zrtpMemFree(hd, sizeof(sha384_ctx), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
 
 void* initializeSha384Context(void* ctx)
@@ -86,7 +87,7 @@ void sha384Ctx(void* ctx, const uint_8t* data, uint64_t dataLength)
     sha384_hash(data, dataLength, hd);
 }
 
-void sha384Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void sha384Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength)
 {
     auto* hd = reinterpret_cast<sha384_ctx*>(ctx);
 
@@ -33,6 +33,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 
 #ifndef SHA384_DIGEST_LENGTH
 #define SHA384_DIGEST_LENGTH 48
@@ -73,7 +74,7 @@ void sha384(const uint8_t *data,
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 48 bytes (SHA384_DIGEST_LENGTH).
  */
-void sha384(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength, uint8_t* digest);
+void sha384(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength, uint8_t* digest);
 
 /**
  * Create and initialize a SHA384 context.
@@ -157,7 +158,7 @@ void sha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  *    Vector of integers that hold the length of each data chunk.
  *
  */
-void sha384Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength);
+void sha384Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength);
 
 /**
  * @}
@@ -20,6 +20,7 @@
 
 #include <cryptcommon/skeinApi.h>
 #include <zrtp/crypto/skein256.h>
+#include <common/zrtpAllocator.h>
 
 #include <cstdlib>
 
@@ -34,7 +35,7 @@ void skein256(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
     skeinFinal(&ctx, digest);
 }
 
-void skein256(const std::vector<const uint8_t*>& dataChunks, const std::vector<uint64_t>& dataChunkLength, uint8_t *digest)
+void skein256(const ZrtpVector<const uint8_t*>& dataChunks, const ZrtpVector<uint64_t>& dataChunkLength, uint8_t *digest)
 {
     SkeinCtx_t ctx = {};
 
@@ -48,7 +49,7 @@ void skein256(const std::vector<const uint8_t*>& dataChunks, const std::vector<u
 
 void* createSkein256Context()
 {
-    auto* ctx = reinterpret_cast<SkeinCtx_t *>(malloc(sizeof(SkeinCtx_t )));
+    auto* ctx = reinterpret_cast<SkeinCtx_t *>(zrtpMemAlloc(sizeof(SkeinCtx_t), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
     skeinCtxPrepare(ctx, SKEIN_SIZE);
     skeinInit(ctx, SKEIN256_DIGEST_LENGTH*8);
     return (void*)ctx;
@@ -61,7 +62,7 @@ void closeSkein256Context(void* ctx, uint8_t* digest)
     if (digest != nullptr) {
         skeinFinal(hd, digest);
     }
-    free(hd);
+    zrtpMemFree(hd, sizeof(SkeinCtx_t), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
 
 void* initializeSkein256Context(void* ctx)
@@ -90,7 +91,7 @@ void skein256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
     skeinUpdate(hd, data, dataLength);
 }
 
-void skein256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength)
+void skein256Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength)
 {
     auto* hd = reinterpret_cast<SkeinCtx_t*>(ctx);
 
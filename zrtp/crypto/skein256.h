@@ -33,6 +33,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 
 #ifndef SKEIN256_DIGEST_LENGTH
 #define SKEIN256_DIGEST_LENGTH  32
@@ -72,7 +73,7 @@ void skein256(const uint8_t *data, uint64_t dataLength, uint8_t *digest);
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 32 bytes (Skein256_DIGEST_LENGTH).
  */
-void skein256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength,
+void skein256(const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength,
               uint8_t *digest);
 /**
  * Create and initialize a Skein256 context.
@@ -156,7 +157,7 @@ void skein256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  *    Vector of integers that hold the length of each data chunk.
  *
  */
-void skein256Ctx(void* ctx, const std::vector<const uint8_t*>& data, const std::vector<uint64_t>& dataLength);
+void skein256Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data, const ZrtpVector<uint64_t>& dataLength);
 
 /**
  * @}
@@ -21,6 +21,7 @@
 
 #include <cryptcommon/skeinApi.h>
 #include <zrtp/crypto/skein384.h>
+#include <common/zrtpAllocator.h>
 
 #include <cstdlib>
 
@@ -38,7 +39,7 @@ void skein384(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
     skeinFinal(&ctx, digest);
 }
 
-void skein384(const std::vector<const uint_8t *>& dataChunks, const std::vector<uint64_t>& dataChunkLength, uint8_t *digest)
+void skein384(const ZrtpVector<const uint8_t*>& dataChunks, const ZrtpVector<uint64_t>& dataChunkLength, uint8_t *digest)
 {
     SkeinCtx_t ctx = {};
 
@@ -52,7 +53,7 @@ void skein384(const std::vector<const uint_8t *>& dataChunks, const std::vector<
 
 void* createSkein384Context()
 {
-    auto *ctx = reinterpret_cast<SkeinCtx_t *>(malloc(sizeof(SkeinCtx_t )));
+    auto *ctx = reinterpret_cast<SkeinCtx_t *>(zrtpMemAlloc(sizeof(SkeinCtx_t), ZRTP_MEM_HASH | ZRTP_MEM_SECRET));
     if (ctx != nullptr) {
         skeinCtxPrepare(ctx, SKEIN_SIZE);
         skeinInit(ctx, SKEIN384_DIGEST_LENGTH*8);
@@ -67,7 +68,7 @@ void closeSkein384Context(void* ctx, uint8_t* digest)
     if (digest != nullptr && hd != nullptr) {
         skeinFinal(hd, digest);
     }
-    free(hd);
+    zrtpMemFree(hd, sizeof(SkeinCtx_t), ZRTP_MEM_HASH | ZRTP_MEM_SECRET);
 }
 
 void* initializeSkein384Context(void* ctx)
@@ -97,8 +98,8 @@ void skein384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength)
 }
 
 void skein384Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength)
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength)
 {
     auto* hd = reinterpret_cast<SkeinCtx_t*>(ctx);
 
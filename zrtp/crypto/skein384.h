@@ -34,6 +34,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 
 #ifndef SKEIN384_DIGEST_LENGTH
 #define SKEIN384_DIGEST_LENGTH  48
@@ -75,8 +76,8 @@ void skein384(const uint8_t *data,
  *    Points to a buffer that receives the computed digest. This
  *    buffer must have a size of at least 48 bytes (Skein384_DIGEST_LENGTH).
  */
-void skein384(const std::vector<const uint8_t*>& data,
-              const std::vector<uint64_t>& dataLength,
+void skein384(const ZrtpVector<const uint8_t*>& data,
+              const ZrtpVector<uint64_t>& dataLength,
               uint8_t *digest);
 /**
  * Create and initialize a Skein384 context.
@@ -161,8 +162,8 @@ void skein384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength);
  *
  */
 void skein384Ctx(void* ctx,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength);
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength);
 
 /**
  * @}
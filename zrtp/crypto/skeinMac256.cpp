@@ -31,8 +31,8 @@ void macSkein256(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 
-void macSkein256(const uint8_t* key, uint64_t keyLength, const std::vector<const uint8_t*>& data,
-                  const std::vector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength )
+void macSkein256(const uint8_t* key, uint64_t keyLength, const ZrtpVector<const uint8_t*>& data,
+                  const ZrtpVector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength )
 {
     macSkein(key, keyLength, data, dataLength, mac, SKEIN256_DIGEST_LENGTH*8, SKEIN_SIZE);
     *macLength = SKEIN256_DIGEST_LENGTH;
@@ -50,8 +50,8 @@ void macSkein256Ctx(void* ctx, const uint8_t* data, uint32_t dataLength, uint8_t
     *macLength = SKEIN256_DIGEST_LENGTH;
 }
 
-void macSkein256Ctx(void* ctx, const std::vector<const uint8_t*>& data,
-                    const std::vector<uint64_t>& dataLength, uint8_t* mac, int32_t* macLength )
+void macSkein256Ctx(void* ctx, const ZrtpVector<const uint8_t*>& data,
+                    const ZrtpVector<uint64_t>& dataLength, uint8_t* mac, int32_t* macLength )
 {
     macSkeinCtx(ctx, data, dataLength, mac);
     *macLength = SKEIN256_DIGEST_LENGTH;
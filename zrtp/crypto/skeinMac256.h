@@ -35,6 +35,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 
 #ifndef SKEIN256_DIGEST_LENGTH
 #define SKEIN256_DIGEST_LENGTH 32
@@ -83,8 +84,8 @@ void macSkein256(const uint8_t* key, uint64_t key_length, const uint8_t* data, u
  *    Point to an integer that receives the length of the computed HMAC.
  */
 
-void macSkein256(const uint8_t* key, uint64_t key_length, const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength);
+void macSkein256(const uint8_t* key, uint64_t key_length, const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength);
 /**
  * @}
  */
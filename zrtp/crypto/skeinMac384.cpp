@@ -31,8 +31,8 @@ void macSkein384(const uint8_t *key, uint64_t keyLength, const uint8_t* data, ui
 }
 
 
-void macSkein384(const uint8_t* key, uint64_t keyLength, const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength )
+void macSkein384(const uint8_t* key, uint64_t keyLength, const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength, uint8_t* mac, uint32_t* macLength )
 {
     macSkein(key, keyLength, data, dataLength, mac, SKEIN384_DIGEST_LENGTH*8, SKEIN_SIZE);
     *macLength = SKEIN384_DIGEST_LENGTH;
@@ -51,8 +51,8 @@ void macSkein384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength, uint8_t
 }
 
 void macSkein384Ctx(void* ctx,
-                    const std::vector<const uint8_t*>& data,
-                    const std::vector<uint64_t>& dataLength,
+                    const ZrtpVector<const uint8_t*>& data,
+                    const ZrtpVector<uint64_t>& dataLength,
                     uint8_t* mac, uint32_t* macLength )
 {
     macSkeinCtx(ctx, data, dataLength, mac);
@@ -35,6 +35,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <common/zrtpAllocator.h>
 
 #ifndef SKEIN384_DIGEST_LENGTH
 #define SKEIN384_DIGEST_LENGTH 48
@@ -84,8 +85,8 @@ void macSkein384(const uint8_t* key, uint64_t key_length, const uint8_t* data, u
  *    Pointer to an uint32_t that receives the length of the computed HMAC.
  */
 void macSkein384(const uint8_t* key, uint64_t keyLength,
-                 const std::vector<const uint8_t*>& data,
-                 const std::vector<uint64_t>& dataLength,
+                 const ZrtpVector<const uint8_t*>& data,
+                 const ZrtpVector<uint64_t>& dataLength,
                  uint8_t* mac, uint32_t* mac_length);
 /**
  * @}
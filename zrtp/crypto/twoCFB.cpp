@@ -23,40 +23,75 @@
 
 #include <zrtp/crypto/twoCFB.h>
 #include <cryptcommon/twofish.h>
+#include <common/zrtpAllocator.h>
 
 static int initialized = 0;
 
-void twoCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+void* createTwoCfbContext(uint8_t* key, int32_t keyLength)
 {
-    Twofish_key keyCtx;
-    int usedBytes = 0;
-
     if (!initialized) {
         Twofish_initialise();
         initialized = 1;
     }
 
-    memset(&keyCtx, 0, sizeof(Twofish_key));
-    Twofish_prepare_key(key, keyLength, &keyCtx);
+    auto* keyCtx = static_cast<Twofish_key*>(zrtpMemAlloc(sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET));
+    if (keyCtx == NULL)
+        return NULL;
+    memset(keyCtx, 0, sizeof(Twofish_key));
+    if (!setTwoCfbContextKey(keyCtx, key, keyLength)) {
+        zrtpMemFree(keyCtx, sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+        return NULL;
+    }
+    return keyCtx;
+}
 
-    Twofish_cfb128_encrypt(&keyCtx, (Twofish_Byte*)data, (Twofish_Byte*)data,
-			   (size_t)dataLength, (Twofish_Byte*)IV, &usedBytes);
+int32_t setTwoCfbContextKey(void* ctx, uint8_t* key, int32_t keyLength)
+{
+    if (ctx == NULL)
+        return 0;
+    return (Twofish_prepare_key(key, keyLength, static_cast<Twofish_key*>(ctx)) < 0) ? 0 : 1;
 }
 
+void twoCfbEncryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    int usedBytes = 0;
+
+    Twofish_cfb128_encrypt(static_cast<Twofish_key*>(ctx), (Twofish_Byte*)data, (Twofish_Byte*)data,
+                           (size_t)dataLength, (Twofish_Byte*)IV, &usedBytes);
+}
 
-void twoCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+void twoCfbDecryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength)
 {
-    Twofish_key keyCtx;
     int usedBytes = 0;
 
-    if (!initialized) {
-        Twofish_initialise();
-        initialized = 1;
-    }
+    Twofish_cfb128_decrypt(static_cast<Twofish_key*>(ctx), (Twofish_Byte*)data, (Twofish_Byte*)data,
+                           (size_t)dataLength, (Twofish_Byte*)IV, &usedBytes);
+}
 
-    memset(&keyCtx, 0, sizeof(Twofish_key));
-    Twofish_prepare_key(key, keyLength, &keyCtx);
+void freeTwoCfbContext(void* ctx)
+{
+    if (ctx == NULL)
+        return;
+    zrtpMemFree(ctx, sizeof(Twofish_key), ZRTP_MEM_KEY | ZRTP_MEM_SECRET);
+}
+
+void twoCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    void* ctx = createTwoCfbContext(key, keyLength);
+    if (ctx == NULL)
+        return;
+
+    twoCfbEncryptCtx(ctx, IV, data, dataLength);
+    freeTwoCfbContext(ctx);
+}
+
+
+void twoCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    void* ctx = createTwoCfbContext(key, keyLength);
+    if (ctx == NULL)
+        return;
 
-    Twofish_cfb128_decrypt(&keyCtx, (Twofish_Byte*)data, (Twofish_Byte*)data, 
-			   (size_t)dataLength, (Twofish_Byte*)IV, &usedBytes);
+    twoCfbDecryptCtx(ctx, IV, data, dataLength);
+    freeTwoCfbContext(ctx);
 }
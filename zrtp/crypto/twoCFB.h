@@ -78,6 +78,74 @@ void twoCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
  */
 
 void twoCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength);
+/**
+ * Create a Twofish CFB context and prepare the key schedule.
+ *
+ * An application uses this context to encrypt or decrypt several data
+ * chunks with the same key without repeating the key schedule.
+ *
+ * @param key
+ *    Points to the key bytes.
+ * @param keyLength
+ *    Length of the key in bytes
+ * @return Returns a pointer to the initialized context or @c NULL if the
+ *    key length is not supported.
+ */
+void* createTwoCfbContext(uint8_t* key, int32_t keyLength);
+
+/**
+ * Replace the key schedule of a Twofish CFB context.
+ *
+ * Reuses the memory of the context for a new key.
+ *
+ * @param ctx
+ *    Pointer to Twofish CFB context
+ * @param key
+ *    Points to the key bytes.
+ * @param keyLength
+ *    Length of the key in bytes
+ * @return 1 on success, 0 if the key length is not supported.
+ */
+int32_t setTwoCfbContextKey(void* ctx, uint8_t* key, int32_t keyLength);
+
+/**
+ * Encrypt data with Twofish CFB mode using a prepared context.
+ *
+ * @param ctx
+ *    Pointer to Twofish CFB context
+ * @param IV
+ *    The initialization vector which must be TWO_BLOCK_SIZE (16) bytes.
+ * @param data
+ *    Points to a buffer that contains and receives the computed
+ *    the data (in-place encryption).
+ * @param dataLength
+ *    Length of the data in bytes
+ */
+void twoCfbEncryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength);
+
+/**
+ * Decrypt data with Twofish CFB mode using a prepared context.
+ *
+ * @param ctx
+ *    Pointer to Twofish CFB context
+ * @param IV
+ *    The initialization vector which must be TWO_BLOCK_SIZE (16) bytes.
+ * @param data
+ *    Points to a buffer that contains and receives the computed
+ *    the data (in-place decryption).
+ * @param dataLength
+ *    Length of the data in bytes
+ */
+void twoCfbDecryptCtx(void* ctx, uint8_t* IV, uint8_t *data, int32_t dataLength);
+
+/**
+ * Wipe the key schedule and free a Twofish CFB context.
+ *
+ * @param ctx
+ *    Pointer to Twofish CFB context, may be @c NULL
+ */
+void freeTwoCfbContext(void* ctx);
+
 /**
  * @}
  */
@@ -24,6 +24,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <common/zrtpAlgorithms.h>
+#include <common/zrtpAllocator.h>
 #include <bn.h>
 #include <bnprint.h>
 #include <ec/ec.h>
@@ -34,6 +36,7 @@
 #include <cryptcommon/ZrtpRandom.h>
 
 
+#if ZRTP_WITH_DH
 static BigNum bnP2048 = {0};
 static BigNum bnP3072 = {0};
 
@@ -43,19 +46,60 @@ static BigNum bnP3072MinusOne = {0};
 static BigNum two = {0};
 
 static uint8_t dhinit = 0;
+#endif
 
 typedef struct _dhCtx {
     BigNum privKey;
     BigNum pubKey;
+    BigNum peerKey;         ///< peer's DH public value
+    BigNum secret;          ///< DH or ECDH agreement
     EcCurve curve;
     EcPoint pubPoint;
+    EcPoint peerPoint;      ///< peer's EC public value
+    uint8_t* scratch;       ///< temporary limbs of the bnlib computations
+    uint32_t scratchSize;
 } dhCtx;
 
+/*
+ * Scratch sizes with headroom, the measured high water marks are 7.3 KB
+ * (DH3k modular exponentiation) and 224 bytes (EC38 inversion)
+ */
+static const uint32_t dhScratchSize = 12 * 1024;
+static const uint32_t ecScratchSize = 1024;
+
+/* Overwrite the limbs of a key value, the bnlib has no wipe function */
+static void wipeBigNum(BigNum* bn, uint32_t bytes)
+{
+    static const uint8_t zeros[3072/8] = {0};
+
+    if (bytes > sizeof(zeros))
+        bytes = sizeof(zeros);
+    bnInsertBigBytes(bn, zeros, 0, bytes);
+}
+
+/* Preallocate the coordinates of a point, curve values need p^2 plus one nimb */
+static void preallocPoint(EcPoint* point, const EcCurve* curve)
+{
+    unsigned bits = bnBits(curve->p) * 2 + 15;
+
+    bnPrealloc(point->x, bits);
+    bnPrealloc(point->y, bits);
+    bnPrealloc(point->z, bits);
+}
+
+/* Open a bnlib scratch window for the life time of a computation */
+class DhScratch {
+public:
+    explicit DhScratch(const dhCtx* ctx) { bnScratchBegin(ctx->scratch, ctx->scratchSize); }
+    ~DhScratch() { bnScratchEnd(); }
+};
+
 void randomZRTP(uint8_t *buf, int32_t length)
 {
     ZrtpRandom::getRandomData(buf, length);
 }
 
+#if ZRTP_WITH_DH
 static const uint8_t P2048[] =
 {
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xC9, 0x0F, 0xDA, 0xA2,
@@ -166,39 +210,48 @@ static const uint8_t P4096[] =
 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
 };
 *************** */
+#endif
 
 ZrtpDH::ZrtpDH(const char* type) {
 
-    uint8_t random[64];
-
-    dhCtx* tmpCtx = new dhCtx;
+    dhCtx* tmpCtx = zrtpNew<dhCtx>(ZRTP_MEM_KEY);
+    if (tmpCtx == NULL)
+        throw std::bad_alloc();
     ctx = static_cast<void*>(tmpCtx);
 
     // Well - the algo type is only 4 char thus cast to int32 and compare
-    if (*(int32_t*)type == *(int32_t*)dh2k) {
+    if (*(int32_t*)type == *(int32_t*)ec25) {
+        pkType = EC25;
+    }
+#if ZRTP_WITH_DH
+    else if (*(int32_t*)type == *(int32_t*)dh2k) {
         pkType = DH2K;
     }
     else if (*(int32_t*)type == *(int32_t*)dh3k) {
         pkType = DH3K;
     }
-    else if (*(int32_t*)type == *(int32_t*)ec25) {
-        pkType = EC25;
-    }
+#endif
+#if ZRTP_WITH_EC38
     else if (*(int32_t*)type == *(int32_t*)ec38) {
         pkType = EC38;
     }
+#endif
+#if ZRTP_WITH_NON_NIST
     else if (*(int32_t*)type == *(int32_t*)e255) {
         pkType = E255;
     }
     else if (*(int32_t*)type == *(int32_t*)e414) {
         pkType = E414;
     }
+#endif
     else {
+        zrtpDelete(tmpCtx, ZRTP_MEM_KEY);
+        ctx = nullptr;
+        pkType = -1;
         return;
     }
 
-    randomZRTP(random, sizeof(random));
-
+#if ZRTP_WITH_DH
     if (!dhinit) {
         bnBegin(&two);
         bnSetQ(&two, 2);
@@ -218,36 +271,62 @@ ZrtpDH::ZrtpDH(const char* type) {
 
         dhinit = 1;
     }
+#endif
 
     bnBegin(&tmpCtx->privKey);
+    bnBegin(&tmpCtx->pubKey);
+    bnBegin(&tmpCtx->peerKey);
+    bnBegin(&tmpCtx->secret);
     INIT_EC_POINT(&tmpCtx->pubPoint);
+    INIT_EC_POINT(&tmpCtx->peerPoint);
 
+    // Size all values once, the key generation and agreement then reuse them
     switch (pkType) {
+#if ZRTP_WITH_DH
     case DH2K:
     case DH3K:
-        bnInsertBigBytes(&tmpCtx->privKey, random, 0, 256/8);
+        bnPrealloc(&tmpCtx->privKey, 512);
+        bnPrealloc(&tmpCtx->pubKey, getDhSize() * 8 + 64);
+        bnPrealloc(&tmpCtx->peerKey, getDhSize() * 8 + 64);
+        bnPrealloc(&tmpCtx->secret, getDhSize() * 8 + 64);
+        tmpCtx->scratchSize = dhScratchSize;
         break;
+#endif
 
     case EC25:
         ecGetCurveNistECp(NIST256P, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
 
+#if ZRTP_WITH_EC38
     case EC38:
         ecGetCurveNistECp(NIST384P, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
+#endif
 
+#if ZRTP_WITH_NON_NIST
     case E255:
         ecGetCurvesCurve(Curve25519, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
 
     case E414:
         ecGetCurvesCurve(Curve3617, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
+#endif
+    }
+    if (pkType != DH2K && pkType != DH3K) {
+        unsigned bits = bnBits(tmpCtx->curve.p) * 2 + 15;
+
+        bnPrealloc(&tmpCtx->privKey, bits);
+        bnPrealloc(&tmpCtx->secret, bits);
+        preallocPoint(&tmpCtx->pubPoint, &tmpCtx->curve);
+        preallocPoint(&tmpCtx->peerPoint, &tmpCtx->curve);
+        tmpCtx->scratchSize = ecScratchSize;
     }
+    tmpCtx->scratch = static_cast<uint8_t*>(zrtpMemAlloc(tmpCtx->scratchSize, ZRTP_MEM_BIGNUM | ZRTP_MEM_SECRET));
+    if (tmpCtx->scratch == nullptr)
+        tmpCtx->scratchSize = 0;
+
+    generatePrivateKey();
 }
 
 ZrtpDH::~ZrtpDH() {
@@ -256,14 +335,13 @@ ZrtpDH::~ZrtpDH() {
 
     dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
     FREE_EC_POINT(&tmpCtx->pubPoint);
+    FREE_EC_POINT(&tmpCtx->peerPoint);
     bnEnd(&tmpCtx->privKey);
+    bnEnd(&tmpCtx->pubKey);
+    bnEnd(&tmpCtx->peerKey);
+    bnEnd(&tmpCtx->secret);
 
     switch (pkType) {
-    case DH2K:
-    case DH3K:
-        bnEnd(&tmpCtx->pubKey);
-        break;
-
     case EC25:
     case EC38:
         ecFreeCurveNistECp(&tmpCtx->curve);
@@ -274,73 +352,89 @@ ZrtpDH::~ZrtpDH() {
         ecFreeCurvesCurve(&tmpCtx->curve);
         break;
     }
-    delete tmpCtx;
+    if (tmpCtx->scratch != nullptr)
+        zrtpMemFree(tmpCtx->scratch, tmpCtx->scratchSize, ZRTP_MEM_BIGNUM | ZRTP_MEM_SECRET);
+    zrtpDelete(tmpCtx, ZRTP_MEM_KEY);
     ctx = nullptr;
 }
 
+void ZrtpDH::generatePrivateKey()
+{
+    dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
+    DhScratch scratch(tmpCtx);
+
+    switch (pkType) {
+#if ZRTP_WITH_DH
+    case DH2K:
+    case DH3K: {
+        uint8_t random[256/8];
+
+        randomZRTP(random, sizeof(random));
+        bnInsertBigBytes(&tmpCtx->privKey, random, 0, sizeof(random));
+        memset(random, 0, sizeof(random));
+        break;
+    }
+#endif
+
+    case EC25:
+    case EC38:
+    case E255:
+    case E414:
+        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        break;
+    }
+}
+
 int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
 
     dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
+    DhScratch scratch(tmpCtx);
 
     int32_t length = getDhSize();
 
-    BigNum sec;
+#if ZRTP_WITH_DH
     if (pkType == DH2K || pkType == DH3K) {
-        BigNum pubKeyOther;
-        bnBegin(&pubKeyOther);
-        bnBegin(&sec);
-
-        bnInsertBigBytes(&pubKeyOther, pubKeyBytes, 0, length);
+        bnInsertBigBytes(&tmpCtx->peerKey, pubKeyBytes, 0, length);
 
         if (pkType == DH2K) {
-            bnExpMod(&sec, &pubKeyOther, &tmpCtx->privKey, &bnP2048);
-        }
-        else if (pkType == DH3K) {
-            bnExpMod(&sec, &pubKeyOther, &tmpCtx->privKey, &bnP3072);
+            bnExpMod(&tmpCtx->secret, &tmpCtx->peerKey, &tmpCtx->privKey, &bnP2048);
         }
         else {
-            return 0;
+            bnExpMod(&tmpCtx->secret, &tmpCtx->peerKey, &tmpCtx->privKey, &bnP3072);
         }
-        bnEnd(&pubKeyOther);
-        bnExtractBigBytes(&sec, secret, 0, length);
-        bnEnd(&sec);
+        bnExtractBigBytes(&tmpCtx->secret, secret, 0, length);
+        wipeBigNum(&tmpCtx->secret, length);
 
         return length;
     }
+#endif
 
     if (pkType == EC25 || pkType == EC38 || pkType == E414) {
         int32_t len = getPubKeySize() / 2;
-        EcPoint pub;
+        EcPoint* pub = &tmpCtx->peerPoint;
 
-        bnBegin(&sec);
-        INIT_EC_POINT(&pub);
-        bnSetQ(pub.z, 1);               // initialze Z to one, these are affine coords
+        bnSetQ(pub->z, 1);               // initialze Z to one, these are affine coords
 
-        bnInsertBigBytes(pub.x, pubKeyBytes, 0, len);
-        bnInsertBigBytes(pub.y, pubKeyBytes+len, 0, len);
+        bnInsertBigBytes(pub->x, pubKeyBytes, 0, len);
+        bnInsertBigBytes(pub->y, pubKeyBytes+len, 0, len);
 
         /* Generate agreement for responder: sec = pub * privKey */
-        ecdhComputeAgreement(&tmpCtx->curve, &sec, &pub, &tmpCtx->privKey);
-        bnExtractBigBytes(&sec, secret, 0, length);
-        bnEnd(&sec);
-        FREE_EC_POINT(&pub);
+        ecdhComputeAgreement(&tmpCtx->curve, &tmpCtx->secret, pub, &tmpCtx->privKey);
+        bnExtractBigBytes(&tmpCtx->secret, secret, 0, length);
+        wipeBigNum(&tmpCtx->secret, length);
 
         return length;
     }
     if (pkType == E255) {
         int32_t len = getPubKeySize();
-        EcPoint pub;
-
-        bnBegin(&sec);
-        INIT_EC_POINT(&pub);
+        EcPoint* pub = &tmpCtx->peerPoint;
 
-        bnInsertLittleBytes(pub.x, pubKeyBytes, 0, len);
+        bnInsertLittleBytes(pub->x, pubKeyBytes, 0, len);
 
         /* Generate agreement for responder: sec = pub * privKey */
-        ecdhComputeAgreement(&tmpCtx->curve, &sec, &pub, &tmpCtx->privKey);
-        bnExtractLittleBytes(&sec, secret, 0, length);
-        bnEnd(&sec);
-        FREE_EC_POINT(&pub);
+        ecdhComputeAgreement(&tmpCtx->curve, &tmpCtx->secret, pub, &tmpCtx->privKey);
+        bnExtractLittleBytes(&tmpCtx->secret, secret, 0, length);
+        wipeBigNum(&tmpCtx->secret, length);
 
         return length;
     }
@@ -350,9 +444,10 @@ int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
 int32_t ZrtpDH::generatePublicKey()
 {
     dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
+    DhScratch scratch(tmpCtx);
 
-    bnBegin(&tmpCtx->pubKey);
     switch (pkType) {
+#if ZRTP_WITH_DH
     case DH2K:
         bnExpMod(&tmpCtx->pubKey, &two, &tmpCtx->privKey, &bnP2048);
         break;
@@ -360,6 +455,7 @@ int32_t ZrtpDH::generatePublicKey()
     case DH3K:
         bnExpMod(&tmpCtx->pubKey, &two, &tmpCtx->privKey, &bnP3072);
         break;
+#endif
 
     case EC25:
     case EC38:
@@ -371,6 +467,28 @@ int32_t ZrtpDH::generatePublicKey()
     return 0;
 }
 
+int32_t ZrtpDH::generateKeyPair()
+{
+    if (ctx == nullptr)
+        return 0;
+    generatePrivateKey();
+    generatePublicKey();
+    return 1;
+}
+
+void ZrtpDH::clearPrivateKey()
+{
+    if (ctx == nullptr)
+        return;
+    dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
+
+    // Wipe the whole preallocated range, the random reduction works in it
+    if (pkType == DH2K || pkType == DH3K)
+        wipeBigNum(&tmpCtx->privKey, 512/8);
+    else
+        wipeBigNum(&tmpCtx->privKey, (bnBits(tmpCtx->curve.p) * 2 + 15) / 8);
+}
+
 uint32_t ZrtpDH::getDhSize() const
 {
     switch (pkType) {
@@ -450,45 +568,39 @@ int32_t ZrtpDH::checkPubKey(uint8_t *pubKeyBytes) const
     if (pkType == EC25 || pkType == EC38 || pkType == E414) {
 
         dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
-        EcPoint pub;
+        DhScratch scratch(tmpCtx);
+        EcPoint* pub = &tmpCtx->peerPoint;
 
-        INIT_EC_POINT(&pub);
         int32_t len = getPubKeySize() / 2;
 
-        bnInsertBigBytes(pub.x, pubKeyBytes, 0, len);
-        bnInsertBigBytes(pub.y, pubKeyBytes+len, 0, len);
+        bnInsertBigBytes(pub->x, pubKeyBytes, 0, len);
+        bnInsertBigBytes(pub->y, pubKeyBytes+len, 0, len);
 
-        return ecCheckPubKey(&tmpCtx->curve, &pub);
+        return ecCheckPubKey(&tmpCtx->curve, pub);
     }
 
     if (pkType == E255) {
         return 1;
     }
 
-    BigNum pubKeyOther;
-    bnBegin(&pubKeyOther);
-    bnInsertBigBytes(&pubKeyOther, pubKeyBytes, 0, getDhSize());
-
-    if (pkType == DH2K) {
-        if (bnCmp(&bnP2048MinusOne, &pubKeyOther) == 0) {
-            return 0;
-        }
-    }
-    else if (pkType == DH3K) {
-        if (bnCmp(&bnP3072MinusOne, &pubKeyOther) == 0) {
-            return 0;
-
-        }
-    }
-    else {
-        return 0;
-    }
-    if (bnCmpQ(&pubKeyOther, 1) == 0) {
+#if ZRTP_WITH_DH
+    if (pkType != DH2K && pkType != DH3K) {
         return 0;
     }
 
-    bnEnd(&pubKeyOther);
-    return 1;
+    dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
+    BigNum* pubKeyOther = &tmpCtx->peerKey;
+    bnInsertBigBytes(pubKeyOther, pubKeyBytes, 0, getDhSize());
+
+    int32_t ret = 1;
+    if (bnCmp((pkType == DH2K) ? &bnP2048MinusOne : &bnP3072MinusOne, pubKeyOther) == 0 ||
+        bnCmpQ(pubKeyOther, 1) == 0) {
+        ret = 0;
+    }
+    return ret;
+#else
+    return 0;
+#endif
 }
 
 const char* ZrtpDH::getDHtype()
@@ -79,10 +79,18 @@ private:
     void* ctx;      ///< Context the DH
     int pkType;     ///< Which type of DH to use
 
+    void generatePrivateKey();
+
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
+
     /**
      * Create a Diffie-Helman key agreement algorithm
-     * 
+     *
+     * The constructor allocates all memory the key generation and the key
+     * agreement need and generates a random private key. A context may be
+     * reused for further agreements, see generateKeyPair().
+     *
      * @param type
      *     Name of the DH algorithm to use
      */
@@ -98,6 +106,24 @@ public:
      */
     int32_t generatePublicKey();
 
+    /**
+     * Generates a new random private key and its public key.
+     *
+     * Reuses the memory of the context, thus a context can serve one
+     * agreement after the other without memory allocation.
+     *
+     * @return 1 on success, 0 on failure
+     */
+    int32_t generateKeyPair();
+
+    /**
+     * Wipes the private key after the agreement.
+     *
+     * Call generateKeyPair() before the context takes part in the next
+     * agreement.
+     */
+    void clearPrivateKey();
+
     /**
      * Returns the size in bytes of the DH parameter p.
      *
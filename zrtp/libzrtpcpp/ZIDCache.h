@@ -15,6 +15,9 @@
  */
 
 #include <string>
+#include <cstring>
+#include <array>
+#include <future>
 
 #include "ZIDRecord.h"
 
@@ -103,6 +106,55 @@ public:
      */
     virtual ZIDRecord *getRecord(unsigned char *zid) =0;
 
+    /**
+     * @brief Create an empty record to use with readRecord().
+     *
+     * ZRTP creates one record when a session starts and reads the peer's
+     * record into it for each handshake, thus a handshake does not allocate
+     * a record.
+     *
+     * @return pointer to the new record, @c nullptr if the cache does not
+     *         support readRecord(). The caller must @c delete the record.
+     */
+    virtual ZIDRecord *createRecord() { return nullptr; }
+
+    /**
+     * @brief Read a ZID record into a record that createRecord() created.
+     *
+     * Works like getRecord() but fills the given record instead of a new one.
+     *
+     * @param zid is the ZRTP id of the peer
+     * @param zidRecord the record to fill
+     * @return true if the record holds the peer's data, false if the cache
+     *         does not support this method
+     */
+    virtual bool readRecord(unsigned char *zid, ZIDRecord *zidRecord) { (void)zid; (void)zidRecord; return false; }
+
+    /**
+     * @brief Start to read a ZID record and return without waiting for it.
+     *
+     * ZRTP calls this method as soon as the peer's Hello arrives. ZRTP needs
+     * the record to build its Commit, thus a background read overlaps the
+     * Hello checks, the algorithm selection and the DH key generation. The
+     * returned future provides the same record that getRecord() returns, the
+     * caller must @c delete the record if it is not longer used.
+     *
+     * The default implementation returns an invalid future, the caller
+     * reads the record when it needs it. The file cache uses its file handle
+     * without a lock, thus it must not read in another thread. The database
+     * cache serializes its calls with a lock and reads in a thread of its
+     * own, the thread and the future allocate memory.
+     *
+     * @param zid is the ZRTP id of the peer, the method copies the ZID
+     * @return future that provides the pointer to the ZID record. If the
+     *         future is not valid the caller uses readRecord() or getRecord()
+     *         instead.
+     */
+    virtual std::future<ZIDRecord*> getRecordAsync(const unsigned char *zid) {
+        (void)zid;
+        return std::future<ZIDRecord*>();
+    }
+
     /**
      * @brief Save a ZID record into the active ZID file.
      *
@@ -117,6 +169,23 @@ public:
      */
     virtual unsigned int saveRecord(ZIDRecord *zidRecord) =0;
 
+    /**
+     * @brief Start a batch of record updates.
+     *
+     * Until the matching endBatch() the cache may delay writing saved records to
+     * storage. The database cache writes the whole batch in one transaction, the
+     * file cache flushes once at the end. Batches may nest, only the outermost
+     * endBatch() writes. Use this when many calls end at the same time.
+     */
+    virtual void beginBatch() {};
+
+    /**
+     * @brief End a batch of record updates.
+     *
+     * @sa beginBatch()
+     */
+    virtual void endBatch() {};
+
     /**
      * @brief Get the ZID associated with this ZID file.
      *
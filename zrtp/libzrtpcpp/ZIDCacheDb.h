@@ -19,6 +19,7 @@
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZIDRecordDb.h>
 #include <libzrtpcpp/zrtpCacheDbBackend.h>
+#include <common/LockStats.h>
 
 #ifndef _ZIDCACHEDB_H_
 #define _ZIDCACHEDB_H_
@@ -56,12 +57,17 @@ private:
 
     char errorBuffer[DB_CACHE_ERR_BUFF_SIZE];
 
+    int32_t batchDepth;
+
+    static LockClass cacheLockClass;
+    InstrumentedMutex cacheLock;
+
     void createZIDFile(char* name);
     void formatOutput(remoteZidRecord_t *remZid, const char *nameBuffer, std::string *output);
 
 public:
 
-    ZIDCacheDb(): zidFile(NULL) {
+    ZIDCacheDb(): zidFile(NULL), batchDepth(0), cacheLock(cacheLockClass) {
         getDbCacheOps(&cacheOps);
     };
 
@@ -75,8 +81,18 @@ public:
 
     ZIDRecord *getRecord(unsigned char *zid);
 
+    ZIDRecord *createRecord() { return new ZIDRecordDb(); }
+
+    bool readRecord(unsigned char *zid, ZIDRecord *zidRecord);
+
+    std::future<ZIDRecord*> getRecordAsync(const unsigned char *zid);
+
     unsigned int saveRecord(ZIDRecord *zidRecord);
 
+    void beginBatch();
+
+    void endBatch();
+
     const unsigned char* getZid() { return associatedZid; };
 
     int32_t getPeerName(const uint8_t *peerZid, std::string *name);
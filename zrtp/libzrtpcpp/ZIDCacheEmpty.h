@@ -60,6 +60,10 @@ public:
 
     ZIDRecord *getRecord(unsigned char *zid) override;
 
+    ZIDRecord *createRecord() override { return new ZIDRecordEmpty(); }
+
+    bool readRecord(unsigned char *zid, ZIDRecord *zidRecord) override;
+
     unsigned int saveRecord(ZIDRecord *zidRecord) override;
 
     const unsigned char* getZid() override { return nullptr; };
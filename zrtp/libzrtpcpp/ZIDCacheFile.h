@@ -50,13 +50,14 @@ private:
 
     FILE* zidFile;
     unsigned char associatedZid[IDENTIFIER_LEN];
+    int32_t batchDepth;
 
     void createZIDFile(char* name);
     void checkDoMigration(char* name);
 
 public:
 
-    ZIDCacheFile(): zidFile(NULL) {};
+    ZIDCacheFile(): zidFile(NULL), batchDepth(0) {};
 
     ~ZIDCacheFile();
 
@@ -68,8 +69,16 @@ public:
 
     ZIDRecord *getRecord(unsigned char *zid);
 
+    ZIDRecord *createRecord() { return new ZIDRecordFile(); }
+
+    bool readRecord(unsigned char *zid, ZIDRecord *zidRecord);
+
     unsigned int saveRecord(ZIDRecord *zidRecord);
 
+    void beginBatch();
+
+    void endBatch();
+
     const unsigned char* getZid() { return associatedZid; };
 
     int32_t getPeerName(const uint8_t *peerZid, std::string *name);
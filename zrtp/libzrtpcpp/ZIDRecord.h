@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <common/osSpecifics.h>
+#include <common/zrtpAllocator.h>
 /**
  * @file ZIDRecord.h
  * @brief ZID cache record management
@@ -53,6 +54,8 @@
 class __EXPORT ZIDRecord {
 
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
+
     /**
      * @brief Destructor.
      * Define a virtual destructor to enable cleanup in derived classes.
@@ -25,6 +25,9 @@
 
 #include <cstdlib>
 
+#include <common/zrtpAllocator.h>
+
+#include <libzrtpcpp/ZrtpConfigProfile.h>
 #include <libzrtpcpp/ZrtpPacketHello.h>
 #include <libzrtpcpp/ZrtpPacketHelloAck.h>
 #include <libzrtpcpp/ZrtpPacketCommit.h>
@@ -41,6 +44,7 @@
 #include <libzrtpcpp/ZrtpPacketRelayAck.h>
 #include <libzrtpcpp/ZrtpCallback.h>
 #include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZrtpTrace.h>
 
 #include <cryptcommon/skeinApi.h>
 #ifdef ZRTP_OPENSSL
@@ -106,6 +110,7 @@ class ZRtp;
 class __EXPORT ZRtp {
 
     public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
 
     typedef enum _secrets {
         Rs1 = 1,
@@ -141,6 +146,15 @@ class __EXPORT ZRtp {
     ZRtp(uint8_t* myZid, ZrtpCallback* cb, std::string id,
          ZrtpConfigure* config, bool mitm = false, bool sasSignSupport= false);
 
+    /**
+     * Constructor that uses a compiled configuration profile.
+     *
+     * The engine shares the profile with other engines and keeps it until
+     * it is destroyed, it does not copy the configuration.
+     */
+    ZRtp(uint8_t* myZid, ZrtpCallback* cb, std::string id,
+         std::shared_ptr<const ZrtpConfigProfile> profile, bool mitm = false, bool sasSignSupport= false);
+
     /**
      * Destructor cleans up.
      */
@@ -449,6 +463,7 @@ class __EXPORT ZRtp {
      * 
      * @param sh the full SAS hash value, 32 bytes
      * @param render the SAS rendering algorithm
+     * @return @c false if the Confirm keys are not ready yet, @c true otherwise
      */
     bool sendSASRelayPacket(uint8_t* sh, std::string render);
 
@@ -655,6 +670,42 @@ class __EXPORT ZRtp {
       */
      void setT2Capping(int32_t capping);
 
+     /**
+      * Enable or disable fast start for this ZRTP session.
+      *
+      * Overwrites the setting of ZrtpConfigure::setFastStart(). Applications may
+      * enable fast start for example after signaling provided the peer's Hello
+      * hash. Setting this after ZRTP received the peer's Hello has no effect.
+      */
+     void setFastStart(bool yesNo) { fastStart = yesNo; }
+
+     /**
+      * Enable or disable paranoid mode for this ZRTP session.
+      *
+      * Overwrites the setting of ZrtpConfigure::setParanoidMode(). Set this
+      * before starting the engine.
+      */
+     void setParanoidMode(bool yesNo) { paranoidMode = yesNo; }
+
+     /**
+      * Use the ZID cache but do not update it.
+      *
+      * The engine uses the retained secrets of the cache for the handshake
+      * but does not store a new retained secret or flags. If several streams
+      * of one call run DH mode handshakes in parallel only one of them may
+      * update the cache, otherwise the peers may keep different retained
+      * secrets. Set this on the other streams before starting the engine and
+      * handle SAS verification on the stream that updates the cache.
+      *
+      * This is an interoperability constraint: the peer must update its cache
+      * with the same stream and use the other streams read only. A peer that
+      * updates its cache with every DH mode stream rolls RS1 more often than
+      * this engine and the next call reports a cache mismatch. Use this only
+      * if the application knows, for example by signaling, that the peer
+      * follows the same rule.
+      */
+     void setCacheReadOnly(bool yesNo) { cacheReadOnly = yesNo; }
+
      /**
       * @brief Get required buffer size to get all 32-bit statistic counters of ZRTP
       *
@@ -732,14 +783,21 @@ private:
     ZrtpCallback* callback;
 
     /**
-     * My active Diffie-Helman context
+     * My active Diffie-Helman context, points into dhContexts
      */
     ZrtpDH* dhContext;
 
     /**
-     * The computed DH shared secret
+     * Diffie-Helman contexts, created for the configured public key algorithms
+     * when the session starts and reused for each agreement
      */
-    uint8_t* DHss;
+    ZrtpDH* dhContexts[ZrtpConfigure::maxNoOfAlgos];
+    int32_t numDhContexts;
+
+    /**
+     * The computed DH shared secret, DH3k has the longest one
+     */
+    uint8_t DHss[3072 / 8];
 
     /**
      * My computed public key
@@ -759,6 +817,11 @@ private:
      */
     std::string SAS;
 
+    /**
+     * Cipher and key agreement description for srtpSecretsOn, reserved with the session
+     */
+    std::string cipherInfo;
+
     /**
      * The SAS hash for signaling and alike. Refer to chapters
      * 4.5 and 7 how sasHash, sasValue and the SAS string are derived.
@@ -782,6 +845,7 @@ private:
      */
     uint8_t* auxSecret;
     uint32_t auxSecretLength;
+    uint32_t auxSecretSize;         // size of the aux secret storage
 
     /**
      * Record if valid rs1 and/or rs1 were found in the
@@ -878,13 +942,31 @@ private:
     uint8_t zrtpKeyI[MAX_DIGEST_LENGTH];
     uint8_t zrtpKeyR[MAX_DIGEST_LENGTH];
 
+    /**
+     * Prepared cipher contexts for zrtpKeyI and zrtpKeyR, avoids the key schedule for
+     * each Confirm and SASrelay packet. zrtpCipherFuncs is set when the contexts
+     * hold the keys of the current handshake.
+     */
+    void* zrtpCipherI;
+    void* zrtpCipherR;
+    const cipherContext_t* zrtpCipherFuncs;
+
+    /**
+     * Cipher context pairs, one per cipher implementation. The constructor creates
+     * them for the configured ciphers, the handshakes only set new keys.
+     */
+    const cipherContext_t* cipherPoolFuncs[ZrtpConfigure::maxNoOfAlgos];
+    void* cipherPoolI[ZrtpConfigure::maxNoOfAlgos];
+    void* cipherPoolR[ZrtpConfigure::maxNoOfAlgos];
+    int32_t numCipherPool;
+
     HashCtx hashCtx;
 
     /**
      * Pointers to negotiated hash and HMAC functions
      */
-    void (*hashListFunction)(const std::vector<const uint8_t*>& data,
-                             const std::vector<uint64_t>& dataLength,
+    void (*hashListFunction)(const ZrtpVector<const uint8_t*>& data,
+                             const ZrtpVector<uint64_t>& dataLength,
                              uint8_t *digest);
 
     void (*hmacFunction)(const uint8_t* key, uint64_t key_length,
@@ -892,8 +974,8 @@ private:
                          uint8_t* mac, uint32_t* mac_length);
 
     void (*hmacListFunction)(const uint8_t* key, uint64_t key_length,
-                             const std::vector<const uint8_t*>& data,
-                             const std::vector<uint64_t>& data_length,
+                             const ZrtpVector<const uint8_t*>& data,
+                             const ZrtpVector<uint64_t>& data_length,
                              uint8_t* mac, uint32_t* mac_length );
 
     void* (*createHashCtx)(void* ctx);
@@ -973,9 +1055,14 @@ private:
     bool enrollmentMode;
 
     /**
-     * Configuration data which algorithms to use.
+     * The configuration profile, shared with other engines.
      */
-    ZrtpConfigure configureAlgos;
+    std::shared_ptr<const ZrtpConfigProfile> configProfile;
+
+    /**
+     * Configuration data which algorithms to use, owned by the profile.
+     */
+    const ZrtpConfigure& configureAlgos;
     /**
      * Pre-initialized packets.
      */
@@ -1008,12 +1095,27 @@ private:
      */
     ZIDRecord *zidRec;
 
+    /**
+     * Record that fetchZidRecord() reads into, created with the session
+     */
+    ZIDRecord *zidRecStore;
+
+    /**
+     * Pending read of the peer's ZID cache record, started when the peer's Hello arrives
+     */
+    std::future<ZIDRecord*> zidRecPending;
+
     /**
      * Save record
      * 
      * If false don't save record until user verified and confirmed the SAS.
      */
     bool saveZidRecord;
+
+    /**
+     * If true don't change the retained secrets and don't save the record.
+     */
+    bool cacheReadOnly;
     /**
      * Random IV data to encrypt the confirm data, 128 bit for AES
      */
@@ -1022,6 +1124,12 @@ private:
     uint8_t tempMsgBuffer[1024];
     uint32_t lengthOfMsgData;
 
+    /**
+     * Scratch lists for the hash and KDF computations, avoid allocations per handshake
+     */
+    ZrtpVector<const uint8_t*> hashChunks;
+    ZrtpVector<uint64_t> hashChunkLength;
+
     /**
      * Variables to store signature data. Includes the signature type block
      */
@@ -1073,6 +1181,18 @@ private:
      */
     bool paranoidMode;
 
+    /**
+     * Answer the peer's Hello with a Commit if the peer already acknowledged our Hello.
+     *
+     * Refer to ZrtpConfigure::setFastStart().
+     */
+    bool fastStart;
+
+    /**
+     * Identifies this instance in the handshake trace, refer to ZrtpTrace.
+     */
+    uint32_t traceId;
+
     /**
      * Is true if the other peer sent a Disclosure flag in its Confirm packet.
      */
@@ -1251,10 +1371,71 @@ private:
 
     void computeSharedSecretSet(ZIDRecord *zidRec);
 
+    /**
+     * Start to read the peer's ZID cache record.
+     *
+     * If the cache reads in the background the read overlaps with the DH
+     * key generation and the wait for the peer's HelloAck or Commit. A
+     * pending read or a record for a previous Hello is discarded.
+     */
+    void prefetchZidRecord();
+
+    /**
+     * Get the peer's ZID cache record, wait for a pending read if necessary.
+     */
+    ZIDRecord* fetchZidRecord();
+
+    /**
+     * Get the DH context of a public key algorithm and generate a new key pair.
+     *
+     * Creates the context only if the algorithm is not configured.
+     *
+     * @return
+     *    The DH context or @c nullptr if the algorithm is no DH algorithm
+     */
+    ZrtpDH* prepareDhContext(AlgorithmEnum* pk);
+
+    /**
+     * Write a record to the handshake trace if tracing is active.
+     *
+     * Fills in the trace id, the current state, role and stream mode.
+     */
+    void traceEvent(uint8_t event, uint8_t message = 0, uint32_t data = 0, uint16_t length = 0, uint8_t retries = 0);
+
+    /**
+     * Write the negotiated algorithms to the handshake trace.
+     */
+    void traceAlgorithms();
+
     void computeAuxSecretIds();
 
     void computeSRTPKeys();
 
+    /**
+     * Prepare the cipher contexts for zrtpKeyI and zrtpKeyR.
+     *
+     * Sets the keys in the pooled contexts of the negotiated cipher, creates new
+     * contexts only if the pool has none for this cipher.
+     */
+    void createZrtpCiphers();
+
+    /**
+     * Create a pooled cipher context pair.
+     *
+     * @param funcs
+     *    The cipher functions.
+     * @param keyLength
+     *    Key length for the initial all-zero key.
+     * @return
+     *    Index into the pool or -1 if the pool is full or the cipher failed.
+     */
+    int32_t addCipherPool(const cipherContext_t* funcs, int32_t keyLength);
+
+    /**
+     * Wipe and free the cipher contexts of zrtpKeyI and zrtpKeyR.
+     */
+    void freeZrtpCiphers();
+
     void KDF(uint8_t* key, size_t keyLength, uint8_t* label, size_t labelLength,
                uint8_t* context, size_t contextLength, size_t L, uint8_t* output);
 
@@ -1343,6 +1524,35 @@ private:
      */
     ZrtpPacketCommit* prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg);
 
+    /**
+     * Check the peer's Hello packet and select the algorithms.
+     *
+     * This is the first part of prepareCommit(). It starts to read the
+     * peer's ZID cache record, generates the DH key and stores the Hello.
+     * The state engine calls it as soon as the Hello arrives and calls
+     * finishCommit() only if it sends a Commit, thus the cache read overlaps
+     * the wait for the peer's answer.
+     *
+     * @param hello
+     *    Points to the received Hello packet
+     * @param errMsg
+     *    Points to an integer that can hold a ZRTP error code.
+     * @return
+     *    False if the Hello is not acceptable, @c errMsg holds the error code
+     */
+    bool acceptPeerHello(ZrtpPacketHello *hello, uint32_t* errMsg);
+
+    /**
+     * Build the Commit packet for the Hello that acceptPeerHello() accepted.
+     *
+     * Waits for the peer's ZID cache record, computes the retained secret ids
+     * and the HVI.
+     *
+     * @return
+     *    A pointer to the prepared Commit packet
+     */
+    ZrtpPacketCommit* finishCommit();
+
     /**
      * Prepare a Commit packet for Multi Stream mode.
      *
@@ -1475,8 +1685,12 @@ private:
      *
      * This method prepares the RelayAck packet. The input to this method is the
      * SASrelay packet received from the peer.
+     *
+     * @return the RelayAck packet or @c nullptr if the SASrelay is not valid.
+     *     @c errMsg is @c IgnorePacket if the SASrelay arrived before the
+     *     Confirm keys were ready.
      */
-    ZrtpPacketRelayAck* prepareRelayAck(ZrtpPacketSASrelay* srly, const uint32_t* errMsg);
+    ZrtpPacketRelayAck* prepareRelayAck(ZrtpPacketSASrelay* srly, uint32_t* errMsg);
 #if 0
     /**
      * Prepare a GoClearAck packet w/o HMAC
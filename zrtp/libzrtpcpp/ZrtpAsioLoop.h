@@ -0,0 +1,104 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPASIOLOOP_H_
+#define _ZRTPASIOLOOP_H_
+
+/**
+ * @file ZrtpAsioLoop.h
+ * @brief Event loop backend for asio style loops
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <chrono>
+#include <memory>
+
+#include <libzrtpcpp/ZrtpEventLoop.h>
+
+/**
+ * Event loop backend for asio style loops.
+ *
+ * The backend is a template on the steady timer type of the loop, thus
+ * the library does not depend on asio. It works with Boost.Asio and with
+ * standalone asio:
+ *
+ * @code
+ * boost::asio::io_context context;
+ * ZrtpAsioLoop<boost::asio::steady_timer> zrtpLoop(context);
+ * @endcode
+ *
+ * The backend uses one steady timer for the timers of all ZRTP sessions on
+ * the loop. The application receives RTP packets with its own asynchronous
+ * socket operations and feeds them to the ZRTP and SRTP functions in its
+ * completion handlers, which run on the same loop thread.
+ *
+ * The loop object must outlive the timers that use it. Completion handlers
+ * that are still queued when the loop object goes away do nothing.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+template <class SteadyTimer>
+class ZrtpAsioLoop : public ZrtpEventLoop {
+public:
+    /**
+     * @brief Create an asio backend.
+     *
+     * @param context the execution context or executor for the steady timer
+     */
+    template <class ExecutionContext>
+    explicit ZrtpAsioLoop(ExecutionContext& context): timer(context), self(new ZrtpAsioLoop*(this)) {}
+
+    ~ZrtpAsioLoop() {
+        *self = NULL;
+        timer.cancel();
+    }
+
+protected:
+    void scheduleWakeup(int32_t time) {
+        if (time < 0) {
+            timer.cancel();
+            return;
+        }
+        timer.expires_after(std::chrono::milliseconds(time));
+        timer.async_wait(WaitHandler(self));
+    }
+
+private:
+    // Also called with a success code if the timer was re-armed after it
+    // expired, such an early runTimers() does no harm.
+    class WaitHandler {
+    public:
+        explicit WaitHandler(const std::shared_ptr<ZrtpAsioLoop*>& loop): loop(loop) {}
+
+        template <class ErrorCode>
+        void operator()(const ErrorCode& error) const {
+            if (!error && *loop != NULL)
+                (*loop)->runTimers();
+        }
+    private:
+        std::shared_ptr<ZrtpAsioLoop*> loop;
+    };
+
+    SteadyTimer timer;
+    std::shared_ptr<ZrtpAsioLoop*> self;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPASIOLOOP_H_
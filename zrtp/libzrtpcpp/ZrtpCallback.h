@@ -127,6 +127,34 @@ protected:
      */
     virtual int32_t sendDataZRTP(const uint8_t* data, int32_t length) =0;
 
+    /**
+     * Send a ZRTP packet via RTP without copying the message data.
+     *
+     * ZRTP calls this method instead of sendDataZRTP() if the ZRTP message
+     * is stored in a transport frame. The frame starts with
+     * @c ZRTP_FRAME_HEADROOM (12) free bytes to store the fixed ZRTP packet
+     * header, followed by the ZRTP message which already contains a 4 bytes
+     * storage at the end to store CRC. @c ZRTP_FRAME_TAILROOM free bytes follow
+     * the CRC storage.
+     *
+     * The method may modify the headroom, the CRC storage and the tailroom
+     * only, it must not modify the ZRTP message because ZRTP resends the
+     * same message if it does not receive an answer. The frame is valid only
+     * during this call.
+     *
+     * The default implementation returns -1, ZRTP then calls sendDataZRTP().
+     *
+     * @param frame
+     *    Points to the first byte of the headroom in front of the ZRTP message.
+     * @param length
+     *    The length in bytes of the ZRTP message, including the CRC storage
+     *    but not including head- and tailroom.
+     * @return
+     *    zero if sending failed, one if packet was send, -1 if the method
+     *    cannot send this frame and ZRTP shall use sendDataZRTP().
+     */
+    virtual int32_t sendFrameZRTP(uint8_t* frame, int32_t length) { (void)frame; (void)length; return -1; }
+
     /**
      * Activate timer.
      *
@@ -218,7 +246,7 @@ protected:
      * @param verified if <code>verified</code> is true then SAS was
      *    verified by both parties during a previous call.
      */
-    virtual void srtpSecretsOn(std::string c, std::string s, bool verified) =0;
+    virtual void srtpSecretsOn(const std::string& c, const std::string& s, bool verified) =0;
 
     /**
      * This method handles GoClear requests.
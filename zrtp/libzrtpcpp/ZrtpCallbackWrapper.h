@@ -64,7 +64,7 @@ public:
 
     void srtpSecretsOff ( EnableSecurity part );
 
-    void srtpSecretsOn ( std::string c, std::string s, bool verified );
+    void srtpSecretsOn ( const std::string& c, const std::string& s, bool verified );
 
     void handleGoClear();
 
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPCONFIGPROFILE_H_
+#define _ZRTPCONFIGPROFILE_H_
+
+/**
+ * @file ZrtpConfigProfile.h
+ * @brief Immutable, shared ZRTP configuration profiles
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include <libzrtpcpp/ZrtpConfigure.h>
+
+/**
+ * A compiled, immutable ZRTP configuration.
+ *
+ * A profile holds a copy of a ZrtpConfigure object and the algorithm
+ * block of the Hello packet rendered from it. Many ZRtp instances share
+ * one profile by pointer, they neither copy the algorithm lists nor
+ * render the Hello algorithms again.
+ *
+ * Applications usually compile one profile per tenant or client
+ * configuration and publish it under a name. Publishing a profile under
+ * an existing name replaces the old profile atomically: new sessions get
+ * the new profile, running sessions keep the profile they started with
+ * until they end.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpConfigProfile {
+public:
+    /**
+     * @brief Compile a profile.
+     *
+     * @param name name of the profile, may be empty for anonymous profiles
+     * @param config the configuration, the profile takes a copy
+     * @return the profile
+     */
+    static std::shared_ptr<const ZrtpConfigProfile> compile(const std::string& name, const ZrtpConfigure& config);
+
+    /**
+     * @brief Publish a profile under its name.
+     *
+     * Replaces a profile with the same name.
+     *
+     * @param profile the profile, must have a name
+     * @return false if the profile has no name
+     */
+    static bool publish(const std::shared_ptr<const ZrtpConfigProfile>& profile);
+
+    /**
+     * @brief Find a published profile.
+     *
+     * @param name name of the profile
+     * @return the profile or an empty pointer if no profile has this name
+     */
+    static std::shared_ptr<const ZrtpConfigProfile> find(const std::string& name);
+
+    /**
+     * @brief Remove a profile from the published profiles.
+     *
+     * Sessions that use the profile keep it until they end.
+     *
+     * @param name name of the profile
+     * @return false if no profile has this name
+     */
+    static bool withdraw(const std::string& name);
+
+    /// Name of the profile
+    const std::string& getName() const { return name; }
+
+    /// The configuration of this profile
+    const ZrtpConfigure& getConfigure() const { return config; }
+
+    /**
+     * @brief Get the Hello algorithm block.
+     *
+     * The block holds the algorithm names in the order of the Hello packet:
+     * hash, cipher, auth length, public key and SAS type.
+     *
+     * @param length receives the length of the block in bytes
+     * @return pointer to the block
+     */
+    const uint8_t* getHelloAlgos(int32_t* length) const { *length = helloAlgosLength; return helloAlgos; }
+
+private:
+    ZrtpConfigProfile(const std::string& name, const ZrtpConfigure& config);
+
+    ZrtpConfigProfile(const ZrtpConfigProfile& other);
+    ZrtpConfigProfile& operator=(const ZrtpConfigProfile& other);
+
+    const std::string name;
+    const ZrtpConfigure config;
+
+    int32_t helloAlgosLength;
+    uint8_t helloAlgos[5 * ZrtpConfigure::maxNoOfAlgos * 4];    // 4 byte names of 5 algorithm types
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPCONFIGPROFILE_H_
@@ -35,6 +35,8 @@
 #include <vector>
 #include <string.h>
 
+#include <common/zrtpAllocator.h>
+
 #include <libzrtpcpp/ZrtpCallback.h>
 
 /**
@@ -48,6 +50,20 @@ enum AlgoTypes {
 typedef void(*encrypt_t)(uint8_t*, int32_t, uint8_t*, uint8_t*, int32_t);
 typedef void(*decrypt_t)(uint8_t*, int32_t, uint8_t*, uint8_t*, int32_t);
 
+/**
+ * Functions to use a symmetric cipher with a prepared key schedule.
+ *
+ * ZRTP uses these functions to encrypt and decrypt several Confirm and
+ * SASrelay packets with the same key without repeating the key schedule.
+ */
+typedef struct _cipherContext {
+    void* (*create)(uint8_t* key, int32_t keyLength);                       ///< prepare key schedule, returns context
+    int32_t (*setKey)(void* ctx, uint8_t* key, int32_t keyLength);          ///< replace key schedule, 0 if key length not supported
+    void (*encrypt)(void* ctx, uint8_t* IV, uint8_t* data, int32_t length); ///< encrypt in place
+    void (*decrypt)(void* ctx, uint8_t* IV, uint8_t* data, int32_t length); ///< decrypt in place
+    void (*free)(void* ctx);                                                 ///< wipe key schedule and free context
+} cipherContext_t;
+
 /**
  * The algorithm enumration class.
  *
@@ -79,11 +95,14 @@ public:
      * @param alId
      *    The algorithm id used by SRTP to identify an algorithm type, for
      *    example Skein, Sha1, Aes, ...
+     * @param ctx
+     *    Pointer to the cipher context functions of this algorithm.
      *
      * @see AlgoTypes
      */
     AlgorithmEnum(const AlgoTypes type, const char* name, uint32_t klen,
-                  const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId);
+                  const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId,
+                  const cipherContext_t* ctx = NULL);
 
     /**
      * AlgorithmEnum destructor
@@ -99,6 +118,30 @@ public:
      */
     const char* getName();
 
+    /**
+     * Get the algorithm's name as 32 bit word.
+     *
+     * The word holds the 4 name bytes in wire order, compare it with the
+     * result of @c nameToId for a name in a received packet.
+     *
+     * @returns
+     *    The name id, 0 for the invalid algorithm.
+     */
+    uint32_t getNameId() const { return nameId; }
+
+    /**
+     * Convert an algorithm name to a name id.
+     *
+     * Reads at most 4 bytes, a shorter nul terminated name is padded with
+     * zero bytes.
+     *
+     * @param name
+     *    The name, for example the name field in a Hello packet.
+     * @returns
+     *    The name id, see @c getNameId.
+     */
+    static uint32_t nameToId(const char* name);
+
     /**
      * Get the algorihm's readable name
      *
@@ -139,6 +182,15 @@ public:
      */
     decrypt_t getDecrypt();
 
+    /**
+     * Get the algorihm's cipher context functions.
+     *
+     * @returns
+     *    Pointer to the cipher context functions or @c NULL if the algorithm
+     *    is not a symmetric cipher.
+     */
+    const cipherContext_t* getCipherContext();
+
     /**
      * Get the algorithm type of this AlgorithmEnum object.
      *
@@ -160,11 +212,13 @@ public:
 private:
     AlgoTypes algoType;
     std::string algoName;
+    uint32_t   nameId;
     uint32_t   keyLen;
     std::string readable;
     encrypt_t encrypt;
     decrypt_t decrypt;
     SrtpAlgorithms   algoId;
+    const cipherContext_t* cipherContext;
 };
 
 /**
@@ -194,6 +248,18 @@ public:
      */
     AlgorithmEnum& getByName(const char* name);
 
+    /**
+     * Get an AlgorithmEnum by its name id
+     *
+     * @param id
+     *    The name id of the AlgorithmEnum to search, see
+     *    AlgorithmEnum::nameToId.
+     * @returns
+     *    The AlgorithmEnum if found or an invalid AlgorithmEnum if the id
+     *    was not found
+     */
+    AlgorithmEnum& getById(uint32_t id);
+
     /**
      * Return all names of all currently stored AlgorithmEnums
      *
@@ -246,7 +312,8 @@ protected:
     ~EnumBase();
     void insert(const char* name);
     void insert(const char* name, uint32_t klen,
-                const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId);
+                const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId,
+                const cipherContext_t* ctx = NULL);
 
 private:
     AlgoTypes algoType;
@@ -310,6 +377,8 @@ extern __EXPORT AuthLengthEnum zrtpAuthLengths;
  */
 class __EXPORT ZrtpConfigure {
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT)
+
     ZrtpConfigure();         /* Creates Configuration data */
     ~ZrtpConfigure();
 
@@ -426,7 +495,7 @@ public:
      *    The number of configured algorithms (used configuration
      *    data slots)
      */
-    int32_t getNumConfiguredAlgos(AlgoTypes algoType);
+    int32_t getNumConfiguredAlgos(AlgoTypes algoType) const;
 
     /**
      * Returns the identifier of the algorithm at index.
@@ -441,7 +510,7 @@ public:
      *    returns NULL.
      *
      */
-    AlgorithmEnum& getAlgoAt(AlgoTypes algoType, int32_t index);
+    AlgorithmEnum& getAlgoAt(AlgoTypes algoType, int32_t index) const;
 
     /**
      * Checks if the configuration data of the algorihm type already contains
@@ -455,7 +524,7 @@ public:
      *    True if the algorithm was found, false otherwise.
      *
      */
-    bool containsAlgo(AlgoTypes algoType, AlgorithmEnum& algo);
+    bool containsAlgo(AlgoTypes algoType, AlgorithmEnum& algo) const;
 
     /**
      * Enables or disables trusted MitM processing.
@@ -474,7 +543,7 @@ public:
      * @return
      *    Returns true if trusted MitM processing is enabled.
      */
-    bool isTrustedMitM();
+    bool isTrustedMitM() const;
 
     /**
      * Enables or disables SAS signature processing.
@@ -493,7 +562,7 @@ public:
      * @return
      *    Returns true if certificate processing is enabled.
      */
-    bool isSasSignature();
+    bool isSasSignature() const;
 
     /**
      * Enables or disables paranoid mode.
@@ -512,7 +581,7 @@ public:
      * @return
      *    Returns true if paranoid mode is enabled.
      */
-    bool isParanoidMode();
+    bool isParanoidMode() const;
 
     /**
      * Enables or disables setting of Disclosure flag.
@@ -530,36 +599,62 @@ public:
      * @return
      *    Returns true if disclosure falg should be set.
      */
-    bool isDisclosureFlag();
+    bool isDisclosureFlag() const;
+
+    /**
+     * Enables or disables fast start.
+     *
+     * If fast start is enabled and the peer acknowledged our Hello then ZRTP
+     * answers the peer's Hello with a Commit instead of a HelloAck, refer to
+     * RFC6189, chapter 4.1. This saves one round trip. The peer must
+     * accept a Commit as implicit HelloAck, which the RFC requires.
+     *
+     * An application may enable fast start for example if the signaling
+     * already provided the peer's Hello hash (a=zrtp-hash).
+     *
+     * @param yesNo
+     *    If set to true then fast start is enabled.
+     */
+    void setFastStart(bool yesNo);
+
+    /**
+     * Check status of fast start.
+     *
+     * @return
+     *    Returns true if fast start is enabled.
+     */
+    bool isFastStart() const;
 
     /// Helper function to print some internal data
-    void printConfiguredAlgos(AlgoTypes algoTyp);
+    void printConfiguredAlgos(AlgoTypes algoTyp) const;
 
-    Policy getSelectionPolicy()         {return selectionPolicy;}
+    Policy getSelectionPolicy() const   {return selectionPolicy;}
     void setSelectionPolicy(Policy pol) {selectionPolicy = pol;}
 
   private:
-    std::vector<AlgorithmEnum* > hashes;
-    std::vector<AlgorithmEnum* > symCiphers;
-    std::vector<AlgorithmEnum* > publicKeyAlgos;
-    std::vector<AlgorithmEnum* > sasTypes;
-    std::vector<AlgorithmEnum* > authLengths;
+    ZrtpVector<AlgorithmEnum* > hashes;
+    ZrtpVector<AlgorithmEnum* > symCiphers;
+    ZrtpVector<AlgorithmEnum* > publicKeyAlgos;
+    ZrtpVector<AlgorithmEnum* > sasTypes;
+    ZrtpVector<AlgorithmEnum* > authLengths;
 
     bool enableTrustedMitM;
     bool enableSasSignature;
     bool enableParanoidMode;
     bool enableDisclosureFlag;
+    bool enableFastStart;
 
 
-    AlgorithmEnum& getAlgoAt(std::vector<AlgorithmEnum* >& a, int32_t index);
-    int32_t addAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo);
-    int32_t addAlgoAt(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo, int32_t index);
-    int32_t removeAlgo(std::vector<AlgorithmEnum* >& a,  AlgorithmEnum& algo);
-    int32_t getNumConfiguredAlgos(std::vector<AlgorithmEnum* >& a);
-    bool containsAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo);
-    std::vector<AlgorithmEnum* >& getEnum(AlgoTypes algoType);
+    AlgorithmEnum& getAlgoAt(const ZrtpVector<AlgorithmEnum* >& a, int32_t index) const;
+    int32_t addAlgo(ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo);
+    int32_t addAlgoAt(ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo, int32_t index);
+    int32_t removeAlgo(ZrtpVector<AlgorithmEnum* >& a,  AlgorithmEnum& algo);
+    int32_t getNumConfiguredAlgos(const ZrtpVector<AlgorithmEnum* >& a) const;
+    bool containsAlgo(const ZrtpVector<AlgorithmEnum* >& a, AlgorithmEnum& algo) const;
+    ZrtpVector<AlgorithmEnum* >& getEnum(AlgoTypes algoType);
+    const ZrtpVector<AlgorithmEnum* >& getEnum(AlgoTypes algoType) const;
 
-    void printConfiguredAlgos(std::vector<AlgorithmEnum* >& a);
+    void printConfiguredAlgos(const ZrtpVector<AlgorithmEnum* >& a) const;
 
     Policy selectionPolicy;
 
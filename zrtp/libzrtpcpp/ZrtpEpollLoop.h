@@ -0,0 +1,163 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPEPOLLLOOP_H_
+#define _ZRTPEPOLLLOOP_H_
+
+/**
+ * @file ZrtpEpollLoop.h
+ * @brief Event loop backend for Linux epoll
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <sys/epoll.h>
+
+#include <libzrtpcpp/ZrtpEventLoop.h>
+
+/**
+ * Handler for file descriptors registered with a ZrtpEpollLoop.
+ */
+class __EXPORT ZrtpIoHandler {
+public:
+    virtual ~ZrtpIoHandler() {}
+
+    /**
+     * @brief The file descriptor of this handler is ready.
+     *
+     * @param events the epoll events, for example @c EPOLLIN
+     */
+    virtual void ioReady(uint32_t events) =0;
+};
+
+/**
+ * Event loop backend for Linux epoll.
+ *
+ * The backend uses one @c timerfd for the timers of all ZRTP sessions of
+ * the loop. It either creates its own epoll instance or uses the epoll
+ * instance of the application. The backend registers file descriptors
+ * with a pointer to their ZrtpIoHandler in @c epoll_event.data.ptr.
+ *
+ * An application that has no loop yet uses poll() as its loop and adds
+ * its RTP sockets with addReader(). The handlers read the packets and feed
+ * them to the ZRTP and SRTP functions:
+ *
+ * @code
+ * ZrtpEpollLoop loop;
+ * loop.addReader(rtpSocket, &rtpHandler);
+ * while (running)
+ *     loop.poll(-1);
+ * @endcode
+ *
+ * An application with its own epoll loop either gives its epoll file
+ * descriptor to the constructor and calls dispatch() for the events of
+ * the ZRTP registrations, or registers getTimerFd() itself and calls
+ * timerReady() when the timer file descriptor is readable.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpEpollLoop : public ZrtpEventLoop {
+public:
+    /**
+     * @brief Create an epoll backend.
+     *
+     * @param epollFd epoll instance of the application, -1 to create a
+     *        new epoll instance that the backend owns
+     */
+    explicit ZrtpEpollLoop(int epollFd = -1);
+
+    ~ZrtpEpollLoop();
+
+    /// False if the backend could not create its file descriptors
+    bool isValid() const { return epollFd >= 0 && timerFd >= 0; }
+
+    /// The epoll file descriptor
+    int getEpollFd() const { return epollFd; }
+
+    /// The timer file descriptor
+    int getTimerFd() const { return timerFd; }
+
+    /**
+     * @brief Watch a file descriptor for input.
+     *
+     * @param fd the file descriptor, usually a non-blocking RTP socket
+     * @param handler the handler to call if @c fd is readable
+     * @return false if epoll refused the file descriptor
+     */
+    bool addReader(int fd, ZrtpIoHandler* handler);
+
+    /**
+     * @brief Stop watching a file descriptor.
+     *
+     * @param fd the file descriptor
+     * @return false if the file descriptor was not registered
+     */
+    bool removeReader(int fd);
+
+    /**
+     * @brief Wait for events and dispatch them.
+     *
+     * @param maxWait maximum wait time in milliseconds, -1 to wait until
+     *        an event arrives
+     * @return number of dispatched events, -1 on error
+     */
+    int32_t poll(int32_t maxWait);
+
+    /**
+     * @brief Dispatch an event of a ZRTP registration.
+     *
+     * Only for events of file descriptors that addReader() registered and
+     * for the timer file descriptor.
+     *
+     * @param event the event as returned by @c epoll_wait()
+     */
+    static void dispatch(const struct epoll_event& event);
+
+    /**
+     * @brief Handle the readable timer file descriptor.
+     *
+     * For applications that registered getTimerFd() themselves.
+     */
+    void timerReady();
+
+    /**
+     * @brief Loop time in milliseconds from the monotonic clock.
+     */
+    uint64_t now();
+
+protected:
+    void scheduleWakeup(int32_t time);
+
+private:
+    class TimerHandler : public ZrtpIoHandler {
+    public:
+        explicit TimerHandler(ZrtpEpollLoop* loop): loop(loop) {}
+        void ioReady(uint32_t) { loop->timerReady(); }
+    private:
+        ZrtpEpollLoop* loop;
+    };
+
+    int epollFd;
+    int timerFd;
+    bool ownEpoll;
+    TimerHandler timerHandler;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPEPOLLLOOP_H_
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPEVENTLOOP_H_
+#define _ZRTPEVENTLOOP_H_
+
+/**
+ * @file ZrtpEventLoop.h
+ * @brief Run ZRTP timers and packet handling on an application event loop
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include <common/osSpecifics.h>
+#include <common/zrtpAllocator.h>
+
+class ZRtp;
+class ZrtpEventLoop;
+
+/**
+ * A ZRTP timer that runs on an application event loop.
+ *
+ * A ZRTP engine uses at most one timer at a time. The application keeps one
+ * ZrtpLoopTimer per engine and implements the timer methods of its
+ * ZrtpCallback with it:
+ *
+ * @code
+ * int32_t MyStream::activateTimer(int32_t time) { return timer.activate(time); }
+ * int32_t MyStream::cancelTimer()               { return timer.cancel(); }
+ * @endcode
+ *
+ * When the timer expires the loop calls timeout() on the loop thread. The
+ * default implementation calls ZRtp::processTimeout() of the engine set
+ * with setEngine().
+ *
+ * The loop reserves a slot in its timer queue when a timer is created, thus
+ * arming and cancelling a timer neither allocates memory nor takes a lock.
+ * All methods must be called on the thread that runs the loop, the loop
+ * must outlive its timers.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpLoopTimer {
+public:
+    /**
+     * @brief Create a timer for an event loop.
+     *
+     * @param loop the loop that runs the timer
+     */
+    explicit ZrtpLoopTimer(ZrtpEventLoop* loop);
+
+    /**
+     * Destructor, cancels the timer.
+     */
+    virtual ~ZrtpLoopTimer();
+
+    /**
+     * @brief Set the ZRTP engine that handles the timeouts.
+     *
+     * @param engine the engine, may be NULL
+     */
+    void setEngine(ZRtp* engine) { this->engine = engine; }
+
+    /**
+     * @brief Arm the timer, replaces a timer that is already armed.
+     *
+     * @param time timeout in milliseconds
+     * @return one, same as ZrtpCallback::activateTimer()
+     */
+    int32_t activate(int32_t time);
+
+    /**
+     * @brief Cancel the timer.
+     *
+     * @return one, same as ZrtpCallback::cancelTimer()
+     */
+    int32_t cancel();
+
+    /// True if the timer is armed
+    bool isActive() const { return heapIndex >= 0; }
+
+    /// The loop of this timer
+    ZrtpEventLoop* getLoop() const { return loop; }
+
+protected:
+    /**
+     * @brief The timer expired.
+     *
+     * The default implementation forwards the timeout to the ZRTP engine.
+     * The timer is not armed anymore when the loop calls this method, thus
+     * the method may arm it again.
+     */
+    virtual void timeout();
+
+private:
+    friend class ZrtpEventLoop;
+
+    ZrtpLoopTimer(const ZrtpLoopTimer& other);
+    ZrtpLoopTimer& operator=(const ZrtpLoopTimer& other);
+
+    ZrtpEventLoop* loop;
+    ZRtp* engine;
+    uint64_t deadline;      // loop time in ms when the timer expires
+    int32_t heapIndex;      // position in the timer heap of the loop, -1 if not armed
+};
+
+/**
+ * Timer queue of an application event loop.
+ *
+ * The queue keeps the armed ZrtpLoopTimer objects of all ZRTP sessions that
+ * run on one loop. It needs one native timer of the loop only: whenever the
+ * earliest deadline moves the queue calls scheduleWakeup(), and when the
+ * native timer fires the loop calls runTimers().
+ *
+ * A backend implements scheduleWakeup() for its loop. This file contains a
+ * backend for loops with C callbacks, ZrtpCallbackLoop, the library also
+ * has backends for epoll (ZrtpEpollLoop.h) and for asio style loops
+ * (ZrtpAsioLoop.h).
+ *
+ * Packet I/O needs no special support: when the loop thread feeds received
+ * packets to the ZRTP and SRTP functions and sends the packets in the
+ * ZrtpCallback::sendDataZRTP() method, then all ZRTP processing runs on
+ * the loop thread. Such an application does not need a mutex in
+ * ZrtpCallback::synchEnter() and ZrtpCallback::synchLeave().
+ *
+ * The queue is not thread safe, all methods must be called on the loop
+ * thread.
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpEventLoop {
+public:
+    ZrtpEventLoop();
+
+    virtual ~ZrtpEventLoop();
+
+    /**
+     * @brief Run the expired timers.
+     *
+     * The backend calls this method when the native timer fires. Calling it
+     * too early does no harm. After the expired timers ran the method calls
+     * scheduleWakeup() for the next deadline.
+     *
+     * @return number of timers that ran
+     */
+    int32_t runTimers();
+
+    /**
+     * @brief Time until the next timer expires.
+     *
+     * A loop that polls, for example with @c poll() or @c epoll_wait(), may
+     * use this value as its wait time instead of a native timer.
+     *
+     * @return milliseconds until the next timer expires, -1 if no timer
+     *         is armed
+     */
+    int32_t nextTimeout();
+
+    /// Number of armed timers
+    size_t getNumberOfTimers() const { return heap.size(); }
+
+    /**
+     * @brief Current loop time in milliseconds.
+     *
+     * The default implementation uses zrtpGetTickCount(). Backends
+     * override this to use a monotonic clock or the cached time of their
+     * loop.
+     */
+    virtual uint64_t now();
+
+protected:
+    /**
+     * @brief Ask the loop to call runTimers().
+     *
+     * The new request replaces an older one.
+     *
+     * @param time milliseconds until the loop shall call runTimers(), -1
+     *        if no timer is armed and the native timer may stop
+     */
+    virtual void scheduleWakeup(int32_t time) =0;
+
+private:
+    friend class ZrtpLoopTimer;
+
+    ZrtpEventLoop(const ZrtpEventLoop& other);
+    ZrtpEventLoop& operator=(const ZrtpEventLoop& other);
+
+    void addTimer();
+    void removeTimer() { numberOfTimers--; }
+    void startTimer(ZrtpLoopTimer* timer, int32_t time);
+    void stopTimer(ZrtpLoopTimer* timer);
+
+    void siftUp(int32_t index);
+    void siftDown(int32_t index);
+    void removeAt(int32_t index);
+    void setAt(int32_t index, ZrtpLoopTimer* timer) { heap[index] = timer; timer->heapIndex = index; }
+
+    ZrtpVector<ZrtpLoopTimer*> heap;    // binary min heap ordered by deadline
+    size_t numberOfTimers;              // timers of this loop, the heap has room for all of them
+    uint64_t wakeupAt;                  // deadline of the wakeup the backend knows, 0 if none
+    uint64_t runNow;                    // loop time of the current runTimers() call
+    bool running;
+};
+
+/**
+ * Event loop backend for loops with C style timer callbacks.
+ *
+ * The application provides a function that (re)starts or stops one native
+ * timer of its loop, and calls runTimers() when that timer fires. With
+ * libuv this looks like:
+ *
+ * @code
+ * static void onZrtpTimer(uv_timer_t* handle) {
+ *     static_cast<ZrtpCallbackLoop*>(handle->data)->runTimers();
+ * }
+ *
+ * static void scheduleZrtpTimer(void* context, int32_t time) {
+ *     uv_timer_t* handle = static_cast<uv_timer_t*>(context);
+ *     if (time < 0)
+ *         uv_timer_stop(handle);
+ *     else
+ *         uv_timer_start(handle, onZrtpTimer, time, 0);
+ * }
+ *
+ * uv_timer_init(uv_default_loop(), &zrtpTimer);
+ * ZrtpCallbackLoop zrtpLoop(scheduleZrtpTimer, &zrtpTimer);
+ * zrtpTimer.data = &zrtpLoop;
+ * @endcode
+ *
+ * @author Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZrtpCallbackLoop : public ZrtpEventLoop {
+public:
+    /**
+     * @brief Function that schedules the native timer.
+     *
+     * @param context the context given to the constructor
+     * @param time milliseconds until the loop shall call runTimers(), -1 to
+     *        stop the native timer
+     */
+    typedef void (*ScheduleFunction)(void* context, int32_t time);
+
+    /**
+     * @brief Create a loop backend.
+     *
+     * @param schedule function that schedules the native timer
+     * @param context context for the schedule function
+     */
+    ZrtpCallbackLoop(ScheduleFunction schedule, void* context): schedule(schedule), context(context) {}
+
+protected:
+    void scheduleWakeup(int32_t time) { schedule(context, time); }
+
+private:
+    ScheduleFunction schedule;
+    void* context;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPEVENTLOOP_H_
@@ -52,6 +52,42 @@
  */
 const uint16_t zrtpId = 0x505a;
 
+/**
+ * Number of bytes in front of a ZRTP message, reserved for the fixed ZRTP
+ * packet header (refer to RFC 6189, chapter 5).
+ */
+#define ZRTP_FRAME_HEADROOM  12
+
+/**
+ * Number of bytes behind the CRC field of a ZRTP message. A client that
+ * tunnels ZRTP packets via SRTP uses this room to store the SRTP tag.
+ */
+#define ZRTP_FRAME_TAILROOM  16
+
+/**
+ * Codes of the ZRTP message types, see ZrtpPacketBase::getMessageCode.
+ *
+ * The codes follow the order of the message type texts in ZrtpTextData.h.
+ */
+enum ZrtpMessageCode {
+    MsgUnknown = 0,
+    MsgHello, MsgHelloAck, MsgCommit, MsgDHPart1, MsgDHPart2, MsgConfirm1, MsgConfirm2, MsgConf2Ack,
+    MsgError, MsgErrorAck, MsgGoClear, MsgClearAck, MsgPing, MsgPingAck, MsgSasRelay, MsgRelayAck
+};
+
+/**
+ * Storage of a ZRTP message with head- and tailroom for the transport.
+ *
+ * The packet classes use this structure to hold the data of the messages
+ * they send. Thus a client can setup the fixed ZRTP packet header and the
+ * CRC around the message data and send the packet without copying it.
+ */
+template <typename T> struct ZrtpFrame {
+    uint8_t headroom[ZRTP_FRAME_HEADROOM];
+    T       message;
+    uint8_t tailroom[ZRTP_FRAME_TAILROOM];
+};
+
 /**
  * This is the base class for all ZRTP packets
  *
@@ -74,8 +110,11 @@ class __EXPORT ZrtpPacketBase {
   protected:
       void* allocated;                  ///< Pointer to ZRTP message data
       zrtpPacketHeader_t* zrtpHeader;   ///< points to the fixed ZRTP header structure
+      uint8_t* frameBase;               ///< points to the headroom in front of the message, NULL if no frame
 
   public:
+    ZrtpPacketBase() : allocated(NULL), zrtpHeader(NULL), frameBase(NULL) {};
+
     /**
      * Destructor is empty
      */
@@ -89,6 +128,19 @@ class __EXPORT ZrtpPacketBase {
      */
     const uint8_t* getHeaderBase() { return (const uint8_t*)zrtpHeader; };
 
+    /**
+     * Get pointer to the transport frame of this ZRTP message.
+     *
+     * The frame starts with @c ZRTP_FRAME_HEADROOM bytes, followed by the
+     * ZRTP message including its CRC field, followed by @c ZRTP_FRAME_TAILROOM
+     * bytes. Only packets that we create to send have a frame, packets that
+     * we create from received data don't have a frame.
+     *
+     * @return
+     *     Pointer to the frame or @c NULL.
+     */
+    uint8_t* getFrameBase()        { return frameBase; };
+
     /**
      * Check is this is a ZRTP message
      *
@@ -134,6 +186,19 @@ class __EXPORT ZrtpPacketBase {
      * Initializes the ZRTP Id field
      */
     void setZrtpId()              { zrtpHeader->zrtpId = zrtpHtons(zrtpId); }
+
+    /**
+     * Get the code of a message type.
+     *
+     * Compares the message type as one 64 bit word with the known types.
+     * The comparison is case sensitive.
+     *
+     * @param type
+     *     Pointer to the 8 byte message type
+     * @return
+     *     The message code, @c MsgUnknown if the type is unknown
+     */
+    static ZrtpMessageCode getMessageCode(const uint8_t* type);
 };
 
 /**
@@ -43,7 +43,7 @@ class __EXPORT ZrtpPacketClearAck : public ZrtpPacketBase {
     virtual ~ZrtpPacketClearAck();
 
  private:
-     ClearAckPacket_t data;
+     ZrtpFrame<ClearAckPacket_t> frame;
 };
 
 /**
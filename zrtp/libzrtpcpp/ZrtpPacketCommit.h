@@ -137,7 +137,7 @@ class __EXPORT ZrtpPacketCommit : public ZrtpPacketBase {
     void setHMACMulti(uint8_t* hash)   { memcpy(commitHeader->hmac-4*ZRTP_WORD_SIZE, hash, sizeof(commitHeader->hmac)); };
 
  private:
-     CommitPacket_t data;
+     ZrtpFrame<CommitPacket_t> frame;
 };
 
 /**
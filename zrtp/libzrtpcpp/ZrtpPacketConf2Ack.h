@@ -49,7 +49,7 @@ class __EXPORT ZrtpPacketConf2Ack : public ZrtpPacketBase {
     virtual ~ZrtpPacketConf2Ack();
 
  private:
-     Conf2AckPacket_t data;
+     ZrtpFrame<Conf2AckPacket_t> frame;
 };
 
 /**
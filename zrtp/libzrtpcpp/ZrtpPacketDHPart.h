@@ -112,7 +112,7 @@ class __EXPORT ZrtpPacketDHPart : public ZrtpPacketBase {
      // - 13 words fixed sizze
      // - up to 128 words variable part, depending on DH algorithm
      //   leads to a maximum of 4*141=564 bytes.
-     uint8_t data[768];       // large enough to hold a full blown DHPart packet
+     ZrtpFrame<uint8_t[768]> frame;       // large enough to hold a full blown DHPart packet
 };
 
 /**
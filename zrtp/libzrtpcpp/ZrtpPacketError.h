@@ -57,7 +57,7 @@ class __EXPORT ZrtpPacketError : public ZrtpPacketBase {
     void setErrorCode(uint32_t code) {errorHeader->errorCode = zrtpHtonl(code); };
 
  private:
-     ErrorPacket_t data;
+     ZrtpFrame<ErrorPacket_t> frame;
 };
 
 /**
@@ -46,7 +46,7 @@ class __EXPORT ZrtpPacketErrorAck : public ZrtpPacketBase {
     virtual ~ZrtpPacketErrorAck();
 
  private:
-     ErrorAckPacket_t data;
+     ZrtpFrame<ErrorAckPacket_t> frame;
 };
 
 /**
@@ -61,7 +61,7 @@ class __EXPORT ZrtpPacketGoClear : public ZrtpPacketBase {
     void clrClearHmac()              { memset(clearHeader->clearHmac, 0, 32); };
 
  private:
-     GoClearPacket_t data;
+     ZrtpFrame<GoClearPacket_t> frame;
 };
 
 /**
@@ -26,6 +26,7 @@
  */
 
 #include <libzrtpcpp/ZrtpPacketBase.h>
+#include <libzrtpcpp/ZrtpConfigProfile.h>
 
 #define HELLO_FIXED_PART_LEN  22
 
@@ -79,7 +80,18 @@ class __EXPORT ZrtpPacketHello : public ZrtpPacketBase {
      * @param config
      *    Pointer to ZrtpConfigure data.
      */
-    void configureHello(ZrtpConfigure* config);
+    void configureHello(const ZrtpConfigure* config);
+
+    /**
+     * Set configure data from a profile and populate Hello message data.
+     *
+     * Same as the ZrtpConfigure variant but copies the algorithm names
+     * that the profile rendered when it was compiled.
+     *
+     * @param profile
+     *    Pointer to the compiled configuration profile.
+     */
+    void configureHello(const ZrtpConfigProfile* profile);
 
     /// Get version number from Hello message, fixed ASCII character array
     uint8_t* getVersion()  { return helloHeader->version; };
@@ -184,12 +196,14 @@ class __EXPORT ZrtpPacketHello : public ZrtpPacketBase {
     bool isLengthOk()        {return (computedLength == getLength());}
 
  private:
+     void setupHello();
+
      uint32_t computedLength;
      // Hello packet is of variable length. It maximum size is 46 words:
      // - 20 words fixed sizze
      // - up to 35 words variable part, depending on number of algorithms
      // leads to a maximum of 4*55=220 bytes.
-     uint8_t data[256];       // large enough to hold a full blown Hello packet
+     ZrtpFrame<uint8_t[256]> frame;       // large enough to hold a full blown Hello packet
 };
 
 /**
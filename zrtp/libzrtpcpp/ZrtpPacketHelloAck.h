@@ -48,7 +48,7 @@ class __EXPORT ZrtpPacketHelloAck : public ZrtpPacketBase {
     virtual ~ZrtpPacketHelloAck();
 
  private:
-     HelloAckPacket_t data;
+     ZrtpFrame<HelloAckPacket_t> frame;
 };
 
 /**
@@ -55,7 +55,7 @@ class __EXPORT ZrtpPacketPing : public ZrtpPacketBase {
     uint8_t* getEpHash()               { return pingHeader->epHash; }
 
  private:
-     PingPacket_t data;
+     ZrtpFrame<PingPacket_t> frame;
 };
 
 /**
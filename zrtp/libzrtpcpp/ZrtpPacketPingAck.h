@@ -63,7 +63,7 @@ class __EXPORT ZrtpPacketPingAck : public ZrtpPacketBase {
     void setLocalEpHash(uint8_t *hash)  { memcpy(pingAckHeader->localEpHash, hash, sizeof(pingAckHeader->localEpHash)); }
 
  private:
-     PingAckPacket_t data;
+     ZrtpFrame<PingAckPacket_t> frame;
 };
 
 /**
@@ -46,7 +46,7 @@ class __EXPORT ZrtpPacketRelayAck : public ZrtpPacketBase {
     virtual ~ZrtpPacketRelayAck();
 
  private:
-     RelayAckPacket_t data;
+     ZrtpFrame<RelayAckPacket_t> frame;
 };
 
 /**
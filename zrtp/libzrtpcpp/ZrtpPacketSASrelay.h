@@ -103,7 +103,7 @@ class __EXPORT ZrtpPacketSASrelay : public ZrtpPacketBase {
      // - 11 words fixed size
      // - up to 513 words variable part, depending if signature is present and its length.
      // This leads to a maximum of 4*524=2096 bytes.
-        uint8_t data[2100];       // large enough to hold a full blown Confirm packet
+        ZrtpFrame<uint8_t[2100]> frame;       // large enough to hold a full blown Confirm packet
 
 };
 
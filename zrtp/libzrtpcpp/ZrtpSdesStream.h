@@ -84,6 +84,7 @@
  */
 
 #include <common/osSpecifics.h>
+#include <common/zrtpAllocator.h>
 #include <srtp/SrtpHandler.h>
 
 class CryptoContext;
@@ -104,6 +105,7 @@ class CryptoContextCtrl;
 class __EXPORT ZrtpSdesStream {
 
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT | ZRTP_MEM_SECRET)
 
     /**
      * Supported SDES crypto suites.
@@ -122,6 +122,7 @@ private:
     ZRtp* parent;           ///< The ZRTP implementation
     ZrtpStates* engine;     ///< The state switching engine
     Event* event;           ///< Current event to process
+    ZrtpMessageCode msgCode; ///< Message code of the current ZrtpPacket event
 
     /**
      * The last packet that was sent.
@@ -131,11 +132,6 @@ private:
      */
     ZrtpPacketBase* sentPacket;
 
-    /**
-     * Points to prepared Commit packet after receiving a Hello packet
-     */
-    ZrtpPacketCommit* commitPkt;
-
     zrtpTimer_t T1;         ///< The Hello message timeout timer
     zrtpTimer_t T2;         ///< Timeout timer for other messages
 
@@ -176,6 +172,8 @@ private:
     int32_t retryCounters[ErrorRetry+1];  // TODO adjust
 
 public:
+    ZRTP_MEM_OPERATORS(ZRTP_MEM_OBJECT)
+
     /// Create a ZrtpStateClass
     ZrtpStateClass(ZRtp *p);
     ~ZrtpStateClass();
@@ -184,7 +182,15 @@ public:
     bool inState(const int32_t state) { return engine->inState(state); };
 
     /// Switch to the specified state
-    void nextState(int32_t state)        { engine->nextState(state); };
+    void nextState(int32_t state) {
+        int32_t oldState = engine->getState();
+        engine->nextState(state);
+        if (ZrtpTrace::isActive())
+            parent->traceEvent(TraceState, 0, static_cast<uint32_t>(oldState));
+    };
+
+    /// Get the current state
+    int32_t getState() { return engine->getState(); };
 
     /// Process an event, the main entry point into the state engine
     void processEvent(Event *ev);
@@ -74,6 +74,9 @@ class __EXPORT ZrtpStates {
     /// Set the next state
     void nextState(int32_t s)        { state = s; }
 
+    /// Get the current state
+    int32_t getState() const         { return state; }
+
  private:
     const int32_t numStates;
     const state_t* states;
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2006 - 2018, Werner Dittmann
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPTRACE_H_
+#define _ZRTPTRACE_H_
+
+/**
+ * @file ZrtpTrace.h
+ * @brief Compact binary trace of the ZRTP handshake
+ *
+ * The trace records what the state engine does: packets sent and received,
+ * state switches, retransmissions, the negotiated algorithms and the final
+ * outcome. It never records packet contents or any key material.
+ *
+ * Each thread writes fixed size records into its own ring buffer without
+ * taking a lock. A background thread drains the rings and appends the
+ * records to the trace file. If a ring overflows the thread drops records
+ * and the drain writes a @c TraceDropped record instead, the handshake never
+ * waits for the trace file.
+ *
+ * The file starts with a @c ZrtpTraceHeader followed by @c ZrtpTraceRecord
+ * entries in host byte order. The @c zrtptrace tool in @c bench reads it.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include <common/osSpecifics.h>
+
+/**
+ * The trace event types.
+ */
+enum ZrtpTraceEvent {
+    TraceStart = 1,     ///< Engine started
+    TraceStop,          ///< Engine stopped
+    TracePacketSent,    ///< Packet sent, @c message and @c length are set
+    TracePacketRecv,    ///< Packet received, @c message and @c length are set
+    TraceState,         ///< State switch, @c state is the new state, @c data the old state
+    TraceRetransmit,    ///< Timer fired, @c retries holds the resend counter, @c data the next timeout in ms
+    TraceAlgorithm,     ///< Negotiated algorithm, @c message is the ZrtpTraceAlgo, @c data the 4 char name
+    TraceSecure,        ///< Secure state reached
+    TraceFailed,        ///< Negotiation failed, @c data holds severity << 16 | sub-code
+    TraceDropped,       ///< Records lost because of ring overflow, @c data holds the count
+    numberOfTraceEvents
+};
+
+/**
+ * Algorithm types of a @c TraceAlgorithm record.
+ */
+enum ZrtpTraceAlgo {
+    TraceHash = 0,
+    TraceCipher,
+    TraceAuthLength,
+    TracePubKey,
+    TraceSas,
+    numberOfTraceAlgos
+};
+
+/**
+ * The trace file header.
+ *
+ * The header has the same size as a record. @c endian holds @c 0x01020304
+ * written in the byte order of the host that wrote the trace.
+ */
+typedef struct ZrtpTraceHeader {
+    char     magic[4];          ///< "ZTRC"
+    uint16_t version;           ///< Trace format version
+    uint16_t recordSize;        ///< sizeof(ZrtpTraceRecord)
+    uint32_t endian;            ///< Byte order marker
+    uint32_t reserved;
+    uint64_t wallClockUs;       ///< Wall clock time in microseconds when the trace was opened
+} ZrtpTraceHeader_t;
+
+/**
+ * One trace record, 24 bytes.
+ */
+typedef struct ZrtpTraceRecord {
+    uint64_t timeUs;            ///< Monotonic time in microseconds since the trace was opened
+    uint32_t session;           ///< Trace id of the ZRtp instance
+    uint32_t data;              ///< Event specific data
+    uint16_t length;            ///< Packet length in bytes for packet events
+    uint8_t  event;             ///< ZrtpTraceEvent
+    uint8_t  state;             ///< State of the engine when the event happened
+    uint8_t  message;           ///< Message code, see ZrtpTrace::messageCode()
+    uint8_t  retries;           ///< Retry counter for retransmit events
+    uint8_t  role;              ///< Role enum: 0 not set, 1 Responder, 2 Initiator
+    uint8_t  flags;             ///< Bit 0: multi-stream mode
+} ZrtpTraceRecord_t;
+
+/**
+ * Process wide ZRTP handshake trace.
+ *
+ * All functions are static. Recording is cheap if tracing is not active:
+ * callers check @c isActive() before they build a record.
+ */
+class __EXPORT ZrtpTrace {
+public:
+    /// Trace file format version
+    static const uint16_t formatVersion = 1;
+
+    /// Number of records in each thread's ring buffer
+    static const uint32_t ringSize = 1024;
+
+    /**
+     * @brief Open a trace file and start the flush thread.
+     *
+     * The file is truncated if it exists.
+     *
+     * @param fileName name of the trace file
+     * @return true if the file was opened or tracing was already active
+     */
+    static bool open(const std::string& fileName);
+
+    /**
+     * @brief Stop tracing, write all pending records and close the file.
+     */
+    static void close();
+
+    /**
+     * @brief Check if tracing is active.
+     */
+    static bool isActive() { return active.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Record an event.
+     *
+     * The function fills in the time stamp. It does nothing if tracing
+     * is not active.
+     */
+    static void record(ZrtpTraceRecord_t& rec);
+
+    /**
+     * @brief Get a new trace id for a ZRtp instance.
+     */
+    static uint32_t newSession();
+
+    /**
+     * @brief Map an 8 character ZRTP message type to a message code.
+     *
+     * @return the message code, 0 if the type is unknown
+     */
+    static uint8_t messageCode(const uint8_t* type);
+
+    /// Name of a message code, "?" if unknown
+    static const char* messageName(uint8_t code);
+
+    /// Name of an event, "?" if unknown
+    static const char* eventName(uint8_t event);
+
+    /// Name of a state engine state, "?" if unknown
+    static const char* stateName(uint8_t state);
+
+    /// Name of an algorithm type, "?" if unknown
+    static const char* algoName(uint8_t algo);
+
+private:
+    static std::atomic<bool> active;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPTRACE_H_
@@ -359,6 +359,26 @@ typedef struct {
      * @param stmt a void pointer to a sqlite3 statement (SQL cursor)
      */
     void (*closeStatement)(void *vstmt);
+
+    /**
+     * @brief Start a transaction
+     *
+     * Updates until the next @c commitTransaction become visible together.
+     *
+     * @param db pointer to an open database
+     * @param errString Pointer to a character buffer, see text above
+     * @return 0 on success
+     */
+    int (*beginTransaction)(void *db, char* errString);
+
+    /**
+     * @brief Commit a transaction started with @c beginTransaction
+     *
+     * @param db pointer to an open database
+     * @param errString Pointer to a character buffer, see text above
+     * @return 0 on success
+     */
+    int (*commitTransaction)(void *db, char* errString);
 } dbCacheOps_t;
 
 void getDbCacheOps(dbCacheOps_t *ops);
@@ -51,10 +51,8 @@
 # define snprintf _snprintf
 #endif
 
-#ifdef TRANSACTIONS
 static const char *beginTransactionSql  = "BEGIN TRANSACTION;";
 static const char *commitTransactionSql = "COMMIT;";
-#endif
 
 /*
  * The database backend uses the following definitions if it implements the localZid storage.
@@ -215,9 +213,9 @@ static int b64Decode(const char *b64Data, int32_t b64length, uint8_t *binData, i
     return codelength;
 }
 
-#ifdef TRANSACTIONS
-static int beginTransaction(sqlite3 *db, char* errString)
+static int beginTransaction(void *vdb, char* errString)
 {
+    sqlite3 *db = (sqlite3*)vdb;
     sqlite3_stmt *stmt;
     int rc;
 
@@ -236,8 +234,9 @@ static int beginTransaction(sqlite3 *db, char* errString)
     return rc;
 }
 
-static int commitTransaction(sqlite3 *db, char* errString)
+static int commitTransaction(void *vdb, char* errString)
 {
+    sqlite3 *db = (sqlite3*)vdb;
     sqlite3_stmt *stmt;
     int rc;
 
@@ -255,7 +254,6 @@ static int commitTransaction(sqlite3 *db, char* errString)
     sqlite3_finalize(stmt);
     return rc;
 }
-#endif
 
 /**
  * Initialize remote ZID and remote name tables.
@@ -861,5 +859,8 @@ void getDbCacheOps(dbCacheOps_t *ops)
     ops->prepareReadAllZid = prepareReadAllZid;
     ops->readNextZidRecord = readNextZidRecord;
     ops->closeStatement = closeStatement;
+
+    ops->beginTransaction = beginTransaction;
+    ops->commitTransaction = commitTransaction;
 }
 